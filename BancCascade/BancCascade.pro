@@ -0,0 +1,40 @@
+#-------------------------------------------------
+#
+# Cascades internes contre detectMultiScale : fenêtres trouvées fenêtre par fenêtre et temps,
+# puis visage + sourire + yeux avec et sans partage des niveaux (ContexteDetection)
+# (voir ../ProjetSY25Berthelon_Bucheron/cascadehaar.h)
+#
+#-------------------------------------------------
+
+TEMPLATE = app
+TARGET = BancCascade
+CONFIG += console c++11
+CONFIG -= qt app_bundle
+
+INCLUDEPATH += ../ProjetSY25Berthelon_Bucheron
+
+SOURCES += main.cpp \
+    ../ProjetSY25Berthelon_Bucheron/detecteurvisage.cpp \
+    ../ProjetSY25Berthelon_Bucheron/estimateurexpression.cpp \
+    ../ProjetSY25Berthelon_Bucheron/noyauxpretraitement.cpp \
+    ../ProjetSY25Berthelon_Bucheron/cascadehaar.cpp \
+    ../ProjetSY25Berthelon_Bucheron/contextedetection.cpp \
+    ../ProjetSY25Berthelon_Bucheron/evaluateurcascade.cpp \
+    ../ProjetSY25Berthelon_Bucheron/noyauxcascade.cpp \
+    ../ProjetSY25Berthelon_Bucheron/mesurelatence.cpp
+
+HEADERS += ../ProjetSY25Berthelon_Bucheron/cascadehaar.h \
+    ../ProjetSY25Berthelon_Bucheron/contextedetection.h \
+    ../ProjetSY25Berthelon_Bucheron/evaluateurcascade.h \
+    ../ProjetSY25Berthelon_Bucheron/noyauxcascade.h \
+    ../ProjetSY25Berthelon_Bucheron/mesurelatence.h \
+    ../ProjetSY25Berthelon_Bucheron/detecteurvisage.h \
+    ../ProjetSY25Berthelon_Bucheron/estimateurexpression.h \
+    ../ProjetSY25Berthelon_Bucheron/noyauxpretraitement.h
+
+CONFIG += link_pkgconfig
+PKGCONFIG += opencv
+
+# Mêmes options de compilation que l'application pour les noyaux vectorisés et les cascades internes.
+contains(QMAKE_HOST.arch, armv7l): QMAKE_CXXFLAGS += -mfpu=neon-vfpv4
+QMAKE_CXXFLAGS += -ffp-contract=off
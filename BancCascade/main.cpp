@@ -0,0 +1,375 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Cascade interne (../ProjetSY25Berthelon_Bucheron/cascadehaar.h) contre cv::CascadeClassifier::detectMultiScale,
+ * sur les mêmes images et les mêmes réglages.
+ *
+ * Les deux sont lancés sans regroupement (voisins minimum 0) : les rectangles rendus sont alors les fenêtres acceptées
+ * par la cascade, une par une. Pour chaque image et chaque réglage (facteur d'échelle x taille minimum), l'outil compte
+ * les fenêtres trouvées par les deux, les fenêtres manquantes et en trop de la cascade interne, et donne le temps médian
+ * (ms) de chacun sur --iterations passages : pyramide comprise des deux côtés (nouveau contexte à chaque passage pour
+ * la cascade interne), un seul thread pour OpenCV (--threads pour changer).
+ *
+ * Visage + sourire + yeux (tableau suivant, sauf --fenetres) : le traitement d'une image de detectFace(), avec les réglages
+ * de l'application au niveau de qualité 0 (ReglagesDetection) : plus grand visage, puis sourire sur le visage et chaque oeil
+ * sur une moitié. Trois façons, temps médians (ms) :
+ *  - opencv : un detectMultiScale par cascade, chacun construit sa pyramide et ses intégrales ;
+ *  - séparés : cascades internes, un contexte par cascade (pyramide recalculée pour chacune sur ce qu'elle parcourt,
+ *    moitié du visage pour les yeux, comme opencv) ;
+ *  - partagé : cascades internes sur un seul contexte, comme l'application : le sourire et les yeux reprennent les niveaux
+ *    déjà calculés pour le visage ou l'un pour l'autre (contextedetection.h).
+ * La différence entre séparés et partagé est le gain du partage des niveaux ; les niveaux calculés et réutilisés par image
+ * sont donnés par ContexteDetection::rapportTemps(). Les résultats (visage, sourire, yeux) des trois sont comparés.
+ *
+ * Les images sont lues en niveaux de gris et égalisées comme l'image de détection de l'application.
+ * Les temps sont ceux de la machine : à lancer sur la raspi pour le noyau NEON.
+ *
+ * Code de retour : 0 si toutes les fenêtres sont les mêmes (et les résultats de séparés et partagé), 2 sinon.
+ *
+ * Utilisation : BancCascade [options] <image> [image ...]
+ *   --cascade fichier : cascade comparée (défaut haarcascade_frontalface_default.xml du dossier des cascades)
+ *   --cascades dossier : dossier des cascades d'OpenCV (défaut /usr/share/opencv/haarcascades)
+ *   --facteurs f1,f2... (défaut 1.1,1.2,1.3), --tailles t1,t2... : taille minimum en px (défaut 30,60,90)
+ *   --iterations n (défaut 10), --threads n (défaut 1)
+ *   --fenetres : comparaison des fenêtres seulement (pas de visage + sourire + yeux)
+ */
+#include "cascadehaar.h"
+#include "contextedetection.h"
+#include "detecteurvisage.h" // ReglagesDetection, plusGrand()
+#include "mesurelatence.h"
+
+#include "opencv2/core/core.hpp"
+#include "opencv2/imgcodecs/imgcodecs.hpp"
+#include "opencv2/imgproc/imgproc.hpp"
+#include "opencv2/objdetect/objdetect.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace cv;
+
+struct Options {
+    std::string dossierCascades = "/usr/share/opencv/haarcascades";
+    std::string cascade;
+    std::vector<double> facteurs;
+    std::vector<int> tailles;
+    int iterations = 10;
+    int threads = 1;
+    bool fenetresSeulement = false;
+    std::vector<std::string> images;
+};
+
+// Cascades du traitement d'une image : visage, sourire, oeil gauche, oeil droit.
+static const char *FICHIERS_CASCADES[4] = { "haarcascade_frontalface_default.xml", "haarcascade_smile.xml",
+                                            "haarcascade_lefteye_2splits.xml", "haarcascade_righteye_2splits.xml" };
+
+struct ResultatImage {
+    Rect visage; // vide : pas de visage
+    bool sourire = false;
+    bool oeilGauche = false;
+    bool oeilDroit = false;
+};
+
+static bool operator==(const ResultatImage &a, const ResultatImage &b)
+{
+    return a.visage == b.visage && a.sourire == b.sourire && a.oeilGauche == b.oeilGauche && a.oeilDroit == b.oeilDroit;
+}
+
+static bool plusPetit(const Rect &a, const Rect &b)
+{
+    if (a.x != b.x) return a.x < b.x;
+    if (a.y != b.y) return a.y < b.y;
+    if (a.width != b.width) return a.width < b.width;
+    return a.height < b.height;
+}
+
+/*
+ * Fenêtres de "a" absentes de "b" (les deux triés).
+ */
+static int absentes(const std::vector<Rect> &a, const std::vector<Rect> &b)
+{
+    std::vector<Rect> difference;
+    std::set_difference(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(difference), plusPetit);
+    return (int)difference.size();
+}
+
+static double mediane(std::vector<double> temps)
+{
+    if (temps.empty())
+        return 0;
+    std::sort(temps.begin(), temps.end());
+    return temps[temps.size() / 2];
+}
+
+static bool lireListe(const char *texte, std::vector<double> &valeurs)
+{
+    std::stringstream flux(texte);
+    std::string element;
+    valeurs.clear();
+    while (std::getline(flux, element, ','))
+        valeurs.push_back(atof(element.c_str()));
+    return !valeurs.empty();
+}
+
+static void usage()
+{
+    fprintf(stderr, "Utilisation : BancCascade [--cascade fichier] [--cascades dossier] [--facteurs f1,f2...] [--tailles t1,t2...]\n"
+                    "                          [--iterations n] [--threads n] [--fenetres] <image> [image ...]\n");
+}
+
+static bool lireOptions(int argc, char **argv, Options &o)
+{
+    lireListe("1.1,1.2,1.3", o.facteurs);
+    std::vector<double> tailles;
+    lireListe("30,60,90", tailles);
+    for (int i = 1; i < argc; i++){
+        std::string a = argv[i];
+        bool valeur = i + 1 < argc;
+        if (a == "--cascade" && valeur) o.cascade = argv[++i];
+        else if (a == "--cascades" && valeur) o.dossierCascades = argv[++i];
+        else if (a == "--facteurs" && valeur){ if (!lireListe(argv[++i], o.facteurs)) return false; }
+        else if (a == "--tailles" && valeur){ if (!lireListe(argv[++i], tailles)) return false; }
+        else if (a == "--iterations" && valeur) o.iterations = std::max(atoi(argv[++i]), 1);
+        else if (a == "--threads" && valeur) o.threads = atoi(argv[++i]);
+        else if (a == "--fenetres") o.fenetresSeulement = true;
+        else if (a[0] == '-') return false;
+        else o.images.push_back(a);
+    }
+    for (size_t i = 0; i < tailles.size(); i++)
+        o.tailles.push_back((int)tailles[i]);
+    if (o.cascade.empty())
+        o.cascade = o.dossierCascades + "/haarcascade_frontalface_default.xml";
+    return !o.images.empty();
+}
+
+/*
+ * Fenêtres de la cascade interne et de detectMultiScale, image par image et réglage par réglage.
+ * Retourne le nombre de cas différents, -1 si la cascade n'est pas lisible.
+ */
+static int comparerFenetres(const Options &options, const std::vector<Mat> &images)
+{
+    CascadeClassifier reference;
+    CascadeHaar interne;
+    if (!reference.load(options.cascade) || !interne.charger(options.cascade)){
+        fprintf(stderr, "%s : cascade illisible (format BOOST + HAAR attendu)\n", options.cascade.c_str());
+        return -1;
+    }
+    printf("%s : %d étages, noyau %s\n", options.cascade.c_str(), (int)interne.modele().etages.size(),
+           interne.estVectorisee() ? "vectorisé" : "scalaire (EvaluateurCascade)");
+    printf("%-24s %7s %6s | %8s %8s %9s %7s | %9s %9s %7s\n", "image", "facteur", "taille", "opencv", "interne",
+           "manquantes", "en trop", "opencv ms", "interne ms", "gain");
+
+    int erreurs = 0;
+    double totalReference = 0, totalInterne = 0;
+    for (size_t i = 0; i < images.size(); i++){
+        const Mat &image = images[i];
+        Rect entiere(0, 0, image.cols, image.rows);
+        std::string nom = options.images[i].substr(options.images[i].find_last_of('/') + 1);
+
+        for (size_t f = 0; f < options.facteurs.size(); f++){
+            for (size_t t = 0; t < options.tailles.size(); t++){
+                double facteur = options.facteurs[f];
+                Size tailleMin(options.tailles[t], options.tailles[t]);
+                std::vector<Rect> fenetresReference, fenetresInterne;
+                std::vector<double> tempsReference, tempsInterne;
+                for (int k = 0; k < options.iterations; k++){
+                    uint64_t debut = MesureLatence::horloge();
+                    reference.detectMultiScale(image, fenetresReference, facteur, 0, CASCADE_SCALE_IMAGE, tailleMin);
+                    uint64_t milieu = MesureLatence::horloge();
+                    ContexteDetection contexte; // pyramide recalculée, comme pour une nouvelle image.
+                    contexte.nouvelleImage(image);
+                    interne.detecter(contexte, entiere, entiere, fenetresInterne, facteur, 0, tailleMin);
+                    uint64_t fin = MesureLatence::horloge();
+                    tempsReference.push_back((milieu - debut) / 1000.);
+                    tempsInterne.push_back((fin - milieu) / 1000.);
+                }
+
+                std::sort(fenetresReference.begin(), fenetresReference.end(), plusPetit);
+                std::sort(fenetresInterne.begin(), fenetresInterne.end(), plusPetit);
+                int manquantes = absentes(fenetresReference, fenetresInterne);
+                int enTrop = absentes(fenetresInterne, fenetresReference);
+                erreurs += manquantes + enTrop > 0;
+
+                double msReference = mediane(tempsReference), msInterne = mediane(tempsInterne);
+                totalReference += msReference;
+                totalInterne += msInterne;
+                printf("%-24.24s %7.2f %6d | %8d %8d %9d %7d | %9.2f %9.2f %6.2fx\n", nom.c_str(), facteur, tailleMin.width,
+                       (int)fenetresReference.size(), (int)fenetresInterne.size(), manquantes, enTrop,
+                       msReference, msInterne, msInterne > 0 ? msReference / msInterne : 0.);
+            }
+        }
+    }
+    printf("total : opencv %.1f ms, interne %.1f ms (somme des médianes)\n", totalReference, totalInterne);
+    if (erreurs > 0){
+        printf("%d cas avec des fenêtres différentes\n", erreurs);
+    } else {
+        printf("fenêtres identiques dans tous les cas\n");
+    }
+    return erreurs;
+}
+
+/*
+ * Visage + sourire + yeux par detectMultiScale, comme DetecteurVisage sans les cascades internes.
+ */
+static ResultatImage traiterOpenCV(CascadeClassifier cascades[4], const Mat &image, const ReglagesDetection &r)
+{
+    ResultatImage resultat;
+    std::vector<Rect> objets;
+    cascades[0].detectMultiScale(image, objets, r.facteurEchelle, r.voisinsVisage, CASCADE_SCALE_IMAGE,
+                                 Size(r.tailleMinVisage, r.tailleMinVisage));
+    int indice = DetecteurVisage::plusGrand(objets);
+    if (indice < 0)
+        return resultat;
+    Rect visage = objets[indice];
+    resultat.visage = visage;
+    Mat zone = image(visage);
+    cascades[1].detectMultiScale(zone, objets, r.facteurSourire, r.voisinsSourire);
+    resultat.sourire = !objets.empty();
+    cascades[2].detectMultiScale(zone(Rect(0, 0, visage.width/2 - 1, visage.height - 1)), objets, r.facteurYeux, r.voisinsYeux, 0);
+    resultat.oeilGauche = !objets.empty();
+    cascades[3].detectMultiScale(zone(Rect(visage.width/2, 0, visage.width/2 - 1, visage.height - 1)), objets, r.facteurYeux, r.voisinsYeux, 0);
+    resultat.oeilDroit = !objets.empty();
+    return resultat;
+}
+
+/*
+ * Visage + sourire + yeux par les cascades internes, comme DetecteurVisage : contextes[i] sert à la cascade i
+ * (quatre fois le même contexte pour le partage). Sans partage, la pyramide de chaque oeil ne couvre que sa moitié
+ * du visage, comme le detectMultiScale sur la moitié qu'elle remplace ; avec, c'est celle du visage, commune au sourire.
+ */
+static ResultatImage traiterInternes(CascadeHaar cascades[4], ContexteDetection *contextes[4], const Mat &image, const ReglagesDetection &r)
+{
+    ResultatImage resultat;
+    std::vector<Rect> objets;
+    Rect entiere(0, 0, image.cols, image.rows);
+    for (int c = 0; c < 4; c++){
+        if (c == 0 || contextes[c] != contextes[c - 1])
+            contextes[c]->nouvelleImage(image);
+    }
+    cascades[0].detecter(*contextes[0], entiere, entiere, objets, r.facteurEchelle, r.voisinsVisage,
+                         Size(r.tailleMinVisage, r.tailleMinVisage));
+    int indice = DetecteurVisage::plusGrand(objets);
+    if (indice < 0)
+        return resultat;
+    Rect visage = objets[indice];
+    resultat.visage = visage;
+    Rect moitieGauche(visage.x, visage.y, visage.width/2 - 1, visage.height - 1);
+    Rect moitieDroite(visage.x + visage.width/2, visage.y, visage.width/2 - 1, visage.height - 1);
+    bool partage = contextes[2] == contextes[1];
+    cascades[1].detecter(*contextes[1], visage, visage, objets, r.facteurSourire, r.voisinsSourire);
+    resultat.sourire = !objets.empty();
+    cascades[2].detecter(*contextes[2], partage ? visage : moitieGauche, moitieGauche, objets, r.facteurYeux, r.voisinsYeux);
+    resultat.oeilGauche = !objets.empty();
+    cascades[3].detecter(*contextes[3], partage ? visage : moitieDroite, moitieDroite, objets, r.facteurYeux, r.voisinsYeux);
+    resultat.oeilDroit = !objets.empty();
+    return resultat;
+}
+
+static void afficherResultat(const ResultatImage &r, char *texte, size_t taille)
+{
+    if (r.visage.area() == 0)
+        snprintf(texte, taille, "-");
+    else
+        snprintf(texte, taille, "%dx%d %c%c%c", r.visage.width, r.visage.height, r.sourire ? 'S' : '.', r.oeilGauche ? 'G' : '.', r.oeilDroit ? 'D' : '.');
+}
+
+/*
+ * Visage + sourire + yeux : detectMultiScale par cascade, cascades internes séparées, cascades internes partageant
+ * un contexte. Retourne le nombre d'images où séparé et partagé diffèrent, -1 si une cascade n'est pas lisible.
+ */
+static int comparerExpression(const Options &options, const std::vector<Mat> &images)
+{
+    CascadeClassifier opencv[4];
+    CascadeHaar internes[4];
+    for (int c = 0; c < 4; c++){
+        std::string chemin = options.dossierCascades + "/" + FICHIERS_CASCADES[c];
+        if (!opencv[c].load(chemin) || !internes[c].charger(chemin)){
+            fprintf(stderr, "%s : cascade illisible\n", chemin.c_str());
+            return -1;
+        }
+    }
+    ReglagesDetection reglages;
+    ContexteDetection separes[4];
+    ContexteDetection partage;
+    ContexteDetection *contextesSepares[4] = { &separes[0], &separes[1], &separes[2], &separes[3] };
+    ContexteDetection *contextesPartage[4] = { &partage, &partage, &partage, &partage };
+
+    printf("\nvisage + sourire + yeux (facteurs %.2f / %.2f / %.2f, taille min %d) : temps médians en ms, "
+           "résultat : taille du visage, S sourire, G D yeux\n", reglages.facteurEchelle, reglages.facteurSourire,
+           reglages.facteurYeux, reglages.tailleMinVisage);
+    printf("%-24s | %9s %9s %9s %8s | %-14s %-14s %s\n", "image", "opencv", "separes", "partage", "partage",
+           "opencv", "internes", "");
+    printf("%-24s | %9s %9s %9s %8s |\n", "", "", "", "", "/separes");
+
+    int erreurs = 0;
+    for (size_t i = 0; i < images.size(); i++){
+        std::string nom = options.images[i].substr(options.images[i].find_last_of('/') + 1);
+        std::vector<double> tempsOpenCV, tempsSepares, tempsPartage;
+        ResultatImage resultatOpenCV, resultatSepares, resultatPartage;
+        for (int k = 0; k < options.iterations; k++){
+            uint64_t t0 = MesureLatence::horloge();
+            resultatOpenCV = traiterOpenCV(opencv, images[i], reglages);
+            uint64_t t1 = MesureLatence::horloge();
+            resultatSepares = traiterInternes(internes, contextesSepares, images[i], reglages);
+            uint64_t t2 = MesureLatence::horloge();
+            resultatPartage = traiterInternes(internes, contextesPartage, images[i], reglages);
+            uint64_t t3 = MesureLatence::horloge();
+            tempsOpenCV.push_back((t1 - t0) / 1000.);
+            tempsSepares.push_back((t2 - t1) / 1000.);
+            tempsPartage.push_back((t3 - t2) / 1000.);
+        }
+        bool identiques = resultatSepares == resultatPartage;
+        erreurs += !identiques;
+
+        char texteOpenCV[32], texteInternes[32];
+        afficherResultat(resultatOpenCV, texteOpenCV, sizeof(texteOpenCV));
+        afficherResultat(resultatPartage, texteInternes, sizeof(texteInternes));
+        double msSepares = mediane(tempsSepares), msPartage = mediane(tempsPartage);
+        printf("%-24.24s | %9.2f %9.2f %9.2f %7.0f%% | %-14s %-14s %s\n", nom.c_str(), mediane(tempsOpenCV), msSepares, msPartage,
+               msSepares > 0 ? 100. * msPartage / msSepares : 0., texteOpenCV, texteInternes,
+               identiques ? "" : "séparés et partagé diffèrent");
+    }
+
+    // niveaux calculés et réutilisés par image, avec et sans partage.
+    printf("partagé  : %s\n", partage.rapportTemps().c_str());
+    for (int c = 0; c < 4; c++)
+        printf("séparé %d : %s\n", c, separes[c].rapportTemps().c_str());
+    return erreurs;
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!lireOptions(argc, argv, options)){
+        usage();
+        return 1;
+    }
+    setNumThreads(options.threads);
+
+    std::vector<Mat> images;
+    for (size_t i = 0; i < options.images.size(); i++){
+        Mat image = imread(options.images[i], IMREAD_GRAYSCALE);
+        if (image.empty()){
+            fprintf(stderr, "%s : image illisible\n", options.images[i].c_str());
+            return 1;
+        }
+        equalizeHist(image, image);
+        images.push_back(image);
+    }
+
+    int erreurs = comparerFenetres(options, images);
+    if (erreurs < 0)
+        return 1;
+    if (!options.fenetresSeulement){
+        int differences = comparerExpression(options, images);
+        if (differences < 0)
+            return 1;
+        erreurs += differences;
+    }
+    return erreurs > 0 ? 2 : 0;
+}
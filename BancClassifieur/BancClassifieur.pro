@@ -0,0 +1,30 @@
+#-------------------------------------------------
+#
+# Classifieur d'expression int8 : noyaux vectorisés (NEON / SSE2 / AVX2) contre la référence scalaire, couche par couche,
+# temps de chaque couche, et refus des fichiers de poids malformés
+# (voir ../ProjetSY25Berthelon_Bucheron/classifieurexpression.h)
+#
+#-------------------------------------------------
+
+TEMPLATE = app
+TARGET = BancClassifieur
+CONFIG += console c++11
+CONFIG -= qt app_bundle
+
+INCLUDEPATH += ../ProjetSY25Berthelon_Bucheron
+
+SOURCES += main.cpp \
+    ../ProjetSY25Berthelon_Bucheron/classifieurexpression.cpp \
+    ../ProjetSY25Berthelon_Bucheron/noyauxint8.cpp \
+    ../ProjetSY25Berthelon_Bucheron/mesurelatence.cpp
+
+HEADERS += ../ProjetSY25Berthelon_Bucheron/classifieurexpression.h \
+    ../ProjetSY25Berthelon_Bucheron/estimateurexpression.h \
+    ../ProjetSY25Berthelon_Bucheron/noyauxint8.h \
+    ../ProjetSY25Berthelon_Bucheron/mesurelatence.h
+
+CONFIG += link_pkgconfig
+PKGCONFIG += opencv
+
+# Mêmes options de compilation que l'application pour les noyaux vectorisés.
+contains(QMAKE_HOST.arch, armv7l): QMAKE_CXXFLAGS += -mfpu=neon-vfpv4
@@ -0,0 +1,420 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Vérification et temps du classifieur d'expression int8 (../ProjetSY25Berthelon_Bucheron/classifieurexpression.h).
+ *
+ * Noyaux (noyauxint8.h) : produit scalaire et max pooling 2x2 vectorisés comparés à la référence scalaire sur des vecteurs
+ * et des images tirés au hasard, plus les extrêmes (-128 partout, 127 partout) qui chargent les accumulateurs au maximum,
+ * pour plusieurs longueurs et nombres de canaux ; temps médian de chacun (µs).
+ *
+ * Couches : un réseau de la forme prévue (entrée 48x48, trois convolutions 3x3 de 8, 16 et 32 canaux suivies d'un max
+ * pooling, puis une couche dense de 7 classes) est écrit avec des poids tirés au hasard dans --dossier, chargé par
+ * ClassifieurExpression, et chaque couche est comparée entre la passe vectorisée et la passe de référence (setReference())
+ * sur --entrees entrées au hasard et les deux entrées extrêmes. Puis temps moyen de chaque couche (µs) dans les deux passes,
+ * sur --iterations inférences. Avec --modele, le même travail sur un vrai fichier de poids.
+ *
+ * Fichiers malformés : en-têtes et descripteurs dont les tailles débordent (positions et nombres de sorties proches de 2^32
+ * ou 2^64, dimensions nulles ou énormes) : charger() doit les refuser.
+ *
+ * Les temps sont ceux de la machine : à lancer sur la raspi pour le noyau NEON.
+ * Code de retour : 0 si tout est identique et tous les fichiers malformés refusés, 2 sinon.
+ *
+ * Utilisation : BancClassifieur [--modele fichier] [--dossier d] [--entrees n] [--iterations n] [--graine g]
+ */
+#include "classifieurexpression.h"
+#include "mesurelatence.h"
+#include "noyauxint8.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+struct Options {
+    std::string modele;
+    std::string dossier = "/tmp";
+    int entrees = 20;
+    int iterations = 200;
+    uint32_t graine = 1;
+};
+
+// Description d'une couche du réseau synthétique.
+struct CoucheEssai {
+    TypeCouche type;
+    uint32_t sorties;
+    bool maxPool;
+    bool relu;
+};
+
+static int nbErreurs = 0;
+
+/*
+ * Générateur reproductible (xorshift).
+ */
+struct Aleatoire {
+    uint32_t etat;
+    explicit Aleatoire(uint32_t graine) : etat(graine * 2654435761u + 1) {}
+    uint32_t suivant()
+    {
+        etat ^= etat << 13;
+        etat ^= etat >> 17;
+        etat ^= etat << 5;
+        return etat;
+    }
+    int8_t octet() { return (int8_t)(suivant() >> 24); }
+};
+
+static double mediane(std::vector<double> temps)
+{
+    if (temps.empty())
+        return 0;
+    std::sort(temps.begin(), temps.end());
+    return temps[temps.size() / 2];
+}
+
+/*
+ * Remplit "v" au hasard, ou avec une valeur extrême (mode 1 : -128, mode 2 : 127).
+ */
+static void remplir(std::vector<int8_t> &v, Aleatoire &alea, int mode)
+{
+    for (size_t i = 0; i < v.size(); i++)
+        v[i] = mode == 1 ? -128 : (mode == 2 ? 127 : alea.octet());
+}
+
+static void verifierProduitScalaire(Aleatoire &alea, int iterations)
+{
+    const int longueurs[] = { 16, 32, 144, 288, 1024, 4608, 17, 31 }; // 9 x 16 et 9 x 32 : patchs des convolutions.
+    printf("\nproduit scalaire (%s)\n%8s %10s %12s %12s %8s\n", jeuInstructionsInt8(), "longueur", "resultat", "vectorise us",
+           "reference us", "gain");
+    for (size_t l = 0; l < sizeof(longueurs) / sizeof(longueurs[0]); l++){
+        int n = longueurs[l];
+        std::vector<int8_t> a(n), b(n);
+        int differences = 0;
+        for (int essai = 0; essai < 100; essai++){
+            int mode = essai < 3 ? essai : 0; // -128 x -128 : le plus grand produit ; 127 x 127.
+            remplir(a, alea, mode);
+            remplir(b, alea, mode);
+            differences += produitScalaireInt8(a.data(), b.data(), n) != produitScalaireInt8Reference(a.data(), b.data(), n);
+        }
+        nbErreurs += differences;
+
+        // Temps sur un lot d'appels (un appel seul est trop court pour l'horloge).
+        const int appels = 1000;
+        std::vector<double> tempsVectorise, tempsReference;
+        volatile int32_t puits = 0;
+        for (int k = 0; k < iterations; k++){
+            uint64_t t0 = MesureLatence::horloge();
+            for (int j = 0; j < appels; j++)
+                puits = puits + produitScalaireInt8(a.data(), b.data(), n);
+            uint64_t t1 = MesureLatence::horloge();
+            for (int j = 0; j < appels; j++)
+                puits = puits + produitScalaireInt8Reference(a.data(), b.data(), n);
+            uint64_t t2 = MesureLatence::horloge();
+            tempsVectorise.push_back((double)(t1 - t0) / appels);
+            tempsReference.push_back((double)(t2 - t1) / appels);
+        }
+        double vectorise = mediane(tempsVectorise), reference = mediane(tempsReference);
+        printf("%8d %10s %12.4f %12.4f %7.2fx\n", n, differences == 0 ? "identique" : "DIFFERENT", vectorise, reference,
+               vectorise > 0 ? reference / vectorise : 0.);
+    }
+}
+
+static void verifierMaxPool(Aleatoire &alea, int iterations)
+{
+    const int tailles[][3] = { { 48, 48, 8 }, { 24, 24, 16 }, { 12, 12, 32 }, { 7, 5, 16 }, { 2, 2, 48 }, { 9, 9, 3 } };
+    printf("\nmax pooling 2x2 (%s ; canaux non multiples de 16 : référence)\n%-10s %10s %12s %12s %8s\n",
+           jeuInstructionsInt8(), "entree", "resultat", "vectorise us", "reference us", "gain");
+    for (size_t t = 0; t < sizeof(tailles) / sizeof(tailles[0]); t++){
+        int largeur = tailles[t][0], hauteur = tailles[t][1], canaux = tailles[t][2];
+        std::vector<int8_t> entree(largeur * hauteur * canaux);
+        std::vector<int8_t> vectorise((largeur / 2) * (hauteur / 2) * canaux + 1), reference(vectorise.size());
+        int differences = 0;
+        for (int essai = 0; essai < 20; essai++){
+            remplir(entree, alea, essai < 3 ? essai : 0);
+            std::fill(vectorise.begin(), vectorise.end(), 0);
+            std::fill(reference.begin(), reference.end(), 0);
+            maxPool2x2Int8(entree.data(), vectorise.data(), largeur, hauteur, canaux);
+            maxPool2x2Int8Reference(entree.data(), reference.data(), largeur, hauteur, canaux);
+            differences += vectorise != reference; // le dernier octet vérifie aussi qu'aucun n'écrit au delà de la sortie.
+        }
+        nbErreurs += differences;
+
+        const int appels = 100;
+        std::vector<double> tempsVectorise, tempsReference;
+        for (int k = 0; k < iterations; k++){
+            uint64_t t0 = MesureLatence::horloge();
+            for (int j = 0; j < appels; j++)
+                maxPool2x2Int8(entree.data(), vectorise.data(), largeur, hauteur, canaux);
+            uint64_t t1 = MesureLatence::horloge();
+            for (int j = 0; j < appels; j++)
+                maxPool2x2Int8Reference(entree.data(), reference.data(), largeur, hauteur, canaux);
+            uint64_t t2 = MesureLatence::horloge();
+            tempsVectorise.push_back((double)(t1 - t0) / appels);
+            tempsReference.push_back((double)(t2 - t1) / appels);
+        }
+        char nom[32];
+        snprintf(nom, sizeof(nom), "%dx%dx%d", largeur, hauteur, canaux);
+        double v = mediane(tempsVectorise), r = mediane(tempsReference);
+        printf("%-10s %10s %12.3f %12.3f %7.2fx\n", nom, differences == 0 ? "identique" : "DIFFERENT", v, r, v > 0 ? r / v : 0.);
+    }
+}
+
+/*
+ * Ecrit un fichier de poids au format de classifieurexpression.h, poids et biais tirés au hasard.
+ * Le décalage de chaque couche ramène l'écart type de l'accumulateur vers une trentaine, pour que les sorties
+ * ne soient ni toutes saturées ni toutes nulles.
+ */
+static bool ecrireModele(const std::string &chemin, int largeur, int hauteur, const std::vector<CoucheEssai> &description,
+                         Aleatoire &alea)
+{
+    EnTeteModele entete;
+    memset(&entete, 0, sizeof(entete));
+    entete.magie = MAGIE_MODELE_CNN8;
+    entete.version = VERSION_MODELE_CNN8;
+    entete.nbCouches = description.size();
+    entete.largeurEntree = largeur;
+    entete.hauteurEntree = hauteur;
+    entete.canauxEntree = 1;
+
+    std::vector<DescripteurCouche> couches(description.size());
+    std::vector<uint8_t> donnees(sizeof(EnTeteModele) + description.size() * sizeof(DescripteurCouche));
+    uint32_t canaux = 1;
+    for (size_t i = 0; i < description.size(); i++){
+        DescripteurCouche &c = couches[i];
+        memset(&c, 0, sizeof(c));
+        c.type = description[i].type;
+        c.entrees = c.type == COUCHE_CONVOLUTION_3X3 ? canaux : largeur * hauteur * canaux;
+        c.sorties = description[i].sorties;
+        c.maxPool = description[i].maxPool;
+        c.relu = description[i].relu;
+        int longueur = longueurAlignee(c.type == COUCHE_CONVOLUTION_3X3 ? 9 * c.entrees : c.entrees);
+        c.multiplicateur = 1;
+        c.decalage = (int)std::lround(std::log2(128.0 * 74 * std::sqrt((double)longueur) / 30));
+
+        donnees.resize((donnees.size() + ALIGNEMENT_INT8 - 1) / ALIGNEMENT_INT8 * ALIGNEMENT_INT8);
+        c.positionPoids = donnees.size();
+        for (int k = 0; k < (int)c.sorties * longueur; k++){
+            int colonne = k % longueur;
+            // complément d'alignement à zéro, comme dans un vrai fichier (il ne change rien au résultat).
+            bool utile = c.type == COUCHE_CONVOLUTION_3X3 ? colonne < 9 * (int)c.entrees : colonne < (int)c.entrees;
+            donnees.push_back(utile ? (uint8_t)alea.octet() : 0);
+        }
+        donnees.resize((donnees.size() + 3) / 4 * 4);
+        c.positionBiais = donnees.size();
+        for (uint32_t k = 0; k < c.sorties; k++){
+            int32_t biais = (int32_t)(alea.suivant() % 20001) - 10000;
+            donnees.insert(donnees.end(), (uint8_t *)&biais, (uint8_t *)&biais + sizeof(biais));
+        }
+
+        canaux = c.sorties;
+        if (c.type == COUCHE_DENSE)
+            largeur = hauteur = 1;
+        else if (c.maxPool){
+            largeur /= 2;
+            hauteur /= 2;
+        }
+    }
+    entete.nbClasses = largeur * hauteur * canaux;
+    memcpy(donnees.data(), &entete, sizeof(entete));
+    memcpy(donnees.data() + sizeof(entete), couches.data(), couches.size() * sizeof(DescripteurCouche));
+
+    FILE *f = fopen(chemin.c_str(), "wb");
+    if (!f)
+        return false;
+    bool ecrit = fwrite(donnees.data(), 1, donnees.size(), f) == donnees.size();
+    return fclose(f) == 0 && ecrit;
+}
+
+/*
+ * Chaque couche, passe vectorisée contre passe de référence, puis temps moyens par couche.
+ */
+static bool verifierCouches(const std::string &chemin, const Options &options, Aleatoire &alea)
+{
+    ClassifieurExpression classifieur;
+    if (!classifieur.charger(chemin)){
+        fprintf(stderr, "%s : fichier de poids refusé\n", chemin.c_str());
+        return false;
+    }
+    int nbCouches = classifieur.nombreCouches();
+
+    // Taille de l'entrée : la sortie de la couche 0 est calculée sur une entrée de la bonne taille, lue dans le fichier.
+    FILE *f = fopen(chemin.c_str(), "rb");
+    EnTeteModele entete;
+    bool lu = f && fread(&entete, sizeof(entete), 1, f) == 1;
+    if (f)
+        fclose(f);
+    if (!lu)
+        return false;
+    std::vector<int8_t> entree(entete.largeurEntree * entete.hauteurEntree * entete.canauxEntree);
+
+    std::vector<int> differences(nbCouches, 0);
+    std::vector<size_t> tailles(nbCouches, 0);
+    std::vector<std::vector<int8_t> > sortiesVectorise, sortiesReference;
+    for (int e = 0; e < options.entrees + 2; e++){
+        remplir(entree, alea, e < 2 ? e + 1 : 0); // d'abord les deux entrées extrêmes.
+        classifieur.setReference(false);
+        classifieur.inferer(entree.data(), &sortiesVectorise);
+        classifieur.setReference(true);
+        classifieur.inferer(entree.data(), &sortiesReference);
+        for (int i = 0; i < nbCouches; i++){
+            tailles[i] = sortiesReference[i].size();
+            for (size_t k = 0; k < tailles[i]; k++)
+                differences[i] += sortiesVectorise[i][k] != sortiesReference[i][k];
+        }
+    }
+
+    // Temps : une passe sur la même entrée, --iterations fois, pour chacun des deux chemins.
+    classifieur.rapportTemps(); // remise à zéro des mesures de la vérification.
+    classifieur.setReference(false);
+    for (int k = 0; k < options.iterations; k++)
+        classifieur.inferer(entree.data());
+    std::vector<double> tempsVectorise = classifieur.tempsMoyensCouches();
+    classifieur.rapportTemps();
+    classifieur.setReference(true);
+    for (int k = 0; k < options.iterations; k++)
+        classifieur.inferer(entree.data());
+    std::vector<double> tempsReference = classifieur.tempsMoyensCouches();
+    classifieur.rapportTemps();
+
+    printf("\n%s : %d couches, %d entrées comparées, temps moyens sur %d inférences\n", chemin.c_str(), nbCouches,
+           options.entrees + 2, options.iterations);
+    printf("%6s %8s %14s %12s %12s %8s\n", "couche", "sortie", "resultat", "vectorise us", "reference us", "gain");
+    double totalVectorise = 0, totalReference = 0;
+    bool identiques = true;
+    for (int i = 0; i < nbCouches; i++){
+        char resultat[32];
+        if (differences[i] == 0)
+            snprintf(resultat, sizeof(resultat), "identique");
+        else
+            snprintf(resultat, sizeof(resultat), "%d differents", differences[i]);
+        identiques = identiques && differences[i] == 0;
+        nbErreurs += differences[i] != 0;
+        totalVectorise += tempsVectorise[i];
+        totalReference += tempsReference[i];
+        printf("%6d %8d %14s %12.1f %12.1f %7.2fx\n", i, (int)tailles[i], resultat, tempsVectorise[i], tempsReference[i],
+               tempsVectorise[i] > 0 ? tempsReference[i] / tempsVectorise[i] : 0.);
+    }
+    printf("%6s %8s %14s %12.1f %12.1f %7.2fx\n", "total", "", identiques ? "identique" : "DIFFERENT", totalVectorise,
+           totalReference, totalVectorise > 0 ? totalReference / totalVectorise : 0.);
+    return true;
+}
+
+/*
+ * Fichiers dont les tailles débordent : charger() doit les refuser sans lire hors du fichier.
+ */
+static void verifierFichiersMalformes(const std::string &dossier, Aleatoire &alea)
+{
+    std::string chemin = dossier + "/banc_classifieur_malforme.cnn8";
+    std::vector<CoucheEssai> description;
+    CoucheEssai dense = { COUCHE_DENSE, 7, false, false };
+    description.push_back(dense);
+    if (!ecrireModele(chemin, 8, 8, description, alea)){
+        fprintf(stderr, "%s : écriture impossible\n", chemin.c_str());
+        nbErreurs++;
+        return;
+    }
+    FILE *f = fopen(chemin.c_str(), "rb");
+    std::vector<uint8_t> valide;
+    int c;
+    while (f && (c = fgetc(f)) != EOF)
+        valide.push_back((uint8_t)c);
+    if (f)
+        fclose(f);
+
+    const size_t debutCouche = sizeof(EnTeteModele);
+    struct Alteration {
+        const char *nom;
+        size_t position; // dans le fichier
+        uint64_t valeur;
+        size_t taille;   // 4 ou 8 octets
+    };
+    const Alteration alterations[] = {
+        { "sorties = 2^32 - 1", debutCouche + offsetof(DescripteurCouche, sorties), 0xffffffffu, 4 },
+        { "sorties x poids proche de 2^32", debutCouche + offsetof(DescripteurCouche, sorties), 0x04000001u, 4 },
+        { "sorties = 0", debutCouche + offsetof(DescripteurCouche, sorties), 0, 4 },
+        { "position des poids proche de 2^64", debutCouche + offsetof(DescripteurCouche, positionPoids), 0xfffffffffffffff0ull, 8 },
+        { "position des poids proche de 2^32", debutCouche + offsetof(DescripteurCouche, positionPoids), 0xfffffff0ull, 8 },
+        { "position des biais proche de 2^64", debutCouche + offsetof(DescripteurCouche, positionBiais), 0xfffffffffffffffcull, 8 },
+        { "entrées = 0", debutCouche + offsetof(DescripteurCouche, entrees), 0, 4 },
+        { "largeur d'entrée énorme", offsetof(EnTeteModele, largeurEntree), 0x80000000u, 4 },
+        { "largeur x hauteur débordant 32 bits", offsetof(EnTeteModele, largeurEntree), 0x10000u, 4 },
+        { "largeur d'entrée nulle", offsetof(EnTeteModele, largeurEntree), 0, 4 },
+        { "nombre de couches énorme", offsetof(EnTeteModele, nbCouches), 0xffffffffu, 4 },
+    };
+
+    printf("\nfichiers malformés\n");
+    ClassifieurExpression classifieur;
+    bool valideCharge = classifieur.charger(chemin);
+    printf("%-40s %s\n", "fichier valide", valideCharge ? "chargé" : "REFUSE");
+    nbErreurs += !valideCharge;
+    for (size_t i = 0; i < sizeof(alterations) / sizeof(alterations[0]); i++){
+        std::vector<uint8_t> donnees = valide;
+        memcpy(donnees.data() + alterations[i].position, &alterations[i].valeur, alterations[i].taille); // petit boutiste
+        if (alterations[i].valeur == 0x10000u){ // hauteur aussi : 2^16 x 2^16 = 2^32.
+            uint32_t hauteur = 0x10000u;
+            memcpy(donnees.data() + offsetof(EnTeteModele, hauteurEntree), &hauteur, sizeof(hauteur));
+        }
+        f = fopen(chemin.c_str(), "wb");
+        bool ecrit = f && fwrite(donnees.data(), 1, donnees.size(), f) == donnees.size();
+        if (f)
+            fclose(f);
+        bool charge = ecrit && classifieur.charger(chemin);
+        printf("%-40s %s\n", alterations[i].nom, charge ? "ACCEPTE" : "refusé");
+        nbErreurs += charge || !ecrit;
+    }
+    remove(chemin.c_str());
+}
+
+static bool lireOptions(int argc, char **argv, Options &o)
+{
+    for (int i = 1; i < argc; i++){
+        std::string a = argv[i];
+        bool valeur = i + 1 < argc;
+        if (a == "--modele" && valeur) o.modele = argv[++i];
+        else if (a == "--dossier" && valeur) o.dossier = argv[++i];
+        else if (a == "--entrees" && valeur) o.entrees = std::max(atoi(argv[++i]), 0);
+        else if (a == "--iterations" && valeur) o.iterations = std::max(atoi(argv[++i]), 1);
+        else if (a == "--graine" && valeur) o.graine = (uint32_t)atol(argv[++i]);
+        else return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!lireOptions(argc, argv, options)){
+        fprintf(stderr, "Utilisation : BancClassifieur [--modele fichier] [--dossier d] [--entrees n] [--iterations n] [--graine g]\n");
+        return 1;
+    }
+    Aleatoire alea(options.graine);
+    printf("noyaux %s\n", jeuInstructionsInt8());
+
+    verifierProduitScalaire(alea, options.iterations);
+    verifierMaxPool(alea, options.iterations);
+
+    std::vector<CoucheEssai> reseau;
+    CoucheEssai couches[] = { { COUCHE_CONVOLUTION_3X3, 8, true, true }, { COUCHE_CONVOLUTION_3X3, 16, true, true },
+                              { COUCHE_CONVOLUTION_3X3, 32, true, true }, { COUCHE_DENSE, NB_EXPRESSIONS, false, false } };
+    reseau.assign(couches, couches + sizeof(couches) / sizeof(couches[0]));
+    std::string synthetique = options.dossier + "/banc_classifieur.cnn8";
+    if (!ecrireModele(synthetique, 48, 48, reseau, alea) || !verifierCouches(synthetique, options, alea))
+        nbErreurs++;
+    remove(synthetique.c_str());
+    if (!options.modele.empty() && !verifierCouches(options.modele, options, alea))
+        nbErreurs++;
+
+    verifierFichiersMalformes(options.dossier, alea);
+
+    if (nbErreurs > 0){
+        printf("\n%d cas en erreur\n", nbErreurs);
+        return 2;
+    }
+    printf("\ntous les cas sont bons\n");
+    return 0;
+}
@@ -0,0 +1,28 @@
+#-------------------------------------------------
+#
+# Index des personnes enrôlées pour la reconnaissance : banc d'essai de la recherche (100 à 100000 entrées),
+# construction du quantifieur grossier, description d'un index
+# (voir ../ProjetSY25Berthelon_Bucheron/indexidentites.h)
+#
+#-------------------------------------------------
+
+TEMPLATE = app
+TARGET = BancIdentites
+CONFIG += console c++11
+CONFIG -= qt app_bundle
+
+INCLUDEPATH += ../ProjetSY25Berthelon_Bucheron
+
+SOURCES += main.cpp \
+    ../ProjetSY25Berthelon_Bucheron/indexidentites.cpp \
+    ../ProjetSY25Berthelon_Bucheron/noyauxidentites.cpp \
+    ../ProjetSY25Berthelon_Bucheron/noyauxint8.cpp \
+    ../ProjetSY25Berthelon_Bucheron/mesurelatence.cpp
+
+HEADERS += ../ProjetSY25Berthelon_Bucheron/indexidentites.h \
+    ../ProjetSY25Berthelon_Bucheron/noyauxidentites.h \
+    ../ProjetSY25Berthelon_Bucheron/noyauxint8.h \
+    ../ProjetSY25Berthelon_Bucheron/mesurelatence.h
+
+# Mêmes options de compilation que l'application pour les noyaux vectorisés.
+contains(QMAKE_HOST.arch, armv7l): QMAKE_CXXFLAGS += -mfpu=neon-vfpv4
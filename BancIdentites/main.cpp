@@ -0,0 +1,318 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Outil de l'index des personnes enrôlées (voir ../ProjetSY25Berthelon_Bucheron/indexidentites.h).
+ *
+ * banc : latence de la recherche selon la taille de la base. Des index synthétiques de 100, 1000, 10000 et 100000 entrées
+ * (jusqu'à --max) sont écrits dans --dossier : des "personnes" tirées au hasard (histogrammes positifs, normés, de la dimension
+ * du descripteur LBP) et 5 échantillons bruités par personne. Pour chaque taille : temps d'ajout par entrée, taille du fichier,
+ * temps d'ouverture (projection et lecture des noms), puis --requetes recherches d'un nouvel échantillon d'une personne :
+ *  - float32 : recherche exhaustive scalaire en mémoire, comme une base non quantifiée (jusqu'à 10000 entrées) ;
+ *  - index : recherche exhaustive dans l'index projeté (noyaux vectorisés), accord de son plus proche avec celui en float32 ;
+ *  - quantifieur (à partir de 1000 entrées) : racine du nombre d'entrées en listes, --sondees listes parcourues, temps de
+ *    construction et rappel (même plus proche que la recherche exhaustive de l'index).
+ * Les latences (médiane et 99e centile, en ms) sont celles de la machine qui lance l'outil : à lancer sur la raspi.
+ *
+ * quantifier : construit le quantifieur grossier d'un index existant (défaut : racine du nombre d'entrées en listes).
+ * info : format, taille, personnes et listes d'un index.
+ *
+ * Utilisation :
+ *   BancIdentites banc [--format int8|demi] [--max n] [--requetes n] [--sondees p] [--dossier d] [--graine g]
+ *   BancIdentites quantifier <index> [listes]
+ *   BancIdentites info <index>
+ */
+#include "indexidentites.h"
+#include "mesurelatence.h"
+#include "noyauxidentites.h"
+#include "noyauxint8.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Dimension du descripteur LBP de l'application (DIMENSION_DESCRIPTEUR de descripteurvisage.h).
+#define DIMENSION_BANC 944
+#define ECHANTILLONS_PAR_PERSONNE 5
+
+struct Options {
+    FormatIndex format = FORMAT_INT8;
+    int maximum = 100000;
+    int requetes = 200;
+    int sondees = 8;
+    std::string dossier = "/tmp";
+    uint32_t graine = 1;
+};
+
+/*
+ * Générateur reproductible (xorshift), une suite par graine.
+ */
+struct Aleatoire {
+    uint32_t etat;
+    explicit Aleatoire(uint32_t graine) : etat(graine * 2654435761u + 1) {}
+    float uniforme()
+    {
+        etat ^= etat << 13;
+        etat ^= etat >> 17;
+        etat ^= etat << 5;
+        return (etat >> 8) * (1.f / 16777216.f);
+    }
+};
+
+/*
+ * Echantillon "numero" de la personne "personne" : histogramme de la personne (valeurs très inégales, comme les racines
+ * des histogrammes LBP) plus un bruit propre à l'échantillon, ramené au positif et normé.
+ */
+static void echantillon(uint32_t graine, int personne, uint32_t numero, float *descripteur)
+{
+    Aleatoire centre(graine * 1000003u + personne);
+    Aleatoire bruit(graine * 7919u + personne * 104729u + numero * 15485863u + 17);
+    double norme = 0;
+    for (int i = 0; i < DIMENSION_BANC; i++){
+        float u = centre.uniforme();
+        float v = u * u * u + 0.35f * (bruit.uniforme() - 0.5f) * (0.2f + u);
+        descripteur[i] = v > 0 ? v : 0;
+        norme += descripteur[i] * descripteur[i];
+    }
+    float inverse = norme > 0 ? (float)(1. / std::sqrt(norme)) : 0.f;
+    for (int i = 0; i < DIMENSION_BANC; i++)
+        descripteur[i] *= inverse;
+}
+
+static double centile(std::vector<double> valeurs, double p)
+{
+    if (valeurs.empty())
+        return 0;
+    std::sort(valeurs.begin(), valeurs.end());
+    size_t i = (size_t)std::min((double)valeurs.size() - 1, std::floor(p / 100. * valeurs.size()));
+    return valeurs[i];
+}
+
+static void supprimerIndex(const std::string &chemin)
+{
+    unlink(chemin.c_str());
+    unlink((chemin + ".meta").c_str());
+    unlink((chemin + ".centres").c_str());
+}
+
+static int banc(const Options &o)
+{
+    printf("format %s (%s), dimension %d, %d requêtes, quantifieur : %d listes sondées\n",
+           o.format == FORMAT_INT8 ? "int8" : "float16", o.format == FORMAT_INT8 ? jeuInstructionsInt8() : jeuInstructionsDemi(),
+           DIMENSION_BANC, o.requetes, o.sondees);
+    printf("%8s %9s %8s %9s | %17s | %17s %7s | %6s %8s %17s %7s\n", "entrées", "fichier", "ajout", "ouverture",
+           "float32 (ms)", "index (ms)", "accord", "listes", "constr.", "quantifieur (ms)", "rappel");
+    printf("%8s %9s %8s %9s | %8s %8s | %8s %8s %7s | %6s %8s %8s %8s %7s\n", "", "(Mo)", "(µs)", "(ms)",
+           "médiane", "99%", "médiane", "99%", "", "", "(s)", "médiane", "99%", "");
+
+    std::vector<float> descripteur(DIMENSION_BANC);
+    for (int n = 100; n <= o.maximum; n *= 10){
+        std::string chemin = o.dossier + "/banc_identites_" + std::to_string(n) + ".idx";
+        supprimerIndex(chemin);
+
+        IndexIdentites index;
+        if (!index.ouvrir(chemin, DIMENSION_BANC, o.format)){
+            fprintf(stderr, "%s : impossible de créer l'index\n", chemin.c_str());
+            return 1;
+        }
+
+        // base float32 de comparaison, gardée en mémoire jusqu'à 10000 entrées.
+        bool reference = n <= 10000;
+        std::vector<float> base;
+        if (reference)
+            base.resize((size_t)n * DIMENSION_BANC);
+
+        uint64_t debut = MesureLatence::horloge();
+        for (int e = 0; e < n; e++){
+            int personne = e / ECHANTILLONS_PAR_PERSONNE;
+            echantillon(o.graine, personne, e % ECHANTILLONS_PAR_PERSONNE, &descripteur[0]);
+            if (reference)
+                std::copy(descripteur.begin(), descripteur.end(), base.begin() + (size_t)e * DIMENSION_BANC);
+            char nom[NOM_IDENTITE_MAX];
+            snprintf(nom, sizeof(nom), "personne_%d", personne);
+            if (!index.ajouter(nom, &descripteur[0])){
+                fprintf(stderr, "%s : ajout impossible\n", chemin.c_str());
+                return 1;
+            }
+        }
+        // (le temps de génération des échantillons est compté avec l'ajout, il est petit devant l'écriture)
+        double ajout = (double)(MesureLatence::horloge() - debut) / n;
+        index.fermer();
+
+        debut = MesureLatence::horloge();
+        if (!index.ouvrir(chemin, DIMENSION_BANC)){
+            fprintf(stderr, "%s : relecture impossible\n", chemin.c_str());
+            return 1;
+        }
+        double ouverture = (MesureLatence::horloge() - debut) / 1000.;
+        struct stat infos;
+        stat(chemin.c_str(), &infos);
+
+        // requêtes : nouveaux échantillons (numéros après ceux de la base) de personnes tirées au hasard.
+        int personnes = (n + ECHANTILLONS_PAR_PERSONNE - 1) / ECHANTILLONS_PAR_PERSONNE;
+        Aleatoire tirage(o.graine + 12345);
+        std::vector<std::vector<float> > requetes(o.requetes, std::vector<float>(DIMENSION_BANC));
+        for (int r = 0; r < o.requetes; r++)
+            echantillon(o.graine, std::min((int)(tirage.uniforme() * personnes), personnes - 1), ECHANTILLONS_PAR_PERSONNE + r, &requetes[r][0]);
+
+        std::vector<double> tempsReference, tempsIndex, tempsQuantifieur;
+        std::vector<int> plusProchesReference(o.requetes, -1), plusProchesIndex(o.requetes, -1);
+        for (int r = 0; r < o.requetes; r++){
+            const float *q = &requetes[r][0];
+            if (reference){
+                uint64_t t = MesureLatence::horloge();
+                float meilleure = -2;
+                for (int e = 0; e < n; e++){
+                    const float *x = &base[(size_t)e * DIMENSION_BANC];
+                    float s = 0;
+                    for (int k = 0; k < DIMENSION_BANC; k++)
+                        s += x[k] * q[k];
+                    if (s > meilleure){
+                        meilleure = s;
+                        plusProchesReference[r] = e;
+                    }
+                }
+                tempsReference.push_back((MesureLatence::horloge() - t) / 1000.);
+            }
+            VoisinIdentite voisin;
+            uint64_t t = MesureLatence::horloge();
+            if (index.chercher(q, 1, &voisin) == 1)
+                plusProchesIndex[r] = voisin.entree;
+            tempsIndex.push_back((MesureLatence::horloge() - t) / 1000.);
+        }
+        // accord : même personne que la recherche float32 (les 5 échantillons d'une personne sont proches entre eux).
+        int accords = 0;
+        for (int r = 0; r < o.requetes && reference; r++)
+            accords += index.nom(plusProchesIndex[r]) == index.nom(plusProchesReference[r]);
+
+        char colonnesReference[40] = "       -        -", colonnesAccord[16] = "      -";
+        if (reference){
+            snprintf(colonnesReference, sizeof(colonnesReference), "%8.3f %8.3f", centile(tempsReference, 50), centile(tempsReference, 99));
+            snprintf(colonnesAccord, sizeof(colonnesAccord), "%6.1f%%", 100. * accords / o.requetes);
+        }
+        printf("%8d %9.1f %8.1f %9.2f | %s | %8.3f %8.3f %s |", n, infos.st_size / 1048576., ajout, ouverture,
+               colonnesReference, centile(tempsIndex, 50), centile(tempsIndex, 99), colonnesAccord);
+
+        if (n >= 1000){
+            int listes = (int)std::lround(std::sqrt((double)n));
+            debut = MesureLatence::horloge();
+            index.construireQuantifieur(listes);
+            double construction = (MesureLatence::horloge() - debut) / 1e6;
+            int rappels = 0;
+            for (int r = 0; r < o.requetes; r++){
+                VoisinIdentite voisin;
+                uint64_t t = MesureLatence::horloge();
+                int trouves = index.chercher(&requetes[r][0], 1, &voisin, o.sondees);
+                tempsQuantifieur.push_back((MesureLatence::horloge() - t) / 1000.);
+                rappels += trouves == 1 && voisin.entree == plusProchesIndex[r];
+            }
+            printf(" %6d %8.2f %8.3f %8.3f %6.1f%%\n", listes, construction, centile(tempsQuantifieur, 50), centile(tempsQuantifieur, 99),
+                   100. * rappels / o.requetes);
+        } else {
+            printf(" %6s %8s %8s %8s %7s\n", "-", "-", "-", "-", "-");
+        }
+        fflush(stdout);
+        index.fermer();
+        supprimerIndex(chemin);
+    }
+    return 0;
+}
+
+/*
+ * Dimension d'un index existant, lue dans son en-tête.
+ */
+static int dimensionIndex(const std::string &chemin)
+{
+    EnTeteIndex entete;
+    int fd = open(chemin.c_str(), O_RDONLY);
+    bool ok = fd >= 0 && read(fd, &entete, sizeof(entete)) == (ssize_t)sizeof(entete) && entete.magie == MAGIE_INDEX_IDENTITES;
+    if (fd >= 0)
+        close(fd);
+    return ok ? (int)entete.dimension : 0;
+}
+
+static bool ouvrirExistant(const std::string &chemin, IndexIdentites &index)
+{
+    int dimension = dimensionIndex(chemin);
+    if (dimension == 0 || !index.ouvrir(chemin, dimension)){
+        fprintf(stderr, "%s : pas un index d'identités\n", chemin.c_str());
+        return false;
+    }
+    return true;
+}
+
+static void afficherInfo(const std::string &chemin, const IndexIdentites &index)
+{
+    printf("%s : %s, dimension %d, %d octets par entrée, %d entrées, %d personnes, ", chemin.c_str(),
+           index.format() == FORMAT_INT8 ? "int8" : "float16", index.dimension(), index.tailleEntree(), index.taille(), index.nombrePersonnes());
+    if (index.nombreListes() > 0)
+        printf("quantifieur de %d listes\n", index.nombreListes());
+    else
+        printf("sans quantifieur\n");
+}
+
+static void usage()
+{
+    fprintf(stderr, "Utilisation :\n"
+                    "  BancIdentites banc [--format int8|demi] [--max n] [--requetes n] [--sondees p] [--dossier d] [--graine g]\n"
+                    "  BancIdentites quantifier <index> [listes]\n"
+                    "  BancIdentites info <index>\n");
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2){
+        usage();
+        return 1;
+    }
+    std::string commande = argv[1];
+
+    if (commande == "banc"){
+        Options o;
+        for (int i = 2; i < argc; i++){
+            std::string a = argv[i];
+            if (i + 1 >= argc){
+                usage();
+                return 1;
+            }
+            if (a == "--format") o.format = std::string(argv[++i]) == "demi" ? FORMAT_DEMI : FORMAT_INT8;
+            else if (a == "--max") o.maximum = atoi(argv[++i]);
+            else if (a == "--requetes") o.requetes = std::max(atoi(argv[++i]), 1);
+            else if (a == "--sondees") o.sondees = atoi(argv[++i]);
+            else if (a == "--dossier") o.dossier = argv[++i];
+            else if (a == "--graine") o.graine = atoi(argv[++i]);
+            else {
+                usage();
+                return 1;
+            }
+        }
+        return banc(o);
+    }
+
+    if ((commande == "quantifier" || commande == "info") && argc >= 3){
+        IndexIdentites index;
+        if (!ouvrirExistant(argv[2], index))
+            return 1;
+        if (commande == "quantifier"){
+            int listes = argc >= 4 ? atoi(argv[3]) : (int)std::lround(std::sqrt((double)index.taille()));
+            uint64_t debut = MesureLatence::horloge();
+            if (!index.construireQuantifieur(listes)){
+                fprintf(stderr, "%s : quantifieur non construit\n", argv[2]);
+                return 1;
+            }
+            printf("quantifieur construit en %.1f s\n", (MesureLatence::horloge() - debut) / 1e6);
+        }
+        afficherInfo(argv[2], index);
+        return 0;
+    }
+
+    usage();
+    return 1;
+}
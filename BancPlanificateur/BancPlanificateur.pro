@@ -0,0 +1,21 @@
+#-------------------------------------------------
+#
+# Trajectoires des servos du programme de l'arduino, sur le PC : vérification du profil trapézoïdal
+# (arrivée, dépassement, bornes, petits pas, changements de cible en route) et temps de avancer()
+# (voir ../ControlMoteurArduino/planificateurmouvement.h)
+#
+#-------------------------------------------------
+
+TEMPLATE = app
+TARGET = BancPlanificateur
+CONFIG += console c++11
+CONFIG -= qt app_bundle
+
+INCLUDEPATH += ../ControlMoteurArduino ../ProjetSY25Berthelon_Bucheron
+
+SOURCES += main.cpp \
+    ../ControlMoteurArduino/planificateurmouvement.cpp \
+    ../ProjetSY25Berthelon_Bucheron/mesurelatence.cpp
+
+HEADERS += ../ControlMoteurArduino/planificateurmouvement.h \
+    ../ProjetSY25Berthelon_Bucheron/mesurelatence.h
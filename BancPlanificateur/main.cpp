@@ -0,0 +1,272 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Vérification et temps de la trajectoire des servos (../ControlMoteurArduino/planificateurmouvement.h), sur le PC :
+ * le même fichier que le programme de l'arduino, compilé avec g++, avancé par pas de PERIODE_MOUVEMENT_US comme la boucle
+ * de mouvement du programme.
+ *
+ * Cas vérifiés :
+ *  - déplacements de toutes les positions de départ vers toutes les cibles d'une grille (0 à 180°) : arrivée exacte sur la
+ *    cible, sans la dépasser, vitesse jamais au dessus du maximum, variation de vitesse par pas au plus accélération x pas,
+ *    durée proche de celle du profil trapézoïdal continu ;
+ *  - petits pas (une commande 'H' de PAS_COMMANDE_SERVO, et moins) : mêmes contrôles, fini avant l'image suivante (120 ms) ;
+ *  - bornes : cibles hors de 0 - 180° ramenées aux bornes, position toujours dans les bornes, arrêt en butée sur une
+ *    borne quand la cible passe derrière le servo trop près d'elle pour freiner avant ;
+ *  - changements de cible en route (--essais trajectoires tirées au hasard, cibles de -20 à 200°, changées tous les 1 à 40
+ *    pas) : position dans les bornes à chaque pas, limites de vitesse et d'accélération, arrivée sur la dernière cible.
+ * Puis temps moyen d'un appel à avancer() (ns), en mouvement, sur --appels appels.
+ *
+ * Code de retour : 0 si tous les cas sont bons, 2 sinon.
+ *
+ * Utilisation : BancPlanificateur [--essais n] [--appels n] [--graine g]
+ * Sans qmake : g++ -O2 -I../ControlMoteurArduino -I../ProjetSY25Berthelon_Bucheron main.cpp
+ *              ../ControlMoteurArduino/planificateurmouvement.cpp ../ProjetSY25Berthelon_Bucheron/mesurelatence.cpp
+ */
+#include "planificateurmouvement.h"
+#include "mesurelatence.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#define PAS_S (PERIODE_MOUVEMENT_US * 1e-6f)
+#define TOLERANCE 1e-3f // ° et °/s : arrondis en float
+
+static int nbErreurs = 0;
+
+static void erreur(const char *cas, float depart, float cible, const char *detail, float valeur)
+{
+    if (nbErreurs < 20)
+        printf("ERREUR %s (%.3f -> %.3f) : %s %.6f\n", cas, depart, cible, detail, valeur);
+    nbErreurs++;
+}
+
+/*
+ * Générateur reproductible (xorshift).
+ */
+struct Aleatoire {
+    uint32_t etat;
+    explicit Aleatoire(uint32_t graine) : etat(graine * 2654435761u + 1) {}
+    float uniforme()
+    {
+        etat ^= etat << 13;
+        etat ^= etat >> 17;
+        etat ^= etat << 5;
+        return (etat >> 8) * (1.f / 16777216.f);
+    }
+};
+
+/*
+ * Durée (s) du profil trapézoïdal continu sur "distance" degrés, départ et arrivée à l'arrêt.
+ */
+static float dureeTheorique(float distance)
+{
+    float distanceAcceleration = VITESSE_MAX_SERVO * VITESSE_MAX_SERVO / ACCELERATION_SERVO; // accélération + freinage
+    if (distance >= distanceAcceleration)
+        return distance / VITESSE_MAX_SERVO + VITESSE_MAX_SERVO / ACCELERATION_SERVO;
+    return 2.0f * std::sqrt(distance / ACCELERATION_SERVO);
+}
+
+/*
+ * Un pas de la trajectoire, avec les contrôles communs : bornes, vitesse maximum, variation de vitesse.
+ */
+static void pas(PlanificateurMouvement &p, const char *cas, float depart)
+{
+    float vitessePrecedente = p.vitesse();
+    p.avancer(PAS_S);
+    if (p.position() < 0.0f || p.position() > 180.0f || std::signbit(p.position()))
+        erreur(cas, depart, p.cible(), "position hors des bornes", p.position());
+    if (std::fabs(p.vitesse()) > VITESSE_MAX_SERVO + TOLERANCE)
+        erreur(cas, depart, p.cible(), "vitesse au dessus du maximum", p.vitesse());
+    // à l'arrivée la vitesse tombe à 0 (dernier pas de freinage plus court), de même en butée sur une borne
+    // (cible changée derrière le servo trop près de la borne pour freiner avant) : seules exceptions.
+    bool butee = p.vitesse() == 0.0f && (p.position() == 0.0f || p.position() == 180.0f);
+    if (!p.estArrive() && !butee && std::fabs(p.vitesse() - vitessePrecedente) > ACCELERATION_SERVO * PAS_S + TOLERANCE)
+        erreur(cas, depart, p.cible(), "variation de vitesse sur un pas", p.vitesse() - vitessePrecedente);
+}
+
+/*
+ * Déplacement à l'arrêt de "depart" vers "cible". Retourne la durée (s), ou -1 si le servo n'arrive pas.
+ */
+static float deplacement(float depart, float cible, const char *cas)
+{
+    PlanificateurMouvement p(depart);
+    p.viser(cible);
+    cible = p.cible(); // bornée.
+    float sens = cible >= depart ? 1.0f : -1.0f;
+    int n = 0;
+    while (!p.estArrive() && n < 10000){
+        pas(p, cas, depart);
+        if ((p.position() - cible) * sens > 0.0f)
+            erreur(cas, depart, cible, "dépassement de la cible", p.position() - cible);
+        n++;
+    }
+    if (!p.estArrive() || p.position() != cible){
+        erreur(cas, depart, cible, "pas arrivé, position", p.position());
+        return -1;
+    }
+    return n * PAS_S;
+}
+
+static void verifierGrille()
+{
+    const float positions[] = { 0.0f, 0.5f, 2.0f, 10.0f, 45.0f, 89.0f, 90.0f, 91.5f, 135.0f, 178.0f, 180.0f };
+    const int n = sizeof(positions) / sizeof(positions[0]);
+    float ecartMax = 0;
+    int nbCas = 0;
+    for (int i = 0; i < n; i++){
+        for (int j = 0; j < n; j++){
+            float duree = deplacement(positions[i], positions[j], "grille");
+            if (duree < 0)
+                continue;
+            // la trajectoire par pas peut finir un pas plus tôt ou plus tard que le profil continu, plus le pas d'arrivée.
+            float ecart = duree - dureeTheorique(std::fabs(positions[j] - positions[i]));
+            ecartMax = std::max(ecartMax, std::fabs(ecart));
+            if (std::fabs(ecart) > 3 * PAS_S)
+                erreur("grille", positions[i], positions[j], "écart à la durée du profil (s)", ecart);
+            nbCas++;
+        }
+    }
+    printf("grille : %d déplacements, écart maximum à la durée du profil %.1f ms\n", nbCas, ecartMax * 1000);
+}
+
+static void verifierPetitsPas()
+{
+    const float ecarts[] = { PAS_COMMANDE_SERVO, -PAS_COMMANDE_SERVO, 1.0f, 0.5f, 0.1f, 0.01f, -0.001f };
+    float dureeMax = 0;
+    for (size_t i = 0; i < sizeof(ecarts) / sizeof(ecarts[0]); i++){
+        for (float depart = 1.0f; depart < 180.0f; depart += 29.5f){
+            float duree = deplacement(depart, depart + ecarts[i], "petit pas");
+            dureeMax = std::max(dureeMax, duree);
+            if (duree > 0.120f)
+                erreur("petit pas", depart, depart + ecarts[i], "plus long qu'une image (s)", duree);
+        }
+    }
+    printf("petits pas : durée maximum %.0f ms (pas de %.0f° : %.0f ms pour le profil continu)\n",
+           dureeMax * 1000, PAS_COMMANDE_SERVO, dureeTheorique(PAS_COMMANDE_SERVO) * 1000);
+}
+
+static void verifierBornes()
+{
+    PlanificateurMouvement p(90.0f);
+    p.viser(-10.0f);
+    if (p.cible() != 0.0f)
+        erreur("bornes", 90.0f, -10.0f, "cible", p.cible());
+    p.viser(200.0f);
+    if (p.cible() != 180.0f)
+        erreur("bornes", 90.0f, 200.0f, "cible", p.cible());
+    p.placer(181.0f);
+    if (p.position() != 180.0f)
+        erreur("bornes", 181.0f, 181.0f, "placer", p.position());
+    p.decaler(5.0f);
+    if (p.cible() != 180.0f)
+        erreur("bornes", 180.0f, 185.0f, "cible décalée", p.cible());
+    // arrivée sur les bornes à pleine vitesse, puis demi-tour juste avant.
+    if (deplacement(90.0f, 0.0f, "bornes") < 0 || deplacement(90.0f, 180.0f, "bornes") < 0)
+        return;
+    const float butees[] = { 0.0f, 180.0f };
+    for (int b = 0; b < 2; b++){
+        PlanificateurMouvement q(90.0f);
+        q.viser(butees[b]);
+        while (std::fabs(q.position() - butees[b]) > 3.0f)
+            pas(q, "bornes", 90.0f);
+        q.viser(90.0f);
+        q.viser(butees[b]); // cible remise sur la borne au pas suivant : le servo est lancé vers elle.
+        for (int k = 0; k < 2000 && !q.estArrive(); k++){
+            if (k == 3)
+                q.viser(100.0f); // demi-tour tardif, à pleine vitesse près de la borne.
+            pas(q, "bornes", 90.0f);
+        }
+        if (!q.estArrive() || q.position() != 100.0f)
+            erreur("bornes", 90.0f, 100.0f, "demi-tour près de la borne, position", q.position());
+    }
+    printf("bornes : cibles ramenées dans 0 - 180°\n");
+}
+
+static void verifierChangementsCible(int essais, uint32_t graine)
+{
+    Aleatoire alea(graine);
+    float minimum = 180.0f, maximum = 0.0f;
+    for (int e = 0; e < essais; e++){
+        float depart = alea.uniforme() * 180.0f;
+        PlanificateurMouvement p(depart);
+        int changements = 1 + (int)(alea.uniforme() * 10);
+        for (int c = 0; c < changements; c++){
+            p.viser(-20.0f + alea.uniforme() * 220.0f);
+            int pasAvantChangement = 1 + (int)(alea.uniforme() * 40);
+            for (int k = 0; k < pasAvantChangement; k++){
+                pas(p, "changements de cible", depart);
+                minimum = std::min(minimum, p.position());
+                maximum = std::max(maximum, p.position());
+            }
+        }
+        int n = 0;
+        while (!p.estArrive() && n < 10000){
+            pas(p, "changements de cible", depart);
+            minimum = std::min(minimum, p.position());
+            maximum = std::max(maximum, p.position());
+            n++;
+        }
+        if (!p.estArrive())
+            erreur("changements de cible", depart, p.cible(), "pas arrivé, position", p.position());
+    }
+    printf("changements de cible : %d trajectoires, positions de %.3f à %.3f°\n", essais, minimum, maximum);
+}
+
+/*
+ * Temps d'un appel à avancer(), en mouvement (cible changée dès que le servo arrive).
+ */
+static void mesurerTemps(long appels)
+{
+    PlanificateurMouvement p(0.0f);
+    float cibles[2] = { 180.0f, 3.0f };
+    int suivante = 0;
+    double somme = 0; // utilisé après la boucle, pour que le compilateur ne la supprime pas.
+    uint64_t debut = MesureLatence::horloge();
+    for (long i = 0; i < appels; i++){
+        if (p.estArrive()){
+            p.viser(cibles[suivante]);
+            suivante ^= 1;
+        }
+        p.avancer(PAS_S);
+        somme += p.position();
+    }
+    uint64_t duree = MesureLatence::horloge() - debut;
+    printf("avancer() : %.1f ns par appel (%ld appels, moyenne des positions %.1f°)\n",
+           duree * 1000.0 / appels, appels, somme / appels);
+}
+
+int main(int argc, char **argv)
+{
+    int essais = 100000;
+    long appels = 20000000;
+    uint32_t graine = 1;
+    for (int i = 1; i < argc; i++){
+        std::string a = argv[i];
+        bool valeur = i + 1 < argc;
+        if (a == "--essais" && valeur) essais = std::max(atoi(argv[++i]), 1);
+        else if (a == "--appels" && valeur) appels = std::max(atol(argv[++i]), 1L);
+        else if (a == "--graine" && valeur) graine = (uint32_t)atol(argv[++i]);
+        else {
+            fprintf(stderr, "Utilisation : BancPlanificateur [--essais n] [--appels n] [--graine g]\n");
+            return 1;
+        }
+    }
+
+    printf("vitesse %.0f°/s, accélération %.0f°/s², pas de %.0f ms\n", VITESSE_MAX_SERVO, ACCELERATION_SERVO, PAS_S * 1000);
+    verifierGrille();
+    verifierPetitsPas();
+    verifierBornes();
+    verifierChangementsCible(essais, graine);
+    mesurerTemps(appels);
+
+    if (nbErreurs > 0){
+        printf("%d erreurs\n", nbErreurs);
+        return 2;
+    }
+    printf("tous les cas sont bons\n");
+    return 0;
+}
@@ -0,0 +1,27 @@
+#-------------------------------------------------
+#
+# Noyau de préparation de l'image de détection (retournement, réduction, égalisation en une passe) :
+# comparaison bit à bit avec OpenCV et temps des deux
+# (voir ../ProjetSY25Berthelon_Bucheron/noyauxpretraitement.h)
+#
+#-------------------------------------------------
+
+TEMPLATE = app
+TARGET = BancPretraitement
+CONFIG += console c++11
+CONFIG -= qt app_bundle
+
+INCLUDEPATH += ../ProjetSY25Berthelon_Bucheron
+
+SOURCES += main.cpp \
+    ../ProjetSY25Berthelon_Bucheron/noyauxpretraitement.cpp \
+    ../ProjetSY25Berthelon_Bucheron/mesurelatence.cpp
+
+HEADERS += ../ProjetSY25Berthelon_Bucheron/noyauxpretraitement.h \
+    ../ProjetSY25Berthelon_Bucheron/mesurelatence.h
+
+CONFIG += link_pkgconfig
+PKGCONFIG += opencv
+
+# Mêmes options de compilation que l'application pour les noyaux vectorisés.
+contains(QMAKE_HOST.arch, armv7l): QMAKE_CXXFLAGS += -mfpu=neon-vfpv4
@@ -0,0 +1,249 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Vérification et temps du noyau de préparation de l'image de détection (../ProjetSY25Berthelon_Bucheron/noyauxpretraitement.h).
+ *
+ * Pour chaque image, chaque facteur de réduction (1 et 2) et avec ou sans retournement, compare bit à bit :
+ *  - l'image préparée par pretraiterImage() (vectorisé) et par pretraiterImageReference() (scalaire),
+ *  - avec la chaîne OpenCV qu'ils remplacent : flip(), resize() en INTER_AREA (lignes et colonnes paires), equalizeHist(),
+ *  - et leurs histogrammes avec calcHist() de l'image réduite avant égalisation.
+ * puis donne le temps médian de chacun (ms) sur --iterations passages.
+ *
+ * Images : synthétiques (bruit, dégradé bruité, faible contraste) à plusieurs tailles, dont des largeurs qui ne tombent pas
+ * juste sur les vecteurs et des tailles impaires, stockées avec un pas aligné sur 32 comme le plan Y de la raspicam ;
+ * et les images données en argument (lues en niveaux de gris). Les temps sont ceux de la machine : à lancer sur la raspi.
+ *
+ * Code de retour : 0 si tout est identique, 2 sinon.
+ *
+ * Utilisation : BancPretraitement [--iterations n] [image ...]
+ */
+#include "noyauxpretraitement.h"
+#include "mesurelatence.h"
+
+#include "opencv2/core/core.hpp"
+#include "opencv2/imgcodecs/imgcodecs.hpp"
+#include "opencv2/imgproc/imgproc.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace cv;
+
+struct ImageEssai {
+    std::string nom;
+    Mat image; // vue sur un tampon de pas aligné sur 32
+    Mat tampon;
+};
+
+static const char *jeuInstructions()
+{
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    return "NEON";
+#elif defined(__AVX2__)
+    return "AVX2";
+#elif defined(__SSE2__)
+    return "SSE2";
+#else
+    return "scalaire";
+#endif
+}
+
+/*
+ * Image "nature" de la taille donnée, dans un tampon plus large (pas aligné sur 32).
+ */
+static ImageEssai creerImage(const std::string &nature, int largeur, int hauteur)
+{
+    ImageEssai essai;
+    char nom[64];
+    snprintf(nom, sizeof(nom), "%s %dx%d", nature.c_str(), largeur, hauteur);
+    essai.nom = nom;
+    essai.tampon = Mat(hauteur, (largeur + 31) & ~31, CV_8UC1, Scalar(0));
+    essai.image = essai.tampon(Rect(0, 0, largeur, hauteur));
+
+    uint32_t etat = 2463534242u + largeur * 31 + hauteur;
+    for (int y = 0; y < hauteur; y++){
+        uint8_t *ligne = essai.image.ptr<uint8_t>(y);
+        for (int x = 0; x < largeur; x++){
+            etat ^= etat << 13;
+            etat ^= etat >> 17;
+            etat ^= etat << 5;
+            int bruit = etat >> 24;
+            int v;
+            if (nature == "bruit")
+                v = bruit;
+            else if (nature == "degrade")
+                v = (x * 255) / std::max(largeur - 1, 1) / 2 + (y * 255) / std::max(hauteur - 1, 1) / 4 + bruit / 8;
+            else // faible contraste : l'égalisation étire une trentaine de niveaux.
+                v = 100 + (x / 7 + y / 5) % 20 + bruit / 32;
+            ligne[x] = (uint8_t)std::min(v, 255);
+        }
+    }
+    return essai;
+}
+
+/*
+ * La chaîne OpenCV remplacée par le noyau. Une ligne ou une colonne impaire est ignorée par la réduction,
+ * comme dans le noyau (après le retournement).
+ */
+static void pretraiterOpenCV(const Mat &source, int facteur, bool retourner, Mat &retournee, Mat &reduite, Mat &sortie)
+{
+    Mat image = source;
+    if (retourner){
+        flip(source, retournee, 0);
+        image = retournee;
+    }
+    if (facteur == 2){
+        Mat paire = image(Rect(0, 0, image.cols & ~1, image.rows & ~1));
+        resize(paire, reduite, Size(paire.cols / 2, paire.rows / 2), 0, 0, INTER_AREA);
+        image = reduite;
+    }
+    equalizeHist(image, sortie);
+}
+
+/*
+ * Histogramme OpenCV de l'image avant égalisation.
+ */
+static void histogrammeOpenCV(const Mat &image, uint32_t histogramme[256])
+{
+    Mat h;
+    int canaux[] = { 0 };
+    int tailles[] = { 256 };
+    float plage[] = { 0, 256 };
+    const float *plages[] = { plage };
+    calcHist(&image, 1, canaux, Mat(), h, 1, tailles, plages);
+    for (int i = 0; i < 256; i++)
+        histogramme[i] = (uint32_t)h.at<float>(i);
+}
+
+static int pixelsDifferents(const Mat &a, const Mat &b)
+{
+    if (a.size() != b.size())
+        return a.rows * a.cols + 1;
+    int n = 0;
+    for (int y = 0; y < a.rows; y++){
+        const uint8_t *la = a.ptr<uint8_t>(y);
+        const uint8_t *lb = b.ptr<uint8_t>(y);
+        for (int x = 0; x < a.cols; x++)
+            n += la[x] != lb[x];
+    }
+    return n;
+}
+
+static double mediane(std::vector<double> temps)
+{
+    if (temps.empty())
+        return 0;
+    std::sort(temps.begin(), temps.end());
+    return temps[temps.size() / 2];
+}
+
+int main(int argc, char **argv)
+{
+    int iterations = 50;
+    std::vector<std::string> fichiers;
+    for (int i = 1; i < argc; i++){
+        std::string a = argv[i];
+        if (a == "--iterations" && i + 1 < argc){
+            iterations = std::max(atoi(argv[++i]), 1);
+        } else if (a[0] == '-'){
+            fprintf(stderr, "Utilisation : BancPretraitement [--iterations n] [image ...]\n");
+            return 1;
+        } else {
+            fichiers.push_back(a);
+        }
+    }
+
+    std::vector<ImageEssai> images;
+    const int tailles[][2] = { { 1640, 1232 }, { 1280, 720 }, { 640, 480 }, { 129, 67 }, { 66, 33 }, { 31, 5 } };
+    const char *natures[] = { "bruit", "degrade", "contraste" };
+    for (size_t t = 0; t < sizeof(tailles) / sizeof(tailles[0]); t++)
+        for (size_t n = 0; n < sizeof(natures) / sizeof(natures[0]); n++)
+            images.push_back(creerImage(natures[n], tailles[t][0], tailles[t][1]));
+    for (size_t f = 0; f < fichiers.size(); f++){
+        Mat lue = imread(fichiers[f], IMREAD_GRAYSCALE);
+        if (lue.empty()){
+            fprintf(stderr, "%s : image illisible\n", fichiers[f].c_str());
+            return 1;
+        }
+        ImageEssai essai;
+        essai.nom = fichiers[f];
+        essai.tampon = Mat(lue.rows, (lue.cols + 31) & ~31, CV_8UC1, Scalar(0));
+        essai.image = essai.tampon(Rect(0, 0, lue.cols, lue.rows));
+        lue.copyTo(essai.image);
+        images.push_back(essai);
+    }
+
+    printf("noyau %s, %d passages, temps médians en ms\n", jeuInstructions(), iterations);
+    printf("%-26s %7s %10s %10s %10s | %9s %9s %9s %8s\n", "image", "facteur", "retourner", "vectorise", "reference",
+           "opencv", "vectorise", "reference", "gain");
+
+    int erreurs = 0;
+    Mat retournee, reduite, attendu;
+    for (size_t i = 0; i < images.size(); i++){
+        const Mat &source = images[i].image;
+        for (int facteur = 1; facteur <= 2; facteur++){
+            for (int retourner = 0; retourner <= 1; retourner++){
+                int largeurSortie = source.cols / facteur;
+                int hauteurSortie = source.rows / facteur;
+                // sorties de pas différent de la largeur, comme l'image de détection de l'application.
+                Mat sortieVectorise(hauteurSortie, largeurSortie + 3, CV_8UC1, Scalar(0));
+                Mat sortieReference(hauteurSortie, largeurSortie + 3, CV_8UC1, Scalar(0));
+                Mat vectorise = sortieVectorise(Rect(0, 0, largeurSortie, hauteurSortie));
+                Mat reference = sortieReference(Rect(0, 0, largeurSortie, hauteurSortie));
+                uint32_t histogrammeVectorise[256], histogrammeReference[256], histogrammeAttendu[256];
+
+                pretraiterOpenCV(source, facteur, retourner != 0, retournee, reduite, attendu);
+                histogrammeOpenCV(facteur == 2 ? reduite : (retourner ? retournee : source), histogrammeAttendu);
+                pretraiterImage(source.data, source.cols, source.rows, source.step, facteur, retourner != 0,
+                                vectorise.data, vectorise.step, histogrammeVectorise);
+                pretraiterImageReference(source.data, source.cols, source.rows, source.step, facteur, retourner != 0,
+                                         reference.data, reference.step, histogrammeReference);
+
+                int ecartVectorise = pixelsDifferents(vectorise, attendu);
+                int ecartReference = pixelsDifferents(reference, attendu);
+                bool histogrammesEgaux = memcmp(histogrammeVectorise, histogrammeAttendu, sizeof(histogrammeAttendu)) == 0
+                        && memcmp(histogrammeReference, histogrammeAttendu, sizeof(histogrammeAttendu)) == 0;
+                erreurs += ecartVectorise != 0 || ecartReference != 0 || !histogrammesEgaux;
+
+                std::vector<double> tempsOpenCV, tempsVectorise, tempsReference;
+                for (int k = 0; k < iterations; k++){
+                    uint64_t t0 = MesureLatence::horloge();
+                    pretraiterOpenCV(source, facteur, retourner != 0, retournee, reduite, attendu);
+                    uint64_t t1 = MesureLatence::horloge();
+                    pretraiterImage(source.data, source.cols, source.rows, source.step, facteur, retourner != 0,
+                                    vectorise.data, vectorise.step, histogrammeVectorise);
+                    uint64_t t2 = MesureLatence::horloge();
+                    pretraiterImageReference(source.data, source.cols, source.rows, source.step, facteur, retourner != 0,
+                                             reference.data, reference.step, histogrammeReference);
+                    uint64_t t3 = MesureLatence::horloge();
+                    tempsOpenCV.push_back((t1 - t0) / 1000.);
+                    tempsVectorise.push_back((t2 - t1) / 1000.);
+                    tempsReference.push_back((t3 - t2) / 1000.);
+                }
+
+                char colonneVectorise[16], colonneReference[16];
+                snprintf(colonneVectorise, sizeof(colonneVectorise), "%s", ecartVectorise == 0 ? "identique" : "");
+                snprintf(colonneReference, sizeof(colonneReference), "%s", ecartReference == 0 ? "identique" : "");
+                if (ecartVectorise != 0)
+                    snprintf(colonneVectorise, sizeof(colonneVectorise), "%d px", ecartVectorise);
+                if (ecartReference != 0)
+                    snprintf(colonneReference, sizeof(colonneReference), "%d px", ecartReference);
+                double opencv = mediane(tempsOpenCV), noyau = mediane(tempsVectorise);
+                printf("%-26s %7d %10s %10s %10s | %9.3f %9.3f %9.3f %7.2fx%s\n", images[i].nom.c_str(), facteur,
+                       retourner ? "oui" : "non", colonneVectorise, colonneReference, opencv, noyau, mediane(tempsReference),
+                       noyau > 0 ? opencv / noyau : 0., histogrammesEgaux ? "" : "  histogramme différent");
+            }
+        }
+    }
+
+    if (erreurs > 0){
+        printf("%d cas différents d'OpenCV\n", erreurs);
+        return 2;
+    }
+    printf("tous les cas identiques à OpenCV\n");
+    return 0;
+}
@@ -0,0 +1,32 @@
+#-------------------------------------------------
+#
+# Bail des trames capturées, hors de la raspi : relecture d'images avec SourceFichier, une nouvelle capture doit être
+# refusée tant qu'une vue de la trame précédente existe
+# (voir ../ProjetSY25Berthelon_Bucheron/sourceimages.h)
+#
+#-------------------------------------------------
+
+TEMPLATE = app
+TARGET = BancSources
+CONFIG += console c++11
+CONFIG -= qt app_bundle
+
+INCLUDEPATH += ../ProjetSY25Berthelon_Bucheron ../ControlMoteurArduino
+
+# Pas de libraspicam sur un PC : sources fichier et nacelle simulée seulement.
+DEFINES += SANS_RASPICAM
+
+SOURCES += main.cpp \
+    ../ProjetSY25Berthelon_Bucheron/sourceimages.cpp \
+    ../ProjetSY25Berthelon_Bucheron/simulateurnacelle.cpp \
+    ../ProjetSY25Berthelon_Bucheron/mesurelatence.cpp \
+    ../ControlMoteurArduino/planificateurmouvement.cpp
+
+HEADERS += ../ProjetSY25Berthelon_Bucheron/sourceimages.h \
+    ../ProjetSY25Berthelon_Bucheron/simulateurnacelle.h \
+    ../ProjetSY25Berthelon_Bucheron/mesurelatence.h \
+    ../ControlMoteurArduino/planificateurmouvement.h \
+    ../ControlMoteurArduino/trametelemetrie.h
+
+CONFIG += link_pkgconfig
+PKGCONFIG += opencv
@@ -0,0 +1,165 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Vérification du bail des trames (../ProjetSY25Berthelon_Bucheron/sourceimages.h), sans la raspi :
+ * une suite d'images synthétiques (une valeur par image) est écrite dans --dossier puis relue avec SourceFichier,
+ * comme la caméra (vues sans copie sur le tampon de la source).
+ *
+ * Cas vérifiés, dans l'ordre :
+ *  - la trame n'est pas libérée : la capture suivante est refusée (acquerir() ne rend pas le bail de la trame passée) ;
+ *  - une vue (copie cv::Mat de luminance) est gardée après liberer() : refusée, et la vue garde son image ;
+ *  - une sous-image de la vue est gardée seule : refusée ; une fois rendue, la capture reprend ;
+ *  - une copie profonde (clone) ne tient pas le bail ;
+ *  - haute résolution (détection réduite) : une vue sur l'image pleine résolution (pleineY) tient aussi le bail ;
+ *  - capturesRefusees() compte chacun des refus.
+ *
+ * Code de retour : 0 si tous les cas sont bons, 2 sinon.
+ *
+ * Utilisation : BancSources [--dossier d] (défaut /tmp)
+ */
+#include "sourceimages.h"
+
+#include "opencv2/core/core.hpp"
+#include "opencv2/imgcodecs/imgcodecs.hpp"
+#include <cstdio>
+#include <string>
+
+#define NOMBRE_IMAGES 8
+#define LARGEUR_IMAGE 320
+#define HAUTEUR_IMAGE 240
+
+using namespace cv;
+
+static int nbErreurs = 0;
+
+static void verifier(bool condition, const char *cas)
+{
+    printf("%-70s %s\n", cas, condition ? "ok" : "ERREUR");
+    if (!condition)
+        nbErreurs++;
+}
+
+/*
+ * Valeur de l'image i de la suite (toutes différentes, pour voir si un tampon a été réécrit).
+ */
+static int valeurImage(int i)
+{
+    return 20 + 25 * i;
+}
+
+static bool uniforme(const Mat &image, int valeur)
+{
+    if (image.empty())
+        return false;
+    for (int y = 0; y < image.rows; y++){
+        const uint8_t *ligne = image.ptr<uint8_t>(y);
+        for (int x = 0; x < image.cols; x++){
+            if (ligne[x] != valeur)
+                return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Bail des vues de luminance (relecture à la taille des images).
+ */
+static void verifierVues(const std::string &motif)
+{
+    SourceFichier source(motif, true, false);
+    if (!source.ouvrir()){
+        verifier(false, "ouverture de la suite d'images");
+        return;
+    }
+    TrameCapture trame;
+    int refus = 0;
+
+    verifier(source.acquerir(trame) && uniforme(trame.luminance, valeurImage(0)), "première capture");
+
+    verifier(!source.acquerir(trame), "trame non libérée : capture refusée");
+    refus++;
+    verifier(uniforme(trame.luminance, valeurImage(0)), "trame non libérée : image intacte");
+
+    Mat vue = trame.luminance;
+    trame.liberer();
+    verifier(!source.acquerir(trame), "vue gardée après liberer() : capture refusée");
+    refus++;
+    verifier(uniforme(vue, valeurImage(0)), "vue gardée : image intacte");
+
+    Mat sousImage = vue(Rect(10, 10, 50, 40));
+    vue.release();
+    verifier(!source.acquerir(trame), "sous-image gardée seule : capture refusée");
+    refus++;
+    verifier(uniforme(sousImage, valeurImage(0)), "sous-image gardée : image intacte");
+    sousImage.release();
+
+    verifier(source.acquerir(trame) && uniforme(trame.luminance, valeurImage(1)), "toutes les vues rendues : capture suivante");
+
+    Mat copie = trame.luminance.clone();
+    trame.liberer();
+    verifier(source.acquerir(trame), "copie profonde gardée : capture acceptée");
+    verifier(uniforme(copie, valeurImage(1)) && uniforme(trame.luminance, valeurImage(2)), "copie profonde : image de la capture précédente");
+    trame.liberer();
+
+    verifier(source.capturesRefusees() == refus, "capturesRefusees() compte les refus");
+}
+
+/*
+ * Haute résolution : la détection reçoit une copie réduite, la trame garde des vues sur l'image entière.
+ */
+static void verifierPleineResolution(const std::string &motif)
+{
+    SourceFichier source(motif, true, false, LARGEUR_IMAGE / 2, HAUTEUR_IMAGE / 2);
+    if (!source.ouvrir()){
+        verifier(false, "ouverture de la suite d'images (haute résolution)");
+        return;
+    }
+    TrameCapture trame;
+    bool capturee = source.acquerir(trame);
+    verifier(capturee && trame.luminance.cols == LARGEUR_IMAGE / 2 && trame.pleineY.cols == LARGEUR_IMAGE,
+             "haute résolution : détection réduite et image entière");
+
+    Mat pleine = trame.pleineY;
+    trame.liberer();
+    verifier(!source.acquerir(trame), "haute résolution : vue pleineY gardée, capture refusée");
+    verifier(uniforme(pleine, valeurImage(0)), "haute résolution : vue pleineY intacte");
+    pleine.release();
+    verifier(source.acquerir(trame), "haute résolution : vue rendue, capture acceptée");
+    trame.liberer();
+}
+
+int main(int argc, char **argv)
+{
+    std::string dossier = "/tmp";
+    for (int i = 1; i < argc; i++){
+        std::string a = argv[i];
+        if (a == "--dossier" && i + 1 < argc){
+            dossier = argv[++i];
+        } else {
+            fprintf(stderr, "Utilisation : BancSources [--dossier d]\n");
+            return 1;
+        }
+    }
+
+    for (int i = 0; i < NOMBRE_IMAGES; i++){
+        char nom[512];
+        snprintf(nom, sizeof(nom), "%s/banc_sources_%04d.png", dossier.c_str(), i);
+        Mat image(HAUTEUR_IMAGE, LARGEUR_IMAGE, CV_8UC1, Scalar(valeurImage(i)));
+        if (!imwrite(nom, image)){
+            fprintf(stderr, "%s : écriture impossible\n", nom);
+            return 1;
+        }
+    }
+    std::string motif = dossier + "/banc_sources_%04d.png";
+
+    verifierVues(motif);
+    verifierPleineResolution(motif);
+
+    if (nbErreurs > 0){
+        printf("%d cas en erreur\n", nbErreurs);
+        return 2;
+    }
+    printf("tous les cas sont bons\n");
+    return 0;
+}
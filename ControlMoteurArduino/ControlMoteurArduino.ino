@@ -1,69 +1,222 @@
-
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Commande des deux servomoteurs de la nacelle par la liaison série (115200 bauds), mêmes commandes qu'avant :
+ *  - 'H' / 'h' : cible horizontale +2° / -2° ; 'V' / 'v' : idem pour la verticale ;
+ *  - 'r' : les deux cibles à 90° ;
+ *  - 'L' / 'l' : allume / éteint la led (réponse "OL" / "Ol") ; tout autre octet : réponse "Err".
+ *
+ * Le programme ne bloque jamais : les octets reçus sont rangés dans une file circulaire par serialEvent(),
+ * loop() les interprète (une commande ne fait que déplacer une cible) puis, toutes les PERIODE_MOUVEMENT_US (micros()),
+ * fait avancer la trajectoire de chaque servo vers sa cible, limitée en vitesse et en accélération
+ * (voir planificateurmouvement.h, compilé aussi par le simulateur de nacelle de l'application).
+ * Une rafale de commandes ne fait donc que reculer la cible, au lieu de bloquer 15 ms par octet avec delay().
+ * Les cibles sont bornées à 0 - 180°.
+ *
+ * Toutes les PERIODE_TELEMETRIE_US, une trame binaire (voir trametelemetrie.h) donne à la raspi les cibles, les angles
+ * commandés, les octets en attente et le nombre de commandes exécutées. Si le tampon d'émission n'a pas la place,
+ * la trame est sautée plutôt que d'attendre.
+ * Les réponses ("OL", "Ol", "Err") passent aussi par une file : chacune n'est écrite que quand le tampon d'émission
+ * a la place de la réponse entière, Serial.print() n'attend donc jamais. File pleine : la réponse est perdue.
+ */
 #include <Servo.h>
+#include "planificateurmouvement.h"
+#include "trametelemetrie.h"
+
+// File circulaire des octets reçus (une case reste vide pour distinguer pleine et vide).
+#define TAILLE_FILE 64
+
+// File circulaire des réponses à envoyer (même principe).
+#define TAILLE_REPONSES 16
+
+// Impulsions de Servo.write() pour 0° et 180° (valeurs par défaut de la bibliothèque Servo).
+#define IMPULSION_MIN_US 544
+#define IMPULSION_MAX_US 2400
 
 Servo servoH;
 Servo servoV;
 
-int posH = 90, posV = 90;
+PlanificateurMouvement mouvementH(90.0f);
+PlanificateurMouvement mouvementV(90.0f);
+
+// Rempli par serialEvent(), vidé par loop() : chaque index n'est écrit que d'un côté.
+volatile char file[TAILLE_FILE];
+volatile uint8_t debutFile = 0;
+volatile uint8_t finFile = 0;
+
+// Réponses en attente d'envoi, remplies et vidées par loop().
+enum Reponse { REPONSE_OL, REPONSE_OL_ETEINTE, REPONSE_ERR };
+const char *const TEXTES_REPONSES[] = { "OL\r\n", "Ol\r\n", "Err\r\n" };
+uint8_t reponses[TAILLE_REPONSES];
+uint8_t debutReponses = 0;
+uint8_t finReponses = 0;
+
+unsigned long dernierPas = 0;
+unsigned long derniereTelemetrie = 0;
+uint8_t numeroTrame = 0;
+uint8_t commandesExecutees = 0;
+int impulsionH = -1, impulsionV = -1;
+
+/*
+ * Angle (fractionnaire) vers la largeur d'impulsion du servo : plus fin que le degré entier de Servo.write().
+ */
+int impulsion(float angle)
+{
+    return IMPULSION_MIN_US + (int)(angle * (IMPULSION_MAX_US - IMPULSION_MIN_US) / 180.0f + 0.5f);
+}
+
+/*
+ * N'écrit que si l'impulsion a changé.
+ */
+void ecrireServo(Servo &servo, int &derniere, float angle)
+{
+    int largeur = impulsion(angle);
+    if (largeur != derniere){
+        servo.writeMicroseconds(largeur);
+        derniere = largeur;
+    }
+}
 
 // the setup function runs once when you press reset or power the board
 void setup() {
-  // initialize digital pin LED_BUILTIN as an output.
   servoH.attach(8);
   servoV.attach(9);
+  ecrireServo(servoH, impulsionH, mouvementH.position());
+  ecrireServo(servoV, impulsionV, mouvementV.position());
   pinMode(LED_BUILTIN, OUTPUT);
   Serial.begin(115200);
+  dernierPas = derniereTelemetrie = micros();
+}
+
+/*
+ * Angle en centièmes de degré pour la télémétrie.
+ */
+int16_t centiemes(float angle)
+{
+  return (int16_t)(angle * 100.0f + (angle >= 0.0f ? 0.5f : -0.5f));
+}
+
+void envoyerTelemetrie(unsigned long maintenant) {
+  if (Serial.availableForWrite() < TAILLE_TRAME_TELEMETRIE)
+    return;
+  TrameTelemetrie t;
+  t.numero = numeroTrame++;
+  t.instant = maintenant;
+  t.cibleH = centiemes(mouvementH.cible());
+  t.cibleV = centiemes(mouvementV.cible());
+  t.angleH = centiemes(mouvementH.position());
+  t.angleV = centiemes(mouvementV.position());
+  int enAttente = (finFile - debutFile + TAILLE_FILE) % TAILLE_FILE + Serial.available();
+  t.enAttente = enAttente > 255 ? 255 : enAttente;
+  t.commandes = commandesExecutees;
+  uint8_t trame[TAILLE_TRAME_TELEMETRIE];
+  encoderTelemetrie(t, trame);
+  Serial.write(trame, TAILLE_TRAME_TELEMETRIE);
+}
+
+/*
+ * Range une réponse dans la file (perdue si la file est pleine).
+ */
+void repondre(Reponse reponse) {
+  uint8_t suivant = (finReponses + 1) % TAILLE_REPONSES;
+  if (suivant == debutReponses)
+    return;
+  reponses[finReponses] = reponse;
+  finReponses = suivant;
+}
+
+/*
+ * Envoie les réponses en attente tant que le tampon d'émission a la place d'une réponse entière.
+ */
+void envoyerReponses() {
+  while (debutReponses != finReponses) {
+    const char *texte = TEXTES_REPONSES[reponses[debutReponses]];
+    size_t longueur = strlen(texte);
+    if ((size_t)Serial.availableForWrite() < longueur)
+      return;
+    Serial.write((const uint8_t *)texte, longueur);
+    debutReponses = (debutReponses + 1) % TAILLE_REPONSES;
+  }
+}
+
+/*
+ * Interprète une commande : seules les cibles changent (ou la led), le mouvement et les réponses sont faits par loop().
+ */
+void executer(char commande) {
+  commandesExecutees++;
+  switch(commande){
+    case 'l':
+      digitalWrite(LED_BUILTIN, LOW);    // turn the LED off by making the voltage LOW
+      repondre(REPONSE_OL_ETEINTE);
+      break;
+    case 'L':
+      digitalWrite(LED_BUILTIN, HIGH);   // turn the LED on by making the voltage HIGH
+      repondre(REPONSE_OL);
+      break;
+    case 'v':
+      mouvementV.decaler(-PAS_COMMANDE_SERVO);
+      break;
+    case 'V':
+      mouvementV.decaler(PAS_COMMANDE_SERVO);
+      break;
+    case 'h':
+      mouvementH.decaler(-PAS_COMMANDE_SERVO);
+      break;
+    case 'H':
+      mouvementH.decaler(PAS_COMMANDE_SERVO);
+      break;
+    case 'r':
+      mouvementH.viser(90.0f);
+      mouvementV.viser(90.0f);
+      break;
+    case '\n':
+    default:
+      repondre(REPONSE_ERR);
+      break;
+  }
 }
 
 // the loop function runs over and over again forever
 void loop() {
+  // commandes reçues depuis le dernier tour.
+  while (debutFile != finFile) {
+    char commande = file[debutFile];
+    debutFile = (debutFile + 1) % TAILLE_FILE;
+    executer(commande);
+  }
+  envoyerReponses();
+
+  // pas de la trajectoire (la soustraction reste juste quand micros() repasse par zéro, toutes les 70 minutes).
+  unsigned long maintenant = micros();
+  unsigned long ecoule = maintenant - dernierPas;
+  if (ecoule >= PERIODE_MOUVEMENT_US) {
+    dernierPas = maintenant;
+    float duree = ecoule * 1e-6f;
+    mouvementH.avancer(duree);
+    mouvementV.avancer(duree);
+    ecrireServo(servoH, impulsionH, mouvementH.position());
+    ecrireServo(servoV, impulsionV, mouvementV.position());
+  }
+
+  if (maintenant - derniereTelemetrie >= PERIODE_TELEMETRIE_US) {
+    derniereTelemetrie += PERIODE_TELEMETRIE_US; // cadence fixe, sans dériver avec la durée des tours de loop().
+    if (maintenant - derniereTelemetrie >= PERIODE_TELEMETRIE_US)
+      derniereTelemetrie = maintenant; // retard de plus d'une période : on ne rattrape pas les trames manquées.
+    envoyerTelemetrie(maintenant);
+  }
 }
 
+/*
+ * Appelée entre deux tours de loop() quand des octets sont arrivés : ils sont juste rangés dans la file.
+ * File pleine : l'octet reste dans le tampon de la liaison série jusqu'au tour suivant.
+ */
 void serialEvent() {
   while (Serial.available()) {
-    byte receivedCommand = Serial.read();
-
-    switch(receivedCommand){
-      case 'l':
-        digitalWrite(LED_BUILTIN, LOW);    // turn the LED off by making the voltage LOW
-        Serial.println("Ol");
-        break;
-      case 'L':
-        digitalWrite(LED_BUILTIN, HIGH);    // turn the LED off by making the voltage LOW
-        Serial.println("OL");
-        break;
-      case 'v':
-        servoV.write(posV - 2);
-        posV = posV - 2;
-        delay(15);
-        break;
-      case 'V':
-        servoV.write(posV + 2);
-        posV = posV + 2;
-        delay(15);
-        break;
-      case 'h':
-        servoH.write(posH - 2);
-        posH = posH - 2;
-        delay(15);
-        break;
-      case 'H': 
-        servoH.write(posH + 2);
-        posH = posH + 2;
-        delay(15);
-        break; 
-      case 'r': 
-        servoH.write(90);
-        posH = 90;
-        delay(15);
-        servoV.write(90);
-        posV = 90;
-        delay(15);
-        break; 
-      case '\n':
-       default:
-        Serial.println("Err");
-        break;
-      }
-    }
+    uint8_t suivant = (finFile + 1) % TAILLE_FILE;
+    if (suivant == debutFile)
+      break;
+    file[finFile] = Serial.read();
+    finFile = suivant;
   }
+}
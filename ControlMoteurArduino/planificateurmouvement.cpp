@@ -0,0 +1,77 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Trajectoire d'un servomoteur limitée en vitesse et en accélération (commune à l'arduino et au simulateur).
+ */
+#include "planificateurmouvement.h"
+
+#include <math.h>
+
+PlanificateurMouvement::PlanificateurMouvement(float position, float vitesseMax, float acceleration, float angleMin, float angleMax) :
+    vitesseMax(vitesseMax),
+    acceleration(acceleration),
+    angle(position),
+    vitesseCourante(0.0f),
+    objectif(position),
+    angleMin(angleMin),
+    angleMax(angleMax)
+{
+    placer(position);
+}
+
+float PlanificateurMouvement::borner(float valeur) const
+{
+    return valeur <= angleMin ? angleMin : (valeur >= angleMax ? angleMax : valeur); // -0 rendu comme angleMin.
+}
+
+void PlanificateurMouvement::viser(float angle)
+{
+    objectif = borner(angle);
+}
+
+void PlanificateurMouvement::placer(float position)
+{
+    angle = objectif = borner(position);
+    vitesseCourante = 0.0f;
+}
+
+void PlanificateurMouvement::avancer(float duree)
+{
+    if (duree <= 0.0f || estArrive())
+        return;
+
+    float ecart = objectif - angle;
+    float distance = fabsf(ecart);
+    float sens = ecart >= 0.0f ? 1.0f : -1.0f;
+    float pasVitesse = acceleration * duree;
+
+    // Vitesse voulue : la plus grande qui permet encore de s'arrêter sur la cible en freinant de a.dt par pas
+    // (v²/2a + v.dt/2 = d, version par pas de v² = 2 a d), plafonnée à la vitesse maximum.
+    float demiPas = 0.5f * pasVitesse;
+    float vitesseArret = sqrtf(demiPas * demiPas + 2.0f * acceleration * distance) - demiPas;
+    float voulue = sens * (vitesseArret < vitesseMax ? vitesseArret : vitesseMax);
+
+    // La vitesse ne change pas de plus de a.dt par pas.
+    if (voulue > vitesseCourante + pasVitesse)
+        vitesseCourante += pasVitesse;
+    else if (voulue < vitesseCourante - pasVitesse)
+        vitesseCourante -= pasVitesse;
+    else
+        vitesseCourante = voulue;
+
+    float suivant = angle + vitesseCourante * duree;
+
+    // Cible atteinte ou dépassée en freinant (le dernier pas tombe rarement pile) : arrêt sur la cible.
+    // Un dépassement à pleine vitesse (cible changée derrière le servo) est gardé, le freinage le ramènera,
+    // sauf au delà des bornes : le servo s'arrête en butée.
+    if ((objectif - suivant) * sens <= 0.0f && fabsf(vitesseCourante) <= vitesseArret + pasVitesse){
+        angle = objectif;
+        vitesseCourante = 0.0f;
+    } else if (suivant <= angleMin || suivant >= angleMax){
+        angle = borner(suivant);
+        vitesseCourante = 0.0f;
+    } else {
+        angle = suivant;
+    }
+}
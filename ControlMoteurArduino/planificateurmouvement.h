@@ -0,0 +1,57 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Trajectoire d'un servomoteur vers un angle cible, limitée en vitesse et en accélération (profil trapézoïdal) :
+ * le servo accélère, plafonne à la vitesse maximum, puis freine pour s'arrêter sur la cible.
+ * Si la cible change en route, la trajectoire repart de la position et de la vitesse courantes.
+ *
+ * C++ simple, sans l'API arduino (ni allocation, ni bibliothèque standard) : le même fichier est compilé
+ * dans le programme de l'arduino et sur la raspi / le PC par le simulateur de nacelle (SimulateurNacelle).
+ * Profil vérifié et avancer() chronométré sur le PC par ../BancPlanificateur.
+ */
+#ifndef PLANIFICATEURMOUVEMENT_H
+#define PLANIFICATEURMOUVEMENT_H
+
+// Réglages du programme de l'arduino, repris par le simulateur.
+#define VITESSE_MAX_SERVO 200.0f      // °/s
+#define ACCELERATION_SERVO 2000.0f    // °/s² (un pas de 2° dure 63 ms : fini avant l'image suivante de l'application)
+#define PERIODE_MOUVEMENT_US 5000UL   // pas de la boucle de mouvement
+#define PAS_COMMANDE_SERVO 2.0f       // déplacement de la cible pour une commande 'H', 'h', 'V' ou 'v'
+
+class PlanificateurMouvement
+{
+public:
+    PlanificateurMouvement(float position = 90.0f, float vitesseMax = VITESSE_MAX_SERVO, float acceleration = ACCELERATION_SERVO,
+                           float angleMin = 0.0f, float angleMax = 180.0f);
+
+    // Nouvelle cible (bornée à angleMin - angleMax).
+    void viser(float angle);
+    // Déplace la cible de "ecart" degrés.
+    void decaler(float ecart) { viser(objectif + ecart); }
+
+    // Avance la trajectoire de "duree" secondes.
+    void avancer(float duree);
+
+    // Place l'axe immobile à cet angle (cible comprise).
+    void placer(float angle);
+
+    float position() const { return angle; }
+    float vitesse() const { return vitesseCourante; }
+    float cible() const { return objectif; }
+    bool estArrive() const { return angle == objectif && vitesseCourante == 0.0f; }
+
+    float vitesseMax;
+    float acceleration;
+
+private:
+    float borner(float valeur) const;
+
+    float angle;
+    float vitesseCourante;
+    float objectif;
+    float angleMin;
+    float angleMax;
+};
+
+#endif // PLANIFICATEURMOUVEMENT_H
@@ -0,0 +1,99 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Trame de télémétrie envoyée par l'arduino toutes les PERIODE_TELEMETRIE_US, au milieu des réponses texte ("OL", "Err"...).
+ * 18 octets, entiers en petit boutiste :
+ *   0-1   : synchronisation 0xA5 0x5A (jamais dans le texte, qui reste en ASCII)
+ *   2     : numéro de trame (modulo 256, pour compter les trames perdues)
+ *   3-6   : instant de la trame, micros() de l'arduino (modulo 2^32)
+ *   7-8   : cible horizontale, 9-10 : cible verticale (centièmes de degré)
+ *   11-12 : angle horizontal, 13-14 : angle vertical : position de la trajectoire écrite aux servos (centièmes de degré ;
+ *           les servos n'ont pas de retour de position, c'est l'angle commandé à cet instant)
+ *   15    : octets en attente de lecture (file circulaire et tampon de la liaison série)
+ *   16    : nombre de commandes exécutées (modulo 256), pour relier une commande de la raspi à son exécution
+ *   17    : CRC-8 (polynôme 0x07) des octets 2 à 16
+ *
+ * Inclus par le programme de l'arduino et par l'application (TelemetrieServo, SimulateurNacelle).
+ */
+#ifndef TRAMETELEMETRIE_H
+#define TRAMETELEMETRIE_H
+
+#include <stdint.h>
+
+#define SYNCHRO_TELEMETRIE_1 0xA5
+#define SYNCHRO_TELEMETRIE_2 0x5A
+#define TAILLE_TRAME_TELEMETRIE 18
+#define PERIODE_TELEMETRIE_US 20000UL
+
+struct TrameTelemetrie {
+    uint8_t numero;
+    uint32_t instant;
+    int16_t cibleH;
+    int16_t cibleV;
+    int16_t angleH;
+    int16_t angleV;
+    uint8_t enAttente;
+    uint8_t commandes;
+};
+
+static inline uint8_t crcTelemetrie(const uint8_t *octets, uint8_t n)
+{
+    uint8_t crc = 0;
+    for (uint8_t i = 0; i < n; i++){
+        crc ^= octets[i];
+        for (uint8_t b = 0; b < 8; b++)
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+    }
+    return crc;
+}
+
+static inline void ecrire16(uint8_t *o, int16_t valeur)
+{
+    o[0] = (uint8_t)valeur;
+    o[1] = (uint8_t)((uint16_t)valeur >> 8);
+}
+
+static inline int16_t lire16(const uint8_t *o)
+{
+    return (int16_t)(o[0] | (o[1] << 8));
+}
+
+static inline void encoderTelemetrie(const TrameTelemetrie &t, uint8_t *trame)
+{
+    trame[0] = SYNCHRO_TELEMETRIE_1;
+    trame[1] = SYNCHRO_TELEMETRIE_2;
+    trame[2] = t.numero;
+    for (uint8_t i = 0; i < 4; i++)
+        trame[3 + i] = (uint8_t)(t.instant >> (8*i));
+    ecrire16(trame + 7, t.cibleH);
+    ecrire16(trame + 9, t.cibleV);
+    ecrire16(trame + 11, t.angleH);
+    ecrire16(trame + 13, t.angleV);
+    trame[15] = t.enAttente;
+    trame[16] = t.commandes;
+    trame[17] = crcTelemetrie(trame + 2, TAILLE_TRAME_TELEMETRIE - 3);
+}
+
+/*
+ * Retourne false si la synchronisation ou le CRC ne correspondent pas.
+ */
+static inline bool decoderTelemetrie(const uint8_t *trame, TrameTelemetrie &t)
+{
+    if (trame[0] != SYNCHRO_TELEMETRIE_1 || trame[1] != SYNCHRO_TELEMETRIE_2
+            || crcTelemetrie(trame + 2, TAILLE_TRAME_TELEMETRIE - 3) != trame[17])
+        return false;
+    t.numero = trame[2];
+    t.instant = 0;
+    for (uint8_t i = 0; i < 4; i++)
+        t.instant |= (uint32_t)trame[3 + i] << (8*i);
+    t.cibleH = lire16(trame + 7);
+    t.cibleV = lire16(trame + 9);
+    t.angleH = lire16(trame + 11);
+    t.angleV = lire16(trame + 13);
+    t.enAttente = trame[15];
+    t.commandes = trame[16];
+    return true;
+}
+
+#endif // TRAMETELEMETRIE_H
@@ -0,0 +1,525 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Evaluation de la détection sur un jeu d'images annotées : pour chaque configuration (réglages de DetecteurVisage),
+ * précision et rappel des visages, répartition de l'IoU, exactitude du sourire et des yeux, et temps par image.
+ * Sert à vérifier qu'une optimisation de detectFace() ou des cascades ne perd pas de visages.
+ *
+ * Jeu d'images : un dossier contenant les images et un fichier annotations.csv (format dans jeuannote.h).
+ *
+ * Configurations : un fichier, une configuration par ligne : nom cle=valeur ... avec les clés de lireReglages() (jeuannote.h) :
+ * echelle, facteur, voisins, taille_min, taille_max, internes, facteur_sourire, voisins_sourire, facteur_yeux, voisins_yeux,
+ * periode_expression (les clés absentes gardent les valeurs de ReglagesDetection). Sans fichier : les niveaux du contrôleur
+ * de qualité, avec detectMultiScale puis avec les cascades internes. Pour chercher la configuration la plus rapide
+ * à une justesse donnée : outil ReglageDetection.
+ *
+ * Sorties :
+ *  - le rapport (sortie standard ou -o) : une section [nom] par configuration, des lignes "cle = valeur" dans un ordre fixe,
+ *    sans date : deux rapports se comparent avec diff, les temps étant sur des lignes à part ;
+ *  - --reference ancien.txt : compare au rapport d'un passage précédent et signale les pertes de précision,
+ *    de rappel ou d'exactitude au delà de --tolerance (code de retour 2) ;
+ *  - --details dossier : pour chaque configuration, un fichier csv image par image (sans les temps), à comparer avec diff
+ *    pour retrouver les images qui ont changé ;
+ *  - --pareto fichier.svg : temps médian par image contre F1 des visages, les configurations non dominées reliées.
+ *
+ * Utilisation : EvaluationDetection [options] <dossier du jeu d'images>
+ *   --configurations fichier, --cascades dossier, --points modele, --iou seuil (défaut 0.5),
+ *   -o rapport.txt, --reference ancien.txt, --tolerance t (défaut 0.005), --details dossier, --pareto fichier.svg
+ */
+#include "detecteurvisage.h"
+#include "controleurqualite.h"
+#include "estimateurexpression.h"
+#include "jeuannote.h"
+#include "mesurelatence.h"
+#include "noyauxpretraitement.h"
+
+#include "opencv2/core/core.hpp"
+#include "opencv2/imgcodecs/imgcodecs.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Cases de la répartition de l'IoU des visages appariés (largeur 0.1).
+#define NB_CASES_IOU 10
+
+struct Options {
+    std::string dossier;
+    std::string fichierConfigurations;
+    std::string dossierCascades = "/usr/share/opencv/haarcascades";
+    std::string modelePoints;
+    double seuilIou = 0.5;
+    std::string rapport;
+    std::string reference;
+    double tolerance = 0.005;
+    std::string details;
+    std::string pareto;
+};
+
+struct Configuration {
+    std::string nom;
+    ReglagesDetection reglages;
+    bool internes = false;
+};
+
+static const char *NOMS_EXPRESSION[3] = { "sourire", "oeil_gauche", "oeil_droit" };
+
+struct Resultats {
+    uint64_t images = 0;
+    uint64_t visages = 0;
+    uint64_t detections = 0;
+    uint64_t vraisPositifs = 0;
+    double sommeIou = 0;
+    std::vector<double> ious;
+    uint64_t casesIou[NB_CASES_IOU] = {};
+    uint64_t expressionsJustes[3] = {};
+    uint64_t expressionsEvaluees[3] = {};
+    HistogrammeLatence latence;
+    bool internesActives = false;
+
+    double precision() const { return detections > 0 ? (double)vraisPositifs / detections : 0.; }
+    double rappel() const { return visages > 0 ? (double)vraisPositifs / visages : 0.; }
+    double f1() const { double p = precision(), r = rappel(); return p + r > 0 ? 2*p*r / (p + r) : 0.; }
+};
+
+static std::string couper(const std::string &texte)
+{
+    size_t debut = texte.find_first_not_of(" \t\r\n");
+    size_t fin = texte.find_last_not_of(" \t\r\n");
+    return debut == std::string::npos ? std::string() : texte.substr(debut, fin - debut + 1);
+}
+
+/*
+ * Une configuration par ligne : nom cle=valeur ...
+ */
+static bool lireConfigurations(const std::string &chemin, std::vector<Configuration> &configurations)
+{
+    FILE *f = fopen(chemin.c_str(), "r");
+    if (!f){
+        perror(chemin.c_str());
+        return false;
+    }
+    char ligne[1024];
+    int numero = 0;
+    bool ok = true;
+    while (ok && fgets(ligne, sizeof(ligne), f)){
+        numero++;
+        std::string texte = couper(ligne);
+        if (texte.empty() || texte[0] == '#')
+            continue;
+
+        std::stringstream flux(texte);
+        Configuration c;
+        flux >> c.nom;
+        std::string reste, erreur;
+        std::getline(flux, reste);
+        if (!lireReglages(reste, c.reglages, c.internes, erreur)){
+            fprintf(stderr, "%s:%d : %s\n", chemin.c_str(), numero, erreur.c_str());
+            ok = false;
+        }
+        configurations.push_back(c);
+    }
+    fclose(f);
+    return ok && !configurations.empty();
+}
+
+/*
+ * Configurations par défaut : les niveaux du contrôleur de qualité, avec detectMultiScale puis les cascades internes.
+ */
+static void configurationsParDefaut(std::vector<Configuration> &configurations)
+{
+    for (int internes = 0; internes < 2; internes++){
+        for (int n = 0; n < ControleurQualite::nombreNiveaux(); n++){
+            Configuration c;
+            char nom[32];
+            snprintf(nom, sizeof(nom), "niveau%d%s", n, internes ? "_internes" : "");
+            c.nom = nom;
+            c.reglages.echelle = ControleurQualite::niveau(n).echelle;
+            c.reglages.facteurEchelle = ControleurQualite::niveau(n).facteurEchelle;
+            c.internes = internes != 0;
+            configurations.push_back(c);
+        }
+    }
+}
+
+/*
+ * Passe une configuration sur toutes les images. Les lignes du fichier de détails sont ajoutées à "details" (si non null).
+ */
+static bool evaluer(const Options &options, bool pretraitementVectorise, const Configuration &configuration,
+                    const std::vector<ImageAnnotee> &images, Resultats &resultats, FILE *details)
+{
+    DetecteurVisage detecteur;
+    if (!detecteur.charger(options.dossierCascades + "/haarcascade_frontalface_default.xml", options.dossierCascades + "/haarcascade_smile.xml",
+                           options.dossierCascades + "/haarcascade_lefteye_2splits.xml", options.dossierCascades + "/haarcascade_righteye_2splits.xml")){
+        fprintf(stderr, "%s : cascade de visage introuvable\n", options.dossierCascades.c_str());
+        return false;
+    }
+    resultats.internesActives = configuration.internes && detecteur.activerCascadesInternes();
+    if (configuration.internes && !resultats.internesActives)
+        fprintf(stderr, "%s : cascades illisibles par l'évaluateur interne, utilisation de detectMultiScale\n", configuration.nom.c_str());
+    detecteur.reglages = configuration.reglages;
+    detecteur.pretraitementVectorise = pretraitementVectorise;
+    EstimateurExpression estimateur;
+    if (!options.modelePoints.empty())
+        estimateur.charger(options.modelePoints);
+
+    if (details)
+        fprintf(details, "image,visages,detections,vrais_positifs,iou_plus_grand,sourire,oeil_gauche,oeil_droit\n");
+
+    std::vector<cv::Rect> detections;
+    std::vector<int> appariement;
+    std::vector<double> valeurs;
+    EtatExpression etat;
+    bool visagePrecedent = false;
+    int compteurExpression = 0;
+    for (size_t i = 0; i < images.size(); i++){
+        const ImageAnnotee &annotee = images[i];
+        cv::Mat image = cv::imread(options.dossier + "/" + annotee.chemin, cv::IMREAD_GRAYSCALE);
+        if (image.empty()){
+            fprintf(stderr, "%s : image illisible\n", annotee.chemin.c_str());
+            return false;
+        }
+
+        // Même traitement que detectFace() : visages, puis expression sur le plus grand
+        // (une image sur periodeExpression tant qu'un visage reste présent, les images étant dans l'ordre du fichier).
+        uint64_t debut = MesureLatence::horloge();
+        detecteur.detecterVisages(image, detections);
+        int plusGrand = DetecteurVisage::plusGrand(detections);
+        if (plusGrand >= 0 && !(visagePrecedent && ++compteurExpression % configuration.reglages.periodeExpression != 0)){
+            etat = EtatExpression();
+            if (!estimateur.estimer(image, detections[plusGrand], etat))
+                detecteur.detecterExpression(image, detections[plusGrand], etat);
+        }
+        visagePrecedent = plusGrand >= 0;
+        resultats.latence.ajouter(MesureLatence::horloge() - debut);
+
+        apparier(detections, annotee.visages, options.seuilIou, appariement, valeurs);
+        int vraisPositifs = 0;
+        for (size_t d = 0; d < detections.size(); d++){
+            if (appariement[d] < 0)
+                continue;
+            vraisPositifs++;
+            resultats.sommeIou += valeurs[d];
+            resultats.ious.push_back(valeurs[d]);
+            resultats.casesIou[std::min((int)(valeurs[d] * NB_CASES_IOU), NB_CASES_IOU - 1)]++;
+        }
+        resultats.images++;
+        resultats.visages += annotee.visages.size();
+        resultats.detections += detections.size();
+        resultats.vraisPositifs += vraisPositifs;
+
+        // L'expression n'est jugée que si le plus grand visage détecté est un vrai visage annoté.
+        bool valeursExpression[3] = { etat.smile, etat.leftEye, etat.rightEye };
+        char jugements[3] = { '-', '-', '-' };
+        if (plusGrand >= 0 && appariement[plusGrand] >= 0){
+            const VisageAnnote &visage = annotee.visages[appariement[plusGrand]];
+            for (int e = 0; e < 3; e++){
+                if (visage.etiquettes[e] < 0)
+                    continue;
+                bool juste = valeursExpression[e] == (visage.etiquettes[e] != 0);
+                resultats.expressionsEvaluees[e]++;
+                resultats.expressionsJustes[e] += juste;
+                jugements[e] = juste ? 'v' : 'x';
+            }
+        }
+
+        if (details){
+            fprintf(details, "%s,%zu,%zu,%d,%.2f,%c,%c,%c\n", annotee.chemin.c_str(), annotee.visages.size(), detections.size(), vraisPositifs,
+                    plusGrand >= 0 ? valeurs[plusGrand] : 0., jugements[0], jugements[1], jugements[2]);
+        }
+    }
+    return true;
+}
+
+static void ecrireSection(FILE *f, const Configuration &c, Resultats &r)
+{
+    const ReglagesDetection &g = c.reglages;
+    fprintf(f, "[%s]\n", c.nom.c_str());
+    fprintf(f, "reglages = %s\n", ecrireReglages(g, r.internesActives).c_str());
+    fprintf(f, "images = %llu\n", (unsigned long long)r.images);
+    fprintf(f, "visages = %llu\n", (unsigned long long)r.visages);
+    fprintf(f, "detections = %llu\n", (unsigned long long)r.detections);
+    fprintf(f, "vrais_positifs = %llu\n", (unsigned long long)r.vraisPositifs);
+    fprintf(f, "precision = %.4f\n", r.precision());
+    fprintf(f, "rappel = %.4f\n", r.rappel());
+    fprintf(f, "f1 = %.4f\n", r.f1());
+
+    std::sort(r.ious.begin(), r.ious.end());
+    fprintf(f, "iou_moyenne = %.4f\n", r.vraisPositifs > 0 ? r.sommeIou / r.vraisPositifs : 0.);
+    fprintf(f, "iou_mediane = %.4f\n", r.ious.empty() ? 0. : r.ious[r.ious.size() / 2]);
+    fprintf(f, "iou_repartition =");
+    for (int i = 0; i < NB_CASES_IOU; i++){
+        if (r.casesIou[i] > 0)
+            fprintf(f, " %.1f:%llu", (double)i / NB_CASES_IOU, (unsigned long long)r.casesIou[i]);
+    }
+    fprintf(f, "\n");
+
+    for (int e = 0; e < 3; e++){
+        fprintf(f, "exactitude_%s = %.4f (%llu)\n", NOMS_EXPRESSION[e],
+                r.expressionsEvaluees[e] > 0 ? (double)r.expressionsJustes[e] / r.expressionsEvaluees[e] : 0.,
+                (unsigned long long)r.expressionsEvaluees[e]);
+    }
+
+    // Les temps varient d'un passage à l'autre : lignes à part, en fin de section.
+    fprintf(f, "latence_moyenne_ms = %.2f\n", r.latence.moyenne() / 1000.);
+    fprintf(f, "latence_mediane_ms = %.1f\n", r.latence.centile(50) / 1000.);
+    fprintf(f, "latence_p90_ms = %.1f\n", r.latence.centile(90) / 1000.);
+    fprintf(f, "latence_p99_ms = %.1f\n", r.latence.centile(99) / 1000.);
+    fprintf(f, "latence_max_ms = %.1f\n", r.latence.maximum() / 1000.);
+    fprintf(f, "\n");
+}
+
+/*
+ * Lit un rapport : valeurs (nombre en tête de la valeur) par section et par clé.
+ */
+static bool lireRapport(const std::string &chemin, std::map<std::string, std::map<std::string, double> > &sections,
+                        std::vector<std::string> &ordre)
+{
+    FILE *f = fopen(chemin.c_str(), "r");
+    if (!f){
+        perror(chemin.c_str());
+        return false;
+    }
+    char ligne[1024];
+    std::string section;
+    while (fgets(ligne, sizeof(ligne), f)){
+        std::string texte = couper(ligne);
+        if (texte.size() > 2 && texte[0] == '[' && texte[texte.size() - 1] == ']'){
+            section = texte.substr(1, texte.size() - 2);
+            ordre.push_back(section);
+            continue;
+        }
+        size_t egal = texte.find(" = ");
+        if (section.empty() || egal == std::string::npos)
+            continue;
+        sections[section][texte.substr(0, egal)] = atof(texte.c_str() + egal + 3);
+    }
+    fclose(f);
+    return true;
+}
+
+/*
+ * Compare au rapport de référence. Retourne le nombre de régressions (baisse d'un indicateur de qualité au delà de la tolérance).
+ */
+static int comparer(FILE *sortie, const Options &options, const std::vector<Configuration> &configurations,
+                    const std::vector<Resultats> &resultats)
+{
+    std::map<std::string, std::map<std::string, double> > reference;
+    std::vector<std::string> ordre;
+    if (!lireRapport(options.reference, reference, ordre))
+        return -1;
+
+    static const char *QUALITE[] = { "precision", "rappel", "f1", "exactitude_sourire", "exactitude_oeil_gauche", "exactitude_oeil_droit" };
+    int regressions = 0;
+    fprintf(sortie, "comparaison avec %s (tolérance %.4f)\n", options.reference.c_str(), options.tolerance);
+    for (size_t i = 0; i < configurations.size(); i++){
+        std::map<std::string, std::map<std::string, double> >::const_iterator s = reference.find(configurations[i].nom);
+        if (s == reference.end()){
+            fprintf(sortie, "[%s] absente de la référence\n", configurations[i].nom.c_str());
+            continue;
+        }
+        const Resultats &r = resultats[i];
+        double valeurs[6] = { r.precision(), r.rappel(), r.f1(), 0, 0, 0 };
+        for (int e = 0; e < 3; e++)
+            valeurs[3 + e] = r.expressionsEvaluees[e] > 0 ? (double)r.expressionsJustes[e] / r.expressionsEvaluees[e] : 0.;
+
+        for (int k = 0; k < 6; k++){
+            std::map<std::string, double>::const_iterator v = s->second.find(QUALITE[k]);
+            if (v == s->second.end())
+                continue;
+            double ecart = valeurs[k] - v->second;
+            if (ecart < -options.tolerance){
+                fprintf(sortie, "REGRESSION [%s] %s : %.4f -> %.4f\n", configurations[i].nom.c_str(), QUALITE[k], v->second, valeurs[k]);
+                regressions++;
+            } else if (ecart > options.tolerance){
+                fprintf(sortie, "amélioration [%s] %s : %.4f -> %.4f\n", configurations[i].nom.c_str(), QUALITE[k], v->second, valeurs[k]);
+            }
+        }
+        std::map<std::string, double>::const_iterator t = s->second.find("latence_mediane_ms");
+        double mediane = r.latence.centile(50) / 1000.;
+        if (t != s->second.end() && t->second > 0)
+            fprintf(sortie, "[%s] latence médiane : %.1f -> %.1f ms (x%.2f)\n", configurations[i].nom.c_str(), t->second, mediane, mediane / t->second);
+    }
+    fprintf(sortie, "%d régression(s)\n", regressions);
+    return regressions;
+}
+
+/*
+ * Graphique SVG : temps médian par image (abscisse) contre F1 des visages (ordonnée).
+ * Les configurations non dominées (aucune autre n'est à la fois plus rapide et plus juste) sont reliées.
+ */
+static bool ecrirePareto(const std::string &chemin, const std::vector<Configuration> &configurations, const std::vector<Resultats> &resultats)
+{
+    const int LARGEUR = 800, HAUTEUR = 500, MARGE = 70;
+    size_t n = configurations.size();
+    std::vector<double> temps(n), justesse(n);
+    double tempsMax = 0, justesseMin = 1;
+    for (size_t i = 0; i < n; i++){
+        temps[i] = resultats[i].latence.centile(50) / 1000.;
+        justesse[i] = resultats[i].f1();
+        tempsMax = std::max(tempsMax, temps[i]);
+        justesseMin = std::min(justesseMin, justesse[i]);
+    }
+    tempsMax = tempsMax > 0 ? tempsMax * 1.1 : 1.;
+    justesseMin = std::max(0., std::floor(justesseMin * 10 - 0.5) / 10);
+
+    std::vector<bool> front(n, true);
+    for (size_t i = 0; i < n; i++){
+        for (size_t j = 0; j < n && front[i]; j++){
+            if (j != i && temps[j] <= temps[i] && justesse[j] >= justesse[i] && (temps[j] < temps[i] || justesse[j] > justesse[i]))
+                front[i] = false;
+        }
+    }
+    std::vector<size_t> ordreFront;
+    for (size_t i = 0; i < n; i++){
+        if (front[i])
+            ordreFront.push_back(i);
+    }
+    std::sort(ordreFront.begin(), ordreFront.end(), [&temps](size_t a, size_t b){ return temps[a] < temps[b]; });
+
+    FILE *f = fopen(chemin.c_str(), "w");
+    if (!f){
+        perror(chemin.c_str());
+        return false;
+    }
+    #define X(t) (MARGE + (t) / tempsMax * (LARGEUR - 2*MARGE))
+    #define Y(j) (HAUTEUR - MARGE - ((j) - justesseMin) / (1. - justesseMin) * (HAUTEUR - 2*MARGE))
+    fprintf(f, "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"%d\" height=\"%d\" font-family=\"sans-serif\" font-size=\"12\">\n", LARGEUR, HAUTEUR);
+    fprintf(f, "<rect width=\"100%%\" height=\"100%%\" fill=\"white\"/>\n");
+    fprintf(f, "<line x1=\"%d\" y1=\"%d\" x2=\"%d\" y2=\"%d\" stroke=\"black\"/>\n", MARGE, HAUTEUR - MARGE, LARGEUR - MARGE, HAUTEUR - MARGE);
+    fprintf(f, "<line x1=\"%d\" y1=\"%d\" x2=\"%d\" y2=\"%d\" stroke=\"black\"/>\n", MARGE, MARGE, MARGE, HAUTEUR - MARGE);
+    for (int k = 0; k <= 5; k++){
+        double t = tempsMax * k / 5, j = justesseMin + (1. - justesseMin) * k / 5;
+        fprintf(f, "<text x=\"%.1f\" y=\"%d\" text-anchor=\"middle\">%.1f</text>\n", X(t), HAUTEUR - MARGE + 18, t);
+        fprintf(f, "<text x=\"%d\" y=\"%.1f\" text-anchor=\"end\">%.2f</text>\n", MARGE - 6, Y(j) + 4, j);
+    }
+    fprintf(f, "<text x=\"%d\" y=\"%d\" text-anchor=\"middle\">temps médian par image (ms)</text>\n", LARGEUR / 2, HAUTEUR - 20);
+    fprintf(f, "<text x=\"20\" y=\"%d\" text-anchor=\"middle\" transform=\"rotate(-90 20 %d)\">F1 des visages</text>\n", HAUTEUR / 2, HAUTEUR / 2);
+
+    fprintf(f, "<polyline fill=\"none\" stroke=\"#c00\" stroke-width=\"2\" points=\"");
+    for (size_t k = 0; k < ordreFront.size(); k++)
+        fprintf(f, "%.1f,%.1f ", X(temps[ordreFront[k]]), Y(justesse[ordreFront[k]]));
+    fprintf(f, "\"/>\n");
+    for (size_t i = 0; i < n; i++){
+        fprintf(f, "<circle cx=\"%.1f\" cy=\"%.1f\" r=\"5\" fill=\"%s\" stroke=\"#c00\"/>\n", X(temps[i]), Y(justesse[i]), front[i] ? "#c00" : "white");
+        fprintf(f, "<text x=\"%.1f\" y=\"%.1f\">%s</text>\n", X(temps[i]) + 8, Y(justesse[i]) - 6, configurations[i].nom.c_str());
+    }
+    fprintf(f, "</svg>\n");
+    #undef X
+    #undef Y
+    return fclose(f) == 0;
+}
+
+static void utilisation(const char *programme)
+{
+    fprintf(stderr, "utilisation : %s [--configurations fichier] [--cascades dossier] [--points modele] [--iou seuil]\n"
+                    "       [-o rapport.txt] [--reference ancien.txt] [--tolerance t] [--details dossier] [--pareto fichier.svg] <dossier>\n", programme);
+}
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    for (int i = 1; i < argc; i++){
+        bool suivant = i + 1 < argc;
+        if (!strcmp(argv[i], "--configurations") && suivant){
+            options.fichierConfigurations = argv[++i];
+        } else if (!strcmp(argv[i], "--cascades") && suivant){
+            options.dossierCascades = argv[++i];
+        } else if (!strcmp(argv[i], "--points") && suivant){
+            options.modelePoints = argv[++i];
+        } else if (!strcmp(argv[i], "--iou") && suivant){
+            options.seuilIou = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "-o") && suivant){
+            options.rapport = argv[++i];
+        } else if (!strcmp(argv[i], "--reference") && suivant){
+            options.reference = argv[++i];
+        } else if (!strcmp(argv[i], "--tolerance") && suivant){
+            options.tolerance = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--details") && suivant){
+            options.details = argv[++i];
+        } else if (!strcmp(argv[i], "--pareto") && suivant){
+            options.pareto = argv[++i];
+        } else if (argv[i][0] == '-'){
+            fprintf(stderr, "option inconnue : %s\n", argv[i]);
+            utilisation(argv[0]);
+            return 1;
+        } else {
+            options.dossier = argv[i];
+        }
+    }
+    if (options.dossier.empty()){
+        utilisation(argv[0]);
+        return 1;
+    }
+
+    std::vector<ImageAnnotee> images;
+    if (!lireAnnotations(options.dossier, images) || images.empty()){
+        fprintf(stderr, "%s : pas d'images annotées\n", options.dossier.c_str());
+        return 1;
+    }
+    std::vector<Configuration> configurations;
+    if (options.fichierConfigurations.empty())
+        configurationsParDefaut(configurations);
+    else if (!lireConfigurations(options.fichierConfigurations, configurations))
+        return 1;
+
+    EstimateurExpression essai;
+    if (!options.modelePoints.empty() && !essai.charger(options.modelePoints)){
+        fprintf(stderr, "%s : modèle de points illisible, utilisation des cascades sourire / yeux\n", options.modelePoints.c_str());
+        options.modelePoints.clear();
+    }
+    bool pretraitementVectorise = verifierPretraitement();
+
+    // Les temps mesurés sont ceux d'un seul coeur, comme dans l'application.
+    std::vector<Resultats> resultats(configurations.size());
+    for (size_t i = 0; i < configurations.size(); i++){
+        FILE *details = 0;
+        if (!options.details.empty()){
+            std::string chemin = options.details + "/" + configurations[i].nom + ".csv";
+            details = fopen(chemin.c_str(), "w");
+            if (!details)
+                perror(chemin.c_str());
+        }
+        bool ok = evaluer(options, pretraitementVectorise, configurations[i], images, resultats[i], details);
+        if (details)
+            fclose(details);
+        if (!ok)
+            return 1;
+        fprintf(stderr, "%s : rappel %.4f, précision %.4f, %.1f ms par image\n", configurations[i].nom.c_str(),
+                resultats[i].rappel(), resultats[i].precision(), resultats[i].latence.centile(50) / 1000.);
+    }
+
+    FILE *rapport = stdout;
+    if (!options.rapport.empty()){
+        rapport = fopen(options.rapport.c_str(), "w");
+        if (!rapport){
+            perror(options.rapport.c_str());
+            return 1;
+        }
+    }
+    size_t nbVisages = 0;
+    for (size_t i = 0; i < images.size(); i++)
+        nbVisages += images[i].visages.size();
+    fprintf(rapport, "# jeu %s : %zu images, %zu visages annotés, seuil d'IoU %.2f, points %s\n\n", options.dossier.c_str(),
+            images.size(), nbVisages, options.seuilIou, options.modelePoints.empty() ? "non" : "oui");
+    for (size_t i = 0; i < configurations.size(); i++)
+        ecrireSection(rapport, configurations[i], resultats[i]);
+    if (rapport != stdout)
+        fclose(rapport);
+
+    if (!options.pareto.empty() && !ecrirePareto(options.pareto, configurations, resultats))
+        return 1;
+
+    if (!options.reference.empty()){
+        int regressions = comparer(stderr, options, configurations, resultats);
+        if (regressions != 0)
+            return regressions < 0 ? 1 : 2;
+    }
+    return 0;
+}
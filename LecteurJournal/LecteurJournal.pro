@@ -0,0 +1,17 @@
+#-------------------------------------------------
+#
+# Outil de lecture du journal binaire des détections
+# (voir ../ProjetSY25Berthelon_Bucheron/formatjournal.h)
+#
+#-------------------------------------------------
+
+TEMPLATE = app
+TARGET = LecteurJournal
+CONFIG += console c++11
+CONFIG -= qt app_bundle
+
+INCLUDEPATH += ../ProjetSY25Berthelon_Bucheron
+
+SOURCES += main.cpp
+
+HEADERS += ../ProjetSY25Berthelon_Bucheron/formatjournal.h
@@ -0,0 +1,245 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Lecture du journal binaire des détections écrit par ProjetSY25Berthelon_Bucheron.
+ * Les segments sont projetés en mémoire et parcourus séquentiellement : la lecture va à la vitesse du disque.
+ *
+ * Utilisation : LecteurJournal [--csv] [--transitions] [--depuis s] [--jusqua s] <dossier ou segments...>
+ *   sans option : résumé (nombre d'images, présence d'un visage, sourires, yeux, transitions)
+ *   --csv : un enregistrement par ligne sur la sortie standard
+ *   --transitions : ne garde que les changements d'état
+ *   --depuis / --jusqua : bornes en secondes depuis le 1er janvier 1970
+ */
+#include "formatjournal.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct Options {
+    bool csv = false;
+    bool transitionsSeules = false;
+    uint64_t depuis = 0;
+    uint64_t jusqua = UINT64_MAX;
+};
+
+struct Resume {
+    uint64_t enregistrements = 0;
+    uint64_t images = 0;
+    uint64_t imagesAvecVisage = 0;
+    uint64_t imagesSourire = 0;
+    uint64_t imagesOeilGauche = 0;
+    uint64_t imagesOeilDroit = 0;
+    uint64_t transitions = 0;
+    uint64_t apparitions = 0;
+    uint64_t debutSourires = 0;
+    uint64_t changementsQualite = 0;
+    uint64_t premier = UINT64_MAX;
+    uint64_t dernier = 0;
+    uint64_t octetsLus = 0;
+};
+
+/*
+ * Liste les segments d'un dossier, triés par numéro.
+ */
+static void listerSegments(const std::string &chemin, std::vector<std::string> &segments)
+{
+    struct stat infos;
+    if (stat(chemin.c_str(), &infos) != 0){
+        fprintf(stderr, "%s : introuvable\n", chemin.c_str());
+        return;
+    }
+    if (!S_ISDIR(infos.st_mode)){
+        segments.push_back(chemin);
+        return;
+    }
+
+    std::vector<std::string> noms;
+    DIR *rep = opendir(chemin.c_str());
+    if (!rep)
+        return;
+    struct dirent *entree;
+    while ((entree = readdir(rep)) != 0){
+        unsigned int numero;
+        if (sscanf(entree->d_name, "journal_%u.bin", &numero) == 1)
+            noms.push_back(entree->d_name);
+    }
+    closedir(rep);
+
+    std::sort(noms.begin(), noms.end()); // numéros sur 6 chiffres : l'ordre alphabétique est l'ordre des segments.
+    for (size_t i = 0; i < noms.size(); i++)
+        segments.push_back(chemin + "/" + noms[i]);
+}
+
+static const char *nomType(uint8_t type)
+{
+    switch (type){
+    case ENREGISTREMENT_DETECTION: return "detection";
+    case ENREGISTREMENT_TRANSITION: return "transition";
+    case ENREGISTREMENT_QUALITE: return "qualite";
+    }
+    return "inconnu";
+}
+
+static void afficherCsv(const EnregistrementJournal &e)
+{
+    if (e.type == ENREGISTREMENT_QUALITE){ // niveaux, raison, temps moyen (ms) et température (°C) : voir formatjournal.h
+        printf("%llu,%u,qualite,niveau=%u,ancien=%u,raison=%u,duree_ms=%.1f,temperature=%.1f\n",
+               (unsigned long long)e.horodatage, e.numeroImage, e.etat, e.etatPrecedent, e.reserve,
+               e.centreX / 10., e.centreY / 10.);
+        return;
+    }
+
+    printf("%llu,%u,%s,%d,%d,%d,%d,%u,%u,%d,%d,%d,%d,%d,%d,%d\n",
+           (unsigned long long)e.horodatage, e.numeroImage,
+           nomType(e.type),
+           (e.etat & ETAT_VISAGE) != 0, (e.etat & ETAT_SOURIRE) != 0,
+           (e.etat & ETAT_OEIL_GAUCHE) != 0, (e.etat & ETAT_OEIL_DROIT) != 0,
+           e.etatPrecedent, e.etat,
+           e.centreX, e.centreY, e.largeur, e.hauteur, e.scoreSourire, e.scoreOeilGauche, e.scoreOeilDroit);
+}
+
+/*
+ * Parcourt un segment projeté en mémoire.
+ */
+static bool lireSegment(const std::string &chemin, const Options &options, Resume &resume)
+{
+    int fd = open(chemin.c_str(), O_RDONLY);
+    if (fd < 0){
+        perror(chemin.c_str());
+        return false;
+    }
+
+    struct stat infos;
+    if (fstat(fd, &infos) != 0 || (size_t)infos.st_size < sizeof(EnTeteSegment)){
+        fprintf(stderr, "%s : segment trop court\n", chemin.c_str());
+        close(fd);
+        return false;
+    }
+
+    void *p = mmap(0, infos.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED){
+        perror(chemin.c_str());
+        return false;
+    }
+    madvise(p, infos.st_size, MADV_SEQUENTIAL);
+
+    const EnTeteSegment *entete = (const EnTeteSegment *)p;
+    if (entete->magie != MAGIE_JOURNAL || entete->version != VERSION_JOURNAL
+            || entete->tailleEnregistrement != sizeof(EnregistrementJournal)){
+        fprintf(stderr, "%s : ce n'est pas un segment de journal (version %u)\n", chemin.c_str(), entete->version);
+        munmap(p, infos.st_size);
+        return false;
+    }
+
+    // Un segment interrompu brutalement n'a pas été raccourci : on s'arrête au compteur ou au premier enregistrement vide.
+    uint64_t nb = (infos.st_size - sizeof(EnTeteSegment)) / sizeof(EnregistrementJournal);
+    nb = std::min(nb, entete->nbEnregistrements);
+    const EnregistrementJournal *e = (const EnregistrementJournal *)((const uint8_t *)p + sizeof(EnTeteSegment));
+
+    for (uint64_t i = 0; i < nb; i++, e++){
+        if (e->type == ENREGISTREMENT_VIDE)
+            break;
+        if (e->horodatage < options.depuis || e->horodatage > options.jusqua)
+            continue;
+        if (options.transitionsSeules && e->type != ENREGISTREMENT_TRANSITION)
+            continue;
+
+        resume.enregistrements++;
+        resume.premier = std::min(resume.premier, (uint64_t)e->horodatage);
+        resume.dernier = std::max(resume.dernier, (uint64_t)e->horodatage);
+
+        if (e->type == ENREGISTREMENT_DETECTION){
+            resume.images++;
+            resume.imagesAvecVisage += (e->etat & ETAT_VISAGE) != 0;
+            resume.imagesSourire += (e->etat & ETAT_SOURIRE) != 0;
+            resume.imagesOeilGauche += (e->etat & ETAT_OEIL_GAUCHE) != 0;
+            resume.imagesOeilDroit += (e->etat & ETAT_OEIL_DROIT) != 0;
+        } else if (e->type == ENREGISTREMENT_QUALITE){
+            resume.changementsQualite++;
+        } else {
+            resume.transitions++;
+            resume.apparitions += (e->etat & ETAT_VISAGE) && !(e->etatPrecedent & ETAT_VISAGE);
+            resume.debutSourires += (e->etat & ETAT_SOURIRE) && !(e->etatPrecedent & ETAT_SOURIRE);
+        }
+
+        if (options.csv)
+            afficherCsv(*e);
+    }
+
+    resume.octetsLus += infos.st_size;
+    munmap(p, infos.st_size);
+    return true;
+}
+
+static double pourcentage(uint64_t n, uint64_t total)
+{
+    return total > 0 ? 100.0 * n / total : 0.;
+}
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    std::vector<std::string> segments;
+
+    for (int i = 1; i < argc; i++){
+        if (!strcmp(argv[i], "--csv")){
+            options.csv = true;
+        } else if (!strcmp(argv[i], "--transitions")){
+            options.transitionsSeules = true;
+        } else if (!strcmp(argv[i], "--depuis") && i + 1 < argc){
+            options.depuis = strtoull(argv[++i], 0, 10) * 1000000;
+        } else if (!strcmp(argv[i], "--jusqua") && i + 1 < argc){
+            options.jusqua = strtoull(argv[++i], 0, 10) * 1000000;
+        } else if (argv[i][0] == '-'){
+            fprintf(stderr, "option inconnue : %s\n", argv[i]);
+            return 1;
+        } else {
+            listerSegments(argv[i], segments);
+        }
+    }
+
+    if (segments.empty()){
+        fprintf(stderr, "utilisation : %s [--csv] [--transitions] [--depuis s] [--jusqua s] <dossier ou segments...>\n", argv[0]);
+        return 1;
+    }
+
+    if (options.csv)
+        printf("horodatage_us,image,type,visage,sourire,oeil_gauche,oeil_droit,etat_precedent,etat,centre_x,centre_y,largeur,hauteur,score_sourire,score_oeil_gauche,score_oeil_droit\n");
+
+    Resume resume;
+    std::chrono::steady_clock::time_point debut = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < segments.size(); i++)
+        lireSegment(segments[i], options, resume);
+    double secondes = std::chrono::duration<double>(std::chrono::steady_clock::now() - debut).count();
+
+    // Le résumé part sur la sortie d'erreur en mode csv pour ne pas se mélanger aux données.
+    FILE *sortie = options.csv ? stderr : stdout;
+    fprintf(sortie, "%zu segments, %llu enregistrements", segments.size(), (unsigned long long)resume.enregistrements);
+    if (resume.enregistrements > 0)
+        fprintf(sortie, " sur %.1f s", (resume.dernier - resume.premier) / 1e6);
+    fprintf(sortie, "\n");
+    fprintf(sortie, "images : %llu, visage %.1f %%, sourire %.1f %%, oeil gauche %.1f %%, oeil droit %.1f %%\n",
+            (unsigned long long)resume.images, pourcentage(resume.imagesAvecVisage, resume.images),
+            pourcentage(resume.imagesSourire, resume.images), pourcentage(resume.imagesOeilGauche, resume.images),
+            pourcentage(resume.imagesOeilDroit, resume.images));
+    fprintf(sortie, "transitions : %llu (apparitions de visage %llu, débuts de sourire %llu)\n",
+            (unsigned long long)resume.transitions, (unsigned long long)resume.apparitions,
+            (unsigned long long)resume.debutSourires);
+    if (resume.changementsQualite > 0)
+        fprintf(sortie, "changements de niveau de qualité : %llu\n", (unsigned long long)resume.changementsQualite);
+    fprintf(sortie, "lecture : %.1f Mo en %.3f s (%.0f Mo/s)\n", resume.octetsLus / 1e6, secondes,
+            secondes > 0 ? resume.octetsLus / 1e6 / secondes : 0.);
+    return 0;
+}
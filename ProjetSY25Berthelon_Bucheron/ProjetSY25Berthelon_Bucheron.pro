@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT       += core gui  serialport
+QT       += core gui  serialport network
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -25,14 +25,87 @@ DEFINES += QT_DEPRECATED_WARNINGS
 
 SOURCES += main.cpp\
         projetsy25main.cpp \
-    SenseHat.cpp
+    SenseHat.cpp \
+    estimateurexpression.cpp \
+    classifieurexpression.cpp \
+    noyauxint8.cpp \
+    noyauxpretraitement.cpp \
+    parametres.cpp \
+    enregistreur.cpp \
+    serveurmjpeg.cpp \
+    journalevenements.cpp \
+    sourceimages.cpp \
+    mesurelatence.cpp \
+    detecteurmouvement.cpp \
+    controleurqualite.cpp \
+    evaluateurcascade.cpp \
+    contextedetection.cpp \
+    cascadehaar.cpp \
+    noyauxcascade.cpp \
+    detecteurvisage.cpp \
+    controleurservo.cpp \
+    simulateurnacelle.cpp \
+    telemetrieservo.cpp \
+    calibrationcamera.cpp \
+    gyroscope.cpp \
+    lecturegyroscope.cpp \
+    suivivisage.cpp \
+    sessionphoto.cpp \
+    sauvegardephotos.cpp \
+    recadragevisage.cpp \
+    descripteurvisage.cpp \
+    indexidentites.cpp \
+    noyauxidentites.cpp \
+    pistesvisages.cpp \
+    reconnaissancevisage.cpp \
+    ../ControlMoteurArduino/planificateurmouvement.cpp
 
 HEADERS  += projetsy25main.h \
     SenseHat.h \
-    font.h
+    font.h \
+    estimateurexpression.h \
+    classifieurexpression.h \
+    noyauxint8.h \
+    noyauxpretraitement.h \
+    parametres.h \
+    enregistreur.h \
+    serveurmjpeg.h \
+    journalevenements.h \
+    formatjournal.h \
+    sourceimages.h \
+    mesurelatence.h \
+    detecteurmouvement.h \
+    controleurqualite.h \
+    evaluateurcascade.h \
+    contextedetection.h \
+    cascadehaar.h \
+    noyauxcascade.h \
+    detecteurvisage.h \
+    controleurservo.h \
+    simulateurnacelle.h \
+    telemetrieservo.h \
+    calibrationcamera.h \
+    gyroscope.h \
+    lecturegyroscope.h \
+    suivivisage.h \
+    sessionphoto.h \
+    sauvegardephotos.h \
+    recadragevisage.h \
+    descripteurvisage.h \
+    indexidentites.h \
+    noyauxidentites.h \
+    pistesvisages.h \
+    reconnaissancevisage.h \
+    ../ControlMoteurArduino/planificateurmouvement.h \
+    ../ControlMoteurArduino/trametelemetrie.h
+
+# Trajectoires des servos : même code que le programme de l'arduino (pour la nacelle simulée).
+INCLUDEPATH += ../ControlMoteurArduino
 
 FORMS    += projetsy25main.ui
 
+DISTFILES += ProjetSY25.ini
+
 # Pour opencv
 CONFIG += link_pkgconfig
 PKGCONFIG += opencv
@@ -43,3 +116,9 @@ LIBS += -L/opt/vc/lib/  -lraspicam -lraspicam_cv -lmmal -lmmal_core -lmmal_util
 
 # Pour SenseHat
 LIBS += -lRTIMULib
+
+# Pour les noyaux vectorisés (NEON sur la raspi, SSE2 est actif par défaut sur PC)
+contains(QMAKE_HOST.arch, armv7l): QMAKE_CXXFLAGS += -mfpu=neon-vfpv4
+# Les caractéristiques des cascades doivent être arrondies comme dans OpenCV : pas de multiplication-addition fusionnée.
+QMAKE_CXXFLAGS += -ffp-contract=off
+CONFIG += c++11
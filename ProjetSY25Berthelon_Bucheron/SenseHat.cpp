@@ -656,6 +656,29 @@ void SenseHat::GetOrientation(float &pitch, float &roll, float &yaw)
     }
 }
 
+/**
+ * @brief SenseHat::LireGyroscope
+ * @return bool vrai si un nouvel échantillon a été lu (les sorties ne sont pas modifiées sinon)
+ * @detail un seul échantillon par appel : vitesses angulaires en rd/s et horodatage de l'échantillon
+ * (µs depuis le 1er janvier 1970, horloge de RTIMULib)
+ *
+ */
+bool SenseHat::LireGyroscope(float &x, float &y, float &z, uint64_t &horodatage)
+{
+  return ReadGyroscope(x, y, z, horodatage);
+}
+bool SenseHat::ReadGyroscope(float &x, float &y, float &z, uint64_t &timestamp)
+{
+    if (!imu->IMURead())
+	return false;
+    RTIMU_DATA imuData = imu->getIMUData();
+    x = imuData.gyro.x();
+    y = imuData.gyro.y();
+    z = imuData.gyro.z();
+    timestamp = imuData.timestamp;
+    return true;
+}
+
 /**
  * @brief SenseHat::ObtenirAcceleration
  * @return float la valeur de l'accélération linéaire suivant X,Y,Z
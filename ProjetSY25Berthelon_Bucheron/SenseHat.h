@@ -135,6 +135,9 @@ public:
     void  ObtenirOrientation(float &pitch, float &roll, float & yaw);
 		void  GetOrientation(float &pitch, float &roll, float & yaw);
 
+    bool  LireGyroscope(float &x, float &y, float &z, uint64_t &horodatage);
+		bool  ReadGyroscope(float &x, float &y, float &z, uint64_t &timestamp);
+
     void  ObtenirAcceleration(float &x, float &y, float &z);
 		void  GetAcceleration(float &x, float &y, float &z);
 
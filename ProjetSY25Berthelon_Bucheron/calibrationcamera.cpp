@@ -0,0 +1,189 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Modèle pixels -> angles de la caméra, et sa calibration automatique par corrélation de phase.
+ */
+#include "calibrationcamera.h"
+#include "controleurservo.h"
+#include "planificateurmouvement.h"
+
+#include "opencv2/imgproc/imgproc.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#define DEGRES (180.0 / CV_PI)
+
+// Netteté minimum du pic de corrélation : en dessous, la scène a bougé ou n'a pas assez de texture.
+#define REPONSE_MIN 0.05
+// Ecart maximum des mesures à l'ajustement (relatif au décalage moyen).
+#define RESIDU_MAX 0.2
+
+CalibrationCamera::CalibrationCamera(int largeur, int hauteur, double champHorizontal, double champVertical) :
+    largeur(largeur),
+    hauteur(hauteur),
+    champHorizontal(champHorizontal),
+    champVertical(champVertical)
+{
+}
+
+double CalibrationCamera::focaleX() const
+{
+    return largeur / 2.0 / std::tan(champHorizontal / 2 / DEGRES);
+}
+
+double CalibrationCamera::focaleY() const
+{
+    return hauteur / 2.0 / std::tan(champVertical / 2 / DEGRES);
+}
+
+double CalibrationCamera::champ(double focale, int taille)
+{
+    return 2 * std::atan(taille / 2.0 / focale) * DEGRES;
+}
+
+double CalibrationCamera::angleHorizontal(double x) const
+{
+    return std::atan((largeur / 2.0 - x) / focaleX()) * DEGRES;
+}
+
+double CalibrationCamera::angleVertical(double y) const
+{
+    return std::atan((hauteur / 2.0 - y) / focaleY()) * DEGRES;
+}
+
+cv::Point2d CalibrationCamera::deplacer(cv::Point2d point, double rotationHorizontale, double rotationVerticale) const
+{
+    // angle restant entre l'axe de la caméra et le point, une fois la caméra tournée.
+    double h = angleHorizontal(point.x) / DEGRES - rotationHorizontale / DEGRES;
+    double v = angleVertical(point.y) / DEGRES - rotationVerticale / DEGRES;
+    return cv::Point2d(largeur / 2.0 - focaleX() * std::tan(h), hauteur / 2.0 - focaleY() * std::tan(v));
+}
+
+CalibrationAuto::CalibrationAuto(const CalibrationCamera &depart, double amplitude, double attente) :
+    calibration(depart),
+    attente(attente)
+{
+    int pas = std::min(std::max((int)std::lround(amplitude / PAS_COMMANDE_SERVO), 1), MAX_PAS_PAR_AXE);
+    const cv::Point positions[] = { cv::Point(0, 0), cv::Point(pas, 0), cv::Point(0, 0), cv::Point(-pas, 0), cv::Point(0, 0),
+                                    cv::Point(0, pas), cv::Point(0, 0), cv::Point(0, -pas), cv::Point(0, 0) };
+    sequence.assign(positions, positions + sizeof(positions) / sizeof(positions[0]));
+}
+
+/*
+ * Octets qui déplacent la nacelle de "deplacement" pas.
+ */
+static int commandesDeplacement(cv::Point deplacement, char *commande)
+{
+    int n = 0;
+    for (int i = 0; i < std::abs(deplacement.x); i++)
+        commande[n++] = deplacement.x > 0 ? 'H' : 'h';
+    for (int i = 0; i < std::abs(deplacement.y); i++)
+        commande[n++] = deplacement.y > 0 ? 'V' : 'v';
+    commande[n] = 0;
+    return n;
+}
+
+int CalibrationAuto::image(const cv::Mat &gris, uint64_t instant, char *commande)
+{
+    commande[0] = 0;
+    if (terminee() || (enMouvement && instant < finMouvement))
+        return 0;
+
+    cv::Mat courante;
+    gris.convertTo(courante, CV_32F);
+    if (fenetreHanning.empty() || fenetreHanning.size() != courante.size())
+        cv::createHanningWindow(fenetreHanning, courante.size(), CV_32F);
+
+    if (etape > 0){ // la nacelle est arrivée : décalage par rapport à l'image de la position précédente.
+        if (precedente.size() != courante.size()){
+            etape = sequence.size(); // la taille de l'image a changé en route : calibration abandonnée.
+            return 0;
+        }
+        Mesure m;
+        m.pasH = (sequence[etape].x - sequence[etape - 1].x) * PAS_COMMANDE_SERVO;
+        m.pasV = (sequence[etape].y - sequence[etape - 1].y) * PAS_COMMANDE_SERVO;
+        m.decalage = cv::phaseCorrelate(precedente, courante, fenetreHanning, &m.reponse);
+        mesures.push_back(m);
+    }
+    precedente = courante;
+    etape++;
+    if (terminee()){
+        enMouvement = false;
+        ajuster();
+        return 0;
+    }
+    enMouvement = true;
+    finMouvement = instant + (uint64_t)(attente * 1e6);
+    return commandesDeplacement(sequence[etape] - sequence[etape - 1], commande);
+}
+
+/*
+ * Focale = somme(décalage * tan(pas)) / somme(tan²(pas)) sur les mesures de chaque axe : 'H' fait glisser l'image
+ * vers la droite, 'V' vers le bas (décalages positifs).
+ */
+void CalibrationAuto::ajuster()
+{
+    double sxy[2] = { 0, 0 }, sxx[2] = { 0, 0 }, moyenne[2] = { 0, 0 };
+    int n[2] = { 0, 0 };
+    bool nettes = true;
+    for (size_t i = 0; i < mesures.size(); i++){
+        const Mesure &m = mesures[i];
+        int axe = m.pasH != 0 ? 0 : 1;
+        double t = std::tan((axe == 0 ? m.pasH : m.pasV) / DEGRES);
+        double d = axe == 0 ? m.decalage.x : m.decalage.y;
+        sxy[axe] += d * t;
+        sxx[axe] += t * t;
+        moyenne[axe] += std::fabs(d);
+        n[axe]++;
+        nettes = nettes && m.reponse >= REPONSE_MIN;
+    }
+    if (n[0] == 0 || n[1] == 0 || sxx[0] <= 0 || sxx[1] <= 0)
+        return;
+    double focale[2] = { sxy[0] / sxx[0], sxy[1] / sxx[1] };
+
+    double residu[2] = { 0, 0 };
+    for (size_t i = 0; i < mesures.size(); i++){
+        const Mesure &m = mesures[i];
+        int axe = m.pasH != 0 ? 0 : 1;
+        double e = (axe == 0 ? m.decalage.x : m.decalage.y) - focale[axe] * std::tan((axe == 0 ? m.pasH : m.pasV) / DEGRES);
+        residu[axe] += e * e;
+    }
+    for (int axe = 0; axe < 2; axe++){
+        moyenne[axe] /= n[axe];
+        residu[axe] = moyenne[axe] > 0 ? std::sqrt(residu[axe] / n[axe]) / moyenne[axe] : 1;
+    }
+    residuX = residu[0];
+    residuY = residu[1];
+
+    succes = nettes && focale[0] > 0 && focale[1] > 0 && residuX <= RESIDU_MAX && residuY <= RESIDU_MAX;
+    if (succes){
+        calibration.champHorizontal = CalibrationCamera::champ(focale[0], calibration.largeur);
+        calibration.champVertical = CalibrationCamera::champ(focale[1], calibration.hauteur);
+    }
+}
+
+std::string CalibrationAuto::rapport() const
+{
+    std::string texte;
+    char ligne[160];
+    for (size_t i = 0; i < mesures.size(); i++){
+        snprintf(ligne, sizeof(ligne), "pas %+5.1f° / %+5.1f° : décalage %+7.1f / %+7.1f px (corrélation %.2f)\n",
+                 mesures[i].pasH, mesures[i].pasV, mesures[i].decalage.x, mesures[i].decalage.y, mesures[i].reponse);
+        texte += ligne;
+    }
+    if (!terminee()){
+        texte += "calibration en cours\n";
+    } else if (succes){
+        snprintf(ligne, sizeof(ligne), "champ %.2f° x %.2f° (focale %.1f x %.1f px, écart à l'ajustement %.0f %% / %.0f %%)\n",
+                 calibration.champHorizontal, calibration.champVertical, calibration.focaleX(), calibration.focaleY(),
+                 residuX * 100, residuY * 100);
+        texte += ligne;
+    } else {
+        snprintf(ligne, sizeof(ligne), "calibration refusée (sens des servos, scène qui bouge ou sans texture : écart %.0f %% / %.0f %%)\n",
+                 residuX * 100, residuY * 100);
+        texte += ligne;
+    }
+    return texte;
+}
@@ -0,0 +1,109 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Correspondance entre les pixels de l'image et les angles des servomoteurs (modèle sténopé) :
+ * un point à x pixels du centre est vu à atan(x / focale) de l'axe de la caméra, la focale (en pixels) venant du champ
+ * de la caméra : focale = (largeur / 2) / tan(champ / 2). La correction d'un écart ne dépend donc plus de seuils en pixels
+ * écrits pour le VGA, mais de la résolution et de l'objectif.
+ *
+ * CalibrationAuto mesure ce champ sur le montage : la nacelle fait des pas connus devant une scène immobile,
+ * le décalage de l'image entre deux positions est mesuré par corrélation de phase, et la focale est ajustée
+ * aux moindres carrés sur ces mesures.
+ */
+#ifndef CALIBRATIONCAMERA_H
+#define CALIBRATIONCAMERA_H
+
+#include <opencv2/core/core.hpp>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class CalibrationCamera
+{
+public:
+    /*
+     * Champ (°) de la raspicam v1 par défaut : 53.50° x 41.41°.
+     */
+    CalibrationCamera(int largeur = 640, int hauteur = 480, double champHorizontal = 53.50, double champVertical = 41.41);
+
+    /*
+     * Rotation (°) à donner à chaque servo pour amener le point (x, y) de l'image au centre :
+     * positive pour 'H' (point à gauche du centre) et pour 'V' (point au dessus).
+     */
+    double angleHorizontal(double x) const;
+    double angleVertical(double y) const;
+
+    /*
+     * Position dans l'image d'un point fixe de la scène, vu en "point", après une rotation de la caméra
+     * de "rotationHorizontale" / "rotationVerticale" degrés (mêmes signes que les servos : 'H' fait glisser l'image
+     * vers la droite, 'V' vers le bas).
+     */
+    cv::Point2d deplacer(cv::Point2d point, double rotationHorizontale, double rotationVerticale) const;
+
+    // Focales (px).
+    double focaleX() const;
+    double focaleY() const;
+
+    // Champ (°) correspondant à une focale (px) pour une taille d'image (px).
+    static double champ(double focale, int taille);
+
+    int largeur;
+    int hauteur;
+    double champHorizontal;
+    double champVertical;
+};
+
+/*
+ * Calibration automatique, pilotée image par image (sans bloquer la boucle de l'application) :
+ * image() reçoit chaque image en niveaux de gris et rend les octets de commande à envoyer.
+ *
+ * Séquence autour de la position de départ, de "amplitude" degrés (arrondie aux pas de 2° de l'arduino) :
+ * droite, retour, gauche, retour, puis haut, retour, bas, retour. Après chaque déplacement, on attend "attente" secondes
+ * (mouvement et latence de la commande), et la première image prise ensuite est comparée à celle de la position
+ * précédente. Huit mesures, quatre par axe ; la nacelle finit à sa position de départ.
+ */
+class CalibrationAuto
+{
+public:
+    CalibrationAuto(const CalibrationCamera &depart, double amplitude = 6, double attente = 0.4);
+
+    /*
+     * Image prise à "instant" (µs). Ecrit dans "commande" (place pour 2*MAX_PAS_PAR_AXE + 1 octets) les commandes à envoyer,
+     * retourne leur nombre (0 : rien à envoyer).
+     */
+    int image(const cv::Mat &gris, uint64_t instant, char *commande);
+
+    bool terminee() const { return etape >= sequence.size(); }
+    // Calibration terminée et mesures cohérentes (sens des servos, corrélation nette, écart à l'ajustement).
+    bool reussie() const { return succes; }
+    const CalibrationCamera &resultat() const { return calibration; }
+
+    // Mesures et ajustement, en texte.
+    std::string rapport() const;
+
+private:
+    struct Mesure {
+        double pasH, pasV;   // rotation commandée (°)
+        cv::Point2d decalage; // décalage de l'image (px)
+        double reponse;      // netteté du pic de corrélation (0 - 1)
+    };
+
+    void ajuster();
+
+    CalibrationCamera calibration;
+    double attente;
+    // positions successives (en pas de 2°), relatives au départ.
+    std::vector<cv::Point> sequence;
+    size_t etape = 0;
+    bool enMouvement = false;
+    uint64_t finMouvement = 0;
+    cv::Mat precedente;
+    cv::Mat fenetreHanning;
+    std::vector<Mesure> mesures;
+    bool succes = false;
+    double residuX = 0;
+    double residuY = 0;
+};
+
+#endif // CALIBRATIONCAMERA_H
@@ -0,0 +1,186 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Cascade de Haar évaluée sur les niveaux partagés d'un ContexteDetection.
+ */
+#include "cascadehaar.h"
+#include "mesurelatence.h"
+
+#include "opencv2/objdetect/objdetect.hpp"
+#include <algorithm>
+
+// Comme OpenCV : seuil d'étage diminué pour absorber les arrondis, et regroupement des rectangles à 20 %.
+#define EPSILON_SEUIL 1e-5f
+#define EPSILON_REGROUPEMENT 0.2
+
+CascadeHaar::CascadeHaar() :
+    evaluateur(0),
+    vectoriseeActive(false)
+{
+}
+
+CascadeHaar::~CascadeHaar()
+{
+    delete evaluateur;
+}
+
+bool CascadeHaar::charger(const cv::String &chemin)
+{
+    delete evaluateur;
+    evaluateur = 0;
+    vectoriseeActive = false;
+    donnees = ModeleCascade();
+
+    cv::FileStorage fichier(chemin, cv::FileStorage::READ);
+    if (!fichier.isOpened()){
+        return false;
+    }
+    cv::FileNode racine = fichier.getFirstTopLevelNode();
+    if ((std::string)racine["stageType"] != "BOOST" || (std::string)racine["featureType"] != "HAAR"){
+        return false; // ancien format ou cascade LBP.
+    }
+    donnees.largeur = (int)racine["width"];
+    donnees.hauteur = (int)racine["height"];
+
+    cv::FileNode etages = racine["stages"];
+    for (cv::FileNodeIterator e = etages.begin(); e != etages.end(); ++e){
+        EtageHaar etage;
+        etage.seuil = (float)(*e)["stageThreshold"] - EPSILON_SEUIL;
+        etage.premierArbre = (int)donnees.arbres.size();
+        cv::FileNode faibles = (*e)["weakClassifiers"];
+        for (cv::FileNodeIterator f = faibles.begin(); f != faibles.end(); ++f){
+            cv::FileNode noeuds = (*f)["internalNodes"];
+            cv::FileNode feuilles = (*f)["leafValues"];
+            ArbreHaar arbre;
+            arbre.premierNoeud = (int)donnees.noeuds.size();
+            arbre.nbNoeuds = (int)noeuds.size() / 4;
+            arbre.premiereFeuille = (int)donnees.feuilles.size();
+            if (arbre.nbNoeuds == 0 || (int)feuilles.size() != arbre.nbNoeuds + 1){
+                return false;
+            }
+            for (int i = 0; i < arbre.nbNoeuds; i++){
+                NoeudHaar noeud;
+                noeud.gauche = (int)noeuds[4*i];
+                noeud.droite = (int)noeuds[4*i + 1];
+                noeud.caracteristique = (int)noeuds[4*i + 2];
+                noeud.seuil = (float)noeuds[4*i + 3];
+                donnees.noeuds.push_back(noeud);
+            }
+            for (int i = 0; i <= arbre.nbNoeuds; i++){
+                donnees.feuilles.push_back((float)feuilles[i]);
+            }
+            donnees.arbres.push_back(arbre);
+        }
+        etage.nbArbres = (int)donnees.arbres.size() - etage.premierArbre;
+        donnees.etages.push_back(etage);
+    }
+
+    cv::FileNode caracteristiques = racine["features"];
+    for (cv::FileNodeIterator c = caracteristiques.begin(); c != caracteristiques.end(); ++c){
+        CaracteristiqueHaar caracteristique;
+        cv::FileNode rects = (*c)["rects"];
+        caracteristique.nbRectangles = std::min((int)rects.size(), 3);
+        for (int r = 0; r < caracteristique.nbRectangles; r++){
+            RectanglePondere &R = caracteristique.rect[r];
+            cv::FileNode valeurs = rects[r];
+            R.x = (int)valeurs[0];
+            R.y = (int)valeurs[1];
+            R.largeur = (int)valeurs[2];
+            R.hauteur = (int)valeurs[3];
+            R.poids = (float)valeurs[4];
+        }
+        for (int r = caracteristique.nbRectangles; r < 3; r++){
+            caracteristique.rect[r] = RectanglePondere();
+        }
+        caracteristique.inclinee = !(*c)["tilted"].empty() && (int)(*c)["tilted"] != 0;
+        donnees.avecInclinees = donnees.avecInclinees || caracteristique.inclinee;
+        donnees.caracteristiques.push_back(caracteristique);
+    }
+
+    for (size_t i = 0; i < donnees.noeuds.size(); i++){
+        if (donnees.noeuds[i].caracteristique < 0 || donnees.noeuds[i].caracteristique >= (int)donnees.caracteristiques.size()){
+            return false;
+        }
+    }
+    if (donnees.largeur < 3 || donnees.hauteur < 3 || donnees.etages.empty()){
+        return false;
+    }
+
+    evaluateur = new EvaluateurCascade(donnees);
+    vectoriseeActive = vectorisee.preparer(donnees) && verifierCascadeVectorisee(donnees);
+    return true;
+}
+
+void CascadeHaar::detecter(ContexteDetection &contexte, const cv::Rect &zone, const cv::Rect &region, std::vector<cv::Rect> &objets,
+                           double facteurEchelle, int voisinsMin, cv::Size tailleMin, cv::Size tailleMax)
+{
+    objets.clear();
+    if (!evaluateur || region.area() <= 0){
+        return;
+    }
+    if (tailleMax.width <= 0 || tailleMax.height <= 0){
+        tailleMax = region.size();
+    }
+
+    // Mêmes tailles que detectMultiScale sur l'image de la région.
+    std::vector<float> echelles;
+    for (double facteur = 1; ; facteur *= facteurEchelle){
+        cv::Size fenetre(cvRound(donnees.largeur * facteur), cvRound(donnees.hauteur * facteur));
+        if (fenetre.width > tailleMax.width || fenetre.height > tailleMax.height
+                || fenetre.width > region.width || fenetre.height > region.height){
+            break;
+        }
+        if (fenetre.width < tailleMin.width || fenetre.height < tailleMin.height){
+            continue;
+        }
+        echelles.push_back((float)facteur);
+    }
+
+    int nbBandes = -1;
+    for (size_t i = 0; i < echelles.size(); i++){
+        float echelle = echelles[i];
+        const NiveauDetection &n = contexte.niveau(zone, echelle, donnees.avecInclinees);
+
+        // Région dans le niveau (le niveau peut couvrir une zone plus grande que celle demandée).
+        int x0 = cvRound((region.x - n.zone.x) / echelle);
+        int y0 = cvRound((region.y - n.zone.y) / echelle);
+        int largeur = std::min(cvRound(region.width / echelle), n.image.cols - x0);
+        int hauteur = std::min(cvRound(region.height / echelle), n.image.rows - y0);
+        int positionsX = largeur + 1 - donnees.largeur;
+        int positionsY = hauteur + 1 - donnees.hauteur;
+        if (positionsX <= 0 || positionsY <= 0){
+            continue;
+        }
+
+        // detectMultiScale découpe les lignes en bandes (positionsX/32 bandes, fixé à la première taille) et
+        // arrondit leur hauteur par défaut : la dernière ligne de fenêtres est parfois ignorée. On fait de même.
+        int pas = echelle >= 2 ? 1 : 2;
+        if (nbBandes < 0){
+            nbBandes = cvCeil(positionsX / 32.);
+        }
+        int bande = std::max((positionsY / pas + nbBandes - 1) / nbBandes, 1) * pas;
+        int lignes = std::min(nbBandes * bande, positionsY);
+
+        uint64_t debut = MesureLatence::horloge();
+        positions.clear();
+        if (vectoriseeActive){
+            uint64_t fenetres = vectorisee.fenetresEvaluees();
+            vectorisee.parcourir(n.integrale, x0, y0, x0 + positionsX - 1, y0 + lignes - 1, pas, positions);
+            contexte.ajouterEvaluation(MesureLatence::horloge() - debut, vectorisee.fenetresEvaluees() - fenetres);
+        } else {
+            uint64_t fenetres = evaluateur->fenetresEvaluees();
+            evaluateur->parcourir(n.integrale, x0, y0, x0 + positionsX - 1, y0 + lignes - 1, pas, positions);
+            contexte.ajouterEvaluation(MesureLatence::horloge() - debut, evaluateur->fenetresEvaluees() - fenetres);
+        }
+
+        cv::Size fenetre(cvRound(donnees.largeur * echelle), cvRound(donnees.hauteur * echelle));
+        for (size_t k = 0; k < positions.size(); k += 2){
+            cv::Rect r(region.x + cvRound((positions[k] - x0) * echelle), region.y + cvRound((positions[k + 1] - y0) * echelle),
+                       fenetre.width, fenetre.height);
+            objets.push_back(r & region);
+        }
+    }
+
+    cv::groupRectangles(objets, voisinsMin, EPSILON_REGROUPEMENT);
+}
@@ -0,0 +1,59 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Cascade de Haar évaluée sur un ContexteDetection, à la place de cv::CascadeClassifier::detectMultiScale.
+ * Les fichiers haarcascade_*.xml d'OpenCV (format "cascade", BOOST + HAAR) sont lus tels quels.
+ *
+ * Les tailles essayées, le pas des fenêtres et les rectangles rendus sont ceux de detectMultiScale
+ * (avec ses particularités : dernière ligne de fenêtres parfois ignorée, rectangles coupés au bord),
+ * si bien que sur une zone entière le résultat est le même, fenêtre par fenêtre.
+ * Sur une région plus petite que le niveau (moitié du visage), les bords de la région sont interpolés
+ * avec les pixels voisins au lieu d'être répétés : quelques fenêtres peuvent différer.
+ *
+ * Les cascades de souches sont évaluées par CascadeVectorisee (quatre fenêtres à la fois) si elle a passé
+ * sa vérification au chargement, les autres par EvaluateurCascade.
+ */
+#ifndef CASCADEHAAR_H
+#define CASCADEHAAR_H
+
+#include "contextedetection.h"
+#include "evaluateurcascade.h"
+#include "noyauxcascade.h"
+
+#include <opencv2/core/core.hpp>
+#include <vector>
+
+class CascadeHaar
+{
+public:
+    CascadeHaar();
+    ~CascadeHaar();
+
+    bool charger(const cv::String &chemin);
+    bool estCharge() const { return evaluateur != 0; }
+
+    const ModeleCascade &modele() const { return donnees; }
+    // La cascade est-elle évaluée par le noyau vectorisé ?
+    bool estVectorisee() const { return vectoriseeActive; }
+
+    /*
+     * Cherche les objets dans "region" de l'image du contexte (coordonnées de l'image).
+     * "zone" est la zone dont la pyramide est partagée (le visage pour le sourire et les yeux, l'image pour le visage) :
+     * elle doit contenir la région. Les rectangles trouvés sont en coordonnées de l'image.
+     */
+    void detecter(ContexteDetection &contexte, const cv::Rect &zone, const cv::Rect &region, std::vector<cv::Rect> &objets,
+                  double facteurEchelle, int voisinsMin, cv::Size tailleMin = cv::Size(), cv::Size tailleMax = cv::Size());
+
+private:
+    CascadeHaar(const CascadeHaar &);
+    CascadeHaar &operator=(const CascadeHaar &);
+
+    ModeleCascade donnees;
+    EvaluateurCascade *evaluateur;
+    CascadeVectorisee vectorisee;
+    bool vectoriseeActive;
+    std::vector<int> positions;
+};
+
+#endif // CASCADEHAAR_H
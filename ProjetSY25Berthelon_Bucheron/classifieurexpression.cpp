@@ -0,0 +1,350 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Petit réseau de convolution quantifié en int8 qui classe l'expression d'un visage recadré.
+ * Voir classifieurexpression.h pour le format du fichier de poids.
+ */
+#include "classifieurexpression.h"
+#include "noyauxint8.h"
+
+#include "opencv2/imgproc/imgproc.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Nombre maximum de couches accepté (le réseau prévu en a 4).
+#define NB_COUCHES_MAX 16
+// Taille maximum d'une activation et d'une ligne de poids (octets) : bien au delà du réseau prévu,
+// et les longueurs restent dans un int pour les noyaux.
+#define TAILLE_ACTIVATION_MAX (64u << 20)
+
+ClassifieurExpression::ClassifieurExpression()
+{
+}
+
+ClassifieurExpression::~ClassifieurExpression()
+{
+    liberer();
+}
+
+void ClassifieurExpression::liberer()
+{
+    if (donnees != 0)
+        munmap((void *)donnees, taille);
+    donnees = 0;
+    taille = 0;
+    entete = 0;
+    couches = 0;
+}
+
+/*
+ * Projette le fichier de poids en mémoire et vérifie sa cohérence.
+ */
+bool ClassifieurExpression::charger(const std::string &chemin)
+{
+    liberer();
+
+    int fd = open(chemin.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat infos;
+    if (fstat(fd, &infos) != 0 || (size_t)infos.st_size < sizeof(EnTeteModele)) {
+        close(fd);
+        return false;
+    }
+
+    void *projection = mmap(0, infos.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // la projection reste valide après la fermeture du descripteur.
+    if (projection == MAP_FAILED)
+        return false;
+
+    donnees = (const uint8_t *)projection;
+    taille = infos.st_size;
+    entete = (const EnTeteModele *)donnees;
+
+    // La caméra est en niveaux de gris : le réseau attend donc une entrée à un seul canal.
+    if (entete->magie != MAGIE_MODELE_CNN8 || entete->version != VERSION_MODELE_CNN8 || entete->canauxEntree != 1
+            || entete->nbCouches == 0 || entete->nbCouches > NB_COUCHES_MAX
+            || sizeof(EnTeteModele) + entete->nbCouches * sizeof(DescripteurCouche) > taille) {
+        liberer();
+        return false;
+    }
+    couches = (const DescripteurCouche *)(donnees + sizeof(EnTeteModele));
+
+    // On suit les dimensions d'une couche à l'autre pour vérifier que le réseau est cohérent
+    // et pour dimensionner les tampons d'activation une fois pour toutes.
+    // Tout est compté sur 64 bits : un fichier malformé ne doit pas faire déborder un size_t de 32 bits (raspi).
+    uint64_t largeur = entete->largeurEntree, hauteur = entete->hauteurEntree, canaux = entete->canauxEntree;
+    uint64_t activationMax = largeur * hauteur * canaux;
+    uint64_t patchMax = 0;
+    if (activationMax == 0 || largeur > TAILLE_ACTIVATION_MAX || hauteur > TAILLE_ACTIVATION_MAX
+            || activationMax > TAILLE_ACTIVATION_MAX) {
+        liberer();
+        return false;
+    }
+
+    for (uint32_t i = 0; i < entete->nbCouches; i++) {
+        const DescripteurCouche &c = couches[i];
+        uint64_t longueurPoids;
+
+        if (c.entrees == 0 || c.sorties == 0 || c.sorties > TAILLE_ACTIVATION_MAX) {
+            liberer();
+            return false;
+        }
+
+        if (c.type == COUCHE_CONVOLUTION_3X3 && c.entrees == canaux) {
+            longueurPoids = (9 * (uint64_t)c.entrees + ALIGNEMENT_INT8 - 1) / ALIGNEMENT_INT8 * ALIGNEMENT_INT8;
+            patchMax = std::max(patchMax, longueurPoids);
+            canaux = c.sorties;
+            activationMax = std::max(activationMax, largeur * hauteur * canaux);
+            if (c.maxPool) {
+                largeur /= 2;
+                hauteur /= 2;
+            }
+        } else if (c.type == COUCHE_DENSE && c.entrees == largeur * hauteur * canaux) {
+            longueurPoids = ((uint64_t)c.entrees + ALIGNEMENT_INT8 - 1) / ALIGNEMENT_INT8 * ALIGNEMENT_INT8;
+            patchMax = std::max(patchMax, longueurPoids);
+            largeur = hauteur = 1;
+            canaux = c.sorties;
+            activationMax = std::max(activationMax, canaux);
+        } else {
+            liberer();
+            return false;
+        }
+
+        // Poids et biais dans le fichier, comptés par division pour qu'aucune somme ne puisse déborder.
+        if (longueurPoids > TAILLE_ACTIVATION_MAX || activationMax > TAILLE_ACTIVATION_MAX
+                || c.positionPoids % ALIGNEMENT_INT8 != 0 || c.positionBiais % 4 != 0
+                || c.positionPoids > taille || c.sorties > (taille - c.positionPoids) / longueurPoids
+                || c.positionBiais > taille || c.sorties > (taille - c.positionBiais) / sizeof(int32_t)) {
+            liberer();
+            return false;
+        }
+    }
+
+    if (largeur * hauteur * canaux != entete->nbClasses || entete->nbClasses > NB_EXPRESSIONS) {
+        liberer();
+        return false;
+    }
+
+    activationA.assign(activationMax, 0);
+    activationB.assign(activationMax, 0);
+    patch.assign(patchMax, 0);
+    entreeReseau.assign(entete->largeurEntree * entete->hauteurEntree * entete->canauxEntree, 0);
+    tempsCouches.assign(entete->nbCouches, 0.);
+    nbInferences = 0;
+    return true;
+}
+
+/*
+ * Convolution 3x3, pas de 1, bord complété par des zéros.
+ * Pour chaque pixel, le voisinage 3x3 x canaux est recopié dans un patch contigu (complété jusqu'à la longueur alignée),
+ * puis chaque canal de sortie est un produit scalaire entre ce patch et ses poids.
+ */
+void ClassifieurExpression::convolution(const DescripteurCouche &couche, const int8_t *entree, int8_t *sortie, int largeur, int hauteur)
+{
+    const int canaux = couche.entrees;
+    const int longueur = longueurAlignee(9 * canaux);
+    const int8_t *poids = (const int8_t *)(donnees + couche.positionPoids);
+    const int32_t *biais = (const int32_t *)(donnees + couche.positionBiais);
+
+    std::fill(patch.begin(), patch.begin() + longueur, 0);
+
+    for (int y = 0; y < hauteur; y++) {
+        for (int x = 0; x < largeur; x++) {
+            int8_t *p = patch.data();
+            for (int ky = -1; ky <= 1; ky++) {
+                for (int kx = -1; kx <= 1; kx++, p += canaux) {
+                    int yy = y + ky, xx = x + kx;
+                    if (yy < 0 || yy >= hauteur || xx < 0 || xx >= largeur)
+                        memset(p, 0, canaux);
+                    else
+                        memcpy(p, entree + (yy * largeur + xx) * canaux, canaux);
+                }
+            }
+
+            int8_t *s = sortie + (y * largeur + x) * couche.sorties;
+            for (uint32_t k = 0; k < couche.sorties; k++) {
+                const int8_t *w = poids + k * longueur;
+                int32_t acc = biais[k] + (utiliserReference ? produitScalaireInt8Reference(patch.data(), w, longueur)
+                                                            : produitScalaireInt8(patch.data(), w, longueur));
+                s[k] = requantifierInt8(acc, couche.multiplicateur, couche.decalage, couche.relu);
+            }
+        }
+    }
+}
+
+/*
+ * Couche dense : un produit scalaire par neurone.
+ */
+void ClassifieurExpression::dense(const DescripteurCouche &couche, const int8_t *entree, int8_t *sortie)
+{
+    const int longueur = longueurAlignee(couche.entrees);
+    const int8_t *poids = (const int8_t *)(donnees + couche.positionPoids);
+    const int32_t *biais = (const int32_t *)(donnees + couche.positionBiais);
+
+    // L'entrée est recopiée dans le patch pour être complétée par des zéros jusqu'à la longueur alignée.
+    memcpy(patch.data(), entree, couche.entrees);
+    memset(patch.data() + couche.entrees, 0, longueur - couche.entrees);
+
+    for (uint32_t k = 0; k < couche.sorties; k++) {
+        const int8_t *w = poids + k * longueur;
+        int32_t acc = biais[k] + (utiliserReference ? produitScalaireInt8Reference(patch.data(), w, longueur)
+                                                    : produitScalaireInt8(patch.data(), w, longueur));
+        sortie[k] = requantifierInt8(acc, couche.multiplicateur, couche.decalage, couche.relu);
+    }
+}
+
+/*
+ * Passe avant du réseau sur une entrée déjà normalisée.
+ */
+std::vector<int8_t> ClassifieurExpression::inferer(const int8_t *entree, std::vector<std::vector<int8_t> > *sortiesCouches)
+{
+    if (!estCharge())
+        return std::vector<int8_t>();
+
+    int largeur = entete->largeurEntree, hauteur = entete->hauteurEntree, canaux = entete->canauxEntree;
+    memcpy(activationA.data(), entree, largeur * hauteur * canaux);
+
+    int8_t *courante = activationA.data();
+    int8_t *suivante = activationB.data();
+
+    for (uint32_t i = 0; i < entete->nbCouches; i++) {
+        const DescripteurCouche &c = couches[i];
+        std::chrono::steady_clock::time_point debut = std::chrono::steady_clock::now();
+
+        if (c.type == COUCHE_CONVOLUTION_3X3) {
+            convolution(c, courante, suivante, largeur, hauteur);
+            canaux = c.sorties;
+            if (c.maxPool) {
+                // Le pooling écrit dans le tampon libre, on n'échange donc pas les tampons cette fois-ci.
+                if (utiliserReference)
+                    maxPool2x2Int8Reference(suivante, courante, largeur, hauteur, canaux);
+                else
+                    maxPool2x2Int8(suivante, courante, largeur, hauteur, canaux);
+                largeur /= 2;
+                hauteur /= 2;
+            } else {
+                std::swap(courante, suivante);
+            }
+        } else {
+            dense(c, courante, suivante);
+            largeur = hauteur = 1;
+            canaux = c.sorties;
+            std::swap(courante, suivante);
+        }
+
+        tempsCouches[i] += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - debut).count();
+        if (sortiesCouches) { // copie hors de la mesure de temps.
+            sortiesCouches->resize(entete->nbCouches);
+            (*sortiesCouches)[i].assign(courante, courante + largeur * hauteur * canaux);
+        }
+    }
+    nbInferences++;
+
+    return std::vector<int8_t>(courante, courante + entete->nbClasses);
+}
+
+/*
+ * Classe l'expression du visage "visage" de l'image en niveaux de gris "image".
+ */
+Expression ClassifieurExpression::classer(const cv::Mat &image, const cv::Rect &visage)
+{
+    if (!estCharge())
+        return EXPRESSION_NEUTRE;
+
+    cv::resize(image(visage & cv::Rect(0, 0, image.cols, image.rows)), visageNormalise,
+               cv::Size(entete->largeurEntree, entete->hauteurEntree), 0, 0, cv::INTER_AREA);
+    cv::equalizeHist(visageNormalise, visageNormalise);
+
+    // Pixels 0..255 ramenés en int8 centré sur 0 (le réseau est entraîné avec la même normalisation).
+    for (int y = 0; y < visageNormalise.rows; y++) {
+        const uint8_t *ligne = visageNormalise.ptr<uint8_t>(y);
+        int8_t *dest = entreeReseau.data() + y * visageNormalise.cols;
+        for (int x = 0; x < visageNormalise.cols; x++)
+            dest[x] = (int8_t)(ligne[x] - 128);
+    }
+
+    std::vector<int8_t> scores = inferer(entreeReseau.data());
+
+    int meilleure = 0;
+    for (size_t i = 1; i < scores.size(); i++) {
+        if (scores[i] > scores[meilleure])
+            meilleure = i;
+    }
+    return (Expression)meilleure;
+}
+
+/*
+ * Compare la passe avant vectorisée et la passe scalaire de référence sur une entrée synthétique.
+ */
+bool ClassifieurExpression::verifierNoyaux()
+{
+    if (!estCharge())
+        return false;
+
+    // Mire pseudo-aléatoire qui couvre toute la plage int8.
+    std::vector<int8_t> mire(entreeReseau.size());
+    for (size_t i = 0; i < mire.size(); i++)
+        mire[i] = (int8_t)(i * 97 + (i >> 3) * 13);
+
+    bool reference = utiliserReference;
+
+    utiliserReference = true;
+    std::vector<int8_t> attendu = inferer(mire.data());
+    utiliserReference = false;
+    std::vector<int8_t> obtenu = inferer(mire.data());
+
+    utiliserReference = reference;
+    rapportTemps(); // la vérification ne compte pas dans les mesures de temps.
+    return attendu == obtenu;
+}
+
+/*
+ * Temps moyen (µs) de chaque couche depuis le dernier rapportTemps(), sans remettre les mesures à zéro.
+ */
+std::vector<double> ClassifieurExpression::tempsMoyensCouches() const
+{
+    std::vector<double> temps(tempsCouches.size(), 0.);
+    for (size_t i = 0; i < tempsCouches.size() && nbInferences > 0; i++)
+        temps[i] = tempsCouches[i] / nbInferences;
+    return temps;
+}
+
+/*
+ * Temps moyen passé dans chaque couche depuis le dernier appel.
+ */
+std::string ClassifieurExpression::rapportTemps()
+{
+    std::ostringstream rapport;
+    rapport << "classifieur (" << jeuInstructionsInt8() << ", " << nbInferences << " inférences) :";
+    for (size_t i = 0; i < tempsCouches.size(); i++) {
+        rapport << " couche " << i << " " << (nbInferences > 0 ? tempsCouches[i] / nbInferences : 0.) << " us";
+        tempsCouches[i] = 0.;
+    }
+    nbInferences = 0;
+    return rapport.str();
+}
+
+/*
+ * Convertit une classe du réseau en booléens sourire / oeil gauche / oeil droit pour displaySmiley().
+ */
+EtatExpression ClassifieurExpression::versEtat(Expression expression)
+{
+    EtatExpression etat;
+    etat.smile = expression == EXPRESSION_SOURIRE;
+    etat.leftEye = expression != EXPRESSION_YEUX_FERMES && expression != EXPRESSION_CLIN_OEIL_GAUCHE;
+    etat.rightEye = expression != EXPRESSION_YEUX_FERMES && expression != EXPRESSION_CLIN_OEIL_DROIT;
+    etat.scoreSourire = etat.smile;
+    etat.scoreOeilGauche = etat.leftEye;
+    etat.scoreOeilDroit = etat.rightEye;
+    return etat;
+}
@@ -0,0 +1,155 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Petit réseau de convolution quantifié en int8 qui classe l'expression d'un visage recadré.
+ * Les poids sont projetés en mémoire (mmap) depuis un fichier binaire, sans framework de réseaux de neurones,
+ * et les calculs passent par les noyaux vectorisés de noyauxint8.h (NEON sur la raspi).
+ *
+ * Format du fichier de poids (petit boutiste) :
+ *   EnTeteModele
+ *   DescripteurCouche x nbCouches
+ *   puis les poids (int8) et les biais (int32), aux positions données par chaque descripteur (alignées sur 16 octets).
+ * Couche convolution 3x3 (pas 1, bord complété par des zéros) : sorties x longueurAlignee(9 x entrees) poids,
+ *   rangés [sortie][ky][kx][canal], canaux d'entrée entrelacés (HWC).
+ * Couche dense : sorties x longueurAlignee(entrees) poids, l'entrée étant l'activation précédente aplatie en HWC.
+ */
+#ifndef CLASSIFIEUREXPRESSION_H
+#define CLASSIFIEUREXPRESSION_H
+
+#include <opencv2/core/core.hpp>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "estimateurexpression.h"
+
+// Classes reconnues par le classifieur, dans l'ordre des sorties du réseau.
+enum Expression {
+    EXPRESSION_NEUTRE = 0,
+    EXPRESSION_SOURIRE,
+    EXPRESSION_SURPRISE,
+    EXPRESSION_TRISTESSE,
+    EXPRESSION_CLIN_OEIL_GAUCHE,
+    EXPRESSION_CLIN_OEIL_DROIT,
+    EXPRESSION_YEUX_FERMES,
+    NB_EXPRESSIONS
+};
+
+#define MAGIE_MODELE_CNN8 0x384e4e43 // "CNN8"
+#define VERSION_MODELE_CNN8 1
+
+enum TypeCouche {
+    COUCHE_CONVOLUTION_3X3 = 1,
+    COUCHE_DENSE = 2
+};
+
+struct EnTeteModele {
+    uint32_t magie;
+    uint32_t version;
+    uint32_t nbCouches;
+    uint32_t largeurEntree;
+    uint32_t hauteurEntree;
+    uint32_t canauxEntree;
+    uint32_t nbClasses;
+    uint32_t reserve;
+};
+
+struct DescripteurCouche {
+    uint32_t type;           // TypeCouche
+    uint32_t entrees;        // canaux d'entrée (convolution) ou taille de l'entrée aplatie (dense)
+    uint32_t sorties;        // canaux de sortie (convolution) ou nombre de neurones (dense)
+    uint32_t maxPool;        // 1 si la convolution est suivie d'un max pooling 2x2
+    uint32_t relu;           // 1 si la sortie passe par un ReLU
+    int32_t multiplicateur;  // requantification de l'accumulateur : (acc * multiplicateur) >> decalage
+    int32_t decalage;
+    uint32_t reserve;
+    uint64_t positionPoids;  // position des poids dans le fichier
+    uint64_t positionBiais;  // position des biais dans le fichier
+};
+
+class ClassifieurExpression
+{
+public:
+    ClassifieurExpression();
+    ~ClassifieurExpression();
+
+    /*
+     * Projette le fichier de poids en mémoire et vérifie sa cohérence.
+     * Retourne false si le fichier est absent ou invalide.
+     */
+    bool charger(const std::string &chemin);
+
+    bool estCharge() const { return donnees != 0; }
+
+    /*
+     * Classe l'expression du visage "visage" de l'image en niveaux de gris "image".
+     * Le visage est recadré, redimensionné à la taille d'entrée du réseau et son histogramme égalisé.
+     */
+    Expression classer(const cv::Mat &image, const cv::Rect &visage);
+
+    /*
+     * Passe avant du réseau sur une entrée déjà normalisée (largeur x hauteur x canaux, valeurs int8).
+     * Retourne les scores (int8) de chaque classe. Si "sortiesCouches" est donné, il reçoit la sortie de chaque couche
+     * (après le max pooling), pour comparer les noyaux couche par couche (BancClassifieur).
+     */
+    std::vector<int8_t> inferer(const int8_t *entree, std::vector<std::vector<int8_t> > *sortiesCouches = 0);
+
+    /*
+     * Force le chemin scalaire de référence (pour vérifier les noyaux vectorisés).
+     */
+    void setReference(bool reference) { utiliserReference = reference; }
+
+    /*
+     * Compare la passe avant vectorisée et la passe scalaire de référence sur une entrée synthétique.
+     * Retourne true si les scores sont identiques.
+     */
+    bool verifierNoyaux();
+
+    /*
+     * Temps moyen passé dans chaque couche (en microsecondes) depuis le dernier appel, sous forme de texte.
+     */
+    std::string rapportTemps();
+
+    /*
+     * Temps moyen passé dans chaque couche (en microsecondes) depuis le dernier rapportTemps(), sans remise à zéro.
+     */
+    std::vector<double> tempsMoyensCouches() const;
+
+    // Nombre de couches du réseau chargé (0 sinon).
+    int nombreCouches() const { return entete ? (int)entete->nbCouches : 0; }
+
+    /*
+     * Convertit une classe du réseau en booléens sourire / oeil gauche / oeil droit pour displaySmiley().
+     */
+    static EtatExpression versEtat(Expression expression);
+
+private:
+    ClassifieurExpression(const ClassifieurExpression &);
+    ClassifieurExpression &operator=(const ClassifieurExpression &);
+
+    void liberer();
+    void convolution(const DescripteurCouche &couche, const int8_t *entree, int8_t *sortie, int largeur, int hauteur);
+    void dense(const DescripteurCouche &couche, const int8_t *entree, int8_t *sortie);
+
+    // Fichier projeté en mémoire.
+    const uint8_t *donnees = 0;
+    size_t taille = 0;
+    const EnTeteModele *entete = 0;
+    const DescripteurCouche *couches = 0;
+
+    // Tampons d'activations réutilisés d'une image à l'autre.
+    std::vector<int8_t> activationA;
+    std::vector<int8_t> activationB;
+    std::vector<int8_t> patch;
+    std::vector<int8_t> entreeReseau;
+    cv::Mat visageNormalise;
+
+    bool utiliserReference = false;
+
+    // Mesure du temps par couche (micro-benchmark permanent).
+    std::vector<double> tempsCouches;
+    int nbInferences = 0;
+};
+
+#endif // CLASSIFIEUREXPRESSION_H
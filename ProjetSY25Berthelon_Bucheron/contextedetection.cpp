@@ -0,0 +1,82 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Niveaux de pyramide et images intégrales partagés par les cascades d'une même image.
+ */
+#include "contextedetection.h"
+#include "mesurelatence.h"
+
+#include "opencv2/imgproc/imgproc.hpp"
+#include <sstream>
+
+ContexteDetection::ContexteDetection() :
+    nbNiveaux(0),
+    nbImages(0),
+    niveauxCalcules(0),
+    niveauxReutilises(0),
+    tempsNiveaux(0),
+    tempsEvaluation(0),
+    nbFenetres(0)
+{
+}
+
+void ContexteDetection::nouvelleImage(const cv::Mat &image)
+{
+    source = image;
+    nbNiveaux = 0;
+    nbImages++;
+}
+
+const NiveauDetection &ContexteDetection::niveau(const cv::Rect &zone, float echelle, bool avecInclinee)
+{
+    // Un niveau de même échelle qui couvre déjà la zone fait l'affaire.
+    for (size_t i = 0; i < nbNiveaux; i++){
+        NiveauDetection &n = niveaux[i];
+        if (n.echelle == echelle && (n.zone & zone) == zone){
+            if (avecInclinee && n.integrale.inclinee.empty()){ // calculée seulement si une cascade en a besoin.
+                uint64_t debut = MesureLatence::horloge();
+                calculerIntegraleInclinee(n.image.data, n.image.cols, n.image.rows, n.image.step, n.integrale);
+                tempsNiveaux += MesureLatence::horloge() - debut;
+            }
+            niveauxReutilises++;
+            return n;
+        }
+    }
+
+    uint64_t debut = MesureLatence::horloge();
+    if (nbNiveaux == niveaux.size()){
+        niveaux.push_back(NiveauDetection());
+    }
+    NiveauDetection &n = niveaux[nbNiveaux++];
+    n.zone = zone;
+    n.echelle = echelle;
+    if (echelle == 1.f){
+        n.image = source(zone); // pas de réduction : vue sur l'image.
+    } else {
+        // même taille et même interpolation que les niveaux de CascadeClassifier::detectMultiScale.
+        cv::Size taille(cvRound(zone.width / echelle), cvRound(zone.height / echelle));
+        cv::resize(source(zone), n.image, taille, 0, 0, cv::INTER_LINEAR_EXACT);
+    }
+    calculerIntegrales(n.image.data, n.image.cols, n.image.rows, n.image.step, avecInclinee, n.integrale);
+    tempsNiveaux += MesureLatence::horloge() - debut;
+    niveauxCalcules++;
+    return n;
+}
+
+void ContexteDetection::ajouterEvaluation(uint64_t duree, uint64_t fenetres)
+{
+    tempsEvaluation += duree;
+    nbFenetres += fenetres;
+}
+
+std::string ContexteDetection::rapportTemps()
+{
+    std::ostringstream rapport;
+    double images = nbImages > 0 ? (double)nbImages : 1.;
+    rapport << "cascades (" << nbImages << " images) : " << niveauxCalcules / images << " niveaux calculés et "
+            << niveauxReutilises / images << " réutilisés par image, niveaux " << tempsNiveaux / images / 1000. << " ms, "
+            << "évaluation " << tempsEvaluation / images / 1000. << " ms (" << nbFenetres / images << " fenêtres)";
+    nbImages = niveauxCalcules = niveauxReutilises = tempsNiveaux = tempsEvaluation = nbFenetres = 0;
+    return rapport.str();
+}
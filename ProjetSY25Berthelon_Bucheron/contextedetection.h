@@ -0,0 +1,75 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Contexte de détection d'une image : les niveaux de pyramide (image réduite et ses intégrales) sont calculés
+ * à la demande et gardés jusqu'à l'image suivante, pour que toutes les cascades lancées sur cette image les partagent.
+ *
+ * Un niveau est repéré par une zone de l'image et une échelle. Une cascade qui cherche dans une partie de la zone
+ * (moitié du visage pour les yeux) travaille sur une vue du niveau, et un niveau déjà calculé pour une zone plus grande
+ * à la même échelle est réutilisé tel quel. Ainsi les cascades sourire et yeux ne calculent qu'une pyramide du visage,
+ * et les deux yeux se partagent tous leurs niveaux.
+ *
+ * Le contexte mesure aussi le temps passé à construire les niveaux et à évaluer les fenêtres (rapportTemps()).
+ */
+#ifndef CONTEXTEDETECTION_H
+#define CONTEXTEDETECTION_H
+
+#include "evaluateurcascade.h"
+
+#include <opencv2/core/core.hpp>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+struct NiveauDetection {
+    cv::Rect zone;      // zone de l'image d'origine couverte par le niveau
+    float echelle;      // taille de la zone / taille du niveau
+    cv::Mat image;      // zone réduite (vue sur l'image d'origine à l'échelle 1)
+    ImageIntegrale integrale;
+};
+
+class ContexteDetection
+{
+public:
+    ContexteDetection();
+
+    /*
+     * Nouvelle image (8 bits, un canal) : les niveaux de l'image précédente sont oubliés.
+     * L'image n'est pas copiée, elle doit rester valide tant que le contexte est utilisé.
+     */
+    void nouvelleImage(const cv::Mat &image);
+
+    const cv::Mat &image() const { return source; }
+
+    /*
+     * Niveau couvrant "zone" à l'échelle donnée (avec l'intégrale inclinée si demandée).
+     * Le niveau retourné peut couvrir une zone plus grande : sa zone sert à placer la région cherchée.
+     */
+    const NiveauDetection &niveau(const cv::Rect &zone, float echelle, bool avecInclinee);
+
+    /*
+     * Temps d'évaluation des fenêtres (µs), ajouté par les cascades.
+     */
+    void ajouterEvaluation(uint64_t duree, uint64_t fenetres);
+
+    /*
+     * Niveaux calculés / réutilisés et temps moyens par image depuis le dernier appel.
+     */
+    std::string rapportTemps();
+
+private:
+    cv::Mat source;
+    // Les niveaux (et leurs tableaux) sont gardés d'une image à l'autre : seuls les nbNiveaux premiers sont valides.
+    std::vector<NiveauDetection> niveaux;
+    size_t nbNiveaux;
+
+    uint64_t nbImages;
+    uint64_t niveauxCalcules;
+    uint64_t niveauxReutilises;
+    uint64_t tempsNiveaux;
+    uint64_t tempsEvaluation;
+    uint64_t nbFenetres;
+};
+
+#endif // CONTEXTEDETECTION_H
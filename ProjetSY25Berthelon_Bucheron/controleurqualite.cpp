@@ -0,0 +1,123 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Contrôleur de qualité de la détection, en fonction du temps de traitement et de la température.
+ */
+#include "controleurqualite.h"
+
+#include <cstdio>
+
+// Du plus précis au plus économe : on réduit d'abord le nombre de tailles essayées, puis l'image, puis l'expression.
+static const NiveauQualite NIVEAUX[] = {
+    { 1.0,  1.1, 1 },
+    { 1.0,  1.2, 1 },
+    { 0.75, 1.2, 2 },
+    { 0.5,  1.2, 2 },
+    { 0.5,  1.3, 4 }
+};
+#define NB_NIVEAUX ((int)(sizeof(NIVEAUX) / sizeof(NIVEAUX[0])))
+
+// Poids de la dernière image dans la moyenne glissante.
+#define LISSAGE 0.2
+// Nombre d'images analysées avant de pouvoir changer à nouveau de niveau.
+#define IMAGES_STABILISATION 10
+// On remonte la qualité sous 70 % de la cible, et 5 °C sous la température maximum.
+#define MARGE_DUREE 0.7
+#define MARGE_TEMPERATURE 5.f
+// Nombre de décisions gardées pour le rapport.
+#define TAILLE_HISTORIQUE 20
+
+ControleurQualite::ControleurQualite(double cible, float temperatureMax, int niveauInitial) :
+    cible(cible),
+    temperatureMax(temperatureMax),
+    courant(niveauInitial < 0 ? 0 : (niveauInitial >= NB_NIVEAUX ? NB_NIVEAUX - 1 : niveauInitial)),
+    dureeMoyenne(-1), // pas encore de mesure
+    derniereTemperature(0),
+    imagesDepuisChangement(0)
+{
+}
+
+int ControleurQualite::nombreNiveaux()
+{
+    return NB_NIVEAUX;
+}
+
+const NiveauQualite &ControleurQualite::niveau() const
+{
+    return NIVEAUX[courant];
+}
+
+const NiveauQualite &ControleurQualite::niveau(int numero)
+{
+    return NIVEAUX[numero < 0 ? 0 : (numero >= NB_NIVEAUX ? NB_NIVEAUX - 1 : numero)];
+}
+
+const char *ControleurQualite::nomRaison(RaisonQualite raison)
+{
+    switch (raison){
+    case RAISON_LATENCE: return "latence";
+    case RAISON_TEMPERATURE: return "temperature";
+    case RAISON_MARGE: return "marge";
+    }
+    return "?";
+}
+
+bool ControleurQualite::mettreAJour(double dureeMs, float temperature, uint64_t horodatage, DecisionQualite &decision)
+{
+    dureeMoyenne = dureeMoyenne < 0 ? dureeMs : dureeMoyenne + LISSAGE * (dureeMs - dureeMoyenne);
+    derniereTemperature = temperature;
+
+    if (++imagesDepuisChangement < IMAGES_STABILISATION)
+        return false;
+
+    int nouveau = courant;
+    RaisonQualite raison = RAISON_MARGE;
+
+    if (temperature > temperatureMax && courant < NB_NIVEAUX - 1){
+        nouveau = courant + 1;
+        raison = RAISON_TEMPERATURE;
+    } else if (dureeMoyenne > cible && courant < NB_NIVEAUX - 1){
+        nouveau = courant + 1;
+        raison = RAISON_LATENCE;
+    } else if (dureeMoyenne < MARGE_DUREE * cible && temperature < temperatureMax - MARGE_TEMPERATURE && courant > 0){
+        nouveau = courant - 1;
+        raison = RAISON_MARGE;
+    }
+
+    if (nouveau == courant)
+        return false;
+
+    decision.horodatage = horodatage;
+    decision.ancienNiveau = courant;
+    decision.nouveauNiveau = nouveau;
+    decision.dureeMoyenne = (float)dureeMoyenne;
+    decision.temperature = temperature;
+    decision.raison = raison;
+
+    historique.push_back(decision);
+    if (historique.size() > TAILLE_HISTORIQUE)
+        historique.pop_front();
+
+    courant = nouveau;
+    imagesDepuisChangement = 0; // la moyenne continue : elle reflète vite le nouveau niveau grâce au lissage.
+    return true;
+}
+
+std::string ControleurQualite::rapport() const
+{
+    char ligne[200];
+    const NiveauQualite &n = NIVEAUX[courant];
+    snprintf(ligne, sizeof(ligne), "niveau %d/%d : echelle %.2f, facteur %.2f, expression 1 image sur %d ; moyenne %.1f ms (cible %.1f), %.1f C (max %.1f)\n",
+             courant, NB_NIVEAUX - 1, n.echelle, n.facteurEchelle, n.periodeExpression,
+             dureeMoyenne < 0 ? 0. : dureeMoyenne, cible, derniereTemperature, temperatureMax);
+    std::string texte = ligne;
+
+    for (size_t i = 0; i < historique.size(); i++){
+        const DecisionQualite &d = historique[i];
+        snprintf(ligne, sizeof(ligne), "%.3f s : niveau %d -> %d (%s, %.1f ms, %.1f C)\n",
+                 d.horodatage / 1e6, d.ancienNiveau, d.nouveauNiveau, nomRaison(d.raison), d.dureeMoyenne, d.temperature);
+        texte += ligne;
+    }
+    return texte;
+}
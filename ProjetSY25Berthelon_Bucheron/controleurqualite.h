@@ -0,0 +1,84 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Contrôleur de qualité : quand le traitement d'une image devient trop long (charge, ralentissement thermique),
+ * il baisse la qualité de la détection, puis la remonte quand il y a de la marge.
+ *
+ * Trois réglages sont regroupés en niveaux, du plus précis (0) au plus économe :
+ *  - l'échelle de l'image donnée à la cascade de visage (1 : pleine résolution),
+ *  - le facteur d'échelle de detectMultiScale (plus grand : moins de tailles essayées),
+ *  - la période de l'analyse de l'expression (1 : à chaque image, 4 : une image sur 4).
+ * Chaque changement de niveau est une DecisionQualite, gardée dans un historique et journalisée.
+ */
+#ifndef CONTROLEURQUALITE_H
+#define CONTROLEURQUALITE_H
+
+#include <deque>
+#include <stdint.h>
+#include <string>
+
+struct NiveauQualite {
+    double echelle;
+    double facteurEchelle;
+    int periodeExpression;
+};
+
+// Raison d'un changement de niveau.
+enum RaisonQualite {
+    RAISON_LATENCE = 1,     // temps de traitement moyen au dessus de la cible
+    RAISON_TEMPERATURE = 2, // processeur trop chaud
+    RAISON_MARGE = 3        // assez de marge pour remonter la qualité
+};
+
+struct DecisionQualite {
+    uint64_t horodatage;      // horloge monotone (µs)
+    int ancienNiveau;
+    int nouveauNiveau;
+    float dureeMoyenne;       // temps de traitement moyen (ms) au moment de la décision
+    float temperature;        // °C
+    RaisonQualite raison;
+};
+
+class ControleurQualite
+{
+public:
+    /*
+     * cible : temps de traitement visé par image (ms), temperatureMax : température (°C) au delà de laquelle on économise.
+     */
+    ControleurQualite(double cible, float temperatureMax, int niveauInitial);
+
+    /*
+     * Temps de traitement d'une image analysée (ms) et dernière température lue.
+     * Retourne true si le niveau a changé (la décision est alors remplie).
+     */
+    bool mettreAJour(double dureeMs, float temperature, uint64_t horodatage, DecisionQualite &decision);
+
+    const NiveauQualite &niveau() const;
+    // Réglages d'un niveau quelconque (pour les outils qui les comparent).
+    static const NiveauQualite &niveau(int numero);
+    int numeroNiveau() const { return courant; }
+    static int nombreNiveaux();
+
+    static const char *nomRaison(RaisonQualite raison);
+
+    /*
+     * Etat courant et dernières décisions, en texte.
+     */
+    std::string rapport() const;
+
+private:
+    double cible;
+    float temperatureMax;
+    int courant;
+
+    // moyenne glissante (exponentielle) du temps de traitement.
+    double dureeMoyenne;
+    float derniereTemperature;
+    // images analysées depuis le dernier changement (on laisse le temps au nouveau niveau de faire effet).
+    int imagesDepuisChangement;
+
+    std::deque<DecisionQualite> historique;
+};
+
+#endif // CONTROLEURQUALITE_H
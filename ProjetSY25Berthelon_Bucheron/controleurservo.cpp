@@ -0,0 +1,98 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Décision des commandes des servomoteurs, commune à l'application et au simulateur de nacelle.
+ */
+#include "controleurservo.h"
+#include "planificateurmouvement.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+ControleurServo::ControleurServo(const CalibrationCamera &calibration, int tolerance) :
+    calibration(calibration),
+    tolerance(tolerance),
+    centreImageX(calibration.largeur/2),
+    centreImageY(calibration.hauteur/2)
+{
+}
+
+int ControleurServo::commander(int centreX, int centreY, char commande[3]) const
+{
+    int n = 0;
+
+    // gestion de l'alignement horizontal (± tolerance autour du centre, soit 300 - 340 px en VGA).
+    if (centreX < centreImageX - tolerance){
+        commande[n++] = 'H';
+    }
+    else if (centreX > centreImageX + tolerance){
+        commande[n++] = 'h';
+    }
+    // gestion de l'alignement vertical (220 - 260 px en VGA).
+    if (centreY < centreImageY - tolerance){
+        commande[n++] = 'V';
+    }
+    else if (centreY > centreImageY + tolerance){
+        commande[n++] = 'v';
+    }
+    commande[n] = 0;
+    return n;
+}
+
+/*
+ * Pas de 2° à ajouter à "cible" pour atteindre "angleVise" (0 si l'écart est sous la tolérance).
+ */
+static int pasManquants(double angleVise, double cible, double toleranceDegres)
+{
+    double ecart = angleVise - cible;
+    if (std::fabs(ecart) <= toleranceDegres)
+        return 0;
+    int pas = std::max(1, (int)std::lround(std::fabs(ecart) / PAS_COMMANDE_SERVO));
+    pas = std::min(pas, MAX_PAS_PAR_AXE);
+    return ecart > 0 ? pas : -pas;
+}
+
+/*
+ * Octets de "pasH" et "pasV" pas (signés), terminés par un zéro.
+ */
+static int ecrirePas(int pasH, int pasV, char *commande)
+{
+    int n = 0;
+    for (int i = 0; i < std::abs(pasH); i++)
+        commande[n++] = pasH > 0 ? 'H' : 'h';
+    for (int i = 0; i < std::abs(pasV); i++)
+        commande[n++] = pasV > 0 ? 'V' : 'v';
+    commande[n] = 0;
+    return n;
+}
+
+int ControleurServo::commanderDirect(int centreX, int centreY, char *commande, double &duree) const
+{
+    // tolérance en pixels autour du centre, convertie en angle.
+    int pasH = pasManquants(calibration.angleHorizontal(centreX), 0, std::fabs(calibration.angleHorizontal(centreImageX - tolerance)));
+    int pasV = pasManquants(calibration.angleVertical(centreY), 0, std::fabs(calibration.angleVertical(centreImageY - tolerance)));
+    duree = dureeDeplacement(std::max(std::abs(pasH), std::abs(pasV)) * PAS_COMMANDE_SERVO);
+    return ecrirePas(pasH, pasV, commande);
+}
+
+int ControleurServo::commanderCompense(int centreX, int centreY, const EtatServos &capture, double cibleH, double cibleV,
+                                       char *commande) const
+{
+    // 'H' (angle horizontal qui augmente) ramène vers le centre un visage à gauche, 'V' un visage en haut.
+    double viseH = capture.angleH + calibration.angleHorizontal(centreX);
+    double viseV = capture.angleV + calibration.angleVertical(centreY);
+    int pasH = pasManquants(viseH, cibleH, std::fabs(calibration.angleHorizontal(centreImageX - tolerance)));
+    int pasV = pasManquants(viseV, cibleV, std::fabs(calibration.angleVertical(centreImageY - tolerance)));
+    return ecrirePas(pasH, pasV, commande);
+}
+
+double ControleurServo::dureeDeplacement(double ecart)
+{
+    ecart = std::fabs(ecart);
+    double v = VITESSE_MAX_SERVO, a = ACCELERATION_SERVO;
+    if (ecart < v * v / a) // profil triangulaire : la vitesse maximum n'est pas atteinte.
+        return 2 * std::sqrt(ecart / a);
+    return ecart / v + v / a;
+}
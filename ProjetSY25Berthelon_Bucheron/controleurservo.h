@@ -0,0 +1,67 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Décision des commandes des servomoteurs (celle de handleServo()), sans le port série :
+ * la même boucle sert à l'application et au simulateur de nacelle (voir simulateurnacelle.h).
+ * Les écarts en pixels sont convertis en angles par la calibration de la caméra (calibrationcamera.h).
+ */
+#ifndef CONTROLEURSERVO_H
+#define CONTROLEURSERVO_H
+
+#include "calibrationcamera.h"
+#include "telemetrieservo.h"
+
+// Pas de 2° envoyés au plus par axe et par image (corrections en une fois) : 20°, un visage au bord de l'image VGA.
+#define MAX_PAS_PAR_AXE 10
+// Marge (s) ajoutée à la durée du mouvement avant de corriger à nouveau : liaison série, servo en retard sur sa consigne, image suivante.
+#define MARGE_CORRECTION 0.3
+
+class ControleurServo
+{
+public:
+    /*
+     * calibration : taille des images analysées (le centre visé est celui de l'image) et champ de la caméra.
+     * tolerance : écart au centre (px) en dessous duquel on ne bouge pas.
+     */
+    ControleurServo(const CalibrationCamera &calibration = CalibrationCamera(), int tolerance = 20);
+
+    /*
+     * Commandes pour ramener le centre du visage vers le centre de l'image : au plus un octet par axe
+     * ('H' / 'h' à l'horizontale, 'V' / 'v' à la verticale), écrits dans "commande" et terminés par un zéro.
+     * Retourne le nombre d'octets (0 si le visage est déjà centré).
+     */
+    int commander(int centreX, int centreY, char commande[3]) const;
+
+    /*
+     * Correction en une fois : l'écart du visage est converti en angles par la calibration, et tous les pas de 2°
+     * nécessaires (jusqu'à MAX_PAS_PAR_AXE par axe) partent ensemble ; l'arduino en fait un seul mouvement.
+     * "duree" reçoit la durée estimée du mouvement (s), pendant laquelle il ne faut pas corriger à nouveau
+     * à partir d'images prises avant son arrivée. "commande" doit avoir la place de 2*MAX_PAS_PAR_AXE + 1 octets.
+     */
+    int commanderDirect(int centreX, int centreY, char *commande, double &duree) const;
+
+    /*
+     * Version compensée, avec la télémétrie des servos : "capture" est l'état des servos pendant la capture de l'image,
+     * cibleH / cibleV les cibles qu'ils auront une fois exécutées les commandes déjà envoyées (TelemetrieServo::ciblesAttendues()).
+     * L'angle visé est l'angle de la caméra pendant la capture corrigé de l'écart du visage au centre (calibration),
+     * et seul ce qui manque aux cibles attendues est envoyé, jusqu'à MAX_PAS_PAR_AXE pas par axe : une image prise
+     * pendant que la nacelle bouge, ou avant que les commandes précédentes soient exécutées, ne fait pas renvoyer les mêmes pas.
+     * "commande" doit avoir la place de 2*MAX_PAS_PAR_AXE + 1 octets (zéro final). Retourne le nombre d'octets.
+     */
+    int commanderCompense(int centreX, int centreY, const EtatServos &capture, double cibleH, double cibleV, char *commande) const;
+
+    /*
+     * Durée (s) d'un déplacement de "ecart" degrés avec le profil de PlanificateurMouvement (vitesse et accélération de l'arduino).
+     */
+    static double dureeDeplacement(double ecart);
+
+    CalibrationCamera calibration;
+    int tolerance;
+
+private:
+    int centreImageX;
+    int centreImageY;
+};
+
+#endif // CONTROLEURSERVO_H
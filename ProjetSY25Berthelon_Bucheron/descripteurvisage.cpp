@@ -0,0 +1,112 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Histogrammes LBP uniformes d'un visage normalisé, et qualité de l'image du visage.
+ */
+#include "descripteurvisage.h"
+
+#include <opencv2/imgproc/imgproc.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+/*
+ * Table motif (8 bits) -> classe : les 58 motifs uniformes (au plus deux transitions 0/1 sur le cercle)
+ * ont chacun leur classe, tous les autres partagent la dernière.
+ */
+static const unsigned char *tableUniforme()
+{
+    static unsigned char table[256];
+    static bool prete = false;
+    if (!prete){
+        int classe = 0;
+        for (int motif = 0; motif < 256; motif++){
+            int transitions = 0;
+            for (int b = 0; b < 8; b++)
+                transitions += ((motif >> b) & 1) != ((motif >> ((b + 1) % 8)) & 1);
+            table[motif] = transitions <= 2 ? classe++ : CLASSES_LBP - 1;
+        }
+        prete = true;
+    }
+    return table;
+}
+
+void DescripteurVisage::normaliser(const cv::Mat &luminance, const cv::Rect &rect, cv::Mat &visage)
+{
+    cv::Rect zone = rect & cv::Rect(0, 0, luminance.cols, luminance.rows);
+    cv::Mat reduit;
+    cv::resize(luminance(zone), reduit, cv::Size(COTE_VISAGE_NORMALISE, COTE_VISAGE_NORMALISE), 0, 0, cv::INTER_AREA);
+    cv::equalizeHist(reduit, visage);
+}
+
+QualiteVisage DescripteurVisage::qualite(const cv::Mat &visage, int taille)
+{
+    QualiteVisage q;
+    q.taille = taille;
+
+    cv::Mat laplacien;
+    cv::Laplacian(visage, laplacien, CV_16S);
+    cv::Scalar moyenne, ecartType;
+    cv::meanStdDev(laplacien, moyenne, ecartType);
+    q.nettete = ecartType[0] * ecartType[0];
+
+    // corrélation centrée avec le miroir : un visage de face est presque symétrique, un profil ne l'est pas.
+    double somme = 0, sommeCarres = 0, sommeProduits = 0;
+    int n = visage.rows * visage.cols;
+    for (int y = 0; y < visage.rows; y++){
+        const unsigned char *ligne = visage.ptr<unsigned char>(y);
+        for (int x = 0; x < visage.cols; x++){
+            double a = ligne[x];
+            somme += a;
+            sommeCarres += a * a;
+            sommeProduits += a * ligne[visage.cols - 1 - x];
+        }
+    }
+    double m = somme / n;
+    double variance = sommeCarres / n - m * m;
+    q.frontalite = variance > 0 ? (sommeProduits / n - m * m) / variance : 0;
+
+    // chaque critère compte jusqu'à une valeur de référence : visage de 120 px, netteté de 300.
+    q.score = std::max(q.frontalite, 0.) * std::min(taille / 120., 1.) * std::min(q.nettete / 300., 1.);
+    return q;
+}
+
+void DescripteurVisage::calculer(const cv::Mat &visage, float *descripteur)
+{
+    const unsigned char *table = tableUniforme();
+    memset(descripteur, 0, DIMENSION_DESCRIPTEUR * sizeof(float));
+
+    // motifs des pixels intérieurs (le bord n'a pas ses 8 voisins), rangés dans la cellule qui contient le pixel.
+    const int interieur = COTE_VISAGE_NORMALISE - 2;
+    for (int y = 1; y <= interieur; y++){
+        const unsigned char *haut = visage.ptr<unsigned char>(y - 1);
+        const unsigned char *ligne = visage.ptr<unsigned char>(y);
+        const unsigned char *bas = visage.ptr<unsigned char>(y + 1);
+        float *cellules = descripteur + ((y - 1) * CELLULES_DESCRIPTEUR / interieur) * CELLULES_DESCRIPTEUR * CLASSES_LBP;
+        for (int x = 1; x <= interieur; x++){
+            unsigned char c = ligne[x];
+            int motif = (haut[x - 1] >= c) | (haut[x] >= c) << 1 | (haut[x + 1] >= c) << 2 | (ligne[x + 1] >= c) << 3
+                      | (bas[x + 1] >= c) << 4 | (bas[x] >= c) << 5 | (bas[x - 1] >= c) << 6 | (ligne[x - 1] >= c) << 7;
+            cellules[((x - 1) * CELLULES_DESCRIPTEUR / interieur) * CLASSES_LBP + table[motif]] += 1;
+        }
+    }
+
+    // racine carrée des histogrammes (Hellinger), puis norme 1.
+    double norme = 0;
+    for (int i = 0; i < DIMENSION_DESCRIPTEUR; i++){
+        descripteur[i] = std::sqrt(descripteur[i]);
+        norme += descripteur[i] * descripteur[i];
+    }
+    float inverse = norme > 0 ? (float)(1. / std::sqrt(norme)) : 0.f;
+    for (int i = 0; i < DIMENSION_DESCRIPTEUR; i++)
+        descripteur[i] *= inverse;
+}
+
+double DescripteurVisage::similarite(const float *a, const float *b)
+{
+    double s = 0;
+    for (int i = 0; i < DIMENSION_DESCRIPTEUR; i++)
+        s += a[i] * b[i];
+    return s;
+}
@@ -0,0 +1,53 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Descripteur d'identité d'un visage, et qualité de l'image du visage pour la reconnaissance.
+ *
+ * Le descripteur est celui de la méthode LBPH (histogrammes de motifs binaires locaux), calculé ici sans le module
+ * "face" d'opencv_contrib : le visage est ramené à 64x64 pixels et égalisé, chaque pixel reçoit son motif LBP uniforme
+ * (8 voisins, rayon 1, 59 classes), et l'image est découpée en 4x4 cellules dont on fait l'histogramme.
+ * Les histogrammes sont passés à la racine carrée puis le vecteur est normé : le produit scalaire de deux descripteurs
+ * (similarité cosinus, dans [0, 1]) équivaut alors à la distance de Hellinger entre histogrammes, et la recherche dans
+ * la base se réduit à des produits scalaires.
+ *
+ * La reconnaissance ne vaut que sur des images correctes du visage : la qualité combine la taille du visage dans l'image,
+ * sa netteté (variance du laplacien) et sa symétrie gauche-droite (corrélation avec son miroir, proche de 1 de face).
+ */
+#ifndef DESCRIPTEURVISAGE_H
+#define DESCRIPTEURVISAGE_H
+
+#include <opencv2/core/core.hpp>
+
+#define COTE_VISAGE_NORMALISE 64
+#define CELLULES_DESCRIPTEUR 4
+#define CLASSES_LBP 59
+#define DIMENSION_DESCRIPTEUR (CELLULES_DESCRIPTEUR * CELLULES_DESCRIPTEUR * CLASSES_LBP) // 944
+
+struct QualiteVisage {
+    int taille = 0;          // largeur du visage dans l'image (px)
+    double nettete = 0;      // variance du laplacien du visage normalisé
+    double frontalite = 0;   // corrélation du visage normalisé avec son miroir, dans [-1, 1]
+    double score = 0;        // dans [0, 1], pour comparer les images d'un même visage
+};
+
+class DescripteurVisage
+{
+public:
+    /*
+     * Visage "rect" de l'image en niveaux de gris ramené à COTE_VISAGE_NORMALISE pixels de côté et égalisé
+     * (copie : l'image source peut être rendue ensuite).
+     */
+    static void normaliser(const cv::Mat &luminance, const cv::Rect &rect, cv::Mat &visage);
+
+    // Qualité du visage normalisé "visage", de largeur "taille" dans l'image.
+    static QualiteVisage qualite(const cv::Mat &visage, int taille);
+
+    // Descripteur (DIMENSION_DESCRIPTEUR valeurs, norme 1) du visage normalisé.
+    static void calculer(const cv::Mat &visage, float *descripteur);
+
+    // Similarité cosinus de deux descripteurs.
+    static double similarite(const float *a, const float *b);
+};
+
+#endif // DESCRIPTEURVISAGE_H
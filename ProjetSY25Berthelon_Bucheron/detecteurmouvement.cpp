@@ -0,0 +1,50 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Détection de mouvement par différence de blocs sur une image réduite.
+ */
+#include "detecteurmouvement.h"
+
+#include "opencv2/imgproc/imgproc.hpp"
+#include <algorithm>
+
+// Largeur de l'image réduite et taille des blocs (sur l'image réduite).
+#define LARGEUR_REDUITE 80
+#define TAILLE_BLOC 8
+
+DetecteurMouvement::DetecteurMouvement(int seuilBloc, int blocsMin, int rafraichissementMax) :
+    seuilBloc(seuilBloc),
+    blocsMin(blocsMin > 0 ? blocsMin : 1),
+    rafraichissementMax((uint64_t)rafraichissementMax * 1000)
+{
+}
+
+bool DetecteurMouvement::detectionNecessaire(const cv::Mat &image, uint64_t horodatage)
+{
+    // Réduction d'un facteur 8 en VGA : chaque pixel réduit est déjà la moyenne d'un bloc 8x8, le bruit du capteur disparaît.
+    int hauteurReduite = std::max(1, image.rows * LARGEUR_REDUITE / image.cols);
+    cv::resize(image, reduite, cv::Size(LARGEUR_REDUITE, hauteurReduite), 0, 0, cv::INTER_AREA);
+
+    bool changee = force || reference.size() != reduite.size()
+            || horodatage - derniereDetection >= rafraichissementMax;
+
+    if (!changee){
+        cv::absdiff(reduite, reference, difference);
+        // Moyenne de la différence par bloc : une somme des différences absolues normalisée.
+        cv::resize(difference, blocs, cv::Size(LARGEUR_REDUITE / TAILLE_BLOC, std::max(1, hauteurReduite / TAILLE_BLOC)),
+                   0, 0, cv::INTER_AREA);
+        changee = cv::countNonZero(blocs > seuilBloc) >= blocsMin;
+    }
+
+    if (!changee){
+        nbIgnorees++;
+        return false;
+    }
+
+    cv::swap(reference, reduite); // l'image de cette détection devient la référence (sans copie).
+    derniereDetection = horodatage;
+    force = false;
+    nbAnalysees++;
+    return true;
+}
@@ -0,0 +1,56 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Détection de mouvement très simple, pour ne lancer les cascades que si la scène a changé.
+ * L'image est réduite à 80 pixels de large, comparée à celle de la dernière détection, puis la différence
+ * est moyennée par blocs de 8x8 (somme des différences absolues) : la scène a changé si assez de blocs dépassent le seuil.
+ * Une détection est de toute façon relancée au bout de "rafraichissementMax" ms.
+ */
+#ifndef DETECTEURMOUVEMENT_H
+#define DETECTEURMOUVEMENT_H
+
+#include <opencv2/core/core.hpp>
+#include <stdint.h>
+
+class DetecteurMouvement
+{
+public:
+    /*
+     * seuilBloc : différence moyenne (niveaux de gris) au delà de laquelle un bloc a changé,
+     * blocsMin : nombre de blocs changés pour relancer la détection,
+     * rafraichissementMax : durée maximum sans détection (ms).
+     */
+    DetecteurMouvement(int seuilBloc, int blocsMin, int rafraichissementMax);
+
+    /*
+     * Retourne true si la détection doit être faite sur cette image (horodatage en µs).
+     * L'image devient alors la nouvelle référence.
+     */
+    bool detectionNecessaire(const cv::Mat &image, uint64_t horodatage);
+
+    /*
+     * La prochaine image sera analysée quoi qu'il arrive (par exemple après un mouvement des servos).
+     */
+    void forcer() { force = true; }
+
+    int imagesIgnorees() const { return nbIgnorees; }
+    int imagesAnalysees() const { return nbAnalysees; }
+
+private:
+    int seuilBloc;
+    int blocsMin;
+    uint64_t rafraichissementMax;
+
+    cv::Mat reduite;
+    cv::Mat reference;
+    cv::Mat difference;
+    cv::Mat blocs;
+
+    uint64_t derniereDetection = 0;
+    bool force = true;
+    int nbIgnorees = 0;
+    int nbAnalysees = 0;
+};
+
+#endif // DETECTEURMOUVEMENT_H
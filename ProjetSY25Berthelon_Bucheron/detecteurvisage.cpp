@@ -0,0 +1,210 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Détection du visage et de l'expression par les cascades (traitement de detectFace(), sans l'interface ni le matériel).
+ */
+#include "detecteurvisage.h"
+#include "noyauxpretraitement.h"
+
+#include "opencv2/imgproc/imgproc.hpp"
+#include "opencv2/objdetect/objdetect_c.h"
+#include <sstream>
+
+DetecteurVisage::DetecteurVisage() :
+    internes(false),
+    echelleDetection(1.0)
+{
+}
+
+bool DetecteurVisage::charger(const cv::String &visage, const cv::String &sourire, const cv::String &oeilGauche, const cv::String &oeilDroit)
+{
+    chemins[0] = visage;
+    chemins[1] = sourire;
+    chemins[2] = oeilGauche;
+    chemins[3] = oeilDroit;
+    internes = false;
+
+    // chargement des bases de données à l'aide de leur path respectifs.
+    bool visageCharge = face_cascade.load(visage);
+    smile_cascade.load(sourire);
+    left_eye_cascade.load(oeilGauche);
+    right_eye_cascade.load(oeilDroit);
+    return visageCharge;
+}
+
+bool DetecteurVisage::activerCascadesInternes()
+{
+    // Cascades internes : mêmes fichiers, évaluées sur des niveaux partagés.
+    internes = visageHaar.charger(chemins[0]) && sourireHaar.charger(chemins[1])
+            && oeilGaucheHaar.charger(chemins[2]) && oeilDroitHaar.charger(chemins[3]);
+    return internes;
+}
+
+std::string DetecteurVisage::rapportCascades() const
+{
+    if (!internes)
+        return "cascades detectMultiScale";
+    std::ostringstream rapport;
+    rapport << "cascades internes vectorisées : visage " << visageHaar.estVectorisee() << ", sourire " << sourireHaar.estVectorisee()
+            << ", yeux " << (oeilGaucheHaar.estVectorisee() && oeilDroitHaar.estVectorisee());
+    return rapport.str();
+}
+
+void DetecteurVisage::detecterVisages(const cv::Mat &image, std::vector<cv::Rect> &visages)
+{
+    detecterVisages(image, cv::Rect(0, 0, image.cols, image.rows), visages);
+}
+
+void DetecteurVisage::detecterVisages(const cv::Mat &entiere, const cv::Rect &zone, std::vector<cv::Rect> &visages)
+{
+    visages.clear();
+    double echelle = reglages.echelle;
+    echelleDetection = echelle;
+    cv::Rect rectZone = zone & cv::Rect(0, 0, entiere.cols, entiere.rows);
+    origineDetection = rectZone.tl();
+    if (rectZone.area() == 0)
+        return;
+    cv::Mat image = entiere(rectZone); // vue sur la zone, sans copie.
+
+    // Image de détection réduite et égalisée. Pour les échelles 1 et 1/2, un seul noyau lit l'image de la caméra une fois
+    // (réduction et histogramme dans la même passe), l'égalisation ne touche ensuite que la petite image.
+    if (echelle == 1.0 || echelle == 0.5){
+        int facteur = echelle == 1.0 ? 1 : 2;
+        uint32_t histogramme[256];
+        detection.create(image.rows/facteur, image.cols/facteur, CV_8UC1);
+        if (pretraitementVectorise){
+            pretraiterImage(image.data, image.cols, image.rows, image.step, facteur, false, detection.data, detection.step, histogramme);
+        } else {
+            pretraiterImageReference(image.data, image.cols, image.rows, image.step, facteur, false, detection.data, detection.step, histogramme);
+        }
+    } else {
+        cv::resize(image, detection, cv::Size(), echelle, echelle, cv::INTER_AREA);
+        cv::equalizeHist(detection, detection);
+    }
+
+    int tailleMin = (int)(reglages.tailleMinVisage*echelle);
+    cv::Size tailleMax; // vide : sans limite.
+    if (reglages.tailleMaxVisage > 0){
+        int t = (int)(reglages.tailleMaxVisage*echelle);
+        tailleMax = cv::Size(t, t);
+    }
+    if (internes){ // les niveaux calculés ici resservent au sourire et aux yeux s'ils tombent à la même échelle.
+        cv::Rect rect(0, 0, detection.cols, detection.rows);
+        contexte.nouvelleImage(detection);
+        visageHaar.detecter(contexte, rect, rect, visages, reglages.facteurEchelle, reglages.voisinsVisage, cv::Size(tailleMin,tailleMin), tailleMax);
+    } else {
+        face_cascade.detectMultiScale(detection,visages,reglages.facteurEchelle,reglages.voisinsVisage,0 | CV_HAAR_SCALE_IMAGE,cv::Size(tailleMin,tailleMin),tailleMax); // detection de visages sur l'image (de taille minimum 90 px * 90 px)
+    }
+    if (echelle < 1.0){ // les rectangles sont ramenés à la taille de l'image.
+        for(size_t i=0;i<visages.size();i++){
+            visages[i] = cv::Rect((int)(visages[i].x/echelle), (int)(visages[i].y/echelle), (int)(visages[i].width/echelle), (int)(visages[i].height/echelle))
+                    & cv::Rect(0, 0, image.cols, image.rows);
+        }
+    }
+    for(size_t i=0;i<visages.size();i++){ // puis dans l'image entière.
+        visages[i] += origineDetection;
+    }
+}
+
+int DetecteurVisage::plusGrand(const std::vector<cv::Rect> &visages)
+{
+    int indicePlusGrand = -1;
+    int plusGrandRectangle = 0;
+    for(size_t i=0;i<visages.size();i++) // Boucle qui vient chercher le plus grand des visages détectés.
+    {
+        if (indicePlusGrand < 0 || visages[i].area()>plusGrandRectangle){ // Si le rectangle ainsi calculé est le plus grand.
+            plusGrandRectangle = visages[i].area();
+            indicePlusGrand = (int)i;
+        }
+    }
+    return indicePlusGrand;
+}
+
+void DetecteurVisage::detecterExpression(const cv::Mat &image, const cv::Rect &visage, EtatExpression &etat)
+{
+    // Cascades internes : le sourire et les yeux réutilisent la pyramide du visage.
+    if (internes){
+        // le visage est ramené dans l'image de détection, celle du contexte.
+        cv::Rect rect = cv::Rect(cvRound((visage.x - origineDetection.x)*echelleDetection), cvRound((visage.y - origineDetection.y)*echelleDetection),
+                                 cvRound(visage.width*echelleDetection), cvRound(visage.height*echelleDetection))
+                & cv::Rect(0, 0, detection.cols, detection.rows);
+        detecterExpressionCascades(rect, etat);
+        return;
+    }
+
+    cv::Mat zone = image(visage); // On créé une image de taille du visage détecté (pour que les détections de sourire et d'yeux soient plus rapides)
+
+    cv::Rect rectGauche(0, 0, (visage.width/2)-1, visage.height-1); // Rectangle pour l'oeil gauche (visage coupé en 2 dans la hauteur)
+    cv::Rect rectDroite((visage.width)/2, 0 ,(visage.width/2)-1,visage.height-1); // Rectangle pour l'oeil droit (visage coupé en 2 dans la hauteur)
+
+    cv::Mat zoneGauche = zone(rectGauche); // On créé une image contenant la moité gauche du visage
+    cv::Mat zoneDroite = zone(rectDroite); // idem pour le coté droit.
+
+    etat = EtatExpression(); // pas de scores continus avec les cascades.
+    etat.smile = detectSmile(zone); // détection d'un éventuel sourire.
+    etat.leftEye = detectLeftEye(zoneGauche); // détection oeil gauche.
+    etat.rightEye = detectRightEye(zoneDroite); // détection oeil droit.
+    etat.scoreSourire = etat.smile;
+    etat.scoreOeilGauche = etat.leftEye;
+    etat.scoreOeilDroit = etat.rightEye;
+}
+
+/*
+ * Fonction de détection de sourire sur le visage détecté
+ * prend en entrée la zone image correspondant au visage détecté à analyser
+ * et retourne un boolean ( true si sourire détecté, false sinon)
+ */
+bool DetecteurVisage::detectSmile(const cv::Mat &zone){
+    std::vector<cv::Rect> smiles; // contiendra tous les sourires détectés
+
+    smile_cascade.detectMultiScale(zone, smiles, reglages.facteurSourire, reglages.voisinsSourire); // fonction qui détecte les sourires dans la zone qu'on lui a donné.
+
+    return smiles.size() > 0; // true si des sourires ont été détectés.
+}
+/*
+ * Fonction de détection de l'oeil gauche sur le visage détecté
+ * prend en entrée la zone image correspondant à la moitié gauche du visage à analyser
+ * et retourne un boolean ( true si oeil détecté, false sinon)
+ */
+bool DetecteurVisage::detectLeftEye(const cv::Mat &zone){
+    std::vector<cv::Rect> leftEye; // contiendra tous les yeux détectés
+
+    left_eye_cascade.detectMultiScale(zone, leftEye, reglages.facteurYeux, reglages.voisinsYeux, 0);// fonction qui détecte les yeux dans la zone qu'on lui a donné.
+
+    return leftEye.size() > 0;
+}
+/*
+ * Fonction de détection de l'oeil droit sur le visage détecté
+ * prend en entrée la zone image correspondant à la moitié droite du visage à analyser
+ * et retourne un boolean ( true si oeil détecté, false sinon)
+ */
+bool DetecteurVisage::detectRightEye(const cv::Mat &zone){
+    std::vector<cv::Rect> rightEye; // contiendra tous les yeux détectés
+
+    right_eye_cascade.detectMultiScale(zone, rightEye, reglages.facteurYeux, reglages.voisinsYeux, 0); // fonction qui détecte les yeux dans la zone qu'on lui a donné.
+
+    return rightEye.size() > 0;
+}
+
+/*
+ * Sourire et yeux par les cascades internes : une seule pyramide du visage pour les trois cascades,
+ * les yeux cherchent chacun dans une moitié des mêmes niveaux.
+ */
+void DetecteurVisage::detecterExpressionCascades(const cv::Rect &visage, EtatExpression &etat){
+
+    std::vector<cv::Rect> objets;
+    cv::Rect moitieGauche(visage.x, visage.y, (visage.width/2)-1, visage.height-1); // mêmes moitiés que pour detectLeftEye() / detectRightEye()
+    cv::Rect moitieDroite(visage.x + visage.width/2, visage.y, (visage.width/2)-1, visage.height-1);
+
+    etat = EtatExpression(); // pas de scores continus avec les cascades.
+    sourireHaar.detecter(contexte, visage, visage, objets, reglages.facteurSourire, reglages.voisinsSourire);
+    etat.smile = !objets.empty();
+    oeilGaucheHaar.detecter(contexte, visage, moitieGauche, objets, reglages.facteurYeux, reglages.voisinsYeux);
+    etat.leftEye = !objets.empty();
+    oeilDroitHaar.detecter(contexte, visage, moitieDroite, objets, reglages.facteurYeux, reglages.voisinsYeux);
+    etat.rightEye = !objets.empty();
+    etat.scoreSourire = etat.smile;
+    etat.scoreOeilGauche = etat.leftEye;
+    etat.scoreOeilDroit = etat.rightEye;
+}
@@ -0,0 +1,137 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Détection du visage et de l'expression par les cascades, sans l'interface ni le matériel :
+ * préparation de l'image de détection, cascade de visage, puis sourire et yeux sur le visage retenu.
+ * C'est le traitement de detectFace() ; l'application et l'outil TraitementLot s'en servent tous les deux,
+ * si bien qu'une vidéo rejouée hors ligne donne les mêmes détections qu'en direct.
+ *
+ * Un DetecteurVisage garde ses cascades et son contexte de détection d'une image à l'autre :
+ * il ne doit être utilisé que par un thread à la fois (un détecteur par thread pour un traitement parallèle).
+ */
+#ifndef DETECTEURVISAGE_H
+#define DETECTEURVISAGE_H
+
+#include "cascadehaar.h"
+#include "contextedetection.h"
+#include "estimateurexpression.h"
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/objdetect/objdetect.hpp>
+#include <string>
+#include <vector>
+
+/*
+ * Réglages de la détection. Les valeurs par défaut sont celles de l'application au niveau de qualité 0.
+ */
+struct ReglagesDetection {
+    // image de détection / image d'origine, et facteur entre deux tailles de fenêtre de la cascade de visage.
+    double echelle = 1.0;
+    double facteurEchelle = 1.1;
+    int voisinsVisage = 2;
+    // taille minimum et maximum (0 : sans limite) d'un visage, en pixels de l'image d'origine.
+    int tailleMinVisage = 90;
+    int tailleMaxVisage = 0;
+    double facteurSourire = 1.8;
+    int voisinsSourire = 20;
+    double facteurYeux = 1.1;
+    int voisinsYeux = 1;
+    // l'expression n'est analysée qu'une image sur periodeExpression, appliqué par l'appelant (detectFace(), ReglageDetection).
+    int periodeExpression = 1;
+};
+
+class DetecteurVisage
+{
+public:
+    DetecteurVisage();
+
+    /*
+     * Charge les cascades (detectMultiScale). Retourne false si la cascade de visage n'a pas pu être lue.
+     */
+    bool charger(const cv::String &visage, const cv::String &sourire, const cv::String &oeilGauche, const cv::String &oeilDroit);
+
+    /*
+     * Passe sur les cascades internes (mêmes fichiers, voir cascadehaar.h).
+     * Retourne false si l'une d'elles n'est pas lisible par l'évaluateur interne : detectMultiScale reste utilisé.
+     */
+    bool activerCascadesInternes();
+    bool cascadesInternes() const { return internes; }
+
+    /*
+     * Prépare l'image de détection (réduite selon reglages.echelle et égalisée) et y cherche les visages.
+     * "image" est en niveaux de gris ; les rectangles sont rendus en coordonnées de "image".
+     */
+    void detecterVisages(const cv::Mat &image, std::vector<cv::Rect> &visages);
+
+    /*
+     * Même détection limitée à "zone" (rectangle de "image", voir SuiviVisage) : seule la zone est préparée et parcourue.
+     * Les rectangles sont rendus en coordonnées de "image", et detecterExpression() s'utilise comme après l'appel sur l'image entière.
+     */
+    void detecterVisages(const cv::Mat &image, const cv::Rect &zone, std::vector<cv::Rect> &visages);
+
+    /*
+     * Indice du plus grand visage (en surface), -1 s'il n'y en a aucun.
+     */
+    static int plusGrand(const std::vector<cv::Rect> &visages);
+
+    /*
+     * Sourire et yeux cherchés par les cascades sur "visage" (coordonnées de "image"),
+     * après detecterVisages() sur la même image. Pas de scores continus : ils valent 0 ou 1.
+     */
+    void detecterExpression(const cv::Mat &image, const cv::Rect &visage, EtatExpression &etat);
+
+    // Image donnée à la cascade de visage lors du dernier appel à detecterVisages() (la zone seulement).
+    const cv::Mat &imageDetection() const { return detection; }
+
+    /*
+     * Cascades internes : vectorisation de chaque cascade, et temps par image depuis le dernier appel (voir ContexteDetection).
+     */
+    std::string rapportCascades() const;
+    std::string rapportTemps() { return contexte.rapportTemps(); }
+
+    ReglagesDetection reglages;
+    // Le noyau vectorisé de préparation de l'image a-t-il passé sa vérification ? (voir noyauxpretraitement.h)
+    bool pretraitementVectorise = true;
+
+private:
+    DetecteurVisage(const DetecteurVisage &);
+    DetecteurVisage &operator=(const DetecteurVisage &);
+
+    /*
+     * Fonctions de détection sur la zone du visage (detectMultiScale) : true si au moins un objet est trouvé.
+     */
+    bool detectSmile(const cv::Mat &zone);
+    bool detectLeftEye(const cv::Mat &zone);
+    bool detectRightEye(const cv::Mat &zone);
+
+    /*
+     * Sourire et yeux par les cascades internes : une seule pyramide du visage (en coordonnées de l'image de détection)
+     * pour les trois cascades.
+     */
+    void detecterExpressionCascades(const cv::Rect &visage, EtatExpression &etat);
+
+    cv::String chemins[4];
+
+    // Les bases de données de reconnaissance de visage, de sourire, d'oeil gauche et d'oeil droit.
+    cv::CascadeClassifier face_cascade;
+    cv::CascadeClassifier smile_cascade;
+    cv::CascadeClassifier left_eye_cascade;
+    cv::CascadeClassifier right_eye_cascade;
+
+    // Les mêmes cascades évaluées dans l'application, et le contexte qui partage les niveaux de pyramide
+    // et les images intégrales de l'image de détection entre elles.
+    bool internes;
+    CascadeHaar visageHaar;
+    CascadeHaar sourireHaar;
+    CascadeHaar oeilGaucheHaar;
+    CascadeHaar oeilDroitHaar;
+    ContexteDetection contexte;
+
+    cv::Mat detection;
+    // échelle de l'image de détection et position de la zone dans l'image lors du dernier appel à detecterVisages().
+    double echelleDetection;
+    cv::Point origineDetection;
+};
+
+#endif // DETECTEURVISAGE_H
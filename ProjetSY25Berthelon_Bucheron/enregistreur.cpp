@@ -0,0 +1,148 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Enregistrement en tâche de fond des images annotées, avec les dernières secondes avant l'évènement.
+ */
+#include "enregistreur.h"
+
+#include <opencv2/videoio/videoio.hpp>
+
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QMutexLocker>
+
+Enregistreur::Enregistreur(const QString &dossier, const QString &codec, double imagesParSeconde,
+                           int secondesAvant, int secondesApres, int fileAttenteMax) :
+    dossier(dossier),
+    imagesParSeconde(imagesParSeconde),
+    dureeAvant(secondesAvant * 1000),
+    dureeApres(secondesApres * 1000),
+    fileAttenteMax(fileAttenteMax)
+{
+    QByteArray c = codec.toLatin1().leftJustified(4, ' ');
+    fourcc = cv::VideoWriter::fourcc(c[0], c[1], c[2], c[3]);
+}
+
+Enregistreur::~Enregistreur()
+{
+    arreter();
+}
+
+/*
+ * Confie une image annotée à l'enregistreur. Ne bloque jamais la détection.
+ */
+void Enregistreur::ajouterImage(const cv::Mat &image)
+{
+    {
+        QMutexLocker l(&verrou);
+        if ((int)fileAttente.size() >= fileAttenteMax){ // l'encodage a pris du retard : on perd cette image.
+            nbImagesPerdues++;
+            return;
+        }
+    }
+
+    // La copie se fait hors du verrou : seul le thread de l'interface ajoute des images, la place reste donc libre.
+    ImageHorodatee nouvelle;
+    nouvelle.image = image.clone();
+    nouvelle.horodatage = QDateTime::currentMSecsSinceEpoch();
+
+    QMutexLocker l(&verrou);
+    fileAttente.push_back(nouvelle);
+    imageDisponible.wakeOne();
+}
+
+/*
+ * Signale un évènement : le prochain passage du thread ouvre un fichier (ou prolonge celui en cours).
+ */
+void Enregistreur::signalerEvenement(const QString &nom)
+{
+    QMutexLocker l(&verrou);
+    evenementEnAttente = nom;
+    imageDisponible.wakeOne();
+}
+
+/*
+ * Termine l'enregistrement en cours et arrête le thread.
+ */
+void Enregistreur::arreter()
+{
+    {
+        QMutexLocker l(&verrou);
+        arret = true;
+        imageDisponible.wakeOne();
+    }
+    wait();
+}
+
+void Enregistreur::ouvrirFichier(const QString &nom, const cv::Size &taille, bool couleur)
+{
+    QDir().mkpath(dossier);
+    QString chemin = dossier + "/" + QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss") + "_" + nom + ".avi";
+
+    if (!fichier.open(chemin.toStdString(), fourcc, imagesParSeconde, taille, couleur)){
+        qWarning() << "impossible d'ouvrir le fichier d'enregistrement" << chemin;
+        return;
+    }
+    qDebug() << "enregistrement de" << chemin;
+}
+
+void Enregistreur::run()
+{
+    QString evenementAOuvrir; // évènement arrivé alors qu'aucun fichier n'est ouvert.
+
+    forever {
+        ImageHorodatee image;
+        QString evenement;
+
+        {
+            QMutexLocker l(&verrou);
+            while (fileAttente.empty() && evenementEnAttente.isEmpty() && !arret)
+                imageDisponible.wait(&verrou);
+            if (arret && fileAttente.empty())
+                break;
+
+            evenement = evenementEnAttente;
+            evenementEnAttente.clear();
+            if (!fileAttente.empty()){
+                image = fileAttente.front();
+                fileAttente.pop_front();
+            }
+        }
+
+        if (!evenement.isEmpty()){
+            // L'enregistrement dure jusqu'à dureeApres après le dernier évènement.
+            finEnregistrement = QDateTime::currentMSecsSinceEpoch() + dureeApres;
+            if (!fichier.isOpened())
+                evenementAOuvrir = evenement;
+        }
+
+        if (image.image.empty())
+            continue;
+
+        if (!evenementAOuvrir.isEmpty()){
+            // Nouveau fichier : on commence par les images gardées avant l'évènement.
+            ouvrirFichier(evenementAOuvrir, image.image.size(), image.image.channels() > 1);
+            evenementAOuvrir.clear();
+            if (fichier.isOpened()){
+                for (size_t i = 0; i < tamponCirculaire.size(); i++)
+                    fichier.write(tamponCirculaire[i].image);
+            }
+        }
+
+        if (fichier.isOpened()){
+            fichier.write(image.image);
+            if (image.horodatage > finEnregistrement)
+                fichier.release();
+        }
+
+        // Le tampon circulaire ne garde que les dureeAvant dernières millisecondes.
+        tamponCirculaire.push_back(image);
+        while (image.horodatage - tamponCirculaire.front().horodatage > dureeAvant)
+            tamponCirculaire.pop_front();
+    }
+
+    if (fichier.isOpened())
+        fichier.release();
+}
@@ -0,0 +1,88 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Enregistrement en tâche de fond des images annotées (rectangle et centre du visage).
+ * Les dernières secondes sont gardées en mémoire dans un tampon circulaire : lorsqu'un évènement survient
+ * (apparition d'un visage, sourire...), le fichier vidéo commence donc avant l'évènement.
+ * L'encodage se fait dans un thread séparé ; si celui-ci prend du retard, ce sont les images de l'enregistreur
+ * qui sont perdues, jamais la détection qui attend.
+ */
+#ifndef ENREGISTREUR_H
+#define ENREGISTREUR_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QString>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <deque>
+
+class Enregistreur : public QThread
+{
+    Q_OBJECT
+
+public:
+    /*
+     * dossier : répertoire des fichiers vidéo, codec : fourcc ("MJPG", "H264"...),
+     * imagesParSeconde : cadence des images reçues, secondesAvant / secondesApres : durée avant / après l'évènement,
+     * fileAttenteMax : nombre d'images en attente d'encodage au delà duquel les nouvelles images sont perdues.
+     */
+    Enregistreur(const QString &dossier, const QString &codec, double imagesParSeconde,
+                 int secondesAvant, int secondesApres, int fileAttenteMax);
+    ~Enregistreur();
+
+    /*
+     * Confie une image annotée à l'enregistreur (elle est copiée). Ne bloque jamais :
+     * si la file d'attente est pleine, l'image est perdue pour l'enregistrement.
+     */
+    void ajouterImage(const cv::Mat &image);
+
+    /*
+     * Signale un évènement : le tampon circulaire est écrit dans un nouveau fichier (ou l'enregistrement en cours est prolongé).
+     */
+    void signalerEvenement(const QString &nom);
+
+    /*
+     * Termine l'enregistrement en cours et arrête le thread.
+     */
+    void arreter();
+
+    // Nombre d'images perdues par l'enregistreur depuis le lancement.
+    int imagesPerdues() const { return nbImagesPerdues; }
+
+protected:
+    void run();
+
+private:
+    struct ImageHorodatee {
+        cv::Mat image;
+        qint64 horodatage; // ms
+    };
+
+    void ouvrirFichier(const QString &nom, const cv::Size &taille, bool couleur);
+
+    QString dossier;
+    int fourcc;
+    double imagesParSeconde;
+    qint64 dureeAvant;  // ms
+    qint64 dureeApres;  // ms
+    int fileAttenteMax;
+
+    // Partagé entre le thread de l'interface et celui de l'enregistreur.
+    QMutex verrou;
+    QWaitCondition imageDisponible;
+    std::deque<ImageHorodatee> fileAttente;
+    QString evenementEnAttente;
+    bool arret = false;
+    volatile int nbImagesPerdues = 0;
+
+    // Propre au thread de l'enregistreur.
+    std::deque<ImageHorodatee> tamponCirculaire;
+    cv::VideoWriter fichier;
+    qint64 finEnregistrement = 0;
+};
+
+#endif // ENREGISTREUR_H
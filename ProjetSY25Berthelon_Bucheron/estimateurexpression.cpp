@@ -0,0 +1,108 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Estimation de l'expression du visage (yeux ouverts/fermés, sourire) à partir de points caractéristiques.
+ * Un seul passage du modèle de points (LBF, 68 points) sur le visage détecté remplace les trois
+ * détections Haar (sourire, oeil gauche, oeil droit) et fournit en plus des scores continus.
+ */
+#include "estimateurexpression.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Indices des points dans le modèle 68 points (annotation iBUG 300-W).
+// L'oeil "gauche" est celui de la moitié gauche de l'image, comme dans detectFace().
+static const int PREMIER_POINT_OEIL_GAUCHE = 36;
+static const int PREMIER_POINT_OEIL_DROIT = 42;
+static const int COIN_BOUCHE_GAUCHE = 48;
+static const int COIN_BOUCHE_DROIT = 54;
+
+// Rapport d'ouverture d'un oeil complètement ouvert / fermé, sert à normaliser le score entre 0 et 1.
+static const float EAR_FERME = 0.12f;
+static const float EAR_OUVERT = 0.32f;
+// Largeur de la bouche rapportée à l'écart entre les yeux : visage neutre / grand sourire.
+static const float LARGEUR_BOUCHE_NEUTRE = 0.52f;
+static const float LARGEUR_BOUCHE_SOURIRE = 0.68f;
+// Au delà de cette ouverture de bouche, on considère que c'est une bouche ouverte (surprise) et pas un sourire.
+static const float MAR_BOUCHE_OUVERTE = 0.6f;
+
+static float distance(const cv::Point2f &a, const cv::Point2f &b)
+{
+    return std::sqrt((a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y));
+}
+
+static float normaliser(float valeur, float bas, float haut)
+{
+    return std::min(1.f, std::max(0.f, (valeur - bas) / (haut - bas)));
+}
+
+EstimateurExpression::EstimateurExpression()
+{
+    facemark = cv::face::FacemarkLBF::create();
+}
+
+/*
+ * Charge le modèle de points caractéristiques (fichier lbfmodel.yaml).
+ */
+bool EstimateurExpression::charger(const cv::String &chemin)
+{
+    try {
+        facemark->loadModel(chemin);
+        charge = true;
+    } catch (const cv::Exception &) { // fichier absent ou illisible : on restera sur les cascades.
+        charge = false;
+    }
+    return charge;
+}
+
+float EstimateurExpression::rapportOeil(const std::vector<cv::Point2f> &points, int premier)
+{
+    const cv::Point2f *p = &points[premier]; // p[0] à p[5] correspondent à p1 à p6
+    float largeur = distance(p[0], p[3]);
+    if (largeur <= 0.f)
+        return 0.f;
+    return (distance(p[1], p[5]) + distance(p[2], p[4])) / (2.f * largeur);
+}
+
+float EstimateurExpression::rapportBouche(const std::vector<cv::Point2f> &points)
+{
+    float largeur = distance(points[60], points[64]);
+    if (largeur <= 0.f)
+        return 0.f;
+    return (distance(points[61], points[67]) + distance(points[62], points[66]) + distance(points[63], points[65])) / (2.f * largeur);
+}
+
+/*
+ * Calcule l'expression sur le visage "visage" de l'image "image".
+ */
+bool EstimateurExpression::estimer(const cv::Mat &image, const cv::Rect &visage, EtatExpression &etat)
+{
+    if (!charge)
+        return false;
+
+    std::vector<cv::Rect> visages(1, visage);
+    std::vector<std::vector<cv::Point2f> > points;
+
+    if (!facemark->fit(image, visages, points) || points.empty() || points[0].size() < 68)
+        return false;
+
+    const std::vector<cv::Point2f> &p = points[0];
+
+    // Yeux : le rapport d'ouverture ne dépend pas de la taille du visage.
+    float earGauche = rapportOeil(p, PREMIER_POINT_OEIL_GAUCHE);
+    float earDroit = rapportOeil(p, PREMIER_POINT_OEIL_DROIT);
+    etat.scoreOeilGauche = normaliser(earGauche, EAR_FERME, EAR_OUVERT);
+    etat.scoreOeilDroit = normaliser(earDroit, EAR_FERME, EAR_OUVERT);
+    etat.leftEye = earGauche > seuilOeilOuvert;
+    etat.rightEye = earDroit > seuilOeilOuvert;
+
+    // Sourire : la bouche s'élargit par rapport à l'écart entre les coins extérieurs des yeux.
+    float ecartYeux = distance(p[PREMIER_POINT_OEIL_GAUCHE], p[PREMIER_POINT_OEIL_DROIT + 3]);
+    float largeurBouche = ecartYeux > 0.f ? distance(p[COIN_BOUCHE_GAUCHE], p[COIN_BOUCHE_DROIT]) / ecartYeux : 0.f;
+    float mar = rapportBouche(p);
+    etat.scoreSourire = mar > MAR_BOUCHE_OUVERTE ? 0.f : normaliser(largeurBouche, LARGEUR_BOUCHE_NEUTRE, LARGEUR_BOUCHE_SOURIRE);
+    etat.smile = etat.scoreSourire > seuilSourire;
+
+    return true;
+}
@@ -0,0 +1,65 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Estimation de l'expression du visage (yeux ouverts/fermés, sourire) à partir de points caractéristiques.
+ * Un seul passage du modèle de points (LBF, 68 points) sur le visage détecté remplace les trois
+ * détections Haar (sourire, oeil gauche, oeil droit) et fournit en plus des scores continus.
+ */
+#ifndef ESTIMATEUREXPRESSION_H
+#define ESTIMATEUREXPRESSION_H
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/face.hpp>
+#include <vector>
+
+/*
+ * Etat de l'expression calculé sur un visage.
+ * Les booléens sont ceux attendus par displaySmiley(), les scores vont de 0 (fermé / neutre) à 1 (ouvert / grand sourire).
+ */
+struct EtatExpression {
+    bool smile = false;
+    bool leftEye = false;
+    bool rightEye = false;
+
+    float scoreSourire = 0.f;
+    float scoreOeilGauche = 0.f;
+    float scoreOeilDroit = 0.f;
+};
+
+class EstimateurExpression
+{
+public:
+    EstimateurExpression();
+
+    /*
+     * Charge le modèle de points caractéristiques (fichier lbfmodel.yaml).
+     * Retourne false si le modèle n'a pas pu être chargé : il faut alors garder les cascades.
+     */
+    bool charger(const cv::String &chemin);
+
+    bool estCharge() const { return charge; }
+
+    /*
+     * Calcule l'expression sur le visage "visage" de l'image "image" (image entière, pas la zone du visage).
+     * Retourne false si le modèle n'a pas réussi à placer les points.
+     */
+    bool estimer(const cv::Mat &image, const cv::Rect &visage, EtatExpression &etat);
+
+    // Seuils de décision, à ajuster selon la caméra et l'éclairage.
+    // Rapport d'ouverture de l'oeil (EAR) en dessous duquel l'oeil est considéré fermé.
+    float seuilOeilOuvert = 0.20f;
+    // Score de sourire au dessus duquel on considère que la personne sourit.
+    float seuilSourire = 0.5f;
+
+private:
+    // Rapport d'ouverture de l'oeil : (|p2-p6| + |p3-p5|) / (2 |p1-p4|), à partir du premier point de l'oeil.
+    static float rapportOeil(const std::vector<cv::Point2f> &points, int premier);
+    // Rapport d'ouverture de la bouche (lèvres intérieures) : (|61-67| + |62-66| + |63-65|) / (2 |60-64|).
+    static float rapportBouche(const std::vector<cv::Point2f> &points);
+
+    cv::Ptr<cv::face::Facemark> facemark;
+    bool charge = false;
+};
+
+#endif // ESTIMATEUREXPRESSION_H
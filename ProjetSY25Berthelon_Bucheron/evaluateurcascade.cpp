@@ -0,0 +1,226 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Evaluation des cascades de Haar sur des images intégrales partagées.
+ */
+#include "evaluateurcascade.h"
+
+#include <cmath>
+#include <cstring>
+
+void calculerIntegrales(const uint8_t *image, int largeur, int hauteur, size_t pasImage, bool avecInclinee, ImageIntegrale &sortie)
+{
+    sortie.largeur = largeur;
+    sortie.hauteur = hauteur;
+    sortie.pas = largeur + 1;
+    size_t taille = (size_t)sortie.pas * (hauteur + 1);
+    sortie.somme.resize(taille + MARGE_INTEGRALE);  // les tableaux gardent leur capacité d'une image à l'autre
+    sortie.carres.resize(taille + MARGE_INTEGRALE);
+    std::memset(sortie.somme.data(), 0, sortie.pas * sizeof(int32_t));
+    std::memset(sortie.carres.data(), 0, sortie.pas * sizeof(uint32_t));
+    std::memset(sortie.somme.data() + taille, 0, MARGE_INTEGRALE * sizeof(int32_t));
+    std::memset(sortie.carres.data() + taille, 0, MARGE_INTEGRALE * sizeof(uint32_t));
+
+    for (int y = 0; y < hauteur; y++){
+        const uint8_t *ligne = image + y * pasImage;
+        const int32_t *sommeHaut = sortie.somme.data() + (size_t)y * sortie.pas;
+        const uint32_t *carresHaut = sortie.carres.data() + (size_t)y * sortie.pas;
+        int32_t *somme = sortie.somme.data() + (size_t)(y + 1) * sortie.pas;
+        uint32_t *carres = sortie.carres.data() + (size_t)(y + 1) * sortie.pas;
+
+        int32_t s = 0;
+        uint32_t q = 0;
+        somme[0] = 0;
+        carres[0] = 0;
+        for (int x = 0; x < largeur; x++){
+            int v = ligne[x];
+            s += v;
+            q += v * v;
+            somme[x + 1] = sommeHaut[x + 1] + s;
+            carres[x + 1] = carresHaut[x + 1] + q;
+        }
+    }
+
+    if (avecInclinee){
+        calculerIntegraleInclinee(image, largeur, hauteur, pasImage, sortie);
+    } else {
+        sortie.inclinee.clear();
+    }
+}
+
+/*
+ * Somme inclinée (même définition que cv::integral) : T(Y, X) est la somme des pixels des lignes y < Y
+ * qui sont à moins de Y-1-y colonnes de X-1 (un triangle pointe en bas).
+ * Récurrence : T(Y,X) = T(Y-1,X-1) + T(Y-1,X+1) - T(Y-2,X) + I(Y-1,X-1) + I(Y-2,X-1).
+ * Les triangles débordent de l'image de Y colonnes de chaque côté : les lignes sont calculées sur une largeur
+ * étendue (hauteur+2 colonnes de marge), où les valeurs hors du tampon sont réellement nulles, puis recopiées.
+ * Seules trois lignes étendues sont gardées.
+ */
+void calculerIntegraleInclinee(const uint8_t *image, int largeur, int hauteur, size_t pasImage, ImageIntegrale &sortie)
+{
+    const int marge = hauteur + 2;
+    const int etendue = largeur + 1 + 2 * marge;
+    size_t taille = (size_t)sortie.pas * (hauteur + 1);
+    sortie.inclinee.resize(taille + MARGE_INTEGRALE);
+    std::memset(sortie.inclinee.data() + taille, 0, MARGE_INTEGRALE * sizeof(int32_t));
+
+    std::vector<int32_t> tampon(3 * (size_t)(etendue + 2), 0);
+    // une colonne nulle de chaque côté de chaque ligne pour X-1 et X+1.
+    int32_t *lignes[3] = { tampon.data() + 1, tampon.data() + 1 + (etendue + 2), tampon.data() + 1 + 2 * (etendue + 2) };
+
+    std::memset(sortie.inclinee.data(), 0, sortie.pas * sizeof(int32_t)); // T(0, X) = 0
+
+    for (int Y = 1; Y <= hauteur; Y++){
+        int32_t *courante = lignes[Y % 3];
+        const int32_t *precedente = lignes[(Y - 1) % 3];
+        const int32_t *avant = lignes[(Y + 1) % 3]; // ligne Y-2 (nulle pour Y = 1)
+        const uint8_t *pixels1 = image + (Y - 1) * pasImage;
+        const uint8_t *pixels2 = Y >= 2 ? image + (Y - 2) * pasImage : 0;
+
+        for (int e = 0; e < etendue; e++){
+            int X = e - marge;
+            int32_t t = precedente[e - 1] + precedente[e + 1] - (Y >= 2 ? avant[e] : 0);
+            if (X >= 1 && X <= largeur){
+                t += pixels1[X - 1];
+                if (pixels2){
+                    t += pixels2[X - 1];
+                }
+            }
+            courante[e] = t;
+        }
+        std::memcpy(sortie.inclinee.data() + (size_t)Y * sortie.pas, courante + marge, sortie.pas * sizeof(int32_t));
+    }
+}
+
+EvaluateurCascade::EvaluateurCascade(const ModeleCascade &modele) :
+    modele(modele),
+    aireNormalisation((double)(modele.largeur - 2) * (modele.hauteur - 2)),
+    souches(true)
+{
+    for (size_t i = 0; i < modele.arbres.size(); i++){
+        if (modele.arbres[i].nbNoeuds != 1){
+            souches = false;
+        }
+    }
+}
+
+/*
+ * Décalages des quatre coins de chaque rectangle dans une intégrale de pas donné (comme CV_SUM_OFS et CV_TILTED_OFS).
+ */
+void EvaluateurCascade::preparer(int pas)
+{
+    optimisees.resize(modele.caracteristiques.size());
+    for (size_t i = 0; i < modele.caracteristiques.size(); i++){
+        const CaracteristiqueHaar &c = modele.caracteristiques[i];
+        CaracteristiqueOpt &o = optimisees[i];
+        o.inclinee = c.inclinee;
+        for (int r = 0; r < 3; r++){
+            const RectanglePondere &R = c.rect[r];
+            o.poids[r] = r < c.nbRectangles ? R.poids : 0.f;
+            if (r >= c.nbRectangles){
+                o.coins[r][0] = o.coins[r][1] = o.coins[r][2] = o.coins[r][3] = 0;
+            } else if (c.inclinee){
+                o.coins[r][0] = R.x + pas * R.y;
+                o.coins[r][1] = R.x - R.hauteur + pas * (R.y + R.hauteur);
+                o.coins[r][2] = R.x + R.largeur + pas * (R.y + R.largeur);
+                o.coins[r][3] = R.x + R.largeur - R.hauteur + pas * (R.y + R.largeur + R.hauteur);
+            } else {
+                o.coins[r][0] = R.x + pas * R.y;
+                o.coins[r][1] = R.x + R.largeur + pas * R.y;
+                o.coins[r][2] = R.x + pas * (R.y + R.hauteur);
+                o.coins[r][3] = R.x + R.largeur + pas * (R.y + R.hauteur);
+            }
+        }
+    }
+
+    // rectangle de normalisation : la fenêtre sans son bord d'un pixel.
+    int l = modele.largeur - 2, h = modele.hauteur - 2;
+    coinsNormalisation[0] = 1 + pas;
+    coinsNormalisation[1] = 1 + l + pas;
+    coinsNormalisation[2] = 1 + pas * (1 + h);
+    coinsNormalisation[3] = 1 + l + pas * (1 + h);
+    pasPrepare = pas;
+}
+
+#define SOMME_COINS(p, c) ((p)[(c)[0]] - (p)[(c)[1]] - (p)[(c)[2]] + (p)[(c)[3]])
+
+inline float EvaluateurCascade::calculer(const CaracteristiqueOpt &c, const int32_t *somme, const int32_t *inclinee) const
+{
+    const int32_t *p = c.inclinee ? inclinee : somme;
+    float valeur = c.poids[0] * SOMME_COINS(p, c.coins[0]) + c.poids[1] * SOMME_COINS(p, c.coins[1]);
+    if (c.poids[2] != 0.f){
+        valeur += c.poids[2] * SOMME_COINS(p, c.coins[2]);
+    }
+    return valeur;
+}
+
+int EvaluateurCascade::evaluer(const ImageIntegrale &integrale, int x, int y)
+{
+    if (integrale.pas != pasPrepare){
+        preparer(integrale.pas);
+    }
+    nbFenetres++;
+
+    size_t decalage = (size_t)y * integrale.pas + x;
+    const int32_t *somme = integrale.somme.data() + decalage;
+    const uint32_t *carres = integrale.carres.data() + decalage;
+    const int32_t *inclinee = integrale.inclinee.empty() ? 0 : integrale.inclinee.data() + decalage;
+
+    // Normalisation par l'écart type (les fenêtres presque uniformes sont rejetées).
+    int valSomme = SOMME_COINS(somme, coinsNormalisation);
+    uint32_t valCarres = SOMME_COINS(carres, coinsNormalisation);
+    double n = aireNormalisation * valCarres - (double)valSomme * valSomme;
+    if (n <= 0.){
+        return -1;
+    }
+    float normalisation = (float)(1. / std::sqrt(n));
+    if (!(aireNormalisation * normalisation < 1e-1)){
+        return -1;
+    }
+
+    const CaracteristiqueOpt *caracteristiques = optimisees.data();
+    const NoeudHaar *noeuds = modele.noeuds.data();
+    const float *feuilles = modele.feuilles.data();
+
+    for (size_t e = 0; e < modele.etages.size(); e++){
+        const EtageHaar &etage = modele.etages[e];
+        double total = 0;
+        for (int a = etage.premierArbre; a < etage.premierArbre + etage.nbArbres; a++){
+            const ArbreHaar &arbre = modele.arbres[a];
+            const NoeudHaar *racine = noeuds + arbre.premierNoeud;
+            int indice = 0;
+            if (souches){
+                float valeur = calculer(caracteristiques[racine->caracteristique], somme, inclinee) * normalisation;
+                indice = valeur < racine->seuil ? racine->gauche : racine->droite;
+            } else {
+                do {
+                    const NoeudHaar &noeud = racine[indice];
+                    float valeur = calculer(caracteristiques[noeud.caracteristique], somme, inclinee) * normalisation;
+                    indice = valeur < noeud.seuil ? noeud.gauche : noeud.droite;
+                } while (indice > 0);
+            }
+            total += feuilles[arbre.premiereFeuille - indice];
+        }
+        if (total < etage.seuil){
+            return -(int)e;
+        }
+    }
+    return 1;
+}
+
+void EvaluateurCascade::parcourir(const ImageIntegrale &integrale, int x0, int y0, int x1, int y1, int pas, std::vector<int> &positions)
+{
+    for (int y = y0; y <= y1; y += pas){
+        for (int x = x0; x <= x1; x += pas){
+            int resultat = evaluer(integrale, x, y);
+            if (resultat > 0){
+                positions.push_back(x);
+                positions.push_back(y);
+            }
+            if (resultat == 0){ // rejet dès le premier étage : la fenêtre voisine a peu de chances de passer.
+                x += pas;
+            }
+        }
+    }
+}
@@ -0,0 +1,126 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Evaluation des cascades de Haar (format des fichiers haarcascade_*.xml d'OpenCV) sur des images intégrales
+ * calculées une seule fois par image et partagées entre les cascades (voir contextedetection.h).
+ *
+ * Le calcul reproduit celui de cv::CascadeClassifier : normalisation par l'écart type de la fenêtre,
+ * caractéristiques en float, arbres (souches ou 2 niveaux) et seuils d'étage diminués de 1e-5.
+ * Cette partie ne dépend pas d'OpenCV : le chargement du fichier et la pyramide sont faits par CascadeHaar.
+ */
+#ifndef EVALUATEURCASCADE_H
+#define EVALUATEURCASCADE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+struct RectanglePondere {
+    int x, y, largeur, hauteur;
+    float poids;
+};
+
+struct CaracteristiqueHaar {
+    RectanglePondere rect[3];
+    int nbRectangles;
+    bool inclinee; // caractéristique tournée de 45° (calculée sur l'intégrale inclinée)
+};
+
+/*
+ * Noeud d'un arbre : gauche / droite > 0 désignent un autre noeud de l'arbre, <= 0 la feuille numéro -valeur.
+ */
+struct NoeudHaar {
+    int gauche, droite;
+    int caracteristique;
+    float seuil;
+};
+
+struct ArbreHaar {
+    int premierNoeud, nbNoeuds;
+    int premiereFeuille;
+};
+
+struct EtageHaar {
+    int premierArbre, nbArbres;
+    float seuil;
+};
+
+struct ModeleCascade {
+    int largeur = 0, hauteur = 0; // taille de la fenêtre de détection
+    std::vector<EtageHaar> etages;
+    std::vector<ArbreHaar> arbres;
+    std::vector<NoeudHaar> noeuds;
+    std::vector<float> feuilles;
+    std::vector<CaracteristiqueHaar> caracteristiques;
+    bool avecInclinees = false;
+};
+
+/*
+ * Images intégrales d'une image 8 bits (largeur+1 x hauteur+1, pas commun aux trois tableaux) :
+ * somme, somme des carrés (sur 32 bits, seules les différences servent) et, si demandée, somme inclinée de 45°.
+ * Les tableaux ont MARGE_INTEGRALE éléments nuls de plus, lus par les voies inutilisées des noyaux vectorisés.
+ */
+#define MARGE_INTEGRALE 8
+
+struct ImageIntegrale {
+    int largeur = 0, hauteur = 0; // taille de l'image
+    int pas = 0;                  // en éléments
+    std::vector<int32_t> somme;
+    std::vector<uint32_t> carres;
+    std::vector<int32_t> inclinee;
+};
+
+/*
+ * Somme et somme des carrés en une passe, et somme inclinée si avecInclinee.
+ */
+void calculerIntegrales(const uint8_t *image, int largeur, int hauteur, size_t pasImage, bool avecInclinee, ImageIntegrale &sortie);
+
+/*
+ * Ajoute la somme inclinée à des intégrales déjà calculées.
+ */
+void calculerIntegraleInclinee(const uint8_t *image, int largeur, int hauteur, size_t pasImage, ImageIntegrale &sortie);
+
+class EvaluateurCascade
+{
+public:
+    explicit EvaluateurCascade(const ModeleCascade &modele);
+
+    /*
+     * Résultat pour la fenêtre dont le coin haut gauche est (x, y) :
+     * 1 si elle passe tous les étages, -e si elle est rejetée à l'étage e (0 pour le premier),
+     * -1 si la fenêtre est trop uniforme pour être évaluée.
+     */
+    int evaluer(const ImageIntegrale &integrale, int x, int y);
+
+    /*
+     * Parcourt les fenêtres de coin haut gauche (x0..x1, y0..y1) inclus, avec un pas de "pas" pixels
+     * (et saute la fenêtre suivante après un rejet au premier étage, comme OpenCV).
+     * Les coins des fenêtres acceptées sont ajoutés à "positions" (x, y à la suite).
+     */
+    void parcourir(const ImageIntegrale &integrale, int x0, int y0, int x1, int y1, int pas, std::vector<int> &positions);
+
+    // Nombre de fenêtres évaluées depuis la création (pour les mesures).
+    uint64_t fenetresEvaluees() const { return nbFenetres; }
+
+private:
+    // Décalages des coins des rectangles dans les intégrales, pour un pas donné.
+    struct CaracteristiqueOpt {
+        int coins[3][4];
+        float poids[3];
+        bool inclinee;
+    };
+
+    void preparer(int pas);
+    inline float calculer(const CaracteristiqueOpt &c, const int32_t *somme, const int32_t *inclinee) const;
+
+    const ModeleCascade &modele;
+    std::vector<CaracteristiqueOpt> optimisees;
+    int pasPrepare = -1;
+    int coinsNormalisation[4];
+    double aireNormalisation;
+    bool souches; // tous les arbres n'ont qu'un noeud
+    uint64_t nbFenetres = 0;
+};
+
+#endif // EVALUATEURCASCADE_H
@@ -0,0 +1,70 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Format binaire du journal des détections, partagé entre l'application (écriture) et l'outil LecteurJournal (lecture).
+ *
+ * Le journal est une suite de segments journal_NNNNNN.bin. Chaque segment commence par un EnTeteSegment de 64 octets,
+ * suivi d'enregistrements de taille fixe (32 octets), uniquement ajoutés à la fin.
+ * Un enregistrement de type 0 (zéros) marque la fin d'un segment interrompu brutalement.
+ */
+#ifndef FORMATJOURNAL_H
+#define FORMATJOURNAL_H
+
+#include <stdint.h>
+
+#define MAGIE_JOURNAL 0x4c4e524a // "JRNL"
+#define VERSION_JOURNAL 1
+
+// Type d'enregistrement.
+enum TypeEnregistrement {
+    ENREGISTREMENT_VIDE = 0,       // place réservée non écrite
+    ENREGISTREMENT_DETECTION = 1,  // résultat de la détection sur une image
+    ENREGISTREMENT_TRANSITION = 2, // changement de l'état (visage, sourire, yeux) par rapport à l'image précédente
+    ENREGISTREMENT_QUALITE = 3     // changement de niveau du contrôleur de qualité (voir ci-dessous)
+};
+
+/*
+ * Pour un enregistrement ENREGISTREMENT_QUALITE, les champs sont réutilisés ainsi :
+ * etat = nouveau niveau, etatPrecedent = ancien niveau, reserve = raison (RaisonQualite),
+ * centreX = temps de traitement moyen en dixièmes de ms, centreY = température en dixièmes de °C.
+ */
+
+// Bits du champ "etat".
+#define ETAT_VISAGE      0x01
+#define ETAT_SOURIRE     0x02
+#define ETAT_OEIL_GAUCHE 0x04
+#define ETAT_OEIL_DROIT  0x08
+
+struct EnTeteSegment {
+    uint32_t magie;
+    uint32_t version;
+    uint32_t tailleEnregistrement;
+    uint32_t numeroSegment;
+    uint64_t capacite;            // nombre d'enregistrements prévus dans le segment
+    uint64_t nbEnregistrements;   // mis à jour après chaque ajout
+    uint64_t horodatageCreation;  // microsecondes depuis le 1er janvier 1970
+    uint8_t reserve[24];
+};
+
+struct EnregistrementJournal {
+    uint64_t horodatage;    // microsecondes depuis le 1er janvier 1970
+    uint32_t numeroImage;
+    uint8_t type;           // TypeEnregistrement
+    uint8_t etat;           // bits ETAT_*
+    uint8_t etatPrecedent;  // pour une transition : état de l'image précédente
+    uint8_t reserve;
+    int16_t centreX;        // centre et taille du visage (en pixels), 0 si pas de visage
+    int16_t centreY;
+    uint16_t largeur;
+    uint16_t hauteur;
+    uint8_t scoreSourire;   // scores continus de EtatExpression, ramenés sur 0-255
+    uint8_t scoreOeilGauche;
+    uint8_t scoreOeilDroit;
+    uint8_t reserve2[5];
+};
+
+static_assert(sizeof(EnTeteSegment) == 64, "en-tête de segment : 64 octets");
+static_assert(sizeof(EnregistrementJournal) == 32, "enregistrement du journal : 32 octets");
+
+#endif // FORMATJOURNAL_H
@@ -0,0 +1,178 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Intégration des vitesses du gyroscope en rotation de la caméra, et journal des échantillons.
+ */
+#include "gyroscope.h"
+
+#include <algorithm>
+
+#define DEGRES (180.0 / 3.14159265358979323846)
+// Angles cumulés gardés (µs) : largement plus que l'intervalle entre deux images.
+#define HISTORIQUE_GYRO_US 2000000ULL
+// Au delà du dernier échantillon, la dernière vitesse est prolongée pendant au plus ce temps (µs).
+#define PROLONGATION_MAX_US 50000ULL
+
+Gyroscope::Gyroscope(int axeHorizontal, int signeHorizontal, int axeVertical, int signeVertical, double dureeBiais) :
+    dureeBiais((uint64_t)(dureeBiais * 1e6))
+{
+    axes[0] = std::min(std::max(axeHorizontal, 0), 2);
+    axes[1] = std::min(std::max(axeVertical, 0), 2);
+    signes[0] = signeHorizontal < 0 ? -1 : 1;
+    signes[1] = signeVertical < 0 ? -1 : 1;
+    biaisConnu = this->dureeBiais == 0;
+}
+
+Gyroscope::~Gyroscope()
+{
+    if (journal)
+        fclose(journal);
+}
+
+void Gyroscope::ajouter(const EchantillonGyro &echantillon)
+{
+    std::lock_guard<std::mutex> garde(verrou);
+    if (journal)
+        fprintf(journal, "g,%llu,%.6f,%.6f,%.6f\n", (unsigned long long)echantillon.instant, echantillon.x, echantillon.y, echantillon.z);
+    if (nombre++ == 0)
+        debut = echantillon.instant;
+
+    const double brut[3] = { echantillon.x, echantillon.y, echantillon.z };
+    if (!biaisConnu){ // nacelle immobile : la moyenne des vitesses mesurées est le biais.
+        for (int i = 0; i < 3; i++)
+            sommeBiais[i] += brut[i];
+        nombreBiais++;
+        if (echantillon.instant - debut < dureeBiais)
+            return;
+        for (int i = 0; i < 3; i++)
+            biais[i] = sommeBiais[i] / nombreBiais;
+        biaisConnu = true;
+    }
+
+    double vitesse[2];
+    for (int k = 0; k < 2; k++)
+        vitesse[k] = (brut[axes[k]] - biais[axes[k]]) * signes[k] * DEGRES;
+
+    if (cumuls.empty()){
+        Cumul premier = { echantillon.instant, 0, 0 };
+        cumuls.push_back(premier);
+    } else {
+        const Cumul &dernier = cumuls.back();
+        if (echantillon.instant <= dernier.instant) // échantillon en double ou horloge qui recule : ignoré.
+            return;
+        double dt = (echantillon.instant - dernier.instant) / 1e6;
+        Cumul suivant = { echantillon.instant, dernier.horizontal + (vitesses[0] + vitesse[0]) / 2 * dt,
+                          dernier.vertical + (vitesses[1] + vitesse[1]) / 2 * dt };
+        cumuls.push_back(suivant);
+        while (cumuls.front().instant + HISTORIQUE_GYRO_US < echantillon.instant)
+            cumuls.pop_front();
+    }
+    vitesses[0] = vitesse[0];
+    vitesses[1] = vitesse[1];
+}
+
+/*
+ * Angles cumulés à "instant", interpolés entre les deux échantillons qui l'entourent (appelée sous le verrou).
+ */
+bool Gyroscope::angles(uint64_t instant, double &horizontal, double &vertical) const
+{
+    if (cumuls.empty() || instant < cumuls.front().instant || instant > cumuls.back().instant + PROLONGATION_MAX_US)
+        return false;
+    if (instant >= cumuls.back().instant){
+        double dt = (instant - cumuls.back().instant) / 1e6;
+        horizontal = cumuls.back().horizontal + vitesses[0] * dt;
+        vertical = cumuls.back().vertical + vitesses[1] * dt;
+        return true;
+    }
+    Cumul cle = { instant, 0, 0 };
+    std::deque<Cumul>::const_iterator apres = std::lower_bound(cumuls.begin(), cumuls.end(), cle,
+                                                               [](const Cumul &a, const Cumul &b){ return a.instant < b.instant; });
+    if (apres->instant == instant || apres == cumuls.begin()){
+        horizontal = apres->horizontal;
+        vertical = apres->vertical;
+        return true;
+    }
+    std::deque<Cumul>::const_iterator avant = apres - 1;
+    double t = (double)(instant - avant->instant) / (apres->instant - avant->instant);
+    horizontal = avant->horizontal + t * (apres->horizontal - avant->horizontal);
+    vertical = avant->vertical + t * (apres->vertical - avant->vertical);
+    return true;
+}
+
+bool Gyroscope::rotation(uint64_t debut, uint64_t fin, double &horizontale, double &verticale) const
+{
+    std::lock_guard<std::mutex> garde(verrou);
+    double h0, v0, h1, v1;
+    if (!biaisConnu || !angles(debut, h0, v0) || !angles(fin, h1, v1))
+        return false;
+    horizontale = h1 - h0;
+    verticale = v1 - v0;
+    return true;
+}
+
+bool Gyroscope::biaisMesure() const
+{
+    std::lock_guard<std::mutex> garde(verrou);
+    return biaisConnu;
+}
+
+uint64_t Gyroscope::nombreEchantillons() const
+{
+    std::lock_guard<std::mutex> garde(verrou);
+    return nombre;
+}
+
+bool Gyroscope::ouvrirJournal(const std::string &chemin)
+{
+    std::lock_guard<std::mutex> garde(verrou);
+    if (journal)
+        fclose(journal);
+    journal = fopen(chemin.c_str(), "w");
+    if (!journal)
+        return false;
+    fprintf(journal, "type,instant_us,x_ou_numero,y,z\n");
+    return true;
+}
+
+void Gyroscope::journaliserImage(uint64_t instant, unsigned int numero)
+{
+    std::lock_guard<std::mutex> garde(verrou);
+    if (journal)
+        fprintf(journal, "i,%llu,%u\n", (unsigned long long)instant, numero);
+}
+
+bool Gyroscope::lireJournal(const std::string &chemin, std::vector<EchantillonGyro> &echantillons, std::vector<uint64_t> &images)
+{
+    FILE *fichier = fopen(chemin.c_str(), "r");
+    if (!fichier)
+        return false;
+    char ligne[256];
+    while (fgets(ligne, sizeof(ligne), fichier)){
+        unsigned long long instant;
+        EchantillonGyro e;
+        unsigned int numero;
+        if (sscanf(ligne, "g,%llu,%f,%f,%f", &instant, &e.x, &e.y, &e.z) == 4){
+            e.instant = instant;
+            echantillons.push_back(e);
+        } else if (sscanf(ligne, "i,%llu,%u", &instant, &numero) == 2){
+            images.push_back(instant);
+        }
+    }
+    fclose(fichier);
+    return true;
+}
+
+std::string Gyroscope::rapport() const
+{
+    std::lock_guard<std::mutex> garde(verrou);
+    char texte[200];
+    if (!biaisConnu){
+        snprintf(texte, sizeof(texte), "gyroscope : %llu échantillons, mesure du biais en cours (nacelle immobile)\n", (unsigned long long)nombre);
+    } else {
+        double intervalle = cumuls.size() > 1 ? (cumuls.back().instant - cumuls.front().instant) / 1000. / (cumuls.size() - 1) : 0;
+        snprintf(texte, sizeof(texte), "gyroscope : %llu échantillons, un toutes les %.1f ms, biais %+.2f %+.2f %+.2f °/s\n",
+                 (unsigned long long)nombre, intervalle, biais[0] * DEGRES, biais[1] * DEGRES, biais[2] * DEGRES);
+    }
+    return texte;
+}
@@ -0,0 +1,101 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Rotation de la caméra mesurée par le gyroscope du SenseHat, monté sur la nacelle.
+ * Les vitesses angulaires (rad/s, lues par SenseHat::LireGyroscope()) sont intégrées par la méthode des trapèzes
+ * en angles cumulés datés : rotation() donne la rotation de la caméra entre deux instants (deux images par exemple),
+ * dans la convention des servos : degrés, positive dans le sens de 'H' (l'image glisse vers la droite) et de 'V'
+ * (vers le bas). Les axes du gyroscope qui correspondent au panoramique et à l'inclinaison, et leurs signes,
+ * dépendent du montage ([imu] du fichier ini).
+ *
+ * Le biais du gyroscope est mesuré pendant les "dureeBiais" premières secondes (la nacelle est immobile au lancement)
+ * puis retranché ; avant, rotation() ne répond pas.
+ *
+ * Les échantillons bruts peuvent être écrits dans un journal csv, avec les instants des images prises en même temps
+ * (même horloge, MesureLatence::horloge()) : l'outil SuiviInertiel rejoue ce journal avec la vidéo enregistrée.
+ *
+ * ajouter() (thread de lecture du gyroscope) et rotation() (boucle des images) peuvent être appelés de deux threads.
+ */
+#ifndef GYROSCOPE_H
+#define GYROSCOPE_H
+
+#include <deque>
+#include <mutex>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// Vitesses angulaires lues à "instant" (µs), en rad/s, dans les axes du gyroscope.
+struct EchantillonGyro {
+    uint64_t instant;
+    float x, y, z;
+};
+
+class Gyroscope
+{
+public:
+    /*
+     * axeHorizontal / axeVertical : axe du gyroscope (0 : x, 1 : y, 2 : z) qui tourne avec le servo horizontal / vertical,
+     * signeHorizontal / signeVertical : +1 ou -1 selon le sens de montage.
+     */
+    Gyroscope(int axeHorizontal = 2, int signeHorizontal = 1, int axeVertical = 0, int signeVertical = 1, double dureeBiais = 1.0);
+    ~Gyroscope();
+
+    void ajouter(const EchantillonGyro &echantillon);
+
+    /*
+     * Rotation de la caméra (°) entre les instants "debut" et "fin" (µs). Retourne false si le biais n'est pas encore mesuré
+     * ou si l'un des instants n'est pas couvert par les échantillons gardés (deux secondes, un peu au delà du dernier).
+     */
+    bool rotation(uint64_t debut, uint64_t fin, double &horizontale, double &verticale) const;
+
+    bool biaisMesure() const;
+    uint64_t nombreEchantillons() const;
+
+    /*
+     * Journal csv : une ligne "g,instant,x,y,z" par échantillon reçu ensuite, une ligne "i,instant,numero" par image
+     * signalée par journaliserImage(). Retourne false si le fichier n'a pas pu être créé.
+     */
+    bool ouvrirJournal(const std::string &chemin);
+    void journaliserImage(uint64_t instant, unsigned int numero);
+
+    /*
+     * Relit un journal : échantillons et instants des images, dans l'ordre du fichier.
+     */
+    static bool lireJournal(const std::string &chemin, std::vector<EchantillonGyro> &echantillons, std::vector<uint64_t> &images);
+
+    // Biais mesuré, nombre d'échantillons et intervalle moyen, en texte.
+    std::string rapport() const;
+
+private:
+    Gyroscope(const Gyroscope &);
+    Gyroscope &operator=(const Gyroscope &);
+
+    // Angles cumulés (°) à un instant (µs).
+    struct Cumul {
+        uint64_t instant;
+        double horizontal;
+        double vertical;
+    };
+
+    bool angles(uint64_t instant, double &horizontal, double &vertical) const;
+
+    mutable std::mutex verrou;
+    int axes[2];
+    int signes[2];
+    uint64_t dureeBiais;
+    double sommeBiais[3] = { 0, 0, 0 };
+    uint64_t nombreBiais = 0;
+    uint64_t debut = 0;
+    bool biaisConnu = false;
+    double biais[3] = { 0, 0, 0 };
+    // vitesses (°/s) de l'échantillon précédent, sans biais, dans la convention des servos.
+    double vitesses[2] = { 0, 0 };
+    std::deque<Cumul> cumuls;
+    uint64_t nombre = 0;
+    FILE *journal = 0;
+};
+
+#endif // GYROSCOPE_H
@@ -0,0 +1,464 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Index des personnes enrôlées : fichier projeté, ajouts en fin de fichier, quantifieur grossier.
+ */
+#include "indexidentites.h"
+#include "noyauxidentites.h"
+#include "noyauxint8.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Réserve de la projection au delà de la taille du fichier, pour les ajouts.
+#define RESERVE_PROJECTION_MIN (1 << 20)
+
+/*
+ * Quantification int8 d'un vecteur de n valeurs : q = x / echelle, la plus grande valeur absolue donnant 127.
+ * Retourne l'échelle.
+ */
+static float quantifierInt8(const float *x, int n, int8_t *q)
+{
+    float maximum = 0;
+    for (int i = 0; i < n; i++)
+        maximum = std::max(maximum, std::fabs(x[i]));
+    float echelle = maximum > 0 ? maximum / 127.f : 1.f;
+    for (int i = 0; i < n; i++)
+        q[i] = (int8_t)lrintf(x[i] / echelle);
+    return echelle;
+}
+
+IndexIdentites::IndexIdentites()
+{
+    memset(&entete, 0, sizeof(entete));
+}
+
+IndexIdentites::~IndexIdentites()
+{
+    fermer();
+}
+
+void IndexIdentites::fermer()
+{
+    if (projection != 0)
+        munmap((void *)projection, tailleProjection);
+    projection = 0;
+    tailleProjection = 0;
+    if (fd >= 0)
+        close(fd);
+    if (fdMeta >= 0)
+        close(fdMeta);
+    fd = -1;
+    fdMeta = -1;
+    nombre = 0;
+    metas.clear();
+    personnes.clear();
+    centres.clear();
+    centresEncodes.clear();
+    listes.clear();
+    nonClassees.clear();
+}
+
+/*
+ * Projette le fichier avec une réserve (le double de sa taille, au moins 1 Mo) : tant que le fichier ne la dépasse pas,
+ * les entrées ajoutées par write() sont visibles dans la projection (MAP_SHARED, même cache de pages).
+ */
+bool IndexIdentites::projeter(size_t tailleFichier)
+{
+    if (projection != 0 && tailleFichier <= tailleProjection)
+        return true;
+    if (projection != 0)
+        munmap((void *)projection, tailleProjection);
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t taille = std::max(tailleFichier * 2, tailleFichier + RESERVE_PROJECTION_MIN);
+    taille = (taille + page - 1) / page * page;
+    void *p = mmap(0, taille, PROT_READ, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED){
+        projection = 0;
+        tailleProjection = 0;
+        return false;
+    }
+    projection = (const uint8_t *)p;
+    tailleProjection = taille;
+    madvise(p, tailleFichier, MADV_WILLNEED); // lecture anticipée : la première recherche ne part pas de la carte SD.
+    return true;
+}
+
+/*
+ * Taille d'une entrée de "dimensionAlignee" valeurs au format donné.
+ */
+static uint32_t tailleEnregistrement(uint32_t format, uint32_t dimensionAlignee)
+{
+    return format == FORMAT_INT8 ? sizeof(EnTeteEntreeInt8) + dimensionAlignee : dimensionAlignee * sizeof(uint16_t);
+}
+
+bool IndexIdentites::ouvrir(const std::string &chemin, int dimension, FormatIndex format)
+{
+    fermer();
+    if (dimension <= 0)
+        return false;
+    this->chemin = chemin;
+
+    fd = ::open(chemin.c_str(), O_RDWR | O_CREAT, 0644);
+    fdMeta = ::open((chemin + ".meta").c_str(), O_RDWR | O_CREAT, 0644);
+    struct stat infos, infosMeta;
+    if (fd < 0 || fdMeta < 0 || fstat(fd, &infos) != 0 || fstat(fdMeta, &infosMeta) != 0){
+        fermer();
+        return false;
+    }
+
+    if (infos.st_size == 0){ // nouvel index
+        memset(&entete, 0, sizeof(entete));
+        entete.magie = MAGIE_INDEX_IDENTITES;
+        entete.version = VERSION_INDEX_IDENTITES;
+        entete.format = format;
+        entete.dimension = dimension;
+        entete.dimensionAlignee = longueurAlignee(dimension);
+        entete.tailleEnregistrement = tailleEnregistrement(format, entete.dimensionAlignee);
+        if (pwrite(fd, &entete, sizeof(entete), 0) != (ssize_t)sizeof(entete) || ftruncate(fdMeta, 0) != 0){
+            fermer();
+            return false;
+        }
+        infos.st_size = sizeof(entete);
+        infosMeta.st_size = 0;
+    } else if (pread(fd, &entete, sizeof(entete), 0) != (ssize_t)sizeof(entete) || entete.magie != MAGIE_INDEX_IDENTITES
+               || entete.version != VERSION_INDEX_IDENTITES || (int)entete.dimension != dimension
+               || (entete.format != FORMAT_INT8 && entete.format != FORMAT_DEMI)
+               || entete.dimensionAlignee != (uint32_t)longueurAlignee(dimension)
+               || entete.tailleEnregistrement != tailleEnregistrement(entete.format, entete.dimensionAlignee)){
+        // tailles recalculées comme à la création : un en-tête abîmé ferait lire au delà des entrées.
+        fermer();
+        return false;
+    }
+
+    // entrées complètes présentes dans les deux fichiers ; le reste (coupure pendant un ajout) est retiré.
+    size_t entrees = (infos.st_size - sizeof(entete)) / entete.tailleEnregistrement;
+    nombre = (int)std::min(entrees, (size_t)infosMeta.st_size / sizeof(MetaIdentite));
+    size_t tailleFichier = sizeof(entete) + (size_t)nombre * entete.tailleEnregistrement;
+    if ((size_t)infos.st_size != tailleFichier && ftruncate(fd, tailleFichier) != 0){
+        fermer();
+        return false;
+    }
+    if ((size_t)infosMeta.st_size != nombre * sizeof(MetaIdentite) && ftruncate(fdMeta, nombre * sizeof(MetaIdentite)) != 0){
+        fermer();
+        return false;
+    }
+
+    metas.resize(nombre);
+    if (nombre > 0 && pread(fdMeta, &metas[0], nombre * sizeof(MetaIdentite), 0) != (ssize_t)(nombre * sizeof(MetaIdentite))){
+        fermer();
+        return false;
+    }
+    for (int e = 0; e < nombre; e++){
+        metas[e].nom[NOM_IDENTITE_MAX - 1] = 0;
+        personnes.insert(metas[e].nom);
+    }
+
+    if (!projeter(tailleFichier)){
+        fermer();
+        return false;
+    }
+    chargerCentres();
+    return true;
+}
+
+/*
+ * Centres du quantifieur (fichier absent ou d'une autre dimension : pas de quantifieur) et listes des entrées.
+ */
+bool IndexIdentites::chargerCentres()
+{
+    centres.clear();
+    centresEncodes.clear();
+    listes.clear();
+    nonClassees.clear();
+
+    FILE *f = fopen((chemin + ".centres").c_str(), "rb");
+    EnTeteCentres e;
+    bool ok = f && fread(&e, sizeof(e), 1, f) == 1 && e.magie == MAGIE_CENTRES_IDENTITES && e.dimension == entete.dimension && e.nombre > 0;
+    if (ok){
+        centres.resize((size_t)e.nombre * e.dimension);
+        ok = fread(&centres[0], sizeof(float), centres.size(), f) == centres.size();
+    }
+    if (f)
+        fclose(f);
+    if (!ok){
+        centres.clear();
+        for (int i = 0; i < nombre; i++)
+            nonClassees.push_back(i);
+        return false;
+    }
+
+    int nombreCentres = (int)(centres.size() / entete.dimension);
+    std::vector<uint8_t> encode;
+    for (int c = 0; c < nombreCentres; c++){
+        encoder(&centres[(size_t)c * entete.dimension], encode);
+        centresEncodes.insert(centresEncodes.end(), encode.begin(), encode.end());
+    }
+    listes.resize(nombreCentres);
+    for (int i = 0; i < nombre; i++){
+        if (metas[i].liste >= 0 && metas[i].liste < nombreCentres)
+            listes[metas[i].liste].push_back(i);
+        else
+            nonClassees.push_back(i); // toujours parcourues
+    }
+    return true;
+}
+
+void IndexIdentites::encoder(const float *descripteur, std::vector<uint8_t> &entree) const
+{
+    entree.assign(entete.tailleEnregistrement, 0);
+    if (entete.format == FORMAT_INT8){
+        EnTeteEntreeInt8 e;
+        memset(&e, 0, sizeof(e));
+        e.echelle = quantifierInt8(descripteur, entete.dimension, (int8_t *)&entree[sizeof(e)]);
+        memcpy(&entree[0], &e, sizeof(e));
+    } else {
+        uint16_t *valeurs = (uint16_t *)&entree[0];
+        for (uint32_t i = 0; i < entete.dimension; i++)
+            valeurs[i] = versDemi(descripteur[i]);
+    }
+}
+
+void IndexIdentites::lire(int entree, float *descripteur) const
+{
+    decoder(donneesEntree(entree), descripteur);
+}
+
+void IndexIdentites::decoder(const uint8_t *donnees, float *descripteur) const
+{
+    if (entete.format == FORMAT_INT8){
+        EnTeteEntreeInt8 e;
+        memcpy(&e, donnees, sizeof(e));
+        const int8_t *valeurs = (const int8_t *)(donnees + sizeof(e));
+        for (uint32_t i = 0; i < entete.dimension; i++)
+            descripteur[i] = valeurs[i] * e.echelle;
+    } else {
+        const uint16_t *valeurs = (const uint16_t *)donnees;
+        for (uint32_t i = 0; i < entete.dimension; i++)
+            descripteur[i] = depuisDemi(valeurs[i]);
+    }
+}
+
+void IndexIdentites::preparer(const float *descripteur, Requete &r) const
+{
+    if (entete.format == FORMAT_INT8){
+        r.valeursInt8.assign(entete.dimensionAlignee, 0);
+        r.echelle = quantifierInt8(descripteur, entete.dimension, &r.valeursInt8[0]);
+    } else {
+        r.valeurs.assign(entete.dimensionAlignee, 0.f);
+        std::copy(descripteur, descripteur + entete.dimension, r.valeurs.begin());
+    }
+}
+
+float IndexIdentites::similarite(const uint8_t *entree, const Requete &r) const
+{
+    if (entete.format == FORMAT_INT8){
+        float echelle;
+        memcpy(&echelle, entree, sizeof(echelle));
+        return produitScalaireInt8((const int8_t *)(entree + sizeof(EnTeteEntreeInt8)), &r.valeursInt8[0], entete.dimensionAlignee)
+                * echelle * r.echelle;
+    }
+    return produitScalaireDemi((const uint16_t *)entree, &r.valeurs[0], entete.dimensionAlignee);
+}
+
+int IndexIdentites::listeProche(const uint8_t *entree) const
+{
+    // l'entrée, relue en float, est cherchée parmi les centres encodés comme des entrées.
+    std::vector<float> descripteur(entete.dimension);
+    decoder(entree, &descripteur[0]);
+    Requete r;
+    preparer(&descripteur[0], r);
+    int meilleure = -1;
+    float meilleureSimilarite = -2;
+    for (size_t c = 0; c < listes.size(); c++){
+        float s = similarite(&centresEncodes[c * entete.tailleEnregistrement], r);
+        if (s > meilleureSimilarite){
+            meilleureSimilarite = s;
+            meilleure = (int)c;
+        }
+    }
+    return meilleure;
+}
+
+bool IndexIdentites::ajouter(const std::string &nom, const float *descripteur, uint32_t date)
+{
+    if (fd < 0)
+        return false;
+
+    std::vector<uint8_t> entree;
+    encoder(descripteur, entree);
+    MetaIdentite meta;
+    memset(&meta, 0, sizeof(meta));
+    strncpy(meta.nom, nom.c_str(), NOM_IDENTITE_MAX - 1);
+    meta.liste = listes.empty() ? -1 : listeProche(&entree[0]);
+    meta.date = date;
+
+    // descripteur puis nom : une coupure entre les deux laisse une entrée sans nom, retirée à l'ouverture.
+    size_t position = sizeof(entete) + (size_t)nombre * entete.tailleEnregistrement;
+    if (pwrite(fd, &entree[0], entree.size(), position) != (ssize_t)entree.size()
+            || pwrite(fdMeta, &meta, sizeof(meta), (size_t)nombre * sizeof(meta)) != (ssize_t)sizeof(meta))
+        return false;
+    if (!projeter(position + entree.size()))
+        return false;
+
+    metas.push_back(meta);
+    personnes.insert(meta.nom);
+    if (meta.liste >= 0)
+        listes[meta.liste].push_back(nombre);
+    else
+        nonClassees.push_back(nombre);
+    nombre++;
+    return true;
+}
+
+/*
+ * Insère (entree, s) parmi les k meilleurs voisins, rangés par similarité décroissante.
+ */
+static void garder(VoisinIdentite *voisins, int &trouves, int k, int entree, float s)
+{
+    if (trouves == k && s <= voisins[k - 1].similarite)
+        return;
+    int i = trouves < k ? trouves++ : k - 1;
+    for (; i > 0 && voisins[i - 1].similarite < s; i--)
+        voisins[i] = voisins[i - 1];
+    voisins[i].entree = entree;
+    voisins[i].similarite = s;
+}
+
+int IndexIdentites::chercher(const float *descripteur, int k, VoisinIdentite *voisins, int listesSondees) const
+{
+    if (fd < 0 || k <= 0)
+        return 0;
+    preparer(descripteur, requete);
+    int trouves = 0;
+
+    if (listesSondees <= 0 || listesSondees >= (int)listes.size()){
+        // exhaustive : tout le fichier dans l'ordre.
+        for (int e = 0; e < nombre; e++)
+            garder(voisins, trouves, k, e, similarite(donneesEntree(e), requete));
+        return trouves;
+    }
+
+    // listes des centres les plus proches, puis leurs entrées (et celles qui n'ont pas de liste).
+    std::vector<VoisinIdentite> proches(listesSondees);
+    int nombreProches = 0;
+    for (size_t c = 0; c < listes.size(); c++)
+        garder(&proches[0], nombreProches, listesSondees, (int)c, similarite(&centresEncodes[c * entete.tailleEnregistrement], requete));
+    for (int p = 0; p < nombreProches; p++){
+        const std::vector<int> &liste = listes[proches[p].entree];
+        for (size_t i = 0; i < liste.size(); i++)
+            garder(voisins, trouves, k, liste[i], similarite(donneesEntree(liste[i]), requete));
+    }
+    for (size_t i = 0; i < nonClassees.size(); i++)
+        garder(voisins, trouves, k, nonClassees[i], similarite(donneesEntree(nonClassees[i]), requete));
+    return trouves;
+}
+
+/*
+ * Réécrit le fichier .meta (à côté puis renommé) et rouvre son descripteur pour les ajouts suivants.
+ */
+bool IndexIdentites::ecrireMetas()
+{
+    std::string temporaire = chemin + ".meta.tmp";
+    FILE *f = fopen(temporaire.c_str(), "wb");
+    if (!f)
+        return false;
+    bool ok = metas.empty() || fwrite(&metas[0], sizeof(MetaIdentite), metas.size(), f) == metas.size();
+    ok = fclose(f) == 0 && ok;
+    if (!ok || rename(temporaire.c_str(), (chemin + ".meta").c_str()) != 0)
+        return false;
+    close(fdMeta);
+    fdMeta = ::open((chemin + ".meta").c_str(), O_RDWR);
+    return fdMeta >= 0;
+}
+
+bool IndexIdentites::construireQuantifieur(int nombreListes, int iterations, int echantillonsMax)
+{
+    if (fd < 0 || nombre == 0 || nombreListes <= 0)
+        return false;
+    nombreListes = std::min(nombreListes, nombre);
+    const int d = entete.dimension;
+
+    // échantillons répartis régulièrement dans l'index.
+    int nombreEchantillons = std::min(nombre, std::max(echantillonsMax, nombreListes));
+    std::vector<float> echantillons((size_t)nombreEchantillons * d);
+    for (int i = 0; i < nombreEchantillons; i++)
+        lire((int)((int64_t)i * nombre / nombreEchantillons), &echantillons[(size_t)i * d]);
+
+    // k-moyennes sphériques : centres de départ pris parmi les échantillons, affectation au centre le plus similaire,
+    // centre = moyenne normée de sa liste (un centre vide repart d'un échantillon).
+    // L'affectation, l'essentiel du calcul, se fait en int8 avec le noyau vectorisé quel que soit le format de l'index.
+    const int da = entete.dimensionAlignee;
+    std::vector<int8_t> echantillonsInt8((size_t)nombreEchantillons * da, 0), centresInt8((size_t)nombreListes * da, 0);
+    std::vector<float> echellesEchantillons(nombreEchantillons), echellesCentres(nombreListes);
+    for (int i = 0; i < nombreEchantillons; i++)
+        echellesEchantillons[i] = quantifierInt8(&echantillons[(size_t)i * d], d, &echantillonsInt8[(size_t)i * da]);
+    std::vector<float> c((size_t)nombreListes * d);
+    for (int j = 0; j < nombreListes; j++)
+        std::copy(&echantillons[(size_t)((int64_t)j * nombreEchantillons / nombreListes) * d],
+                  &echantillons[(size_t)((int64_t)j * nombreEchantillons / nombreListes) * d] + d, &c[(size_t)j * d]);
+    std::vector<int> affectation(nombreEchantillons, 0);
+    for (int iteration = 0; iteration < iterations; iteration++){
+        for (int j = 0; j < nombreListes; j++)
+            echellesCentres[j] = quantifierInt8(&c[(size_t)j * d], d, &centresInt8[(size_t)j * da]);
+        for (int i = 0; i < nombreEchantillons; i++){
+            const int8_t *x = &echantillonsInt8[(size_t)i * da];
+            float meilleure = -2;
+            for (int j = 0; j < nombreListes; j++){
+                float s = produitScalaireInt8(x, &centresInt8[(size_t)j * da], da) * echellesCentres[j];
+                if (s > meilleure){
+                    meilleure = s;
+                    affectation[i] = j;
+                }
+            }
+        }
+        std::vector<double> sommes((size_t)nombreListes * d, 0.);
+        std::vector<int> effectifs(nombreListes, 0);
+        for (int i = 0; i < nombreEchantillons; i++){
+            effectifs[affectation[i]]++;
+            for (int k = 0; k < d; k++)
+                sommes[(size_t)affectation[i] * d + k] += echantillons[(size_t)i * d + k];
+        }
+        for (int j = 0; j < nombreListes; j++){
+            float *centre = &c[(size_t)j * d];
+            if (effectifs[j] == 0){
+                const float *x = &echantillons[(size_t)((j * 7919 + iteration) % nombreEchantillons) * d];
+                std::copy(x, x + d, centre);
+                continue;
+            }
+            double norme = 0;
+            for (int k = 0; k < d; k++)
+                norme += sommes[(size_t)j * d + k] * sommes[(size_t)j * d + k];
+            norme = norme > 0 ? std::sqrt(norme) : 1.;
+            for (int k = 0; k < d; k++)
+                centre[k] = (float)(sommes[(size_t)j * d + k] / norme);
+        }
+    }
+
+    // centres écrits, puis toutes les entrées rangées dans la liste de leur centre (noyaux de l'index).
+    std::string temporaire = chemin + ".centres.tmp";
+    FILE *f = fopen(temporaire.c_str(), "wb");
+    if (!f)
+        return false;
+    EnTeteCentres e = { MAGIE_CENTRES_IDENTITES, entete.dimension, (uint32_t)nombreListes, 0 };
+    bool ok = fwrite(&e, sizeof(e), 1, f) == 1 && fwrite(&c[0], sizeof(float), c.size(), f) == c.size();
+    ok = fclose(f) == 0 && ok;
+    if (!ok || rename(temporaire.c_str(), (chemin + ".centres").c_str()) != 0)
+        return false;
+    chargerCentres();
+    for (size_t j = 0; j < listes.size(); j++)
+        listes[j].clear();
+    nonClassees.clear();
+    for (int i = 0; i < nombre; i++){
+        metas[i].liste = listeProche(donneesEntree(i));
+        listes[metas[i].liste].push_back(i);
+    }
+    return ecrireMetas();
+}
@@ -0,0 +1,160 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Index des personnes enrôlées pour la reconnaissance (descripteurvisage.h), prévu pour des milliers d'entrées.
+ *
+ * Les descripteurs sont stockés dans un fichier de taille fixe par entrée, projeté en mémoire (mmap) comme les poids
+ * du classifieur d'expression : à l'ouverture rien n'est lu ni converti, et la recherche exhaustive parcourt le fichier
+ * dans l'ordre. En int8 (défaut), une entrée de 944 valeurs fait 960 octets, 4 fois moins qu'en float32, et le produit
+ * scalaire passe par le noyau NEON du classifieur (noyauxint8.h) ; en float16 (noyauxidentites.h), elle fait le double
+ * pour une précision proche du float32. Les noms sont dans un fichier à côté (<index>.meta), lu en mémoire.
+ *
+ * Un ajout écrit une entrée à la fin des deux fichiers, sans les réécrire. La projection est réservée plus grande que
+ * le fichier : les entrées ajoutées y apparaissent sans la refaire, jusqu'à ce que la réserve soit pleine.
+ * Après une coupure pendant un ajout, l'entrée incomplète est retirée à l'ouverture suivante.
+ *
+ * Quantifieur grossier (optionnel, pour les grandes bases) : les entrées sont réparties en listes autour de centres
+ * trouvés par k-moyennes (<index>.centres, voir l'outil BancIdentites). La recherche ne parcourt alors que les listes
+ * des centres les plus proches du descripteur cherché ; les entrées ajoutées ensuite vont dans la liste de leur centre.
+ *
+ * Formats (petit boutiste) :
+ *   <index> : EnTeteIndex puis les entrées de tailleEnregistrement octets. Entrée int8 : EnTeteEntreeInt8 puis
+ *             dimensionAlignee valeurs int8 (descripteur = valeur x echelle) ; entrée float16 : dimensionAlignee valeurs.
+ *             Les valeurs au delà de "dimension" sont nulles.
+ *   <index>.meta : un MetaIdentite par entrée, dans le même ordre.
+ *   <index>.centres : EnTeteCentres puis nombre x dimension float (centres de norme 1).
+ */
+#ifndef INDEXIDENTITES_H
+#define INDEXIDENTITES_H
+
+#include <set>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#define MAGIE_INDEX_IDENTITES 0x31584449   // "IDX1"
+#define VERSION_INDEX_IDENTITES 1
+#define MAGIE_CENTRES_IDENTITES 0x31544e43 // "CNT1"
+#define NOM_IDENTITE_MAX 32
+
+enum FormatIndex {
+    FORMAT_INT8 = 1,
+    FORMAT_DEMI = 2 // float16
+};
+
+struct EnTeteIndex {
+    uint32_t magie;
+    uint32_t version;
+    uint32_t format;
+    uint32_t dimension;
+    uint32_t dimensionAlignee;
+    uint32_t tailleEnregistrement;
+    uint32_t reserve[10];
+};
+
+struct EnTeteEntreeInt8 {
+    float echelle;
+    uint32_t reserve[3];
+};
+
+struct MetaIdentite {
+    char nom[NOM_IDENTITE_MAX]; // terminé par des zéros
+    int32_t liste;              // liste du quantifieur grossier, -1 sans quantifieur
+    uint32_t date;              // ajout, en secondes depuis le 1er janvier 1970
+};
+
+struct EnTeteCentres {
+    uint32_t magie;
+    uint32_t dimension;
+    uint32_t nombre;
+    uint32_t reserve;
+};
+
+struct VoisinIdentite {
+    int entree;
+    float similarite;
+};
+
+class IndexIdentites
+{
+public:
+    IndexIdentites();
+    ~IndexIdentites();
+
+    /*
+     * Ouvre l'index "chemin" (avec ses fichiers .meta et .centres), ou le crée vide s'il n'existe pas,
+     * à la dimension et au format donnés. Retourne false si le fichier n'est pas un index de cette dimension.
+     */
+    bool ouvrir(const std::string &chemin, int dimension, FormatIndex format = FORMAT_INT8);
+    void fermer();
+    bool estOuvert() const { return fd >= 0; }
+
+    // Ajoute une entrée (descripteur de norme 1) à la fin de l'index, sans le réécrire.
+    bool ajouter(const std::string &nom, const float *descripteur, uint32_t date = 0);
+
+    /*
+     * Les "k" entrées les plus similaires au descripteur, de la plus similaire à la moins similaire ; retourne leur nombre.
+     * listesSondees : listes du quantifieur parcourues (0, ou sans quantifieur : recherche exhaustive).
+     * Pas plus d'une recherche à la fois (tampons internes).
+     */
+    int chercher(const float *descripteur, int k, VoisinIdentite *voisins, int listesSondees = 0) const;
+
+    /*
+     * Quantifieur grossier : k-moyennes (sphériques) sur au plus "echantillonsMax" entrées, puis chaque entrée est
+     * rangée dans la liste de son centre. Seuls les fichiers .centres et .meta sont réécrits.
+     */
+    bool construireQuantifieur(int nombreListes, int iterations = 10, int echantillonsMax = 20000);
+
+    // Descripteur d'une entrée (tel que stocké, donc quantifié).
+    void lire(int entree, float *descripteur) const;
+
+    int taille() const { return nombre; }
+    int dimension() const { return entete.dimension; }
+    FormatIndex format() const { return (FormatIndex)entete.format; }
+    int tailleEntree() const { return entete.tailleEnregistrement; }
+    int nombreListes() const { return (int)listes.size(); }
+    std::string nom(int entree) const { return metas[entree].nom; }
+    int nombrePersonnes() const { return (int)personnes.size(); }
+
+private:
+    IndexIdentites(const IndexIdentites &);
+    IndexIdentites &operator=(const IndexIdentites &);
+
+    // Descripteur préparé pour le format de l'index (quantifié en int8, ou complété par des zéros).
+    struct Requete {
+        std::vector<float> valeurs;
+        std::vector<int8_t> valeursInt8;
+        float echelle = 0;
+    };
+    void preparer(const float *descripteur, Requete &requete) const;
+    float similarite(const uint8_t *entree, const Requete &requete) const;
+    const uint8_t *donneesEntree(int e) const { return projection + sizeof(EnTeteIndex) + (size_t)e * entete.tailleEnregistrement; }
+    void encoder(const float *descripteur, std::vector<uint8_t> &entree) const;
+    void decoder(const uint8_t *entree, float *descripteur) const;
+    bool projeter(size_t tailleFichier);
+    bool chargerCentres();
+    bool ecrireMetas();
+    int listeProche(const uint8_t *entree) const;
+
+    std::string chemin;
+    int fd = -1;
+    int fdMeta = -1;
+    EnTeteIndex entete;
+    const uint8_t *projection = 0;
+    size_t tailleProjection = 0;
+    int nombre = 0;
+
+    std::vector<MetaIdentite> metas;
+    std::set<std::string> personnes;
+
+    // quantifieur grossier : centres (float, et préparés pour le format de l'index), entrées de chaque liste.
+    std::vector<float> centres;
+    std::vector<uint8_t> centresEncodes;
+    std::vector<std::vector<int> > listes;
+    std::vector<int> nonClassees;
+
+    mutable Requete requete;
+};
+
+#endif // INDEXIDENTITES_H
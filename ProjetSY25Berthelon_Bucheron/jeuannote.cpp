@@ -0,0 +1,182 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Jeu d'images annotées : annotations.csv, appariement des détections, réglages en texte.
+ */
+#include "jeuannote.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <sstream>
+
+static std::string couper(const std::string &texte)
+{
+    size_t debut = texte.find_first_not_of(" \t\r\n");
+    size_t fin = texte.find_last_not_of(" \t\r\n");
+    return debut == std::string::npos ? std::string() : texte.substr(debut, fin - debut + 1);
+}
+
+bool lireAnnotations(const std::string &dossier, std::vector<ImageAnnotee> &images)
+{
+    std::string chemin = dossier + "/annotations.csv";
+    FILE *f = fopen(chemin.c_str(), "r");
+    if (!f){
+        perror(chemin.c_str());
+        return false;
+    }
+
+    std::map<std::string, size_t> indices;
+    char ligne[1024];
+    int numero = 0;
+    while (fgets(ligne, sizeof(ligne), f)){
+        numero++;
+        std::string texte = couper(ligne);
+        if (texte.empty() || texte[0] == '#' || texte.compare(0, 6, "image,") == 0)
+            continue;
+
+        std::vector<std::string> champs;
+        std::stringstream flux(texte);
+        std::string champ;
+        while (std::getline(flux, champ, ','))
+            champs.push_back(couper(champ));
+
+        std::map<std::string, size_t>::iterator it = indices.find(champs[0]);
+        if (it == indices.end()){
+            ImageAnnotee image;
+            image.chemin = champs[0];
+            it = indices.insert(std::make_pair(champs[0], images.size())).first;
+            images.push_back(image);
+        }
+        if (champs.size() < 5 || champs[1].empty())
+            continue; // image sans visage
+
+        VisageAnnote visage;
+        visage.rect = cv::Rect(atoi(champs[1].c_str()), atoi(champs[2].c_str()), atoi(champs[3].c_str()), atoi(champs[4].c_str()));
+        if (visage.rect.width <= 0 || visage.rect.height <= 0){
+            fprintf(stderr, "%s:%d : rectangle invalide\n", chemin.c_str(), numero);
+            fclose(f);
+            return false;
+        }
+        for (int e = 0; e < 3; e++){
+            size_t c = 5 + e;
+            visage.etiquettes[e] = c < champs.size() && !champs[c].empty() ? atoi(champs[c].c_str()) : -1;
+        }
+        images[it->second].visages.push_back(visage);
+    }
+    fclose(f);
+    return true;
+}
+
+bool ecrireAnnotations(const std::string &dossier, const std::vector<ImageAnnotee> &images)
+{
+    std::string chemin = dossier + "/annotations.csv";
+    FILE *f = fopen(chemin.c_str(), "w");
+    if (!f){
+        perror(chemin.c_str());
+        return false;
+    }
+    fprintf(f, "image,x,y,largeur,hauteur,sourire,oeil_gauche,oeil_droit\n");
+    for (size_t i = 0; i < images.size(); i++){
+        if (images[i].visages.empty())
+            fprintf(f, "%s\n", images[i].chemin.c_str());
+        for (size_t v = 0; v < images[i].visages.size(); v++){
+            const VisageAnnote &visage = images[i].visages[v];
+            fprintf(f, "%s,%d,%d,%d,%d", images[i].chemin.c_str(), visage.rect.x, visage.rect.y, visage.rect.width, visage.rect.height);
+            for (int e = 0; e < 3; e++){
+                if (visage.etiquettes[e] < 0)
+                    fprintf(f, ",");
+                else
+                    fprintf(f, ",%d", visage.etiquettes[e]);
+            }
+            fprintf(f, "\n");
+        }
+    }
+    return fclose(f) == 0;
+}
+
+double iou(const cv::Rect &a, const cv::Rect &b)
+{
+    double intersection = (a & b).area();
+    double reunion = a.area() + b.area() - intersection;
+    return reunion > 0 ? intersection / reunion : 0.;
+}
+
+void apparier(const std::vector<cv::Rect> &detections, const std::vector<VisageAnnote> &visages, double seuil,
+              std::vector<int> &appariement, std::vector<double> &valeurs)
+{
+    struct Paire { double iou; int detection, visage; };
+    std::vector<Paire> paires;
+    for (size_t d = 0; d < detections.size(); d++){
+        for (size_t v = 0; v < visages.size(); v++){
+            Paire p = { iou(detections[d], visages[v].rect), (int)d, (int)v };
+            if (p.iou >= seuil)
+                paires.push_back(p);
+        }
+    }
+    std::sort(paires.begin(), paires.end(), [](const Paire &a, const Paire &b){
+        return a.iou != b.iou ? a.iou > b.iou : (a.detection != b.detection ? a.detection < b.detection : a.visage < b.visage);
+    });
+
+    appariement.assign(detections.size(), -1);
+    valeurs.assign(detections.size(), 0.);
+    std::vector<bool> visagePris(visages.size(), false);
+    for (size_t i = 0; i < paires.size(); i++){
+        if (appariement[paires[i].detection] >= 0 || visagePris[paires[i].visage])
+            continue;
+        appariement[paires[i].detection] = paires[i].visage;
+        valeurs[paires[i].detection] = paires[i].iou;
+        visagePris[paires[i].visage] = true;
+    }
+}
+
+bool lireReglages(const std::string &texte, ReglagesDetection &reglages, bool &internes, std::string &erreur)
+{
+    std::stringstream flux(texte);
+    std::string paire;
+    while (flux >> paire){
+        size_t egal = paire.find('=');
+        std::string cle = paire.substr(0, egal);
+        double valeur = egal == std::string::npos ? 0 : atof(paire.c_str() + egal + 1);
+        if (cle == "echelle") reglages.echelle = valeur;
+        else if (cle == "facteur") reglages.facteurEchelle = valeur;
+        else if (cle == "voisins") reglages.voisinsVisage = (int)valeur;
+        else if (cle == "taille_min") reglages.tailleMinVisage = (int)valeur;
+        else if (cle == "taille_max") reglages.tailleMaxVisage = (int)valeur;
+        else if (cle == "internes") internes = valeur != 0;
+        else if (cle == "facteur_sourire") reglages.facteurSourire = valeur;
+        else if (cle == "voisins_sourire") reglages.voisinsSourire = (int)valeur;
+        else if (cle == "facteur_yeux") reglages.facteurYeux = valeur;
+        else if (cle == "voisins_yeux") reglages.voisinsYeux = (int)valeur;
+        else if (cle == "periode_expression") reglages.periodeExpression = (int)valeur;
+        else {
+            erreur = "clé inconnue " + cle;
+            return false;
+        }
+    }
+    if (reglages.echelle <= 0 || reglages.echelle > 1 || reglages.facteurEchelle <= 1){
+        erreur = "échelle dans ]0, 1] et facteur > 1";
+        return false;
+    }
+    if (reglages.facteurSourire <= 1 || reglages.facteurYeux <= 1 || reglages.periodeExpression < 1){
+        erreur = "facteurs du sourire et des yeux > 1, periode_expression >= 1";
+        return false;
+    }
+    if (reglages.tailleMaxVisage > 0 && reglages.tailleMaxVisage < reglages.tailleMinVisage){
+        erreur = "taille_max (0 : sans limite) au moins égale à taille_min";
+        return false;
+    }
+    return true;
+}
+
+std::string ecrireReglages(const ReglagesDetection &g, bool internes)
+{
+    char texte[300];
+    snprintf(texte, sizeof(texte), "echelle=%g facteur=%g voisins=%d taille_min=%d taille_max=%d internes=%d facteur_sourire=%g "
+             "voisins_sourire=%d facteur_yeux=%g voisins_yeux=%d periode_expression=%d",
+             g.echelle, g.facteurEchelle, g.voisinsVisage, g.tailleMinVisage, g.tailleMaxVisage, (int)internes,
+             g.facteurSourire, g.voisinsSourire, g.facteurYeux, g.voisinsYeux, g.periodeExpression);
+    return texte;
+}
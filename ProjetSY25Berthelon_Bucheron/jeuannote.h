@@ -0,0 +1,61 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Jeu d'images annotées des outils EvaluationDetection et ReglageDetection, sans l'interface ni le matériel :
+ * lecture et écriture de annotations.csv, appariement des détections aux visages annotés, et réglages
+ * de la détection écrits en texte ("echelle=0.75 facteur=1.2 ...").
+ *
+ * annotations.csv, une ligne par visage :
+ *   image,x,y,largeur,hauteur,sourire,oeil_gauche,oeil_droit
+ * (chemin de l'image relatif au dossier, rectangle en pixels ; étiquettes 0 / 1, vide ou -1 si inconnues).
+ * Une image sans visage a une ligne avec son seul nom. Les lignes commençant par # sont ignorées.
+ */
+#ifndef JEUANNOTE_H
+#define JEUANNOTE_H
+
+#include "detecteurvisage.h"
+
+#include <opencv2/core/core.hpp>
+#include <string>
+#include <vector>
+
+struct VisageAnnote {
+    cv::Rect rect;
+    int etiquettes[3]; // sourire, oeil gauche, oeil droit : 0, 1, ou -1 si inconnue
+};
+
+struct ImageAnnotee {
+    std::string chemin;
+    std::vector<VisageAnnote> visages;
+};
+
+/*
+ * Lit "dossier"/annotations.csv. Les visages d'une même image sont regroupés, les images gardent l'ordre du fichier
+ * (celui de la vidéo pour un jeu extrait d'une vidéo : l'expression peut n'être analysée qu'une image sur periodeExpression).
+ */
+bool lireAnnotations(const std::string &dossier, std::vector<ImageAnnotee> &images);
+
+/*
+ * Ecrit "dossier"/annotations.csv (format ci-dessus). Retourne false si le fichier n'a pas pu être écrit.
+ */
+bool ecrireAnnotations(const std::string &dossier, const std::vector<ImageAnnotee> &images);
+
+double iou(const cv::Rect &a, const cv::Rect &b);
+
+/*
+ * Apparie détections et visages annotés : les paires d'IoU au dessus du seuil sont prises de la meilleure à la moins bonne.
+ * appariement[d] : indice du visage annoté de la détection d, -1 si c'est un faux positif.
+ */
+void apparier(const std::vector<cv::Rect> &detections, const std::vector<VisageAnnote> &visages, double seuil,
+              std::vector<int> &appariement, std::vector<double> &valeurs);
+
+/*
+ * Réglages en texte : paires cle=valeur séparées par des espaces, avec les clés echelle, facteur, voisins, taille_min,
+ * taille_max, internes, facteur_sourire, voisins_sourire, facteur_yeux, voisins_yeux, periode_expression.
+ * Les clés absentes gardent leur valeur. Retourne false (et la raison dans "erreur") pour une clé inconnue ou une valeur hors bornes.
+ */
+bool lireReglages(const std::string &texte, ReglagesDetection &reglages, bool &internes, std::string &erreur);
+std::string ecrireReglages(const ReglagesDetection &reglages, bool internes);
+
+#endif // JEUANNOTE_H
@@ -0,0 +1,153 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Journal binaire des détections et des changements d'expression (format dans formatjournal.h).
+ */
+#include "journalevenements.h"
+
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+JournalEvenements::JournalEvenements(const std::string &dossier, uint64_t capacite) :
+    dossier(dossier),
+    capacite(capacite > 0 ? capacite : 1)
+{
+}
+
+JournalEvenements::~JournalEvenements()
+{
+    fermer();
+}
+
+uint64_t JournalEvenements::horodatageMaintenant()
+{
+    struct timeval t;
+    gettimeofday(&t, 0);
+    return (uint64_t)t.tv_sec * 1000000 + t.tv_usec;
+}
+
+/*
+ * Crée le premier segment, avec un numéro supérieur à ceux déjà présents dans le dossier :
+ * on n'écrit jamais dans un segment existant.
+ */
+bool JournalEvenements::ouvrir()
+{
+    mkdir(dossier.c_str(), 0755);
+
+    DIR *rep = opendir(dossier.c_str());
+    if (!rep)
+        return false;
+
+    uint32_t dernier = 0;
+    struct dirent *entree;
+    while ((entree = readdir(rep)) != 0){
+        unsigned int numero;
+        if (sscanf(entree->d_name, "journal_%u.bin", &numero) == 1 && numero > dernier)
+            dernier = numero;
+    }
+    closedir(rep);
+
+    return ouvrirSegment(dernier + 1);
+}
+
+bool JournalEvenements::ouvrirSegment(uint32_t numero)
+{
+    char nom[32];
+    snprintf(nom, sizeof(nom), "journal_%06u.bin", numero);
+    std::string chemin = dossier + "/" + nom;
+
+    fd = open(chemin.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0)
+        return false;
+
+    // Le fichier est agrandi d'un coup à sa taille maximum (les pages ne sont réellement allouées qu'à l'écriture).
+    tailleProjection = sizeof(EnTeteSegment) + capacite * sizeof(EnregistrementJournal);
+    if (ftruncate(fd, tailleProjection) != 0){
+        close(fd);
+        fd = -1;
+        return false;
+    }
+
+    void *p = mmap(0, tailleProjection, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED){
+        close(fd);
+        fd = -1;
+        return false;
+    }
+
+    projection = (uint8_t *)p;
+    entete = (EnTeteSegment *)projection;
+    enregistrements = (EnregistrementJournal *)(projection + sizeof(EnTeteSegment));
+    numeroSegment = numero;
+
+    memset(entete, 0, sizeof(EnTeteSegment));
+    entete->magie = MAGIE_JOURNAL;
+    entete->version = VERSION_JOURNAL;
+    entete->tailleEnregistrement = sizeof(EnregistrementJournal);
+    entete->numeroSegment = numero;
+    entete->capacite = capacite;
+    entete->nbEnregistrements = 0;
+    entete->horodatageCreation = horodatageMaintenant();
+    return true;
+}
+
+/*
+ * Termine le segment : les données sont envoyées au disque et le fichier est ramené à sa taille utile.
+ */
+void JournalEvenements::fermerSegment()
+{
+    if (!projection)
+        return;
+
+    size_t tailleUtile = sizeof(EnTeteSegment) + entete->nbEnregistrements * sizeof(EnregistrementJournal);
+    msync(projection, tailleProjection, MS_SYNC);
+    munmap(projection, tailleProjection);
+    if (ftruncate(fd, tailleUtile) != 0)
+        perror("journal : ftruncate");
+    close(fd);
+
+    fd = -1;
+    projection = 0;
+    entete = 0;
+    enregistrements = 0;
+}
+
+void JournalEvenements::fermer()
+{
+    fermerSegment();
+}
+
+/*
+ * Ajoute un enregistrement à la fin du segment en cours (nouveau segment si celui-ci est plein).
+ */
+bool JournalEvenements::ajouter(EnregistrementJournal enregistrement)
+{
+    if (!projection)
+        return false;
+
+    if (entete->nbEnregistrements >= entete->capacite){
+        fermerSegment();
+        if (!ouvrirSegment(numeroSegment + 1))
+            return false;
+    }
+
+    if (enregistrement.horodatage == 0)
+        enregistrement.horodatage = horodatageMaintenant();
+
+    // L'enregistrement est écrit avant le compteur : un lecteur ne voit jamais d'enregistrement à moitié écrit.
+    enregistrements[entete->nbEnregistrements] = enregistrement;
+    __sync_synchronize();
+    entete->nbEnregistrements++;
+
+    // Toutes les 4096 entrées (128 ko), on demande au noyau d'écrire sans attendre.
+    if ((entete->nbEnregistrements & 4095) == 0)
+        msync(projection, sizeof(EnTeteSegment) + entete->nbEnregistrements * sizeof(EnregistrementJournal), MS_ASYNC);
+    return true;
+}
@@ -0,0 +1,60 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Journal binaire des détections et des changements d'expression (format dans formatjournal.h).
+ * Les segments sont projetés en mémoire (mmap) : un ajout n'est qu'une copie de 32 octets, sans appel système.
+ * Quand un segment est plein, il est ramené à sa taille utile et un nouveau segment est créé.
+ */
+#ifndef JOURNALEVENEMENTS_H
+#define JOURNALEVENEMENTS_H
+
+#include "formatjournal.h"
+
+#include <string>
+
+class JournalEvenements
+{
+public:
+    /*
+     * dossier : répertoire des segments, capacite : nombre d'enregistrements par segment.
+     */
+    JournalEvenements(const std::string &dossier, uint64_t capacite);
+    ~JournalEvenements();
+
+    /*
+     * Crée le premier segment (à la suite des segments déjà présents dans le dossier).
+     */
+    bool ouvrir();
+
+    /*
+     * Ajoute un enregistrement (l'horodatage est rempli s'il vaut 0).
+     */
+    bool ajouter(EnregistrementJournal enregistrement);
+
+    /*
+     * Termine le segment en cours (il est ramené à sa taille utile).
+     */
+    void fermer();
+
+    static uint64_t horodatageMaintenant();
+
+private:
+    JournalEvenements(const JournalEvenements &);
+    JournalEvenements &operator=(const JournalEvenements &);
+
+    bool ouvrirSegment(uint32_t numero);
+    void fermerSegment();
+
+    std::string dossier;
+    uint64_t capacite;
+
+    int fd = -1;
+    uint8_t *projection = 0;
+    size_t tailleProjection = 0;
+    EnTeteSegment *entete = 0;
+    EnregistrementJournal *enregistrements = 0;
+    uint32_t numeroSegment = 0;
+};
+
+#endif // JOURNALEVENEMENTS_H
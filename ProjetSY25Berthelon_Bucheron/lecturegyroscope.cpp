@@ -0,0 +1,55 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Thread de lecture du gyroscope du SenseHat.
+ */
+#include "lecturegyroscope.h"
+#include "mesurelatence.h"
+
+#include <sys/time.h>
+
+/*
+ * Ecart (µs) entre l'horloge de RTIMULib (gettimeofday(), depuis 1970) et MesureLatence::horloge().
+ */
+static int64_t ecartHorloges()
+{
+    uint64_t maintenant = MesureLatence::horloge();
+    struct timeval tv;
+    gettimeofday(&tv, 0);
+    return (int64_t)((uint64_t)tv.tv_sec * 1000000 + tv.tv_usec) - (int64_t)maintenant;
+}
+
+LectureGyroscope::LectureGyroscope(SenseHat &carte, Gyroscope &gyroscope, unsigned long periode) :
+    carte(carte),
+    gyroscope(gyroscope),
+    periode(periode)
+{
+}
+
+LectureGyroscope::~LectureGyroscope()
+{
+    arreter();
+}
+
+void LectureGyroscope::arreter()
+{
+    arret = true;
+    wait();
+}
+
+void LectureGyroscope::run()
+{
+    while (!arret){
+        // tous les échantillons arrivés depuis la lecture précédente (aucun si la centrale n'en a pas produit).
+        // Un même écart pour toute la lecture : les instants restent dans l'ordre des échantillons.
+        int64_t ecart = ecartHorloges();
+        EchantillonGyro echantillon;
+        uint64_t horodatage;
+        while (carte.LireGyroscope(echantillon.x, echantillon.y, echantillon.z, horodatage)){
+            echantillon.instant = (uint64_t)((int64_t)horodatage - ecart);
+            gyroscope.ajouter(echantillon);
+        }
+        usleep(periode);
+    }
+}
@@ -0,0 +1,45 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Lecture du gyroscope du SenseHat dans un thread, à intervalle fixe (quelques ms) : la boucle des images (120 ms)
+ * ne suffirait pas à intégrer les vitesses pendant un mouvement de la nacelle.
+ * Chaque échantillon nouveau de la centrale est daté (instant de l'échantillon, ramené à MesureLatence::horloge(),
+ * l'horloge des trames) et donné au Gyroscope ; une lecture qui ne trouve pas d'échantillon nouveau ne donne rien.
+ *
+ * Seul ce thread utilise la centrale inertielle du SenseHat : le thread de l'interface n'en utilise que le panneau led
+ * et la température du processeur.
+ */
+#ifndef LECTUREGYROSCOPE_H
+#define LECTUREGYROSCOPE_H
+
+#include "SenseHat.h"
+#include "gyroscope.h"
+
+#include <QThread>
+
+class LectureGyroscope : public QThread
+{
+    Q_OBJECT
+
+public:
+    /*
+     * periode : intervalle entre deux lectures (µs).
+     */
+    LectureGyroscope(SenseHat &carte, Gyroscope &gyroscope, unsigned long periode);
+    ~LectureGyroscope();
+
+    // Arrête le thread (attend la fin de la lecture en cours).
+    void arreter();
+
+protected:
+    void run();
+
+private:
+    SenseHat &carte;
+    Gyroscope &gyroscope;
+    unsigned long periode;
+    volatile bool arret = false;
+};
+
+#endif // LECTUREGYROSCOPE_H
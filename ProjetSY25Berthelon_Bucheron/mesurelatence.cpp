@@ -0,0 +1,132 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Mesure de la latence entre la capture d'une image et l'envoi de la commande aux servomoteurs.
+ */
+#include "mesurelatence.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <time.h>
+
+// Largeur d'une case de l'histogramme et nombre de cases (100 µs * 10000 = 1 s).
+#define PAS_HISTOGRAMME 100
+#define NB_CASES 10000
+
+static const char *NOMS_ETAPES[NB_ETAPES] = { "acquisition", "detection", "expression", "servo", "envoi" };
+
+HistogrammeLatence::HistogrammeLatence() :
+    cases(NB_CASES, 0)
+{
+    reinitialiser();
+}
+
+void HistogrammeLatence::ajouter(uint64_t microsecondes)
+{
+    uint64_t i = microsecondes / PAS_HISTOGRAMME;
+    cases[i < NB_CASES ? i : NB_CASES - 1]++;
+    total++;
+    somme += microsecondes;
+    if (microsecondes > plusGrand)
+        plusGrand = microsecondes;
+}
+
+void HistogrammeLatence::reinitialiser()
+{
+    std::fill(cases.begin(), cases.end(), 0);
+    total = 0;
+    somme = 0;
+    plusGrand = 0;
+}
+
+uint64_t HistogrammeLatence::centile(double p) const
+{
+    if (total == 0)
+        return 0;
+
+    uint64_t rang = (uint64_t)(p / 100. * total + 0.5);
+    if (rang < 1)
+        rang = 1;
+
+    uint64_t cumul = 0;
+    for (int i = 0; i < NB_CASES; i++){
+        cumul += cases[i];
+        if (cumul >= rang) // borne haute de la case, sans dépasser le maximum observé.
+            return std::min((uint64_t)(i + 1) * PAS_HISTOGRAMME, plusGrand);
+    }
+    return plusGrand;
+}
+
+MesureLatence::MesureLatence() :
+    capture(0),
+    derniereMarque(0),
+    enCours(false)
+{
+    for (int e = 0; e < NB_ETAPES; e++)
+        marquee[e] = false;
+}
+
+uint64_t MesureLatence::horloge()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000 + t.tv_nsec / 1000;
+}
+
+void MesureLatence::debutImage(uint64_t horodatageCapture, uint64_t debutLecture)
+{
+    if (debutLecture > 0 && horodatageCapture >= debutLecture)
+        attente.ajouter(horodatageCapture - debutLecture);
+    capture = horodatageCapture;
+    derniereMarque = horodatageCapture;
+    enCours = true;
+    for (int e = 0; e < NB_ETAPES; e++)
+        marquee[e] = false;
+}
+
+void MesureLatence::marquer(EtapeLatence etape)
+{
+    if (!enCours || marquee[etape])
+        return;
+
+    uint64_t maintenant = horloge();
+    etapes[etape].ajouter(maintenant > derniereMarque ? maintenant - derniereMarque : 0);
+    derniereMarque = maintenant;
+    marquee[etape] = true;
+}
+
+void MesureLatence::finImage()
+{
+    if (enCours && marquee[ETAPE_ENVOI])
+        total.ajouter(derniereMarque - capture);
+    enCours = false;
+}
+
+static void ligneRapport(std::string &texte, const char *nom, const HistogrammeLatence &h)
+{
+    char ligne[160];
+    snprintf(ligne, sizeof(ligne), "%-12s n=%-7llu moy=%7.2f med=%7.2f p90=%7.2f p99=%7.2f max=%7.2f ms\n",
+             nom, (unsigned long long)h.nombre(), h.moyenne() / 1000., h.centile(50) / 1000.,
+             h.centile(90) / 1000., h.centile(99) / 1000., h.maximum() / 1000.);
+    texte += ligne;
+}
+
+std::string MesureLatence::rapport() const
+{
+    std::string texte;
+    if (attente.nombre() > 0)
+        ligneRapport(texte, "attente", attente);
+    for (int e = 0; e < NB_ETAPES; e++)
+        ligneRapport(texte, NOMS_ETAPES[e], etapes[e]);
+    ligneRapport(texte, "capture->moteur", total);
+    return texte;
+}
+
+void MesureLatence::reinitialiser()
+{
+    for (int e = 0; e < NB_ETAPES; e++)
+        etapes[e].reinitialiser();
+    total.reinitialiser();
+    attente.reinitialiser();
+}
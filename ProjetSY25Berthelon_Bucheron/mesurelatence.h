@@ -0,0 +1,106 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Mesure de la latence "de l'objectif au moteur" : du moment où l'image est capturée
+ * jusqu'au moment où la commande 'H'/'h'/'V'/'v' correspondante quitte transmitCmd().
+ *
+ * Chaque trame porte son horodatage de capture (horloge monotone, en µs). Au cours du traitement, on marque
+ * la fin de chaque étape : le temps passé dans l'étape (depuis la marque précédente) et le temps total
+ * depuis la capture sont rangés dans des histogrammes, dont on tire médiane, 90e, 99e centile et maximum.
+ * L'attente de l'image dans grab() (avant la capture, hors latence de bout en bout) est comptée à part.
+ */
+#ifndef MESURELATENCE_H
+#define MESURELATENCE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Etapes du traitement d'une image, dans l'ordre.
+enum EtapeLatence {
+    ETAPE_ACQUISITION, // trame rendue par la source : réduction ou conversion après la capture (haute résolution, fichier)
+    ETAPE_DETECTION,   // visage trouvé par la cascade
+    ETAPE_EXPRESSION,  // expression calculée (classifieur, points ou cascades)
+    ETAPE_SERVO,       // décision de handleServo()
+    ETAPE_ENVOI,       // commande écrite sur le port série
+    NB_ETAPES
+};
+
+/*
+ * Histogramme de durées, par pas de 100 µs jusqu'à 1 s (au delà : dernière case, le maximum reste exact).
+ */
+class HistogrammeLatence
+{
+public:
+    HistogrammeLatence();
+
+    void ajouter(uint64_t microsecondes);
+    void reinitialiser();
+
+    uint64_t nombre() const { return total; }
+    uint64_t maximum() const { return plusGrand; }
+    double moyenne() const { return total > 0 ? (double)somme / total : 0.; }
+
+    // Centile (0-100) en µs, arrondi à la case supérieure.
+    uint64_t centile(double p) const;
+
+private:
+    std::vector<uint32_t> cases;
+    uint64_t total;
+    uint64_t somme;
+    uint64_t plusGrand;
+};
+
+class MesureLatence
+{
+public:
+    MesureLatence();
+
+    /*
+     * Horloge monotone en µs (la même pour l'horodatage des trames et pour les marques).
+     */
+    static uint64_t horloge();
+
+    /*
+     * Début du traitement d'une image capturée à "horodatageCapture" (valeur de horloge()).
+     * debutLecture : instant où la source a commencé à attendre l'image (0 : inconnu, l'attente n'est pas comptée).
+     */
+    void debutImage(uint64_t horodatageCapture, uint64_t debutLecture = 0);
+
+    /*
+     * Fin d'une étape pour l'image en cours. Une étape déjà marquée pour cette image n'est pas comptée deux fois.
+     */
+    void marquer(EtapeLatence etape);
+
+    /*
+     * Fin du traitement de l'image : si une commande est partie, la latence de bout en bout est comptée.
+     */
+    void finImage();
+
+    // Latence capture -> commande envoyée.
+    const HistogrammeLatence &boutEnBout() const { return total; }
+    // Durée de chaque étape.
+    const HistogrammeLatence &etape(EtapeLatence e) const { return etapes[e]; }
+    // Attente de l'image par la source (grab()), avant la capture.
+    const HistogrammeLatence &attenteCapture() const { return attente; }
+
+    /*
+     * Rapport texte (une ligne par étape et une pour le bout en bout), en millisecondes.
+     */
+    std::string rapport() const;
+
+    void reinitialiser();
+
+private:
+    HistogrammeLatence etapes[NB_ETAPES];
+    HistogrammeLatence total;
+    HistogrammeLatence attente;
+
+    uint64_t capture;
+    uint64_t derniereMarque;
+    bool enCours;
+    bool marquee[NB_ETAPES];
+};
+
+#endif // MESURELATENCE_H
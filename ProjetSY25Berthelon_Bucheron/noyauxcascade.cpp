@@ -0,0 +1,378 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Evaluation vectorisée des cascades de souches, quatre fenêtres à la fois.
+ * Version NEON sur la raspi, SSE2 sur PC (les mêmes quatre voies avec AVX2) ; sans l'un ou l'autre, preparer() refuse.
+ */
+#include "noyauxcascade.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define NOYAUX_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define NOYAUX_SSE2
+#endif
+
+// Nombre de fenêtres évaluées ensemble.
+#define VOIES 4
+// La somme d'un étage en virgule fixe doit tenir sur 31 bits avec de la marge.
+#define BORNE_VIRGULE_FIXE 1073741824.0
+
+#if defined(NOYAUX_NEON)
+typedef int32x4_t VecteurEntier;
+typedef float32x4_t VecteurFlottant;
+
+// Valeurs aux positions p, p+pas, p+2pas, p+3pas (pas de 1 ou 2 comme dans detectMultiScale).
+static inline VecteurEntier charger(const int32_t *p, int pas)
+{
+    return pas == 1 ? vld1q_s32(p) : vld2q_s32(p).val[0];
+}
+static inline VecteurEntier sommeRectangle(const int32_t *p, const int32_t c0, const int32_t c1, const int32_t c2, const int32_t c3, int pas)
+{
+    return vaddq_s32(vsubq_s32(vsubq_s32(charger(p + c0, pas), charger(p + c1, pas)), charger(p + c2, pas)), charger(p + c3, pas));
+}
+static inline VecteurFlottant versFlottant(VecteurEntier v) { return vcvtq_f32_s32(v); }
+static inline VecteurFlottant multiplier(VecteurFlottant a, VecteurFlottant b) { return vmulq_f32(a, b); }
+static inline VecteurFlottant ajouter(VecteurFlottant a, VecteurFlottant b) { return vaddq_f32(a, b); }
+static inline VecteurFlottant diffuser(float v) { return vdupq_n_f32(v); }
+// (a < seuil) ? gauche : droite, voie par voie.
+static inline VecteurEntier choisir(VecteurFlottant a, VecteurFlottant seuil, int32_t gauche, int32_t droite)
+{
+    return vbslq_s32(vcltq_f32(a, seuil), vdupq_n_s32(gauche), vdupq_n_s32(droite));
+}
+static inline VecteurEntier additionner(VecteurEntier a, VecteurEntier b) { return vaddq_s32(a, b); }
+static inline VecteurEntier zero() { return vdupq_n_s32(0); }
+static inline void ranger(int32_t *sortie, VecteurEntier v) { vst1q_s32(sortie, v); }
+static inline VecteurFlottant chargerFlottants(const float *p) { return vld1q_f32(p); }
+
+#elif defined(NOYAUX_SSE2)
+typedef __m128i VecteurEntier;
+typedef __m128 VecteurFlottant;
+
+static inline VecteurEntier charger(const int32_t *p, int pas)
+{
+    if (pas == 1)
+        return _mm_loadu_si128((const __m128i *)p);
+    // une valeur sur deux de huit valeurs consécutives.
+    __m128 a = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)p));
+    __m128 b = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)(p + 4)));
+    return _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+}
+static inline VecteurEntier sommeRectangle(const int32_t *p, const int32_t c0, const int32_t c1, const int32_t c2, const int32_t c3, int pas)
+{
+    return _mm_add_epi32(_mm_sub_epi32(_mm_sub_epi32(charger(p + c0, pas), charger(p + c1, pas)), charger(p + c2, pas)), charger(p + c3, pas));
+}
+static inline VecteurFlottant versFlottant(VecteurEntier v) { return _mm_cvtepi32_ps(v); }
+static inline VecteurFlottant multiplier(VecteurFlottant a, VecteurFlottant b) { return _mm_mul_ps(a, b); }
+static inline VecteurFlottant ajouter(VecteurFlottant a, VecteurFlottant b) { return _mm_add_ps(a, b); }
+static inline VecteurFlottant diffuser(float v) { return _mm_set1_ps(v); }
+static inline VecteurEntier choisir(VecteurFlottant a, VecteurFlottant seuil, int32_t gauche, int32_t droite)
+{
+    __m128i masque = _mm_castps_si128(_mm_cmplt_ps(a, seuil));
+    return _mm_or_si128(_mm_and_si128(masque, _mm_set1_epi32(gauche)), _mm_andnot_si128(masque, _mm_set1_epi32(droite)));
+}
+static inline VecteurEntier additionner(VecteurEntier a, VecteurEntier b) { return _mm_add_epi32(a, b); }
+static inline VecteurEntier zero() { return _mm_setzero_si128(); }
+static inline void ranger(int32_t *sortie, VecteurEntier v) { _mm_storeu_si128((__m128i *)sortie, v); }
+static inline VecteurFlottant chargerFlottants(const float *p) { return _mm_loadu_ps(p); }
+#endif
+
+CascadeVectorisee::CascadeVectorisee() :
+    largeur(0),
+    hauteur(0),
+    aireNormalisation(0),
+    pasPrepare(-1),
+    nbFenetres(0),
+    nbRecalculs(0)
+{
+}
+
+bool CascadeVectorisee::preparer(const ModeleCascade &modele)
+{
+#if !defined(NOYAUX_NEON) && !defined(NOYAUX_SSE2)
+    (void)modele;
+    return false;
+#else
+    for (size_t i = 0; i < modele.arbres.size(); i++){
+        if (modele.arbres[i].nbNoeuds != 1){
+            return false;
+        }
+    }
+
+    largeur = modele.largeur;
+    hauteur = modele.hauteur;
+    aireNormalisation = (double)(largeur - 2) * (hauteur - 2);
+
+    // Echelle de la virgule fixe : la plus fine pour laquelle aucun étage ne peut dépasser la borne.
+    double plusGrandeSomme = 1e-6;
+    for (size_t e = 0; e < modele.etages.size(); e++){
+        const EtageHaar &etage = modele.etages[e];
+        double somme = std::fabs(etage.seuil);
+        for (int a = etage.premierArbre; a < etage.premierArbre + etage.nbArbres; a++){
+            const ArbreHaar &arbre = modele.arbres[a];
+            somme += std::max(std::fabs(modele.feuilles[arbre.premiereFeuille]), std::fabs(modele.feuilles[arbre.premiereFeuille + 1]));
+        }
+        plusGrandeSomme = std::max(plusGrandeSomme, somme);
+    }
+    double unite = std::ldexp(1.0, (int)std::floor(std::log2(BORNE_VIRGULE_FIXE / plusGrandeSomme)));
+
+    size_t nbSouches = modele.arbres.size();
+    for (int r = 0; r < 3; r++){
+        poids[r].resize(nbSouches);
+        rectangles[r].resize(nbSouches);
+    }
+    inclinee.resize(nbSouches);
+    seuils.resize(nbSouches);
+    gauche.resize(nbSouches);
+    droite.resize(nbSouches);
+    gaucheExacte.resize(nbSouches);
+    droiteExacte.resize(nbSouches);
+
+    etages.clear();
+    for (size_t e = 0; e < modele.etages.size(); e++){
+        const EtageHaar &source = modele.etages[e];
+        EtageVectorise etage;
+        etage.premiere = source.premierArbre;
+        etage.nombre = source.nbArbres;
+        etage.seuilExact = source.seuil;
+        etage.seuil = (int32_t)std::lrint(source.seuil * unite);
+        // une demi-unité d'erreur par feuille et pour le seuil, plus une unité de marge.
+        etage.tolerance = etage.nombre / 2 + 2;
+        etages.push_back(etage);
+
+        for (int a = source.premierArbre; a < source.premierArbre + source.nbArbres; a++){
+            const ArbreHaar &arbre = modele.arbres[a];
+            const NoeudHaar &noeud = modele.noeuds[arbre.premierNoeud];
+            const CaracteristiqueHaar &c = modele.caracteristiques[noeud.caracteristique];
+            // comme OpenCV pour les souches : feuille 0 à gauche, feuille 1 à droite.
+            gaucheExacte[a] = modele.feuilles[arbre.premiereFeuille];
+            droiteExacte[a] = modele.feuilles[arbre.premiereFeuille + 1];
+            gauche[a] = (int32_t)std::lrint(gaucheExacte[a] * unite);
+            droite[a] = (int32_t)std::lrint(droiteExacte[a] * unite);
+            seuils[a] = noeud.seuil;
+            inclinee[a] = c.inclinee;
+            for (int r = 0; r < 3; r++){
+                rectangles[r][a] = r < c.nbRectangles ? c.rect[r] : RectanglePondere();
+                poids[r][a] = r < c.nbRectangles ? c.rect[r].poids : 0.f;
+            }
+        }
+    }
+    pasPrepare = -1;
+    return true;
+#endif
+}
+
+void CascadeVectorisee::preparerDecalages(int pas)
+{
+    size_t nbSouches = seuils.size();
+    for (int r = 0; r < 3; r++){
+        for (int c = 0; c < 4; c++){
+            coinsRect[r][c].resize(nbSouches);
+        }
+        for (size_t s = 0; s < nbSouches; s++){
+            const RectanglePondere &R = rectangles[r][s];
+            if (poids[r][s] == 0.f){
+                coinsRect[r][0][s] = coinsRect[r][1][s] = coinsRect[r][2][s] = coinsRect[r][3][s] = 0;
+            } else if (inclinee[s]){
+                coinsRect[r][0][s] = R.x + pas * R.y;
+                coinsRect[r][1][s] = R.x - R.hauteur + pas * (R.y + R.hauteur);
+                coinsRect[r][2][s] = R.x + R.largeur + pas * (R.y + R.largeur);
+                coinsRect[r][3][s] = R.x + R.largeur - R.hauteur + pas * (R.y + R.largeur + R.hauteur);
+            } else {
+                coinsRect[r][0][s] = R.x + pas * R.y;
+                coinsRect[r][1][s] = R.x + R.largeur + pas * R.y;
+                coinsRect[r][2][s] = R.x + pas * (R.y + R.hauteur);
+                coinsRect[r][3][s] = R.x + R.largeur + pas * (R.y + R.hauteur);
+            }
+        }
+    }
+    int l = largeur - 2, h = hauteur - 2;
+    coinsNormalisation[0] = 1 + pas;
+    coinsNormalisation[1] = 1 + l + pas;
+    coinsNormalisation[2] = 1 + pas * (1 + h);
+    coinsNormalisation[3] = 1 + l + pas * (1 + h);
+    pasPrepare = pas;
+}
+
+#define SOMME_COINS(p, c0, c1, c2, c3) ((p)[c0] - (p)[c1] - (p)[c2] + (p)[c3])
+
+/*
+ * Somme d'un étage pour une fenêtre, calculée exactement comme OpenCV (caractéristiques en float, somme en double).
+ */
+double CascadeVectorisee::sommeEtageExacte(const EtageVectorise &etage, const int32_t *somme, const int32_t *incl, float normalisation) const
+{
+    double total = 0;
+    for (int s = etage.premiere; s < etage.premiere + etage.nombre; s++){
+        const int32_t *p = inclinee[s] ? incl : somme;
+        float valeur = poids[0][s] * SOMME_COINS(p, coinsRect[0][0][s], coinsRect[0][1][s], coinsRect[0][2][s], coinsRect[0][3][s])
+                + poids[1][s] * SOMME_COINS(p, coinsRect[1][0][s], coinsRect[1][1][s], coinsRect[1][2][s], coinsRect[1][3][s]);
+        if (poids[2][s] != 0.f){
+            valeur += poids[2][s] * SOMME_COINS(p, coinsRect[2][0][s], coinsRect[2][1][s], coinsRect[2][2][s], coinsRect[2][3][s]);
+        }
+        total += valeur * normalisation < seuils[s] ? gaucheExacte[s] : droiteExacte[s];
+    }
+    return total;
+}
+
+void CascadeVectorisee::evaluerGroupe(const ImageIntegrale &integrale, int x, int y, int pas, int resultats[VOIES])
+{
+#if defined(NOYAUX_NEON) || defined(NOYAUX_SSE2)
+    size_t decalage = (size_t)y * integrale.pas + x;
+    const int32_t *somme = integrale.somme.data() + decalage;
+    const int32_t *carres = (const int32_t *)integrale.carres.data() + decalage; // mêmes bits : seules les différences comptent
+    const int32_t *incl = integrale.inclinee.empty() ? somme : integrale.inclinee.data() + decalage;
+
+    // Normalisation : sommes vectorisées, racine voie par voie (en double, comme OpenCV).
+    int32_t valSomme[VOIES], valCarres[VOIES];
+    ranger(valSomme, sommeRectangle(somme, coinsNormalisation[0], coinsNormalisation[1], coinsNormalisation[2], coinsNormalisation[3], pas));
+    ranger(valCarres, sommeRectangle(carres, coinsNormalisation[0], coinsNormalisation[1], coinsNormalisation[2], coinsNormalisation[3], pas));
+
+    float normalisations[VOIES];
+    bool vivante[VOIES];
+    int nbVivantes = 0;
+    for (int v = 0; v < VOIES; v++){
+        double n = aireNormalisation * (uint32_t)valCarres[v] - (double)valSomme[v] * valSomme[v];
+        normalisations[v] = 1.f;
+        vivante[v] = false;
+        resultats[v] = -1;
+        if (n > 0.){
+            normalisations[v] = (float)(1. / std::sqrt(n));
+            if (aireNormalisation * normalisations[v] < 1e-1){
+                vivante[v] = true;
+                nbVivantes++;
+            }
+        }
+    }
+    if (nbVivantes == 0){
+        return;
+    }
+    VecteurFlottant normalisation = chargerFlottants(normalisations);
+
+    const float *poids0 = poids[0].data(), *poids1 = poids[1].data(), *poids2 = poids[2].data();
+    const float *seuil = seuils.data();
+    const int32_t *g = gauche.data(), *d = droite.data();
+    const uint8_t *estInclinee = inclinee.data();
+
+    for (size_t e = 0; e < etages.size(); e++){
+        const EtageVectorise &etage = etages[e];
+        VecteurEntier total = zero();
+        for (int s = etage.premiere; s < etage.premiere + etage.nombre; s++){
+            const int32_t *p = estInclinee[s] ? incl : somme;
+            VecteurFlottant valeur = ajouter(
+                        multiplier(diffuser(poids0[s]), versFlottant(sommeRectangle(p, coinsRect[0][0][s], coinsRect[0][1][s], coinsRect[0][2][s], coinsRect[0][3][s], pas))),
+                        multiplier(diffuser(poids1[s]), versFlottant(sommeRectangle(p, coinsRect[1][0][s], coinsRect[1][1][s], coinsRect[1][2][s], coinsRect[1][3][s], pas))));
+            if (poids2[s] != 0.f){
+                valeur = ajouter(valeur, multiplier(diffuser(poids2[s]),
+                                                    versFlottant(sommeRectangle(p, coinsRect[2][0][s], coinsRect[2][1][s], coinsRect[2][2][s], coinsRect[2][3][s], pas))));
+            }
+            total = additionner(total, choisir(multiplier(valeur, normalisation), diffuser(seuil[s]), g[s], d[s]));
+        }
+
+        int32_t sommes[VOIES];
+        ranger(sommes, total);
+        for (int v = 0; v < VOIES; v++){
+            if (!vivante[v]){
+                continue;
+            }
+            int32_t ecart = sommes[v] - etage.seuil;
+            bool rejetee = ecart < -etage.tolerance;
+            if (ecart >= -etage.tolerance && ecart <= etage.tolerance){ // trop près du seuil : calcul exact.
+                nbRecalculs++;
+                rejetee = sommeEtageExacte(etage, somme + v * pas, incl + v * pas, normalisations[v]) < etage.seuilExact;
+            }
+            if (rejetee){
+                vivante[v] = false;
+                resultats[v] = -(int)e;
+                nbVivantes--;
+            }
+        }
+        if (nbVivantes == 0){ // les quatre fenêtres sont rejetées : on n'évalue pas les étages suivants.
+            return;
+        }
+    }
+    for (int v = 0; v < VOIES; v++){
+        if (vivante[v]){
+            resultats[v] = 1;
+        }
+    }
+#else
+    (void)integrale; (void)x; (void)y; (void)pas;
+    for (int v = 0; v < VOIES; v++){
+        resultats[v] = -1;
+    }
+#endif
+}
+
+void CascadeVectorisee::evaluerLigne(const ImageIntegrale &integrale, int x0, int x1, int y, int pas, int *resultats)
+{
+    if (integrale.pas != pasPrepare){
+        preparerDecalages(integrale.pas);
+    }
+    int n = 0;
+    for (int x = x0; x <= x1; x += VOIES * pas){
+        int groupe[VOIES];
+        evaluerGroupe(integrale, x, y, pas, groupe); // les voies au delà de x1 lisent la marge des intégrales.
+        for (int v = 0; v < VOIES && x + v * pas <= x1; v++){
+            resultats[n++] = groupe[v];
+        }
+    }
+    nbFenetres += n;
+}
+
+void CascadeVectorisee::parcourir(const ImageIntegrale &integrale, int x0, int y0, int x1, int y1, int pas, std::vector<int> &positions)
+{
+    std::vector<int> resultats((x1 - x0) / pas + 1);
+    for (int y = y0; y <= y1; y += pas){
+        evaluerLigne(integrale, x0, x1, y, pas, resultats.data());
+        for (size_t i = 0; i < resultats.size(); i++){
+            if (resultats[i] > 0){
+                positions.push_back(x0 + (int)i * pas);
+                positions.push_back(y);
+            }
+            if (resultats[i] == 0){ // la fenêtre suivante n'aurait pas été évaluée par detectMultiScale.
+                i++;
+            }
+        }
+    }
+}
+
+bool verifierCascadeVectorisee(const ModeleCascade &modele)
+{
+    CascadeVectorisee vectorisee;
+    if (!vectorisee.preparer(modele)){
+        return false;
+    }
+    EvaluateurCascade reference(modele);
+
+    // Mire : dégradés et motifs qui font passer des fenêtres à des étages variés, largeur qui ne tombe pas juste sur les groupes.
+    const int largeur = 3 * modele.largeur + 7, hauteur = 2 * modele.hauteur + 5;
+    std::vector<uint8_t> mire((size_t)largeur * hauteur);
+    for (int y = 0; y < hauteur; y++){
+        for (int x = 0; x < largeur; x++){
+            mire[(size_t)y * largeur + x] = (uint8_t)((x * 7 + y * 3) ^ (x * y >> 3) ^ ((x / 5 + y / 3) & 1 ? 0x5a : 0));
+        }
+    }
+    ImageIntegrale integrale;
+    calculerIntegrales(mire.data(), largeur, hauteur, largeur, modele.avecInclinees, integrale);
+
+    int x1 = largeur - modele.largeur, y1 = hauteur - modele.hauteur;
+    std::vector<int> resultats(x1 + 1);
+    for (int pas = 1; pas <= 2; pas++){
+        for (int y = 0; y <= y1; y++){
+            int n = x1 / pas + 1;
+            vectorisee.evaluerLigne(integrale, 0, x1, y, pas, resultats.data());
+            for (int i = 0; i < n; i++){
+                if (resultats[i] != reference.evaluer(integrale, i * pas, y)){
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,90 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Evaluation vectorisée des cascades de souches (haarcascade_frontalface_default, haarcascade_smile...) :
+ * quatre fenêtres voisines d'une ligne sont évaluées ensemble, une par voie NEON / SSE2.
+ *
+ *  - Les souches sont rangées en colonnes (décalages des coins, poids, seuil, feuilles) : une étape parcourt
+ *    des tableaux contigus au lieu de suivre noeuds, caractéristiques et rectangles.
+ *  - Les sommes des rectangles sont entières ; la valeur de la caractéristique suit ensuite exactement les
+ *    opérations float d'OpenCV, la comparaison au seuil est donc identique.
+ *  - Les feuilles sont en virgule fixe (entiers 32 bits) : la somme d'un étage est exacte à la quantification près.
+ *    Quand elle tombe trop près du seuil de l'étage pour trancher, l'étage de cette fenêtre est recalculé
+ *    comme dans OpenCV (somme en double), si bien que les décisions sont les mêmes.
+ *  - Les fenêtres rejetées sont masquées, et le groupe s'arrête dès que ses quatre fenêtres sont rejetées
+ *    (en pratique dans les deux premiers étages pour la plupart des groupes).
+ *
+ * Les cascades à arbres (yeux "2splits") restent sur EvaluateurCascade.
+ */
+#ifndef NOYAUXCASCADE_H
+#define NOYAUXCASCADE_H
+
+#include "evaluateurcascade.h"
+
+#include <stdint.h>
+#include <vector>
+
+class CascadeVectorisee
+{
+public:
+    CascadeVectorisee();
+
+    /*
+     * Range le modèle en colonnes. Retourne false si la cascade ne s'y prête pas (arbres, poids trop grands)
+     * ou si le processeur n'a pas d'instructions vectorielles : il faut alors utiliser EvaluateurCascade.
+     */
+    bool preparer(const ModeleCascade &modele);
+
+    /*
+     * Résultats (mêmes codes que EvaluateurCascade::evaluer) des fenêtres x0, x0+pas, ... jusqu'à x1 inclus de la ligne y.
+     */
+    void evaluerLigne(const ImageIntegrale &integrale, int x0, int x1, int y, int pas, int *resultats);
+
+    /*
+     * Même parcours que EvaluateurCascade::parcourir (saut de la fenêtre suivante après un rejet au premier étage).
+     */
+    void parcourir(const ImageIntegrale &integrale, int x0, int y0, int x1, int y1, int pas, std::vector<int> &positions);
+
+    uint64_t fenetresEvaluees() const { return nbFenetres; }
+    // Etages recalculés en double parce que la somme en virgule fixe était trop proche du seuil.
+    uint64_t etagesRecalcules() const { return nbRecalculs; }
+
+private:
+    struct EtageVectorise {
+        int premiere, nombre;  // souches de l'étage
+        int32_t seuil;         // en virgule fixe
+        int32_t tolerance;     // erreur maximum de quantification de la somme de l'étage
+        float seuilExact;
+    };
+
+    void preparerDecalages(int pas);
+    void evaluerGroupe(const ImageIntegrale &integrale, int x, int y, int pas, int resultats[4]);
+    double sommeEtageExacte(const EtageVectorise &etage, const int32_t *somme, const int32_t *inclinee, float normalisation) const;
+
+    int largeur, hauteur;
+    double aireNormalisation;
+    int coinsNormalisation[4];
+
+    // Souches en colonnes : rectangle r, coin c de la souche s dans coinsRect[r][c][s].
+    std::vector<int32_t> coinsRect[3][4];
+    std::vector<float> poids[3];
+    std::vector<uint8_t> inclinee;
+    std::vector<float> seuils;
+    std::vector<int32_t> gauche, droite;           // feuilles en virgule fixe
+    std::vector<float> gaucheExacte, droiteExacte; // feuilles d'origine
+    std::vector<EtageVectorise> etages;
+    // rectangles non décalés (x, y, largeur, hauteur), pour recalculer les coins quand le pas de l'intégrale change.
+    std::vector<RectanglePondere> rectangles[3];
+    int pasPrepare;
+
+    uint64_t nbFenetres;
+    uint64_t nbRecalculs;
+};
+
+/*
+ * Compare, fenêtre par fenêtre, l'évaluation vectorisée et EvaluateurCascade sur une mire.
+ */
+bool verifierCascadeVectorisee(const ModeleCascade &modele);
+
+#endif // NOYAUXCASCADE_H
@@ -0,0 +1,118 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Noyaux demi-précision de l'index des identités.
+ * Version NEON sur la raspi, SSE2 sur PC, scalaire sinon.
+ */
+#include "noyauxidentites.h"
+
+#include <cstring>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define NOYAUX_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define NOYAUX_SSE2
+#endif
+
+const char *jeuInstructionsDemi()
+{
+#if defined(NOYAUX_NEON)
+    return "NEON";
+#elif defined(NOYAUX_SSE2)
+    return "SSE2";
+#else
+    return "scalaire";
+#endif
+}
+
+uint16_t versDemi(float v)
+{
+    uint32_t f;
+    memcpy(&f, &v, sizeof(f));
+    uint16_t signe = (f >> 16) & 0x8000;
+    int exposant = (int)((f >> 23) & 0xff) - 127 + 15;
+    uint32_t mantisse = f & 0x7fffff;
+    if (exposant <= 0)
+        return signe;
+    if (exposant >= 31)
+        return signe | 0x7bff;
+    uint32_t h = (exposant << 10) | (mantisse >> 13);
+    h += (mantisse >> 12) & 1; // arrondi : la retenue passe dans l'exposant si besoin.
+    return signe | (uint16_t)(h > 0x7bff ? 0x7bff : h);
+}
+
+/*
+ * Nombre normal : exposant rebiaisé de 15 à 127 (+112 << 23), mantisse décalée de 13 bits. Exposant nul : zéro.
+ */
+float depuisDemi(uint16_t h)
+{
+    uint32_t f = (h & 0x7c00) == 0 ? 0 : (((uint32_t)(h & 0x7fff) << 13) + (112u << 23));
+    f |= (uint32_t)(h & 0x8000) << 16;
+    float v;
+    memcpy(&v, &f, sizeof(v));
+    return v;
+}
+
+float produitScalaireDemiReference(const uint16_t *a, const float *b, int n)
+{
+    float somme = 0;
+    for (int i = 0; i < n; i++)
+        somme += depuisDemi(a[i]) * b[i];
+    return somme;
+}
+
+#if defined(NOYAUX_NEON)
+static inline float32x4_t demiVersFloatNeon(uint16x4_t h)
+{
+    uint32x4_t x = vmovl_u16(h);
+    uint32x4_t f = vaddq_u32(vshlq_n_u32(vandq_u32(x, vdupq_n_u32(0x7fff)), 13), vdupq_n_u32(112u << 23));
+    uint32x4_t nul = vceqq_u32(vandq_u32(x, vdupq_n_u32(0x7c00)), vdupq_n_u32(0));
+    f = vorrq_u32(vbicq_u32(f, nul), vshlq_n_u32(vandq_u32(x, vdupq_n_u32(0x8000)), 16));
+    return vreinterpretq_f32_u32(f);
+}
+#elif defined(NOYAUX_SSE2)
+static inline __m128 demiVersFloatSse2(__m128i x)
+{
+    __m128i f = _mm_add_epi32(_mm_slli_epi32(_mm_and_si128(x, _mm_set1_epi32(0x7fff)), 13), _mm_set1_epi32(112 << 23));
+    __m128i nul = _mm_cmpeq_epi32(_mm_and_si128(x, _mm_set1_epi32(0x7c00)), _mm_setzero_si128());
+    f = _mm_or_si128(_mm_andnot_si128(nul, f), _mm_slli_epi32(_mm_and_si128(x, _mm_set1_epi32(0x8000)), 16));
+    return _mm_castsi128_ps(f);
+}
+#endif
+
+float produitScalaireDemi(const uint16_t *a, const float *b, int n)
+{
+    int i = 0;
+    float somme = 0;
+
+#if defined(NOYAUX_NEON)
+    // 8 valeurs par tour : deux conversions de 4 et deux multiplications-additions, dans deux accumulateurs.
+    float32x4_t acc0 = vdupq_n_f32(0), acc1 = vdupq_n_f32(0);
+    for (; i + 8 <= n; i += 8) {
+        uint16x8_t h = vld1q_u16(a + i);
+        acc0 = vmlaq_f32(acc0, demiVersFloatNeon(vget_low_u16(h)), vld1q_f32(b + i));
+        acc1 = vmlaq_f32(acc1, demiVersFloatNeon(vget_high_u16(h)), vld1q_f32(b + i + 4));
+    }
+    float32x4_t acc = vaddq_f32(acc0, acc1);
+    float32x2_t s = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+    s = vpadd_f32(s, s);
+    somme = vget_lane_f32(s, 0);
+#elif defined(NOYAUX_SSE2)
+    // extension 16 -> 32 bits par entrelacement avec des zéros, puis même conversion que la version scalaire.
+    __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+    for (; i + 8 <= n; i += 8) {
+        __m128i h = _mm_loadu_si128((const __m128i *)(a + i));
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(demiVersFloatSse2(_mm_unpacklo_epi16(h, _mm_setzero_si128())), _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(demiVersFloatSse2(_mm_unpackhi_epi16(h, _mm_setzero_si128())), _mm_loadu_ps(b + i + 4)));
+    }
+    __m128 acc = _mm_add_ps(acc0, acc1);
+    acc = _mm_add_ps(acc, _mm_shuffle_ps(acc, acc, _MM_SHUFFLE(1, 0, 3, 2)));
+    acc = _mm_add_ps(acc, _mm_shuffle_ps(acc, acc, _MM_SHUFFLE(2, 3, 0, 1)));
+    somme = _mm_cvtss_f32(acc);
+#endif
+
+    return somme + produitScalaireDemiReference(a + i, b + i, n - i);
+}
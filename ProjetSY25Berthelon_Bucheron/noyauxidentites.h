@@ -0,0 +1,34 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Noyaux de l'index des identités (indexidentites.h) pour les descripteurs stockés en demi-précision (float16).
+ * Les descripteurs int8 passent par produitScalaireInt8() (noyauxint8.h).
+ *
+ * La conversion float16 -> float32 se fait par manipulation de bits sur des entiers (NEON ou SSE2), sans extension
+ * matérielle : les sous-normaux (< 6.1e-5) sont ramenés à zéro, ce qui ne change rien pour des descripteurs de norme 1.
+ * Comme pour noyauxint8.h, chaque noyau a une version scalaire de référence ; les sommes flottantes ne sont pas faites
+ * dans le même ordre, les résultats sont donc égaux aux arrondis près.
+ */
+#ifndef NOYAUXIDENTITES_H
+#define NOYAUXIDENTITES_H
+
+#include <stdint.h>
+
+/*
+ * Retourne le jeu d'instructions utilisé par les noyaux vectorisés ("NEON", "SSE2" ou "scalaire").
+ */
+const char *jeuInstructionsDemi();
+
+// Conversions float32 <-> float16 (arrondi au plus proche, sous-normaux ramenés à zéro, saturation à 65504).
+uint16_t versDemi(float v);
+float depuisDemi(uint16_t h);
+
+/*
+ * Produit scalaire d'un vecteur float16 "a" et d'un vecteur float32 "b" de longueur n (multiple de 8 pour la version
+ * vectorisée, la queue est traitée en scalaire).
+ */
+float produitScalaireDemi(const uint16_t *a, const float *b, int n);
+float produitScalaireDemiReference(const uint16_t *a, const float *b, int n);
+
+#endif // NOYAUXIDENTITES_H
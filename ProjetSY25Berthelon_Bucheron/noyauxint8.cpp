@@ -0,0 +1,157 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Noyaux de calcul entiers 8 bits utilisés par le classifieur d'expression.
+ * Version NEON sur la raspi, SSE2 (ou AVX2 si le compilateur l'active) sur PC, scalaire sinon.
+ */
+#include "noyauxint8.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define NOYAUX_NEON
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define NOYAUX_AVX2
+#define NOYAUX_SSE2
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define NOYAUX_SSE2
+#endif
+
+const char *jeuInstructionsInt8()
+{
+#if defined(NOYAUX_NEON)
+    return "NEON";
+#elif defined(NOYAUX_AVX2)
+    return "AVX2";
+#elif defined(NOYAUX_SSE2)
+    return "SSE2";
+#else
+    return "scalaire";
+#endif
+}
+
+/*
+ * Produit scalaire de référence (et traitement de la queue pour les versions vectorisées).
+ */
+int32_t produitScalaireInt8Reference(const int8_t *a, const int8_t *b, int n)
+{
+    int32_t somme = 0;
+    for (int i = 0; i < n; i++)
+        somme += (int32_t)a[i] * (int32_t)b[i];
+    return somme;
+}
+
+int32_t produitScalaireInt8(const int8_t *a, const int8_t *b, int n)
+{
+    int i = 0;
+    int32_t somme = 0;
+
+#if defined(NOYAUX_NEON)
+    // 16 produits 8x8 -> 16 bits (vmull), puis additions par paires dans les accumulateurs 32 bits (vpadal).
+    int32x4_t acc = vdupq_n_s32(0);
+    for (; i + 16 <= n; i += 16) {
+        int8x16_t va = vld1q_s8(a + i);
+        int8x16_t vb = vld1q_s8(b + i);
+        acc = vpadalq_s16(acc, vmull_s8(vget_low_s8(va), vget_low_s8(vb)));
+        acc = vpadalq_s16(acc, vmull_s8(vget_high_s8(va), vget_high_s8(vb)));
+    }
+    int32x2_t s = vadd_s32(vget_low_s32(acc), vget_high_s32(acc));
+    s = vpadd_s32(s, s);
+    somme = vget_lane_s32(s, 0);
+#elif defined(NOYAUX_AVX2)
+    // Extension de signe 8 -> 16 bits puis madd (produits et somme par paires sur 32 bits).
+    __m256i acc = _mm256_setzero_si256();
+    for (; i + 16 <= n; i += 16) {
+        __m256i va = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)(a + i)));
+        __m256i vb = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)(b + i)));
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(va, vb));
+    }
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+    somme = _mm_cvtsi128_si32(s);
+#elif defined(NOYAUX_SSE2)
+    // SSE2 n'a pas d'extension de signe 8 -> 16 bits : on duplique l'octet puis décalage arithmétique de 8.
+    __m128i acc = _mm_setzero_si128();
+    for (; i + 16 <= n; i += 16) {
+        __m128i va = _mm_loadu_si128((const __m128i *)(a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i *)(b + i));
+        __m128i aBas = _mm_srai_epi16(_mm_unpacklo_epi8(va, va), 8);
+        __m128i aHaut = _mm_srai_epi16(_mm_unpackhi_epi8(va, va), 8);
+        __m128i bBas = _mm_srai_epi16(_mm_unpacklo_epi8(vb, vb), 8);
+        __m128i bHaut = _mm_srai_epi16(_mm_unpackhi_epi8(vb, vb), 8);
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(aBas, bBas));
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(aHaut, bHaut));
+    }
+    __m128i s = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+    somme = _mm_cvtsi128_si32(s);
+#endif
+
+    return somme + produitScalaireInt8Reference(a + i, b + i, n - i);
+}
+
+/*
+ * Max pooling 2x2 de référence.
+ */
+void maxPool2x2Int8Reference(const int8_t *entree, int8_t *sortie, int largeur, int hauteur, int canaux)
+{
+    int largeurSortie = largeur / 2;
+    int hauteurSortie = hauteur / 2;
+    int pasLigne = largeur * canaux;
+
+    for (int y = 0; y < hauteurSortie; y++) {
+        for (int x = 0; x < largeurSortie; x++) {
+            const int8_t *p = entree + (2 * y) * pasLigne + (2 * x) * canaux;
+            int8_t *q = sortie + (y * largeurSortie + x) * canaux;
+            for (int c = 0; c < canaux; c++) {
+                int8_t m = p[c];
+                if (p[canaux + c] > m) m = p[canaux + c];
+                if (p[pasLigne + c] > m) m = p[pasLigne + c];
+                if (p[pasLigne + canaux + c] > m) m = p[pasLigne + canaux + c];
+                q[c] = m;
+            }
+        }
+    }
+}
+
+void maxPool2x2Int8(const int8_t *entree, int8_t *sortie, int largeur, int hauteur, int canaux)
+{
+#if defined(NOYAUX_NEON) || defined(NOYAUX_SSE2)
+    if (canaux % 16 != 0) {
+        maxPool2x2Int8Reference(entree, sortie, largeur, hauteur, canaux);
+        return;
+    }
+
+    int largeurSortie = largeur / 2;
+    int hauteurSortie = hauteur / 2;
+    int pasLigne = largeur * canaux;
+
+    for (int y = 0; y < hauteurSortie; y++) {
+        for (int x = 0; x < largeurSortie; x++) {
+            const int8_t *p = entree + (2 * y) * pasLigne + (2 * x) * canaux;
+            int8_t *q = sortie + (y * largeurSortie + x) * canaux;
+            for (int c = 0; c < canaux; c += 16) {
+#if defined(NOYAUX_NEON)
+                int8x16_t m = vmaxq_s8(vld1q_s8(p + c), vld1q_s8(p + canaux + c));
+                m = vmaxq_s8(m, vld1q_s8(p + pasLigne + c));
+                m = vmaxq_s8(m, vld1q_s8(p + pasLigne + canaux + c));
+                vst1q_s8(q + c, m);
+#else
+                // SSE2 n'a que le max non signé : on décale l'intervalle de 128 (xor 0x80) avant et après.
+                const __m128i signe = _mm_set1_epi8((char)0x80);
+                __m128i m = _mm_max_epu8(_mm_xor_si128(_mm_loadu_si128((const __m128i *)(p + c)), signe),
+                                         _mm_xor_si128(_mm_loadu_si128((const __m128i *)(p + canaux + c)), signe));
+                m = _mm_max_epu8(m, _mm_xor_si128(_mm_loadu_si128((const __m128i *)(p + pasLigne + c)), signe));
+                m = _mm_max_epu8(m, _mm_xor_si128(_mm_loadu_si128((const __m128i *)(p + pasLigne + canaux + c)), signe));
+                _mm_storeu_si128((__m128i *)(q + c), _mm_xor_si128(m, signe));
+#endif
+            }
+        }
+    }
+#else
+    maxPool2x2Int8Reference(entree, sortie, largeur, hauteur, canaux);
+#endif
+}
@@ -0,0 +1,61 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Noyaux de calcul entiers 8 bits utilisés par le classifieur d'expression.
+ * Chaque noyau existe en version vectorisée (NEON sur la raspi, SSE2/AVX2 sur PC) et en version
+ * scalaire de référence, qui sert à vérifier que les deux versions donnent exactement le même résultat.
+ */
+#ifndef NOYAUXINT8_H
+#define NOYAUXINT8_H
+
+#include <stdint.h>
+
+/*
+ * Les vecteurs de poids et d'activations sont complétés par des zéros jusqu'à un multiple de ALIGNEMENT_INT8,
+ * ce qui évite de traiter une queue de vecteur dans les boucles vectorisées.
+ */
+#define ALIGNEMENT_INT8 16
+
+inline int longueurAlignee(int n)
+{
+    return (n + ALIGNEMENT_INT8 - 1) / ALIGNEMENT_INT8 * ALIGNEMENT_INT8;
+}
+
+/*
+ * Retourne le jeu d'instructions utilisé par les noyaux vectorisés ("NEON", "AVX2", "SSE2" ou "scalaire").
+ */
+const char *jeuInstructionsInt8();
+
+/*
+ * Produit scalaire de deux vecteurs int8 de longueur n, accumulé sur 32 bits.
+ */
+int32_t produitScalaireInt8(const int8_t *a, const int8_t *b, int n);
+int32_t produitScalaireInt8Reference(const int8_t *a, const int8_t *b, int n);
+
+/*
+ * Max pooling 2x2 (pas de 2) sur une image int8 rangée ligne par ligne, canaux entrelacés (HWC).
+ * La sortie fait largeur/2 x hauteur/2 x canaux.
+ */
+void maxPool2x2Int8(const int8_t *entree, int8_t *sortie, int largeur, int hauteur, int canaux);
+void maxPool2x2Int8Reference(const int8_t *entree, int8_t *sortie, int largeur, int hauteur, int canaux);
+
+/*
+ * Ramène un accumulateur 32 bits dans l'intervalle int8 : (acc * multiplicateur) >> decalage, arrondi au plus proche,
+ * avec un ReLU optionnel.
+ */
+inline int8_t requantifierInt8(int32_t acc, int32_t multiplicateur, int decalage, bool relu)
+{
+    int64_t v = (int64_t)acc * multiplicateur;
+    if (decalage > 0)
+        v = (v + ((int64_t)1 << (decalage - 1))) >> decalage;
+    if (relu && v < 0)
+        v = 0;
+    if (v > 127)
+        v = 127;
+    if (v < -128)
+        v = -128;
+    return (int8_t)v;
+}
+
+#endif // NOYAUXINT8_H
@@ -0,0 +1,255 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Préparation de l'image de détection en une passe : retournement, réduction 2x2 et histogramme.
+ * Version NEON sur la raspi, SSE2 (ou AVX2 si le compilateur l'active) sur PC, scalaire sinon.
+ */
+#include "noyauxpretraitement.h"
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define NOYAUX_NEON
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define NOYAUX_AVX2
+#define NOYAUX_SSE2
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define NOYAUX_SSE2
+#endif
+
+/*
+ * Ligne de la source qui donne la ligne "y" de l'image retournée.
+ */
+static inline const uint8_t *ligneSource(const uint8_t *source, int hauteur, size_t pas, bool retourner, int y)
+{
+    return source + (size_t)(retourner ? hauteur - 1 - y : y) * pas;
+}
+
+/*
+ * Réduction 2x2 de référence : (a + b + c + d + 2) >> 2, l'arrondi de cv::resize en INTER_AREA pour un facteur 2.
+ */
+static inline void reduireLigneReference(const uint8_t *a, const uint8_t *b, uint8_t *sortie, int debut, int fin)
+{
+    for (int x = debut; x < fin; x++)
+        sortie[x] = (uint8_t)((a[2 * x] + a[2 * x + 1] + b[2 * x] + b[2 * x + 1] + 2) >> 2);
+}
+
+void reduireImageReference(const uint8_t *source, int largeur, int hauteur, size_t pasSource, int facteur, bool retourner,
+                           uint8_t *destination, size_t pasDestination, uint32_t histogramme[256])
+{
+    int largeurSortie = largeur / facteur;
+    int hauteurSortie = hauteur / facteur;
+    memset(histogramme, 0, 256 * sizeof(uint32_t));
+
+    for (int y = 0; y < hauteurSortie; y++) {
+        uint8_t *sortie = destination + (size_t)y * pasDestination;
+        if (facteur == 1) {
+            memcpy(sortie, ligneSource(source, hauteur, pasSource, retourner, y), largeurSortie);
+        } else {
+            reduireLigneReference(ligneSource(source, hauteur, pasSource, retourner, 2 * y),
+                                  ligneSource(source, hauteur, pasSource, retourner, 2 * y + 1), sortie, 0, largeurSortie);
+        }
+        for (int x = 0; x < largeurSortie; x++)
+            histogramme[sortie[x]]++;
+    }
+}
+
+/*
+ * Histogramme d'une ligne, sur 4 histogrammes entrelacés : deux pixels égaux qui se suivent
+ * n'incrémentent pas la même case (pas d'attente sur l'écriture précédente).
+ */
+static inline void compterLigne(const uint8_t *ligne, int n, uint32_t histogrammes[4][256])
+{
+    int x = 0;
+    for (; x + 4 <= n; x += 4) {
+        histogrammes[0][ligne[x]]++;
+        histogrammes[1][ligne[x + 1]]++;
+        histogrammes[2][ligne[x + 2]]++;
+        histogrammes[3][ligne[x + 3]]++;
+    }
+    for (; x < n; x++)
+        histogrammes[0][ligne[x]]++;
+}
+
+/*
+ * Réduction 2x2 d'une ligne, vectorisée. Retourne le nombre de pixels de sortie traités (la queue est faite à part).
+ */
+static inline int reduireLigne(const uint8_t *a, const uint8_t *b, uint8_t *sortie, int largeurSortie)
+{
+    int x = 0;
+#if defined(NOYAUX_NEON)
+    // Additions par paires 8 -> 16 bits (vpaddl), somme des deux lignes, puis décalage de 2 avec arrondi (vrshrn).
+    for (; x + 16 <= largeurSortie; x += 16) {
+        uint16x8_t bas = vaddq_u16(vpaddlq_u8(vld1q_u8(a + 2 * x)), vpaddlq_u8(vld1q_u8(b + 2 * x)));
+        uint16x8_t haut = vaddq_u16(vpaddlq_u8(vld1q_u8(a + 2 * x + 16)), vpaddlq_u8(vld1q_u8(b + 2 * x + 16)));
+        vst1q_u8(sortie + x, vcombine_u8(vrshrn_n_u16(bas, 2), vrshrn_n_u16(haut, 2)));
+    }
+#elif defined(NOYAUX_SSE2)
+    // Pixels pairs (masque) et impairs (décalage de 8) sur 16 bits, somme des deux lignes, +2 et >> 2, puis repack.
+    const __m128i masque = _mm_set1_epi16(0x00ff);
+    const __m128i deux = _mm_set1_epi16(2);
+#if defined(NOYAUX_AVX2)
+    const __m256i masque256 = _mm256_set1_epi16(0x00ff);
+    const __m256i deux256 = _mm256_set1_epi16(2);
+    for (; x + 32 <= largeurSortie; x += 32) {
+        __m256i a0 = _mm256_loadu_si256((const __m256i *)(a + 2 * x));
+        __m256i a1 = _mm256_loadu_si256((const __m256i *)(a + 2 * x + 32));
+        __m256i b0 = _mm256_loadu_si256((const __m256i *)(b + 2 * x));
+        __m256i b1 = _mm256_loadu_si256((const __m256i *)(b + 2 * x + 32));
+        __m256i s0 = _mm256_add_epi16(_mm256_add_epi16(_mm256_and_si256(a0, masque256), _mm256_srli_epi16(a0, 8)),
+                                      _mm256_add_epi16(_mm256_and_si256(b0, masque256), _mm256_srli_epi16(b0, 8)));
+        __m256i s1 = _mm256_add_epi16(_mm256_add_epi16(_mm256_and_si256(a1, masque256), _mm256_srli_epi16(a1, 8)),
+                                      _mm256_add_epi16(_mm256_and_si256(b1, masque256), _mm256_srli_epi16(b1, 8)));
+        s0 = _mm256_srli_epi16(_mm256_add_epi16(s0, deux256), 2);
+        s1 = _mm256_srli_epi16(_mm256_add_epi16(s1, deux256), 2);
+        // packus travaille par moitiés de 128 bits : on remet les quatre blocs de 64 bits dans l'ordre.
+        _mm256_storeu_si256((__m256i *)(sortie + x), _mm256_permute4x64_epi64(_mm256_packus_epi16(s0, s1), 0xd8));
+    }
+#endif
+    for (; x + 16 <= largeurSortie; x += 16) {
+        __m128i a0 = _mm_loadu_si128((const __m128i *)(a + 2 * x));
+        __m128i a1 = _mm_loadu_si128((const __m128i *)(a + 2 * x + 16));
+        __m128i b0 = _mm_loadu_si128((const __m128i *)(b + 2 * x));
+        __m128i b1 = _mm_loadu_si128((const __m128i *)(b + 2 * x + 16));
+        __m128i s0 = _mm_add_epi16(_mm_add_epi16(_mm_and_si128(a0, masque), _mm_srli_epi16(a0, 8)),
+                                   _mm_add_epi16(_mm_and_si128(b0, masque), _mm_srli_epi16(b0, 8)));
+        __m128i s1 = _mm_add_epi16(_mm_add_epi16(_mm_and_si128(a1, masque), _mm_srli_epi16(a1, 8)),
+                                   _mm_add_epi16(_mm_and_si128(b1, masque), _mm_srli_epi16(b1, 8)));
+        s0 = _mm_srli_epi16(_mm_add_epi16(s0, deux), 2);
+        s1 = _mm_srli_epi16(_mm_add_epi16(s1, deux), 2);
+        _mm_storeu_si128((__m128i *)(sortie + x), _mm_packus_epi16(s0, s1));
+    }
+#else
+    (void)a;
+    (void)b;
+    (void)sortie;
+    (void)largeurSortie;
+#endif
+    return x;
+}
+
+void reduireImage(const uint8_t *source, int largeur, int hauteur, size_t pasSource, int facteur, bool retourner,
+                  uint8_t *destination, size_t pasDestination, uint32_t histogramme[256])
+{
+    int largeurSortie = largeur / facteur;
+    int hauteurSortie = hauteur / facteur;
+
+    uint32_t histogrammes[4][256];
+    memset(histogrammes, 0, sizeof(histogrammes));
+
+    for (int y = 0; y < hauteurSortie; y++) {
+        uint8_t *sortie = destination + (size_t)y * pasDestination;
+        if (facteur == 1) {
+            memcpy(sortie, ligneSource(source, hauteur, pasSource, retourner, y), largeurSortie);
+        } else {
+            const uint8_t *a = ligneSource(source, hauteur, pasSource, retourner, 2 * y);
+            const uint8_t *b = ligneSource(source, hauteur, pasSource, retourner, 2 * y + 1);
+            int x = reduireLigne(a, b, sortie, largeurSortie);
+            reduireLigneReference(a, b, sortie, x, largeurSortie);
+        }
+        // La ligne qui vient d'être écrite est encore dans le cache : l'histogramme ne relit pas la mémoire.
+        compterLigne(sortie, largeurSortie, histogrammes);
+    }
+
+    for (int i = 0; i < 256; i++)
+        histogramme[i] = histogrammes[0][i] + histogrammes[1][i] + histogrammes[2][i] + histogrammes[3][i];
+}
+
+/*
+ * Même calcul que cv::equalizeHist : histogramme cumulé (sans la première valeur présente) ramené sur 0-255.
+ */
+void tableEgalisation(const uint32_t histogramme[256], uint8_t table[256])
+{
+    memset(table, 0, 256);
+
+    uint64_t total = 0;
+    for (int i = 0; i < 256; i++)
+        total += histogramme[i];
+    if (total == 0)
+        return;
+
+    int i = 0;
+    while (histogramme[i] == 0)
+        i++;
+
+    if (histogramme[i] == total) { // image uniforme : equalizeHist la remplit avec sa seule valeur.
+        memset(table, i, 256);
+        return;
+    }
+
+    float echelle = 255.f / (float)(total - histogramme[i]);
+    uint64_t somme = 0;
+    for (i++; i < 256; i++) {
+        somme += histogramme[i];
+        long v = lrintf((float)somme * echelle); // arrondi de saturate_cast (au pair le plus proche).
+        table[i] = (uint8_t)(v > 255 ? 255 : (v < 0 ? 0 : v));
+    }
+}
+
+void appliquerTable(uint8_t *image, int largeur, int hauteur, size_t pas, const uint8_t table[256])
+{
+    for (int y = 0; y < hauteur; y++) {
+        uint8_t *ligne = image + (size_t)y * pas;
+        for (int x = 0; x < largeur; x++)
+            ligne[x] = table[ligne[x]];
+    }
+}
+
+void pretraiterImage(const uint8_t *source, int largeur, int hauteur, size_t pasSource, int facteur, bool retourner,
+                     uint8_t *destination, size_t pasDestination, uint32_t histogramme[256])
+{
+    uint8_t table[256];
+    reduireImage(source, largeur, hauteur, pasSource, facteur, retourner, destination, pasDestination, histogramme);
+    tableEgalisation(histogramme, table);
+    appliquerTable(destination, largeur / facteur, hauteur / facteur, pasDestination, table);
+}
+
+void pretraiterImageReference(const uint8_t *source, int largeur, int hauteur, size_t pasSource, int facteur, bool retourner,
+                              uint8_t *destination, size_t pasDestination, uint32_t histogramme[256])
+{
+    uint8_t table[256];
+    reduireImageReference(source, largeur, hauteur, pasSource, facteur, retourner, destination, pasDestination, histogramme);
+    tableEgalisation(histogramme, table);
+    appliquerTable(destination, largeur / facteur, hauteur / facteur, pasDestination, table);
+}
+
+bool verifierPretraitement()
+{
+    // Tailles paires, impaires, et largeurs qui ne tombent pas juste sur les vecteurs (queues traitées à part).
+    const int tailles[][2] = { { 640, 480 }, { 129, 67 }, { 66, 33 }, { 31, 5 } };
+
+    for (size_t t = 0; t < sizeof(tailles) / sizeof(tailles[0]); t++) {
+        int largeur = tailles[t][0];
+        int hauteur = tailles[t][1];
+        size_t pas = (largeur + 31) & ~31; // même alignement que le plan Y de la raspicam.
+
+        std::vector<uint8_t> mire(pas * hauteur);
+        for (size_t i = 0; i < mire.size(); i++)
+            mire[i] = (uint8_t)(i * 97 + (i >> 7) * 13 + (i >> 11));
+
+        for (int facteur = 1; facteur <= 2; facteur++) {
+            for (int retourner = 0; retourner <= 1; retourner++) {
+                size_t pasSortie = largeur / facteur + 3;
+                std::vector<uint8_t> attendu(pasSortie * (hauteur / facteur), 0);
+                std::vector<uint8_t> obtenu(attendu.size(), 0);
+                uint32_t histogrammeAttendu[256];
+                uint32_t histogrammeObtenu[256];
+
+                reduireImageReference(mire.data(), largeur, hauteur, pas, facteur, retourner != 0,
+                                      attendu.data(), pasSortie, histogrammeAttendu);
+                reduireImage(mire.data(), largeur, hauteur, pas, facteur, retourner != 0,
+                             obtenu.data(), pasSortie, histogrammeObtenu);
+
+                if (attendu != obtenu || memcmp(histogrammeAttendu, histogrammeObtenu, sizeof(histogrammeAttendu)) != 0)
+                    return false;
+            }
+        }
+    }
+    return true;
+}
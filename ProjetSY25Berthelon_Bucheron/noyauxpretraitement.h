@@ -0,0 +1,50 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Préparation de l'image donnée à la cascade de visage : retournement vertical (optionnel), réduction d'un facteur 2
+ * (moyenne des blocs 2x2, comme cv::resize en INTER_AREA) et égalisation d'histogramme (comme cv::equalizeHist).
+ *
+ * L'image de la caméra n'est lue qu'une fois : le noyau écrit l'image réduite et retournée et compte son histogramme
+ * dans la même passe. L'égalisation n'est ensuite qu'une table de correspondance appliquée à la petite image.
+ * Comme les noyaux int8, il existe une version vectorisée (NEON, SSE2/AVX2) et une version scalaire de référence.
+ */
+#ifndef NOYAUXPRETRAITEMENT_H
+#define NOYAUXPRETRAITEMENT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Réduit (facteur 1 ou 2) et retourne verticalement l'image source, et compte l'histogramme du résultat.
+ * La destination fait largeur/facteur x hauteur/facteur (une colonne ou une ligne impaire est ignorée).
+ */
+void reduireImage(const uint8_t *source, int largeur, int hauteur, size_t pasSource, int facteur, bool retourner,
+                  uint8_t *destination, size_t pasDestination, uint32_t histogramme[256]);
+void reduireImageReference(const uint8_t *source, int largeur, int hauteur, size_t pasSource, int facteur, bool retourner,
+                           uint8_t *destination, size_t pasDestination, uint32_t histogramme[256]);
+
+/*
+ * Table d'égalisation calculée à partir de l'histogramme, identique à celle de cv::equalizeHist.
+ */
+void tableEgalisation(const uint32_t histogramme[256], uint8_t table[256]);
+
+/*
+ * Applique la table à l'image, en place.
+ */
+void appliquerTable(uint8_t *image, int largeur, int hauteur, size_t pas, const uint8_t table[256]);
+
+/*
+ * Les trois étapes à la suite : image réduite, retournée et égalisée, et son histogramme (avant égalisation).
+ */
+void pretraiterImage(const uint8_t *source, int largeur, int hauteur, size_t pasSource, int facteur, bool retourner,
+                     uint8_t *destination, size_t pasDestination, uint32_t histogramme[256]);
+void pretraiterImageReference(const uint8_t *source, int largeur, int hauteur, size_t pasSource, int facteur, bool retourner,
+                              uint8_t *destination, size_t pasDestination, uint32_t histogramme[256]);
+
+/*
+ * Compare les versions vectorisée et de référence sur une mire (tailles et décalages variés).
+ */
+bool verifierPretraitement();
+
+#endif // NOYAUXPRETRAITEMENT_H
@@ -0,0 +1,201 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Paramètres de l'application, lus au lancement dans un fichier ini (QSettings).
+ */
+#include "parametres.h"
+
+#include <QFile>
+#include <QSettings>
+
+/*
+ * Clés du groupe [detection], communes à ProjetSY25.ini et au fichier écrit par ReglageDetection.
+ */
+void Parametres::chargerDetection(QSettings &fichier)
+{
+    cascadeInterne = fichier.value("cascadeInterne", cascadeInterne).toBool();
+    echelleDetection = fichier.value("echelle", echelleDetection).toDouble();
+    facteurVisage = fichier.value("facteur", facteurVisage).toDouble();
+    voisinsVisage = fichier.value("voisins", voisinsVisage).toInt();
+    tailleMinVisage = fichier.value("tailleMin", tailleMinVisage).toInt();
+    tailleMaxVisage = fichier.value("tailleMax", tailleMaxVisage).toInt();
+    facteurSourire = fichier.value("facteurSourire", facteurSourire).toDouble();
+    voisinsSourire = fichier.value("voisinsSourire", voisinsSourire).toInt();
+    facteurYeux = fichier.value("facteurYeux", facteurYeux).toDouble();
+    voisinsYeux = fichier.value("voisinsYeux", voisinsYeux).toInt();
+    periodeExpression = fichier.value("periodeExpression", periodeExpression).toInt();
+}
+
+/*
+ * Lit le fichier ini "chemin". Les clés absentes gardent leur valeur par défaut.
+ */
+void Parametres::charger(const QString &chemin)
+{
+    QSettings fichier(chemin, QSettings::IniFormat);
+
+    fichier.beginGroup("camera");
+    fichierSource = fichier.value("fichier", fichierSource).toString();
+    reboucler = fichier.value("reboucler", reboucler).toBool();
+    largeurCamera = fichier.value("largeur", largeurCamera).toInt();
+    hauteurCamera = fichier.value("hauteur", hauteurCamera).toInt();
+    retournementVertical = fichier.value("retournementVertical", retournementVertical).toBool();
+    retournementFichier = fichier.value("retournementFichier", retournementFichier).toBool();
+    largeurCapteur = fichier.value("largeurCapteur", largeurCapteur).toInt();
+    hauteurCapteur = fichier.value("hauteurCapteur", hauteurCapteur).toInt();
+    fichier.endGroup();
+
+    fichier.beginGroup("servo");
+    portServo = fichier.value("port", portServo).toString();
+    toleranceServo = fichier.value("tolerance", toleranceServo).toInt();
+    simulationNacelle = fichier.value("simulation", simulationNacelle).toBool();
+    firmwareSimule = fichier.value("firmware", firmwareSimule).toString();
+    vitesseServo = fichier.value("vitesse", vitesseServo).toDouble();
+    pixelsParDegre = fichier.value("pixelsParDegre", pixelsParDegre).toDouble();
+    correctionServo = fichier.value("correction", correctionServo).toString();
+    compensationServo = fichier.value("compensation", compensationServo).toBool();
+    fichier.endGroup();
+
+    fichier.beginGroup("calibration");
+    champHorizontal = fichier.value("champHorizontal", champHorizontal).toDouble();
+    champVertical = fichier.value("champVertical", champVertical).toDouble();
+    calibrationAuto = fichier.value("auto", calibrationAuto).toBool();
+    amplitudeCalibration = fichier.value("amplitude", amplitudeCalibration).toDouble();
+    fichierCalibration = fichier.value("fichier", fichierCalibration).toString();
+    fichier.endGroup();
+
+    // dernière calibration automatique.
+    if (!fichierCalibration.isEmpty() && QFile::exists(fichierCalibration)){
+        QSettings resultat(fichierCalibration, QSettings::IniFormat);
+        resultat.beginGroup("calibration");
+        champHorizontal = resultat.value("champHorizontal", champHorizontal).toDouble();
+        champVertical = resultat.value("champVertical", champVertical).toDouble();
+        resultat.endGroup();
+    }
+
+    fichier.beginGroup("latence");
+    periodeRapportLatence = fichier.value("periodeRapport", periodeRapportLatence).toInt();
+    fichier.endGroup();
+
+    fichier.beginGroup("mouvement");
+    mouvementActif = fichier.value("actif", mouvementActif).toBool();
+    seuilMouvement = fichier.value("seuil", seuilMouvement).toInt();
+    blocsMouvement = fichier.value("blocs", blocsMouvement).toInt();
+    rafraichissementMax = fichier.value("rafraichissementMax", rafraichissementMax).toInt();
+    fichier.endGroup();
+
+    fichier.beginGroup("qualite");
+    qualiteActive = fichier.value("actif", qualiteActive).toBool();
+    cibleTraitement = fichier.value("cibleMs", cibleTraitement).toDouble();
+    temperatureMax = fichier.value("temperatureMax", temperatureMax).toFloat();
+    niveauInitial = fichier.value("niveauInitial", niveauInitial).toInt();
+    fichier.endGroup();
+
+    fichier.beginGroup("detection");
+    chargerDetection(fichier);
+    fichierDetection = fichier.value("fichier", fichierDetection).toString();
+    fichier.endGroup();
+
+    // réglages trouvés par ReglageDetection.
+    if (!fichierDetection.isEmpty() && QFile::exists(fichierDetection)){
+        QSettings reglages(fichierDetection, QSettings::IniFormat);
+        reglages.beginGroup("detection");
+        chargerDetection(reglages);
+        reglages.endGroup();
+    }
+
+    fichier.beginGroup("suivi");
+    suiviActif = fichier.value("actif", suiviActif).toBool();
+    margeSuivi = fichier.value("marge", margeSuivi).toDouble();
+    echecsSuivi = fichier.value("echecs", echecsSuivi).toInt();
+    fichier.endGroup();
+
+    fichier.beginGroup("imu");
+    imuActive = fichier.value("actif", imuActive).toBool();
+    axeHorizontalImu = fichier.value("axeHorizontal", axeHorizontalImu).toString();
+    signeHorizontalImu = fichier.value("signeHorizontal", signeHorizontalImu).toInt();
+    axeVerticalImu = fichier.value("axeVertical", axeVerticalImu).toString();
+    signeVerticalImu = fichier.value("signeVertical", signeVerticalImu).toInt();
+    periodeImu = fichier.value("periodeMs", periodeImu).toInt();
+    dureeBiaisImu = fichier.value("biais", dureeBiaisImu).toDouble();
+    journalImu = fichier.value("journal", journalImu).toString();
+    videoImu = fichier.value("video", videoImu).toString();
+    fichier.endGroup();
+
+    fichier.beginGroup("enregistrement");
+    enregistrementActif = fichier.value("actif", enregistrementActif).toBool();
+    dossierEnregistrement = fichier.value("dossier", dossierEnregistrement).toString();
+    codecEnregistrement = fichier.value("codec", codecEnregistrement).toString();
+    secondesAvantEvenement = fichier.value("secondesAvant", secondesAvantEvenement).toInt();
+    secondesApresEvenement = fichier.value("secondesApres", secondesApresEvenement).toInt();
+    fileAttenteEnregistrement = fichier.value("fileAttente", fileAttenteEnregistrement).toInt();
+    fichier.endGroup();
+
+    fichier.beginGroup("diffusion");
+    diffusionActive = fichier.value("actif", diffusionActive).toBool();
+    adresseDiffusion = fichier.value("adresse", adresseDiffusion).toString();
+    portDiffusion = fichier.value("port", portDiffusion).toInt();
+    qualiteDiffusion = fichier.value("qualite", qualiteDiffusion).toInt();
+    largeurDiffusion = fichier.value("largeur", largeurDiffusion).toInt();
+    octetsEnAttenteDiffusion = fichier.value("octetsEnAttente", octetsEnAttenteDiffusion).toInt();
+    fichier.endGroup();
+
+    fichier.beginGroup("photo");
+    sessionPhoto = fichier.value("session", sessionPhoto).toBool();
+    periodeVeille = fichier.value("periodeVeilleMs", periodeVeille).toInt();
+    rafalePhoto = fichier.value("rafale", rafalePhoto).toInt();
+    attenteMaxPhoto = fichier.value("attenteMaxMs", attenteMaxPhoto).toInt();
+    toleranceExposition = fichier.value("toleranceExposition", toleranceExposition).toDouble();
+    dossierPhotos = fichier.value("dossier", dossierPhotos).toString();
+    formatPhoto = fichier.value("format", formatPhoto).toString();
+    qualitePhoto = fichier.value("qualite", qualitePhoto).toInt();
+    fileAttentePhotos = fichier.value("fileAttente", fileAttentePhotos).toInt();
+    fichier.endGroup();
+
+    fichier.beginGroup("visages");
+    recadrageActif = fichier.value("actif", recadrageActif).toBool();
+    periodeRecadrage = fichier.value("periodeMs", periodeRecadrage).toInt();
+    margeRecadrage = fichier.value("marge", margeRecadrage).toDouble();
+    dossierRecadrages = fichier.value("dossier", dossierRecadrages).toString();
+    couleurRecadrages = fichier.value("couleur", couleurRecadrages).toBool();
+    qualiteRecadrages = fichier.value("qualite", qualiteRecadrages).toInt();
+    fileAttenteRecadrages = fichier.value("fileAttente", fileAttenteRecadrages).toInt();
+    fichier.endGroup();
+
+    fichier.beginGroup("reconnaissance");
+    reconnaissanceActive = fichier.value("actif", reconnaissanceActive).toBool();
+    fichierIdentites = fichier.value("base", fichierIdentites).toString();
+    formatIdentites = fichier.value("format", formatIdentites).toString();
+    listesSondees = fichier.value("listesSondees", listesSondees).toInt();
+    seuilReconnaissance = fichier.value("seuil", seuilReconnaissance).toDouble();
+    preferenceConnus = fichier.value("preferenceConnus", preferenceConnus).toBool();
+    periodeImageEntiere = fichier.value("periodeImageEntiere", periodeImageEntiere).toInt();
+    tailleMinReconnaissance = fichier.value("tailleMin", tailleMinReconnaissance).toInt();
+    netteteMinReconnaissance = fichier.value("netteteMin", netteteMinReconnaissance).toDouble();
+    frontaliteMinReconnaissance = fichier.value("frontaliteMin", frontaliteMinReconnaissance).toDouble();
+    essaisReconnaissance = fichier.value("essais", essaisReconnaissance).toInt();
+    fileAttenteReconnaissance = fichier.value("fileAttente", fileAttenteReconnaissance).toInt();
+    nomEnrolement = fichier.value("enrolement", nomEnrolement).toString();
+    echantillonsEnrolement = fichier.value("echantillons", echantillonsEnrolement).toInt();
+    periodeEnrolement = fichier.value("periodeEnrolementMs", periodeEnrolement).toInt();
+    fichier.endGroup();
+
+    fichier.beginGroup("journal");
+    journalActif = fichier.value("actif", journalActif).toBool();
+    dossierJournal = fichier.value("dossier", dossierJournal).toString();
+    enregistrementsParSegment = fichier.value("enregistrementsParSegment", enregistrementsParSegment).toInt();
+    fichier.endGroup();
+}
+
+bool Parametres::enregistrerCalibration() const
+{
+    if (fichierCalibration.isEmpty())
+        return false;
+    QSettings resultat(fichierCalibration, QSettings::IniFormat);
+    resultat.beginGroup("calibration");
+    resultat.setValue("champHorizontal", champHorizontal);
+    resultat.setValue("champVertical", champVertical);
+    resultat.endGroup();
+    resultat.sync();
+    return resultat.status() == QSettings::NoError;
+}
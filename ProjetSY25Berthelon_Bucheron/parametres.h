@@ -0,0 +1,209 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Paramètres de l'application, lus au lancement dans un fichier ini (QSettings).
+ * Toutes les valeurs ont un défaut : sans fichier, l'application se comporte comme avant.
+ */
+#ifndef PARAMETRES_H
+#define PARAMETRES_H
+
+#include <QString>
+
+class QSettings;
+
+struct Parametres {
+
+    // [camera] : source des images. Si "fichier" est renseigné, la vidéo est rejouée à la place de la raspicam.
+    QString fichierSource = "";
+    bool reboucler = true;
+    int largeurCamera = 640;
+    int hauteurCamera = 480;
+    // caméra montée à l'envers : l'image est retournée par la caméra.
+    bool retournementVertical = true;
+    // vidéo rejouée ("fichier") à retourner à la lecture : les vidéos de l'Enregistreur sont déjà à l'endroit.
+    bool retournementFichier = false;
+    // taille de capture de la raspicam si elle dépasse largeur x hauteur (0 : même taille) : la détection reçoit une copie
+    // réduite à largeur x hauteur, l'image pleine résolution sert aux recadrages du visage ([visages]).
+    int largeurCapteur = 0;
+    int hauteurCapteur = 0;
+
+    // [servo] : port série de l'arduino (un pseudo-terminal créé par socat pour travailler sans la carte).
+    QString portServo = "/dev/ttyACM0";
+    // écart au centre de l'image (px) en dessous duquel les servos ne bougent pas.
+    int toleranceServo = 20;
+    // nacelle simulée (voir simulateurnacelle.h) : pas de port série, la vidéo de [camera] est une image grand angle
+    // dans laquelle les commandes déplacent la fenêtre vue par la caméra.
+    bool simulationNacelle = false;
+    // programme de l'arduino simulé : "planifie" (ControlMoteurArduino.ino actuel) ou "bloquant" (delay(15) par commande).
+    QString firmwareSimule = "planifie";
+    double vitesseServo = 300;
+    double pixelsParDegre = 12;
+    // "directe" : l'écart est corrigé en une fois, converti en angles par la calibration (ControleurServo::commanderDirect()) ;
+    // "pas" : un pas de 2° par image tant que le visage est hors de la tolérance (ancienne commande).
+    QString correctionServo = "directe";
+    // commande compensée avec la télémétrie des servos (voir ControleurServo::commanderCompense()).
+    bool compensationServo = true;
+
+    // [calibration] : champ de la caméra (°) pour convertir les pixels en angles (raspicam v1 par défaut).
+    double champHorizontal = 53.50;
+    double champVertical = 41.41;
+    // calibration automatique (CalibrationAuto) au lancement de la vidéo, amplitude des pas (°).
+    bool calibrationAuto = false;
+    double amplitudeCalibration = 6;
+    // résultat de la calibration automatique : relu après ce fichier, il remplace champHorizontal / champVertical.
+    QString fichierCalibration = "/home/pi/ProjetSY25-calibration.ini";
+
+    // [latence] : rapport des latences capture -> commande toutes les "periodeRapport" images (0 : jamais).
+    int periodeRapportLatence = 100;
+
+    // [mouvement] : la détection n'est relancée que si la scène a bougé (ou au bout de rafraichissementMax ms).
+    bool mouvementActif = true;
+    // différence moyenne (niveaux de gris) d'un bloc de 64x64 pixels en VGA pour le considérer comme changé.
+    int seuilMouvement = 8;
+    int blocsMouvement = 1;
+    int rafraichissementMax = 1000;
+
+    // [qualite] : baisse la qualité de la détection quand le traitement est trop long ou le processeur trop chaud.
+    bool qualiteActive = true;
+    // temps de traitement visé par image (ms), sous l'intervalle de capture de 120 ms.
+    double cibleTraitement = 100;
+    float temperatureMax = 75;
+    int niveauInitial = 0;
+
+    // [detection] : cascades évaluées dans l'application (pyramide et intégrales partagées entre visage, sourire et yeux)
+    // au lieu de CascadeClassifier::detectMultiScale.
+    bool cascadeInterne = false;
+    // réglages de la détection au niveau de qualité 0 (ReglagesDetection) : les niveaux suivants partent de ceux-ci.
+    double echelleDetection = 1.0;
+    double facteurVisage = 1.1;
+    int voisinsVisage = 2;
+    int tailleMinVisage = 90;
+    int tailleMaxVisage = 0;
+    double facteurSourire = 1.8;
+    int voisinsSourire = 20;
+    double facteurYeux = 1.1;
+    int voisinsYeux = 1;
+    int periodeExpression = 1;
+    // réglages trouvés par l'outil ReglageDetection : relu après ce fichier, il remplace les valeurs ci-dessus.
+    QString fichierDetection = "/home/pi/ProjetSY25-detection.ini";
+
+    // [suivi] : la détection ne cherche le visage suivi que dans une fenêtre autour de sa position prédite (voir suivivisage.h).
+    bool suiviActif = false;
+    // la fenêtre dépasse le visage de "marge" fois sa taille de chaque côté ; image entière après "echecs" images sans visage.
+    double margeSuivi = 0.75;
+    int echecsSuivi = 2;
+
+    // [imu] : gyroscope du SenseHat monté sur la nacelle (voir gyroscope.h) : la prédiction du suivi suit la rotation de la caméra.
+    bool imuActive = false;
+    // axe du gyroscope ("x", "y" ou "z") qui tourne avec chaque servo, et signe (+1 / -1) selon le montage.
+    QString axeHorizontalImu = "z";
+    int signeHorizontalImu = 1;
+    QString axeVerticalImu = "x";
+    int signeVerticalImu = 1;
+    // intervalle entre deux lectures du gyroscope (ms), durée de la mesure du biais au lancement (s, nacelle immobile).
+    int periodeImu = 5;
+    double dureeBiaisImu = 1.0;
+    // enregistrement pour l'outil SuiviInertiel : journal csv du gyroscope et des instants des images,
+    // vidéo des images brutes (niveaux de gris, avant annotation). Vides : pas d'enregistrement.
+    QString journalImu = "";
+    QString videoImu = "";
+
+    // [enregistrement] : enregistrement vidéo des images annotées autour d'un évènement (apparition d'un visage, sourire).
+    bool enregistrementActif = false;
+    QString dossierEnregistrement = "/home/pi/enregistrements";
+    // codec fourcc passé à cv::VideoWriter ("MJPG", "H264", "X264"...)
+    QString codecEnregistrement = "MJPG";
+    // durée gardée en mémoire avant l'évènement et durée enregistrée après.
+    int secondesAvantEvenement = 5;
+    int secondesApresEvenement = 5;
+    // nombre d'images en attente d'encodage au delà duquel l'enregistreur perd des images (la détection n'attend jamais).
+    int fileAttenteEnregistrement = 8;
+
+    // [diffusion] : flux MJPEG des images traitées (http://adresse:port/flux.mjpg).
+    bool diffusionActive = false;
+    // 127.0.0.1 pour la raspi seule, 0.0.0.0 pour tout le réseau local.
+    QString adresseDiffusion = "127.0.0.1";
+    int portDiffusion = 8080;
+    int qualiteDiffusion = 80;
+    // largeur des images diffusées (0 : taille de la caméra).
+    int largeurDiffusion = 0;
+    // octets non envoyés au delà desquels un client est considéré comme lent (il perd alors des images).
+    int octetsEnAttenteDiffusion = 200000;
+
+    // [photo] : session de capture gardée ouverte entre deux photos (voir sessionphoto.h) : l'exposition est déjà stabilisée
+    // au clic et la photo part à l'image suivante. Sans session, la caméra est ouverte puis fermée à chaque photo.
+    bool sessionPhoto = true;
+    // intervalle (ms) entre deux images prises pendant la veille pour suivre l'exposition.
+    int periodeVeille = 250;
+    // images prises au clic, la plus nette est gardée ; attente maximum d'images bien exposées (ms).
+    int rafalePhoto = 1;
+    int attenteMaxPhoto = 3000;
+    // variation relative de la luminosité moyenne d'une image à l'autre sous laquelle l'exposition est stable.
+    double toleranceExposition = 0.03;
+    // photos écrites en tâche de fond : dossier, format ("jpg" ou "png"), qualité jpeg, photos en attente au delà desquelles elles sont perdues.
+    QString dossierPhotos = "/home/pi/photos";
+    QString formatPhoto = "jpg";
+    int qualitePhoto = 95;
+    int fileAttentePhotos = 4;
+
+    // [visages] : recadrages pleine résolution du visage suivi pendant la vidéo (voir recadragevisage.h),
+    // au plus un toutes les periodeMs, élargis de "marge" fois la taille du visage de chaque côté.
+    bool recadrageActif = false;
+    int periodeRecadrage = 2000;
+    double margeRecadrage = 0.3;
+    // écrits en tâche de fond : dossier, couleur (sinon niveaux de gris), qualité jpeg, recadrages en attente au delà desquels ils sont perdus.
+    QString dossierRecadrages = "/home/pi/visages";
+    bool couleurRecadrages = true;
+    int qualiteRecadrages = 95;
+    int fileAttenteRecadrages = 4;
+
+    // [reconnaissance] : identité des visages (voir reconnaissancevisage.h), calculée en tâche de fond sur les meilleures
+    // images de chaque visage et gardée tant que le visage reste dans l'image.
+    bool reconnaissanceActive = false;
+    // index des personnes enrôlées (indexidentites.h) : format d'un index à créer ("int8" ou "demi"), listes parcourues
+    // si l'index a un quantifieur grossier (0 : recherche exhaustive).
+    QString fichierIdentites = "/home/pi/identites.idx";
+    QString formatIdentites = "int8";
+    int listesSondees = 8;
+    // similarité (cosinus des descripteurs LBP) au dessus de laquelle un visage est celui d'une personne enrôlée.
+    double seuilReconnaissance = 0.9;
+    // la nacelle suit de préférence le plus grand des visages reconnus (sinon le plus grand visage).
+    bool preferenceConnus = true;
+    // avec le suivi ([suivi] actif), une image analysée sur "periodeImageEntiere" l'est en entier pour voir les autres visages
+    // (0 : jamais, la préférence ne joue alors qu'à la perte du visage suivi).
+    int periodeImageEntiere = 10;
+    // qualité minimum d'une image de visage (taille en px, variance du laplacien, symétrie), reconnaissances au plus par visage.
+    int tailleMinReconnaissance = 60;
+    double netteteMinReconnaissance = 50;
+    double frontaliteMinReconnaissance = 0.5;
+    int essaisReconnaissance = 5;
+    int fileAttenteReconnaissance = 2;
+    // enrôlement : si un nom est donné, le visage suivi est ajouté à la base sous ce nom (echantillons images de qualité,
+    // une toutes les periodeEnrolementMs), au lieu d'être reconnu.
+    QString nomEnrolement = "";
+    int echantillonsEnrolement = 10;
+    int periodeEnrolement = 500;
+
+    // [journal] : journal binaire des détections et changements d'expression (lu avec l'outil LecteurJournal).
+    bool journalActif = false;
+    QString dossierJournal = "/home/pi/journal";
+    // enregistrements de 32 octets par segment (1048576 : segments de 32 Mo).
+    int enregistrementsParSegment = 1048576;
+
+    /*
+     * Lit le fichier ini "chemin". Les clés absentes gardent leur valeur par défaut.
+     */
+    void charger(const QString &chemin);
+
+    /*
+     * Ecrit champHorizontal / champVertical dans fichierCalibration (le fichier principal, commenté, n'est pas réécrit).
+     * Retourne false si le fichier n'a pas pu être écrit.
+     */
+    bool enregistrerCalibration() const;
+
+private:
+    void chargerDetection(QSettings &fichier);
+};
+
+#endif // PARAMETRES_H
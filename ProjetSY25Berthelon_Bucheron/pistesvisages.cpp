@@ -0,0 +1,147 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Pistes des visages, identité gardée par piste, choix du visage suivi.
+ */
+#include "pistesvisages.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+PistesVisages::PistesVisages(const CriteresQualite &criteres, int essaisMax, int absencesMax) :
+    criteres(criteres),
+    essaisMax(essaisMax),
+    absencesMax(absencesMax)
+{
+}
+
+void PistesVisages::mettreAJour(const std::vector<cv::Rect> &visages, std::vector<int> &numeros, const cv::Rect &zone)
+{
+    // paires (visage, piste) compatibles, rattachées de la plus proche à la plus lointaine.
+    struct Paire { double distance; int visage, piste; };
+    std::vector<Paire> paires;
+    for (size_t v = 0; v < visages.size(); v++){
+        cv::Point2d c(visages[v].x + visages[v].width / 2., visages[v].y + visages[v].height / 2.);
+        for (size_t p = 0; p < pistes.size(); p++){
+            const cv::Rect &r = pistes[p].rect;
+            double rapportTailles = (double)visages[v].width / r.width;
+            double distance = std::hypot(c.x - (r.x + r.width / 2.), c.y - (r.y + r.height / 2.)) / r.width;
+            if (distance < 0.5 && rapportTailles > 0.6 && rapportTailles < 1.6){
+                Paire paire = { distance, (int)v, (int)p };
+                paires.push_back(paire);
+            }
+        }
+    }
+    std::sort(paires.begin(), paires.end(), [](const Paire &a, const Paire &b){ return a.distance < b.distance; });
+
+    numeros.assign(visages.size(), 0);
+    std::vector<bool> pisteVue(pistes.size(), false);
+    for (size_t i = 0; i < paires.size(); i++){
+        if (numeros[paires[i].visage] != 0 || pisteVue[paires[i].piste])
+            continue;
+        PisteVisage &piste = pistes[paires[i].piste];
+        piste.rect = visages[paires[i].visage];
+        piste.absences = 0;
+        pisteVue[paires[i].piste] = true;
+        numeros[paires[i].visage] = piste.numero;
+    }
+
+    // pistes sans visage : une absence de plus, disparition au delà de absencesMax (sauf hors de la zone regardée).
+    std::vector<PisteVisage> restantes;
+    for (size_t p = 0; p < pistes.size(); p++){
+        const cv::Rect &r = pistes[p].rect;
+        bool regardee = zone.area() == 0 || zone.contains(cv::Point(r.x + r.width / 2, r.y + r.height / 2));
+        if (pisteVue[p] || !regardee || ++pistes[p].absences <= absencesMax)
+            restantes.push_back(pistes[p]);
+    }
+    pistes.swap(restantes);
+
+    for (size_t v = 0; v < visages.size(); v++){
+        if (numeros[v] != 0)
+            continue;
+        PisteVisage nouvelle;
+        nouvelle.numero = prochainNumero++;
+        nouvelle.rect = visages[v];
+        pistes.push_back(nouvelle);
+        numeros[v] = nouvelle.numero;
+        nbPistes++;
+    }
+}
+
+PisteVisage *PistesVisages::piste(int numero)
+{
+    for (size_t p = 0; p < pistes.size(); p++){
+        if (pistes[p].numero == numero)
+            return &pistes[p];
+    }
+    return 0;
+}
+
+bool PistesVisages::qualiteSuffisante(const QualiteVisage &qualite) const
+{
+    return qualite.taille >= criteres.tailleMin && qualite.nettete >= criteres.netteteMin && qualite.frontalite >= criteres.frontaliteMin;
+}
+
+bool PistesVisages::aReconnaitre(int numero, const QualiteVisage &qualite)
+{
+    PisteVisage *p = piste(numero);
+    // une image de plus n'est utile que si elle est nettement meilleure (10 %) que celles déjà reconnues.
+    if (!p || p->enAttente || p->essais >= essaisMax || !qualiteSuffisante(qualite) || qualite.score <= p->meilleureQualite * 1.1)
+        return false;
+    p->qualitePrecedente = p->meilleureQualite;
+    p->meilleureQualite = qualite.score;
+    p->essais++;
+    p->enAttente = true;
+    nbDemandes++;
+    return true;
+}
+
+void PistesVisages::annulerDemande(int numero)
+{
+    PisteVisage *p = piste(numero);
+    if (p && p->enAttente){
+        p->enAttente = false;
+        p->essais--;
+        p->meilleureQualite = p->qualitePrecedente;
+        nbDemandes--;
+    }
+}
+
+void PistesVisages::identifier(int numero, const std::string &identite, double similarite)
+{
+    PisteVisage *p = piste(numero);
+    if (!p)
+        return;
+    if (!p->reconnue)
+        nbReconnues++;
+    p->enAttente = false;
+    p->reconnue = true;
+    // chaque image reconnue est meilleure que les précédentes : son résultat remplace le leur.
+    p->identite = identite;
+    p->similarite = similarite;
+}
+
+int PistesVisages::choisir(const std::vector<cv::Rect> &visages, const std::vector<int> &numeros, bool preferenceConnus)
+{
+    int choisi = -1;
+    bool choisiConnu = false;
+    for (size_t v = 0; v < visages.size(); v++){
+        PisteVisage *p = preferenceConnus ? piste(numeros[v]) : 0;
+        bool connu = p && !p->identite.empty();
+        if (choisi < 0 || (connu && !choisiConnu) || (connu == choisiConnu && visages[v].area() > visages[choisi].area())){
+            choisi = (int)v;
+            choisiConnu = connu;
+        }
+    }
+    return choisi;
+}
+
+std::string PistesVisages::rapport() const
+{
+    char texte[200];
+    snprintf(texte, sizeof(texte), "pistes de visages : %llu créées, %llu reconnaissances demandées, %llu pistes reconnues\n",
+             (unsigned long long)nbPistes, (unsigned long long)nbDemandes, (unsigned long long)nbReconnues);
+    return texte;
+}
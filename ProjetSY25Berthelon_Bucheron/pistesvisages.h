@@ -0,0 +1,93 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Pistes des visages présents dans l'image, pour la reconnaissance (voir reconnaissancevisage.h).
+ *
+ * Chaque visage détecté est rattaché à la piste du visage le plus proche de l'image précédente (centre à moins de la moitié
+ * de sa taille, taille comparable) ; une piste disparaît après "absencesMax" images sans son visage.
+ * L'identité trouvée est gardée dans la piste : elle n'est pas recalculée à chaque image. Un visage n'est proposé
+ * à la reconnaissance que sur ses meilleures images : qualité suffisante, et nettement meilleure que celle
+ * des images déjà reconnues pour cette piste, dans la limite de "essaisMax" reconnaissances par piste.
+ *
+ * Le visage suivi par la nacelle est le plus grand, ou avec "preferenceConnus" le plus grand des visages reconnus.
+ */
+#ifndef PISTESVISAGES_H
+#define PISTESVISAGES_H
+
+#include "descripteurvisage.h"
+
+#include <opencv2/core/core.hpp>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+struct PisteVisage {
+    int numero = 0;
+    cv::Rect rect;
+    int absences = 0;
+    // meilleure qualité proposée à la reconnaissance, reconnaissances demandées, résultat attendu.
+    double meilleureQualite = 0;
+    double qualitePrecedente = 0;
+    int essais = 0;
+    bool enAttente = false;
+    // identité (vide : inconnue) et similarité de la dernière reconnaissance.
+    std::string identite;
+    double similarite = 0;
+    bool reconnue = false; // au moins une reconnaissance a répondu
+};
+
+// Seuils de qualité d'une image de visage pour la reconnaissance.
+struct CriteresQualite {
+    int tailleMin = 60;
+    double netteteMin = 50;
+    double frontaliteMin = 0.5;
+};
+
+class PistesVisages
+{
+public:
+    PistesVisages(const CriteresQualite &criteres = CriteresQualite(), int essaisMax = 5, int absencesMax = 5);
+
+    /*
+     * Rattache les visages de l'image à leurs pistes (nouvelles pistes pour les autres) ;
+     * "numeros" reçoit le numéro de piste de chaque visage, dans l'ordre de "visages".
+     * zone : partie de l'image où les visages ont été cherchés (fenêtre du suivi), vide pour l'image entière.
+     * Une piste hors de la zone n'a pas été regardée : elle ne compte pas d'absence.
+     */
+    void mettreAJour(const std::vector<cv::Rect> &visages, std::vector<int> &numeros, const cv::Rect &zone = cv::Rect());
+
+    PisteVisage *piste(int numero);
+
+    /*
+     * L'image du visage de la piste, de qualité "qualite", doit-elle être reconnue ? Si oui, la piste attend le résultat ;
+     * annulerDemande() si l'image n'a finalement pas pu être confiée à la reconnaissance.
+     */
+    bool aReconnaitre(int numero, const QualiteVisage &qualite);
+    void annulerDemande(int numero);
+    bool qualiteSuffisante(const QualiteVisage &qualite) const;
+
+    // Résultat d'une reconnaissance (ignoré si la piste a disparu entre temps).
+    void identifier(int numero, const std::string &identite, double similarite);
+
+    /*
+     * Indice (dans "visages") du visage à suivre : le plus grand, ou avec preferenceConnus le plus grand des reconnus.
+     */
+    int choisir(const std::vector<cv::Rect> &visages, const std::vector<int> &numeros, bool preferenceConnus);
+
+    // Pistes créées, reconnaissances demandées, pistes reconnues, en texte.
+    std::string rapport() const;
+
+private:
+    CriteresQualite criteres;
+    int essaisMax;
+    int absencesMax;
+    std::vector<PisteVisage> pistes;
+    int prochainNumero = 1;
+
+    uint64_t nbPistes = 0;
+    uint64_t nbDemandes = 0;
+    uint64_t nbReconnues = 0;
+};
+
+#endif // PISTESVISAGES_H
@@ -9,43 +9,217 @@
  */
 #include "projetsy25main.h"
 #include "SenseHat.h" // pour utiliser le panneau led.
+#include "noyauxint8.h"
+#include "noyauxpretraitement.h"
 
 
 #include "opencv2/imgproc/imgproc.hpp"
 #include "opencv2/imgproc/types_c.h"
 #include <QMessageBox>
 #include <QThread>
+#include <algorithm>
+#include <cstring>
+
+/*
+ * Axe du gyroscope nommé dans le fichier ini ("x", "y" ou "z").
+ */
+static int axeGyroscope(const QString &nom)
+{
+    return nom == "x" ? 0 : nom == "y" ? 1 : 2;
+}
 
 ProjetSY25main::ProjetSY25main(QWidget *parent) :
     QMainWindow(parent)
 {
     setupUi(this); // Initialisation de l'interface graphique.
 
+    parametres.charger(config_path); // Lecture des paramètres (les valeurs par défaut sont gardées si le fichier n'existe pas).
+    controleurServo = ControleurServo(CalibrationCamera(parametres.largeurCamera, parametres.hauteurCamera, parametres.champHorizontal,
+                                                        parametres.champVertical), parametres.toleranceServo);
+
     configureCamera();
 
     // chargement des bases de données à l'aide de leur path respectifs.
-    face_cascade.load(face_cascade_path);
-    smile_cascade.load(smile_cascade_path);
-    left_eye_cascade.load(left_eye_cascade_path);
-    right_eye_cascade.load(right_eye_cascade_path);
+    detecteur.charger(face_cascade_path, smile_cascade_path, left_eye_cascade_path, right_eye_cascade_path);
+    reglagesDetection.echelle = std::min(std::max(parametres.echelleDetection, 0.1), 1.0);
+    reglagesDetection.facteurEchelle = std::max(parametres.facteurVisage, 1.01);
+    reglagesDetection.voisinsVisage = parametres.voisinsVisage;
+    reglagesDetection.tailleMinVisage = parametres.tailleMinVisage;
+    reglagesDetection.tailleMaxVisage = parametres.tailleMaxVisage;
+    reglagesDetection.facteurSourire = std::max(parametres.facteurSourire, 1.01);
+    reglagesDetection.voisinsSourire = parametres.voisinsSourire;
+    reglagesDetection.facteurYeux = std::max(parametres.facteurYeux, 1.01);
+    reglagesDetection.voisinsYeux = parametres.voisinsYeux;
+    reglagesDetection.periodeExpression = std::max(parametres.periodeExpression, 1);
+    detecteur.reglages = reglagesDetection;
+
+    // Cascades internes : mêmes fichiers, évaluées sur des niveaux partagés.
+    if (parametres.cascadeInterne){
+        if (!detecteur.activerCascadesInternes()){
+            qWarning() << "cascades illisibles par l'évaluateur interne, utilisation de detectMultiScale";
+        } else {
+            qDebug() << detecteur.rapportCascades().c_str();
+        }
+    }
+
+    // Si le modèle de points est disponible, il remplace les trois cascades sourire / yeux.
+    if (!estimateur.charger(landmark_model_path)){
+        qDebug() << "modèle de points absent, utilisation des cascades sourire / yeux";
+    }
 
+    // Même vérification pour le noyau qui prépare l'image de détection.
+    if (!verifierPretraitement()){
+        qWarning() << "noyau de préparation de l'image incohérent, utilisation de la version scalaire";
+        detecteur.pretraitementVectorise = false;
+    }
+
+    // Classifieur d'expression : on vérifie au chargement que les noyaux vectorisés donnent le même résultat que la référence.
+    if (classifieur.charger(expression_model_path)){
+        if (classifieur.verifierNoyaux()){
+            qDebug() << "classifieur d'expression chargé, jeu d'instructions :" << jeuInstructionsInt8();
+        } else { // les noyaux vectorisés ne sont pas fiables sur cette machine, on passe sur la version scalaire.
+            qWarning() << "noyaux vectorisés incohérents, utilisation de la version scalaire";
+            classifieur.setReference(true);
+        }
+    }
+
+    // Détection de mouvement, pour ne pas relancer les cascades sur une scène immobile.
+    if (parametres.mouvementActif){
+        detecteurMouvement = new DetecteurMouvement(parametres.seuilMouvement, parametres.blocsMouvement, parametres.rafraichissementMax);
+    }
+
+    // Suivi du visage : la détection ne parcourt qu'une fenêtre autour de la position prédite.
+    if (parametres.suiviActif){
+        suivi = new SuiviVisage(controleurServo.calibration, parametres.margeSuivi, parametres.echecsSuivi);
+    }
+
+    // Gyroscope de la nacelle, lu toutes les quelques ms dans son thread : la prédiction du suivi suit la rotation de la caméra.
+    if (parametres.imuActive){
+        gyroscope = new Gyroscope(axeGyroscope(parametres.axeHorizontalImu), parametres.signeHorizontalImu,
+                                  axeGyroscope(parametres.axeVerticalImu), parametres.signeVerticalImu, parametres.dureeBiaisImu);
+        if (!parametres.journalImu.isEmpty() && !gyroscope->ouvrirJournal(parametres.journalImu.toStdString())){
+            qWarning() << "impossible de créer le journal du gyroscope" << parametres.journalImu;
+        }
+        lectureGyroscope = new LectureGyroscope(carte, *gyroscope, std::max(parametres.periodeImu, 1) * 1000);
+        lectureGyroscope->start(QThread::HighPriority);
+    }
+
+    // Contrôleur de qualité : la détection s'adapte à la charge et à la température.
+    if (parametres.qualiteActive){
+        controleurQualite = new ControleurQualite(parametres.cibleTraitement, parametres.temperatureMax, parametres.niveauInitial);
+        temperatureCpu = carte.getCpuTemperature();
+    }
+
+    // Enregistreur des images annotées, dans son propre thread pour ne jamais ralentir la détection.
+    if (parametres.enregistrementActif){
+        enregistreur = new Enregistreur(parametres.dossierEnregistrement, parametres.codecEnregistrement, 1000.0/intervalleCapture,
+                                        parametres.secondesAvantEvenement, parametres.secondesApresEvenement, parametres.fileAttenteEnregistrement);
+        enregistreur->start(QThread::LowPriority);
+    }
 
+    // Photos écrites en tâche de fond ; la session de capture reste ouverte entre deux photos.
+    sessionPhoto = SessionPhoto(parametres.toleranceExposition);
+    sauvegardePhotos = new SauvegardePhotos(parametres.dossierPhotos, "photo", parametres.formatPhoto, parametres.qualitePhoto, parametres.fileAttentePhotos);
+    sauvegardePhotos->start(QThread::LowPriority);
+    if (parametres.sessionPhoto){
+        if (source->ouvrir()){
+            minuterieVeille = new QTimer(this);
+            connect(minuterieVeille, SIGNAL(timeout()), this, SLOT(entretenirSession()));
+            minuterieVeille->start(std::max(parametres.periodeVeille, 10));
+        } else {
+            qWarning() << "caméra indisponible : pas de session de capture, elle sera ouverte à chaque photo";
+        }
+    }
+
+    // Recadrages du visage : copiés dans la boucle des images, convertis et écrits en tâche de fond.
+    if (parametres.recadrageActif){
+        recadrage = new RecadrageVisage(parametres.margeRecadrage, parametres.periodeRecadrage);
+        sauvegardeVisages = new SauvegardePhotos(parametres.dossierRecadrages, "visage", "jpg", parametres.qualiteRecadrages, parametres.fileAttenteRecadrages);
+        sauvegardeVisages->start(QThread::LowPriority);
+    }
+
+    // Reconnaissance des visages : la base des personnes est lue ici, les descripteurs sont calculés dans son thread.
+    if (parametres.reconnaissanceActive){
+        CriteresQualite criteres;
+        criteres.tailleMin = parametres.tailleMinReconnaissance;
+        criteres.netteteMin = parametres.netteteMinReconnaissance;
+        criteres.frontaliteMin = parametres.frontaliteMinReconnaissance;
+        pistes = PistesVisages(criteres, parametres.essaisReconnaissance);
+        reconnaissance = new ReconnaissanceVisage(parametres.fichierIdentites, parametres.formatIdentites, parametres.seuilReconnaissance,
+                                                  parametres.listesSondees, parametres.fileAttenteReconnaissance);
+        if (!reconnaissance->charger()){
+            qWarning() << "index des personnes illisible :" << parametres.fichierIdentites << "(reconnaissance sans personnes enrôlées)";
+        }
+        qDebug() << "reconnaissance :" << reconnaissance->nombrePersonnes() << "personnes enrôlées";
+        reconnaissance->start(QThread::LowPriority);
+    }
+
+    // Journal binaire des détections.
+    if (parametres.journalActif){
+        journal = new JournalEvenements(parametres.dossierJournal.toStdString(), parametres.enregistrementsParSegment);
+        if (!journal->ouvrir()){
+            qWarning() << "impossible de créer le journal dans" << parametres.dossierJournal;
+            delete journal;
+            journal = 0;
+        }
+    }
+
+    // Diffusion des images traitées sur le réseau (encodées une seule fois quel que soit le nombre de clients).
+    if (parametres.diffusionActive){
+        serveurMJPEG = new ServeurMJPEG(parametres.qualiteDiffusion, parametres.largeurDiffusion, parametres.octetsEnAttenteDiffusion, this);
+        serveurMJPEG->ecouter(QHostAddress(parametres.adresseDiffusion), parametres.portDiffusion);
+    }
+}
+
+ProjetSY25main::~ProjetSY25main()
+{
+    delete enregistreur; // termine le fichier en cours et arrête le thread.
+    delete sauvegardePhotos; // écrit les photos en attente.
+    delete sauvegardeVisages;
+    delete reconnaissance; // traite les visages en attente (et termine l'enrôlement).
+    delete recadrage;
+    delete journal; // ramène le dernier segment à sa taille utile.
+    delete detecteurMouvement;
+    delete controleurQualite;
+    trame.liberer();
+    delete source;
+    delete simulateur;
+    delete calibrationAuto;
+    delete lectureGyroscope; // arrête le thread avant de détruire le gyroscope qu'il alimente.
+    delete gyroscope;
+    delete suivi;
 }
 /*
  * Fonction qui configure la raspicam au lancement de l'application
  */
 void ProjetSY25main::configureCamera(){
 
-    camera.set( CV_CAP_PROP_FORMAT, CV_8UC1 ); // format de la prise de photo ( ici en noir et blanc ).
-    camera.set(CV_CAP_PROP_FRAME_WIDTH, 640); // format VGA : largeur de 640 pixels
-    camera.set(CV_CAP_PROP_FRAME_HEIGHT, 480); // format VGA : hauteur de 480 pixels
+    if (parametres.simulationNacelle && !parametres.fichierSource.isEmpty()){ // nacelle simulée : fenêtre mobile dans une vidéo grand angle.
+        simulateur = new SimulateurNacelle(parametres.vitesseServo, parametres.pixelsParDegre, Size(parametres.largeurCamera, parametres.hauteurCamera),
+                                           parametres.firmwareSimule == "bloquant" ? FIRMWARE_BLOQUANT : FIRMWARE_PLANIFIE);
+        source = new SourceNacelle(parametres.fichierSource.toStdString(), parametres.reboucler, simulateur);
+    } else if (!parametres.fichierSource.isEmpty()){ // relecture d'une vidéo, pour travailler sans la raspi.
+        // avec les recadrages du visage, une vidéo plus grande que la caméra est réduite pour la détection, comme la raspicam.
+        source = parametres.recadrageActif ?
+                    new SourceFichier(parametres.fichierSource.toStdString(), parametres.reboucler, parametres.retournementFichier,
+                                      parametres.largeurCamera, parametres.hauteurCamera) :
+                    new SourceFichier(parametres.fichierSource.toStdString(), parametres.reboucler, parametres.retournementFichier);
+    } else { // format VGA par défaut, en YUV420 : la détection travaille directement sur le plan Y (noir et blanc).
+        // La caméra est à l'envers : c'est elle qui retourne l'image, plus besoin de flip() sur chaque image.
+        // Capteur plus grand que la détection ([camera] largeurCapteur) : la source rend une copie réduite et l'image pleine résolution.
+        source = new SourceRaspiCam(parametres.largeurCamera, parametres.hauteurCamera, parametres.retournementVertical,
+                                    parametres.largeurCapteur, parametres.hauteurCapteur);
+    }
 }
 /*
  * Fonction utilisée pour initialiser la liaison série avec l'arduino qui controle les moteurs.
 */
 void ProjetSY25main::initPort()
 {
-    port.setPortName("/dev/ttyACM0"); // peut varier en fonction de la raspi, à vérifier dans un terminal avec cd /dev|ls
+    if (simulateur){ // les commandes vont au simulateur.
+        return;
+    }
+    port.setPortName(parametres.portServo); // peut varier en fonction de la raspi, à vérifier dans un terminal avec cd /dev|ls
     port.setBaudRate(QSerialPort::Baud115200); // On set le baud rate de la liaison à 115200 bauds (équivalent à celle set sur la carte arduino).
 
 
@@ -53,9 +227,29 @@ void ProjetSY25main::initPort()
         QMessageBox::warning(this, "impossible d'ouvrir le port", port.portName());
         return;
     }
+    connect(&port, SIGNAL(readyRead()), this, SLOT(lireRetourServo())); // télémétrie et réponses de l'arduino.
     qDebug() <<"port opened";
 }
 
+/*
+ * Octets renvoyés par l'arduino (ou la nacelle simulée), datés à leur lecture.
+ */
+void ProjetSY25main::lireRetourServo()
+{
+    uint64_t maintenant = MesureLatence::horloge();
+    if (simulateur){
+        std::string octets = simulateur->lireSortie(maintenant);
+        telemetrie.recevoir(octets.data(), octets.size(), maintenant);
+    } else if (port.isOpen()){
+        QByteArray octets = port.readAll();
+        telemetrie.recevoir(octets.constData(), octets.size(), maintenant);
+    }
+    std::string texte = telemetrie.lireTexte();
+    if (!texte.empty()){
+        qDebug() << (simulateur ? "nacelle simulée :" : "arduino :") << texte.c_str();
+    }
+}
+
 /*
  * Fonction qui transmet les commandes via la liaison série à la carte arduino.
  */
@@ -65,10 +259,17 @@ void ProjetSY25main::transmitCmd(const char* valeur){
 
 
     qDebug() <<"transmitCmd";
-    if(port.isOpen()){
+    if (simulateur){ // même flot d'octets que sur la liaison série.
+        uint64_t envoi = MesureLatence::horloge();
+        simulateur->recevoir(valeur, strlen(valeur), envoi);
+        telemetrie.commandesEnvoyees(valeur, strlen(valeur), envoi);
+        latence.marquer(ETAPE_ENVOI);
+    } else if(port.isOpen()){
         port.write(valeur);
         qDebug() <<"byte(s) written ";
         port.flush();
+        telemetrie.commandesEnvoyees(valeur, strlen(valeur), MesureLatence::horloge());
+        latence.marquer(ETAPE_ENVOI); // la commande a quitté l'application.
     }
 }
 
@@ -299,52 +500,88 @@ void ProjetSY25main::displaySmiley(bool smile, bool leftEye, bool rightEye){
 }
 
 /*
- * Fonction de détection de sourire sur le visage détecté
- * prend en entrée la zone image correspondant au visage détecté à analyser
- * et retourne un boolean ( true si sourire détecté, false sinon)
+ * Fonction qui affiche l'expression trouvée par le classifieur sur le SenseHat (panneau led)
+ * Les combinaisons sourire / yeux passent par displaySmiley(), la surprise et la tristesse ont leur propre motif.
  */
-bool ProjetSY25main::detectSmile(Mat frame){
-    vector<Rect> smiles; // contiendra tous les sourires détectés
+void ProjetSY25main::displayExpression(Expression expression){
 
-    smile_cascade.detectMultiScale(frame, smiles, 1.8,20); // fonction qui détecte les sourires dans la zone qu'on lui a donné.
+    //visage surpris (bouche ouverte) yeux ouverts
+    uint8_t faceSurprise[8][8][3] = {
+        {{0,   0,   0}, {0,   0,   0}, {0,  0,   0}, {0, 0,   0}, {0, 0,   0}, { 0, 0,   0}, {  0, 0,  0}, {  0, 0, 0}},
+        {{0,   0,   0}, {0,   0,   0}, {0,  0,   0}, {0, 0,   0}, {0, 0,   0}, { 255, 0,   0}, {  255, 0,  0}, {  0, 0, 0}},
+        {{0,   0,   0}, {0,   0,   0}, {255,  0,   0}, {0, 0,   0}, {0, 0,   0}, { 255, 0,   0}, {  255, 0,  0}, {  0, 0, 0}},
+        {{0,   0,   0}, {255,   0,   0}, {0,  0,   0}, {255, 0,   0}, {0, 0,   0}, { 0, 0,   0}, {  0, 0,  0}, {  0, 0, 0}},
+        {{0,   0,   0}, {255,   0,   0}, {0,  0,   0}, {255, 0,   0}, {0, 0,   0}, { 0, 0,   0}, {  0, 0,  0}, {  0, 0, 0}},
+        {{0,   0,   0}, {0,   0,   0}, {255,  0,   0}, {0, 0,   0}, {0, 0,   0}, { 255, 0,   0}, {  255, 0,  0}, {  0, 0, 0}},
+        {{0,   0,   0}, {0,   0,   0}, {0,  0,   0}, {0, 0,   0}, {0, 0,   0}, { 255, 0,   0}, {  255, 0,  0}, {  0, 0, 0}},
+        {{0,   0,   0}, {0,   0,   0}, {0,  0,   0}, {0, 0,   0}, {0, 0,   0}, { 0, 0,   0}, {  0, 0,  0}, {  0, 0, 0}}
+    };
+    //visage triste (coins de la bouche vers le bas) yeux ouverts
+    uint8_t faceTriste[8][8][3] = {
+        {{0,   0,   0}, {0,   0,   0}, {0,  0,   0}, {0, 0,   0}, {0, 0,   0}, { 0, 0,   0}, {  0, 0,  0}, {  0, 0, 0}},
+        {{0,   0,   0}, {255,   0,   0}, {0,  0,   0}, {0, 0,   0}, {0, 0,   0}, { 255, 0,   0}, {  255, 0,  0}, {  0, 0, 0}},
+        {{0,   0,   0}, {0,   0,   0}, {255,  0,   0}, {0, 0,   0}, {0, 0,   0}, { 255, 0,   0}, {  255, 0,  0}, {  0, 0, 0}},
+        {{0,   0,   0}, {0,   0,   0}, {255,  0,   0}, {0, 0,   0}, {0, 0,   0}, { 0, 0,   0}, {  0, 0,  0}, {  0, 0, 0}},
+        {{0,   0,   0}, {0,   0,   0}, {255,  0,   0}, {0, 0,   0}, {0, 0,   0}, { 0, 0,   0}, {  0, 0,  0}, {  0, 0, 0}},
+        {{0,   0,   0}, {0,   0,   0}, {255,  0,   0}, {0, 0,   0}, {0, 0,   0}, { 255, 0,   0}, {  255, 0,  0}, {  0, 0, 0}},
+        {{0,   0,   0}, {255,   0,   0}, {0,  0,   0}, {0, 0,   0}, {0, 0,   0}, { 255, 0,   0}, {  255, 0,  0}, {  0, 0, 0}},
+        {{0,   0,   0}, {0,   0,   0}, {0,  0,   0}, {0, 0,   0}, {0, 0,   0}, { 0, 0,   0}, {  0, 0,  0}, {  0, 0, 0}}
+    };
 
-    if (smiles.size() > 0){ // Si des sourires ont été détectés on return true.
-       return true;
-    } else { // si aucun sourire n'est détecté on return false.
-        return false;
+    if (expression == EXPRESSION_SURPRISE){
+        for(int k=0; k<8; k++){
+                for(int l=1; l<9; l++){
+                    pixel = carte.ConvertirRGB565(faceSurprise[k][l-1]);
+                    carte.AllumerPixel(k,l,pixel);
+                }
+         }
+    } else if (expression == EXPRESSION_TRISTESSE){
+        for(int k=0; k<8; k++){
+                for(int l=1; l<9; l++){
+                    pixel = carte.ConvertirRGB565(faceTriste[k][l-1]);
+                    carte.AllumerPixel(k,l,pixel);
+                }
+         }
+    } else { // les autres expressions sont des combinaisons sourire / yeux déjà prévues.
+        EtatExpression etat = ClassifieurExpression::versEtat(expression);
+        displaySmiley(etat.smile, etat.leftEye, etat.rightEye);
     }
 }
+
 /*
- * Fonction de détection de l'oeil droit sur le visage détecté
- * prend en entrée la zone image correspondant à la moitié droite du visage à analyser
- * et retourne un boolean ( true si oeil détecté, false sinon)
+ * Fonction qui ajoute le résultat de la détection au journal binaire (et une transition si l'état a changé).
  */
-bool ProjetSY25main::detectRightEye(Mat frame){
-    vector<Rect> rightEye; // contiendra tous les yeux détectés
-
-    right_eye_cascade.detectMultiScale(frame, rightEye, 1.1,1, 0); // fonction qui détecte les yeux dans la zone qu'on lui a donné.
+void ProjetSY25main::journaliserDetection(const Rect *visage){
 
-    if (rightEye.size() > 0){ // Si des yeux ont été détectés on return true.
-       return true;
-    } else { // si aucun oeil n'est détecté on return false.
-        return false;
+    if (!journal){
+        return;
     }
-}
-/*
- * Fonction de détection de l'oeil gauche sur le visage détecté
- * prend en entrée la zone image correspondant à la moitié gauche du visage à analyser
- * et retourne un boolean ( true si oeil détecté, false sinon)
- */
-bool ProjetSY25main::detectLeftEye(Mat frame){
-    vector<Rect> leftEye; // contiendra tous les yeux détectés
 
-    left_eye_cascade.detectMultiScale(frame, leftEye, 1.1,1, 0);// fonction qui détecte les yeux dans la zone qu'on lui a donné.
+    EnregistrementJournal e;
+    memset(&e, 0, sizeof(e));
+    e.horodatage = JournalEvenements::horodatageMaintenant();
+    e.numeroImage = numeroImage;
+    e.type = ENREGISTREMENT_DETECTION;
+
+    if (visage){
+        e.etat = ETAT_VISAGE | (etatExpression.smile ? ETAT_SOURIRE : 0)
+                | (etatExpression.leftEye ? ETAT_OEIL_GAUCHE : 0) | (etatExpression.rightEye ? ETAT_OEIL_DROIT : 0);
+        e.centreX = visage->x + visage->width/2;
+        e.centreY = visage->y + visage->height/2;
+        e.largeur = visage->width;
+        e.hauteur = visage->height;
+        e.scoreSourire = (uint8_t)(etatExpression.scoreSourire*255);
+        e.scoreOeilGauche = (uint8_t)(etatExpression.scoreOeilGauche*255);
+        e.scoreOeilDroit = (uint8_t)(etatExpression.scoreOeilDroit*255);
+    }
+    e.etatPrecedent = etatPrecedent;
+    journal->ajouter(e);
 
-    if (leftEye.size() > 0){ // Si des yeux ont été détectés on return true.
-       return true;
-    } else {// si aucun oeil n'est détecté on return false.
-        return false;
+    if (e.etat != etatPrecedent){ // changement d'expression ou apparition / disparition du visage.
+        e.type = ENREGISTREMENT_TRANSITION;
+        journal->ajouter(e);
     }
+    etatPrecedent = e.etat;
 }
 
 /*
@@ -354,22 +591,34 @@ bool ProjetSY25main::detectLeftEye(Mat frame){
  */
 void ProjetSY25main::handleServo(int faceCenterX, int faceCenterY){
 
-    // gestion de l'alignement horizontal.
-    // tolérance de ± 20 px pour le centre
-
-    if(faceCenterX<300){
-        transmitCmd("H");
-    }
-    else if(faceCenterX>340){
-        transmitCmd("h");
-    }
-    // gestion de l'alignement vertical.
-    // tolérance de ± 20 px pour le centre
-    if(faceCenterY<220){
-        transmitCmd("V");
+    // Les commandes des deux axes partent en une seule écriture (l'arduino lit les octets un par un).
+    // tolérance de ± 20 px autour du centre de l'image par défaut (voir controleurservo.h).
+    // Avec la télémétrie : angles des servos pendant la capture de l'image et commandes pas encore exécutées sont pris en compte.
+    // Sans : correction en une fois (calibration de la caméra), puis plus de correction tant que le mouvement n'est pas fini.
+    char commande[2*MAX_PAS_PAR_AXE + 1];
+    int n = 0;
+    EtatServos capture;
+    double cibleH, cibleV;
+    lireRetourServo(); // trames arrivées pendant le traitement de l'image.
+    if (parametres.compensationServo && telemetrie.etat(trame.horodatage, capture)
+            && telemetrie.ciblesAttendues(MesureLatence::horloge(), cibleH, cibleV)){
+        n = controleurServo.commanderCompense(faceCenterX, faceCenterY, capture, cibleH, cibleV, commande);
+    } else if (parametres.correctionServo == "pas"){
+        n = controleurServo.commander(faceCenterX, faceCenterY, commande);
+    } else if (trame.horodatage >= finCorrection){ // image prise après la fin du mouvement précédent.
+        double duree;
+        n = controleurServo.commanderDirect(faceCenterX, faceCenterY, commande, duree);
+        if (n > 0){ // la commande part maintenant, le servo s'arrête "duree" plus tard (plus la marge de la liaison et du servo).
+            finCorrection = MesureLatence::horloge() + (uint64_t)((duree + MARGE_CORRECTION) * 1e6);
+        }
     }
-    else if(faceCenterY>260){
-        transmitCmd("v");
+
+    latence.marquer(ETAPE_SERVO);
+    if (n > 0){
+        transmitCmd(commande);
+        if (detecteurMouvement){ // la caméra va bouger : l'image suivante doit être analysée.
+            detecteurMouvement->forcer();
+        }
     }
 }
 
@@ -383,39 +632,106 @@ void ProjetSY25main::handleServo(int faceCenterX, int faceCenterY){
 Mat ProjetSY25main::detectFace(Mat frame){
 
     vector<Rect> faces;
-    face_cascade.detectMultiScale(frame,faces,1.1,2,0 | CV_HAAR_SCALE_IMAGE,Size(90,90)); // detection de visages sur l'image (de taille minimum 90 px * 90 px)
+    imageAnalysee = true;
+
+    // Réglages de [detection], réduits par le contrôleur de qualité : son niveau 0 (échelle 1, facteur 1.1, période 1)
+    // les garde tels quels, les niveaux suivants multiplient l'échelle et la période et relèvent le facteur.
+    detecteur.reglages.echelle = reglagesDetection.echelle;
+    detecteur.reglages.facteurEchelle = reglagesDetection.facteurEchelle;
+    int periodeExpression = reglagesDetection.periodeExpression;
+    if (controleurQualite){
+        const NiveauQualite &niveau = controleurQualite->niveau();
+        detecteur.reglages.echelle *= niveau.echelle;
+        detecteur.reglages.facteurEchelle = std::max(detecteur.reglages.facteurEchelle, niveau.facteurEchelle);
+        periodeExpression *= niveau.periodeExpression;
+    }
+
+    // Image de détection réduite et égalisée, puis cascade de visage (voir detecteurvisage.h).
+    // Avec le suivi, seule la fenêtre autour de la position prédite du visage est préparée et parcourue ;
+    // avec la préférence pour les visages reconnus, une image sur periodeImageEntiere l'est en entier (autres visages).
+    Rect zone(0, 0, frame.cols, frame.rows);
+    if (suivi){
+        bool imageEntiere = reconnaissance && parametres.preferenceConnus && parametres.periodeImageEntiere > 0
+                && ++imagesDepuisImageEntiere >= parametres.periodeImageEntiere;
+        zone = suivi->zoneRecherche(trame.horodatage, gyroscope, imageEntiere);
+        if (zone.width == frame.cols && zone.height == frame.rows)
+            imagesDepuisImageEntiere = 0;
+    }
+    detecteur.detecterVisages(frame, zone, faces);
+    latence.marquer(ETAPE_DETECTION);
+    // Visage suivi : le plus grand, ou avec la reconnaissance le plus grand des visages reconnus.
+    int choisi = reconnaissance ? reconnaitreVisages(frame, faces, zone) : DetecteurVisage::plusGrand(faces);
+    if (suivi){
+        if (reconnaissance && choisi >= 0 && numerosPistes[choisi] != pisteSuivie){ // autre personne : nouvelle prédiction.
+            pisteSuivie = numerosPistes[choisi];
+            suivi->changerVisage();
+        }
+        suivi->resultat(choisi < 0 ? 0 : &faces[choisi]);
+    }
 
 
     if (faces.size()>0){ // Si au moins un visage est détecté.
 
-        plusGrandRectangle=0;
-        indicePlusGrand =0;
+        indicePlusGrand = choisi; // On vient chercher le plus grand des visages détectés (ou le plus grand des visages reconnus).
 
-        for(size_t i=0;i<faces.size();i++) // Boucle qui vient chercher le plus grand des visages détectés.
-        {
-            if (faces[i].width*faces[i].height>plusGrandRectangle){ // Si le rectangle ainsi calculé est le plus grand.
-                plusGrandRectangle = faces[i].width*faces[i].height; // On calcule la taille du rectangle
-                indicePlusGrand = i;
+        // Recadrage pleine résolution du visage (avant toute annotation de l'image), écrit en tâche de fond.
+        if (recadrage){
+            Mat y, u, v;
+            if (recadrage->recadrer(trame, faces[indicePlusGrand], y, u, v)){
+                if (parametres.couleurRecadrages){
+                    sauvegardeVisages->ajouter(y, u, v);
+                } else {
+                    sauvegardeVisages->ajouter(y);
+                }
             }
         }
 
-        Mat zone = frame(faces[indicePlusGrand]); // On créé une image de taille du visage détecté (pour que les détections de sourire et d'yeux soient plus rapides)
-
-        Rect rectGauche(0, 0, (faces[indicePlusGrand].width/2)-1, faces[indicePlusGrand].height-1); // Rectangle pour l'oeil gauche (visage coupé en 2 dans la hauteur)
-        Rect rectDroite((faces[indicePlusGrand].width)/2, 0 ,(faces[indicePlusGrand].width/2)-1,faces[indicePlusGrand].height-1); // Rectangle pour l'oeil droit (visage coupé en 2 dans la hauteur)
+        Expression expression = EXPRESSION_NEUTRE;
+        bool sourirePrecedent = visagePresent && etatExpression.smile;
 
-        Mat zoneGauche = zone(rectGauche); // On créé une image contenant la moité gauche du visage
-        Mat zoneDroite = zone(rectDroite); // idem pour le coté droit.
+        // En qualité réduite, l'expression n'est analysée qu'une image sur periodeExpression (toujours à l'apparition d'un visage).
+        if (visagePresent && ++compteurExpression % periodeExpression != 0){
+            expression = derniereExpression; // etatExpression garde le résultat précédent.
+        }
+        else if (classifieur.estCharge()){ // Le classifieur donne directement l'expression, sans points ni cascades.
+            expression = classifieur.classer(frame, faces[indicePlusGrand]);
+            etatExpression = ClassifieurExpression::versEtat(expression);
+            if (++nbImagesClassees % 100 == 0){
+                qDebug() << classifieur.rapportTemps().c_str();
+            }
+        }
+        // Un seul passage du modèle de points remplace les trois cascades (et donne des scores continus).
+        else if (!estimateur.estimer(frame, faces[indicePlusGrand], etatExpression)){
+            // Sinon sourire et yeux par les cascades (internes : elles réutilisent la pyramide du visage).
+            detecteur.detecterExpression(frame, faces[indicePlusGrand], etatExpression);
+        }
 
-        /*bool smile = detectSmile(zone); // détection d'un éventuel sourire.
-        bool leftEye = detectLeftEye(zoneGauche); // détection oeil gauche.
-        bool rightEye = detectRightEye(zoneDroite); // détection oeil droit.*/
+        derniereExpression = expression;
+        latence.marquer(ETAPE_EXPRESSION);
 
+        if (classifieur.estCharge()){
+            displayExpression(expression);
+        } else {
+            displaySmiley(etatExpression.smile, etatExpression.leftEye, etatExpression.rightEye);
+        }
 
-        displaySmiley(detectSmile(zone)/* détection du sourire*/, detectLeftEye(zoneGauche)/* détection de l'oeil gauche*/, detectRightEye(zoneDroite)/* détection de l'oeil droit*/);
+        // Evènements pour l'enregistreur : apparition d'un visage, début d'un sourire.
+        if (enregistreur){
+            if (!visagePresent){
+                enregistreur->signalerEvenement("visage");
+            } else if (etatExpression.smile && !sourirePrecedent){
+                enregistreur->signalerEvenement("sourire");
+            }
+        }
+        visagePresent = true;
+        dernierVisage = faces[indicePlusGrand];
+        journaliserDetection(&faces[indicePlusGrand]);
 
 
         rectangle(frame, faces[indicePlusGrand], CV_RGB(0, 0,0), 2); // Dessine un rectangle autour du visage détecté.
+        if (reconnaissance){
+            annoterIdentites(frame, faces);
+        }
         faceCenterX = faces[indicePlusGrand].x +0.5*faces[indicePlusGrand].width; // calcule l'abscisse du centre du visage
         faceCenterY = faces[indicePlusGrand].y + 0.5*faces[indicePlusGrand].height; // calcule l'ordonnée du centre du visage
         Point centreVisage(faceCenterX, faceCenterY); // définit un point.
@@ -426,6 +742,8 @@ Mat ProjetSY25main::detectFace(Mat frame){
         handleServo(faceCenterX, faceCenterY);
 
     }else { // Si on a pas réussi à identifier un visage, on affiche une croix sur le panneau led.
+        visagePresent = false;
+        journaliserDetection(0);
         // pas de visage
         uint8_t noFace[8][8][3] = {
             {{0,   0,   0}, {0,   0,   0}, {0,  0,   0}, {0, 0,   0}, {0, 0,   0}, { 0, 0,   0}, {  0, 0,  0}, {  0, 0, 0}},
@@ -445,32 +763,294 @@ Mat ProjetSY25main::detectFace(Mat frame){
                 }
          }
     }
+
+    // Fenêtre de recherche, tracée en dernier : recadrage, classifieur et expression lisent l'image sans annotation.
+    if (suivi && zone.area() < frame.cols*frame.rows){
+        rectangle(frame, zone, CV_RGB(128, 128, 128), 1);
+    }
 return frame;
 }
 
+/*
+ * Reconnaissance : résultats arrivés depuis l'image précédente, pistes des visages de cette image, puis visages de qualité
+ * confiés au thread de la reconnaissance (seul le visage suivi pendant un enrôlement). Seule la normalisation du visage
+ * (64x64 pixels) et sa qualité sont calculées ici ; une piste déjà reconnue ne coûte plus rien.
+ */
+int ProjetSY25main::reconnaitreVisages(const Mat &frame, const vector<Rect> &faces, const Rect &zone){
+
+    vector<ResultatReconnaissance> resultats;
+    reconnaissance->resultats(resultats);
+    for (size_t i = 0; i < resultats.size(); i++){
+        pistes.identifier(resultats[i].piste, resultats[i].identite, resultats[i].similarite);
+    }
+
+    pistes.mettreAJour(faces, numerosPistes, zone);
+    int choisi = pistes.choisir(faces, numerosPistes, parametres.preferenceConnus);
+
+    bool enrolement = !parametres.nomEnrolement.isEmpty();
+    for (size_t i = 0; i < faces.size(); i++){
+        PisteVisage *piste = pistes.piste(numerosPistes[i]);
+        if (enrolement ? ((int)i != choisi || enrolementsSoumis >= parametres.echantillonsEnrolement
+                          || trame.horodatage - dernierEnrolement < (uint64_t)parametres.periodeEnrolement * 1000)
+                       : (piste->enAttente || piste->essais >= parametres.essaisReconnaissance)){
+            continue;
+        }
+        if (faces[i].width < parametres.tailleMinReconnaissance){
+            continue;
+        }
+        Mat visage;
+        DescripteurVisage::normaliser(frame, faces[i], visage);
+        QualiteVisage qualite = DescripteurVisage::qualite(visage, faces[i].width);
+        if (enrolement){
+            if (pistes.qualiteSuffisante(qualite) && reconnaissance->enroler(parametres.nomEnrolement, visage)){
+                dernierEnrolement = trame.horodatage;
+                if (++enrolementsSoumis == parametres.echantillonsEnrolement){
+                    qDebug() << "enrôlement de" << parametres.nomEnrolement << "terminé :" << enrolementsSoumis << "images";
+                }
+            }
+        } else if (pistes.aReconnaitre(numerosPistes[i], qualite) && !reconnaissance->soumettre(numerosPistes[i], visage)){
+            pistes.annulerDemande(numerosPistes[i]); // file pleine : une prochaine image de ce visage sera proposée.
+        }
+    }
+    return choisi;
+}
+
+/*
+ * Nom des personnes reconnues au dessus de leur visage ("?" pour un inconnu), avec la similarité pour régler le seuil.
+ */
+void ProjetSY25main::annoterIdentites(Mat &frame, const vector<Rect> &faces){
+
+    for (size_t i = 0; i < faces.size() && i < numerosPistes.size(); i++){
+        PisteVisage *piste = pistes.piste(numerosPistes[i]);
+        if (piste && piste->reconnue){
+            char texte[NOM_IDENTITE_MAX + 16];
+            snprintf(texte, sizeof(texte), "%s %.2f", piste->identite.empty() ? "?" : piste->identite.c_str(), piste->similarite);
+            putText(frame, texte, Point(faces[i].x, std::max(faces[i].y - 6, 12)), FONT_HERSHEY_SIMPLEX, 0.5, CV_RGB(255, 255, 255), 1);
+        }
+    }
+}
+
+/*
+ * Fonction appelée à la place de detectFace() quand la scène n'a pas bougé.
+ */
+void ProjetSY25main::reutiliserDetection(Mat frame){
+
+    if (visagePresent){
+        journaliserDetection(&dernierVisage);
+        rectangle(frame, dernierVisage, CV_RGB(0, 0,0), 2); // même annotation que lors de la détection.
+        Point centreVisage(dernierVisage.x + dernierVisage.width/2, dernierVisage.y + dernierVisage.height/2);
+        circle(frame, centreVisage, 2, CV_RGB(0, 0,0), 2, 8,0 );
+    } else {
+        journaliserDetection(0);
+    }
+}
+
+/*
+ * Fonction qui transmet le temps de traitement de l'image au contrôleur de qualité
+ * et affiche / journalise ses décisions.
+ */
+void ProjetSY25main::ajusterQualite(uint64_t horodatageCapture){
+
+    uint64_t maintenant = MesureLatence::horloge();
+    if (maintenant - lectureTemperature > 3000000){ // la température varie lentement : lue toutes les 3 s.
+        temperatureCpu = carte.getCpuTemperature();
+        lectureTemperature = maintenant;
+    }
+
+    DecisionQualite decision;
+    if (!controleurQualite->mettreAJour((maintenant - horodatageCapture) / 1000.0, temperatureCpu, maintenant, decision)){
+        return;
+    }
+
+    qDebug() << "qualité : niveau" << decision.ancienNiveau << "->" << decision.nouveauNiveau
+             << "(" << ControleurQualite::nomRaison(decision.raison) << "," << decision.dureeMoyenne << "ms,"
+             << decision.temperature << "C )";
+
+    if (journal){
+        EnregistrementJournal e;
+        memset(&e, 0, sizeof(e));
+        e.numeroImage = numeroImage;
+        e.type = ENREGISTREMENT_QUALITE;
+        e.etat = decision.nouveauNiveau;
+        e.etatPrecedent = decision.ancienNiveau;
+        e.reserve = decision.raison;
+        e.centreX = (int16_t)std::min(decision.dureeMoyenne*10, 32767.f);
+        e.centreY = (int16_t)(decision.temperature*10);
+        journal->ajouter(e);
+    }
+    if (serveurMJPEG){
+        serveurMJPEG->publierTexte("/qualite.txt", QByteArray(controleurQualite->rapport().c_str()));
+    }
+}
+
 /*
  *Fonction qui s'occupe de capturer une image et de l'afficher dans le label associé.
  */
 void ProjetSY25main::capturePicture(){
 
-    camera.grab(); // On capture une image
-    camera.retrieve(image); // On stocke l'image dans une image (sous forme de Mat)
-    flip(image,image,0); // On la retourne (à l'envers par défaut)
-    detectFace(image); // On fait toutes les détections.
+    if (!source->acquerir(trame)){ // On capture une image (pas d'image, ou tampon encore utilisé : on attend le tour suivant)
+        return;
+    }
+    numeroImage++; // numéro de l'image, repris dans le journal
+    if (simulateur){ // pas de readyRead pour la nacelle simulée : sa sortie est lue à chaque image.
+        lireRetourServo();
+    }
+    latence.debutImage(trame.horodatage, trame.debutLecture); // les latences sont comptées depuis la capture de l'image.
+    latence.marquer(ETAPE_ACQUISITION); // réduction / conversion de l'image par la source, et lecture de la nacelle simulée.
+    Mat image = trame.luminance; // vue sur le tampon de la caméra (sous le bail de la trame), déjà à l'endroit, sans copie ni conversion
+    imageAnalysee = false;
+    if (gyroscope){ // instant de l'image dans le journal du gyroscope, et image brute pour l'outil SuiviInertiel.
+        gyroscope->journaliserImage(trame.horodatage, numeroImage);
+        if (!parametres.videoImu.isEmpty()){
+            if (!videoImu.isOpened()){
+                videoImu.open(parametres.videoImu.toStdString(), VideoWriter::fourcc('M','J','P','G'), 1000.0/intervalleCapture, image.size(), false);
+            }
+            videoImu.write(image);
+        }
+    }
+    if (calibrationAuto){ // calibration en cours : pas de détection, la nacelle suit la séquence de calibration.
+        poursuivreCalibration(image);
+    } else if (!detecteurMouvement || detecteurMouvement->detectionNecessaire(image, trame.horodatage)){
+        detectFace(image); // On fait toutes les détections.
+    } else {
+        reutiliserDetection(image); // scène immobile : le résultat précédent est toujours valable.
+    }
+    latence.finImage();
+    if (parametres.periodeRapportLatence > 0 && numeroImage % parametres.periodeRapportLatence == 0){
+        std::string rapport = latence.rapport();
+        if (telemetrie.nombreTrames() > 0){ // latences des servos, vues par la télémétrie.
+            rapport += telemetrie.rapport();
+        }
+        if (suivi){
+            rapport += suivi->rapport();
+        }
+        if (gyroscope){
+            rapport += gyroscope->rapport();
+        }
+        if (recadrage){
+            rapport += recadrage->rapport();
+        }
+        if (reconnaissance){
+            rapport += pistes.rapport() + reconnaissance->rapport();
+        }
+        qDebug() << rapport.c_str();
+        if (detecteurMouvement){
+            qDebug() << "détection de mouvement :" << detecteurMouvement->imagesIgnorees() << "images sans détection sur"
+                     << detecteurMouvement->imagesIgnorees() + detecteurMouvement->imagesAnalysees();
+        }
+        if (detecteur.cascadesInternes()){
+            qDebug() << detecteur.rapportTemps().c_str();
+        }
+        if (serveurMJPEG){
+            serveurMJPEG->publierTexte("/latence.txt", QByteArray(rapport.c_str()));
+            if (controleurQualite){
+                serveurMJPEG->publierTexte("/qualite.txt", QByteArray(controleurQualite->rapport().c_str()));
+            }
+        }
+    }
+    if (enregistreur){
+        enregistreur->ajouterImage(image); // copie de l'image annotée pour l'enregistrement (perdue si l'encodage est en retard).
+    }
+    if (serveurMJPEG){
+        serveurMJPEG->publierImage(image); // encodée seulement si quelqu'un regarde le flux.
+    }
     QImage image2 = cvMatToQImage(image); // On convertit l'image en QImage
     photoLabel->setPixmap(QPixmap::fromImage(image2)); // Puis on l'affiche dans l'interface utilisateur.
+    if (controleurQualite && imageAnalysee){ // temps total de l'image, de la capture à l'affichage.
+        ajusterQualite(trame.horodatage);
+    }
+    image.release(); // l'affichage a sa propre copie : la vue et la trame rendent le bail, la caméra peut réutiliser son tampon.
+    trame.liberer();
+}
+
+/*
+ * Fonction qui donne l'image à la calibration automatique, envoie ses commandes et, à la fin, applique et enregistre le résultat.
+ */
+void ProjetSY25main::poursuivreCalibration(Mat image)
+{
+    char commande[2*MAX_PAS_PAR_AXE + 1];
+    int n = calibrationAuto->image(image, trame.horodatage, commande);
+    if (n > 0){
+        transmitCmd(commande);
+    }
+    if (!calibrationAuto->terminee()){
+        return;
+    }
+    qDebug() << calibrationAuto->rapport().c_str();
+    if (calibrationAuto->reussie()){
+        controleurServo.calibration = calibrationAuto->resultat();
+        if (suivi){
+            suivi->calibration = controleurServo.calibration;
+        }
+        parametres.champHorizontal = controleurServo.calibration.champHorizontal;
+        parametres.champVertical = controleurServo.calibration.champVertical;
+        if (!parametres.enregistrerCalibration()){
+            qWarning() << "calibration non enregistrée :" << parametres.fichierCalibration;
+        }
+    } else {
+        qWarning() << "calibration automatique refusée, champ de la caméra inchangé";
+    }
+    delete calibrationAuto;
+    calibrationAuto = 0;
+}
+
+/*
+ * Veille de la session de capture : l'image est seulement regardée (exposition), puis rendue à la caméra.
+ */
+void ProjetSY25main::entretenirSession(){
+
+    if (!source->acquerir(trame)){
+        return;
+    }
+    sessionPhoto.observer(trame.luminance, trame.horodatage);
+    trame.liberer();
 }
 
 /*
  * appelé lors de click sur le bouton takePic
  * Fonctionne uniquement quand on ne capture pas de vidéo (sinon le bouton est grisé/désactivé).
+ * Avec la session de capture, l'exposition est déjà stable : la photo est l'image suivante (ou la plus nette de la rafale).
+ * La photo est affichée telle qu'elle est écrite, sans annotations ; l'écriture se fait en tâche de fond.
  */
 void ProjetSY25main::on_takepicBtn_clicked(){
 
-    if(camera.open()){ // si la caméra s'est bien ouverte.
-        capturePicture();
-        camera.release();
-     }
+    bool sessionFroide = !source->estOuverte(); // sans session : la caméra n'est ouverte que pour cette photo.
+    if (sessionFroide){
+        if (!source->ouvrir()){
+            return;
+        }
+        sessionPhoto.reinitialiser();
+    }
+
+    // Images jusqu'à une rafale complète d'images bien exposées (ou jusqu'à l'attente maximum).
+    uint64_t clic = MesureLatence::horloge();
+    sessionPhoto.debutRafale(clic, parametres.rafalePhoto);
+    while (!sessionPhoto.rafaleComplete() && MesureLatence::horloge() - clic < (uint64_t)parametres.attenteMaxPhoto * 1000){
+        if (!source->acquerir(trame)){
+            break;
+        }
+        sessionPhoto.observer(trame.luminance, trame.horodatage);
+        if (sessionPhoto.expositionStable()){
+            sessionPhoto.proposer(trame.luminance, trame.horodatage);
+        }
+        trame.liberer();
+    }
+    if (sessionFroide){
+        source->fermer();
+    }
+
+    Mat photo;
+    if (!sessionPhoto.photo(photo)){ // ni rafale ni image de veille bien exposée.
+        qWarning() << "pas d'image bien exposée pour la photo";
+        return;
+    }
+    QString chemin = sauvegardePhotos->ajouter(photo);
+    if (chemin.isEmpty()){
+        qWarning() << "photo perdue : écriture en retard";
+    }
+    QImage image2 = cvMatToQImage(photo);
+    photoLabel->setPixmap(QPixmap::fromImage(image2));
+    qDebug() << chemin << sessionPhoto.rapport().c_str();
 }
 /*
  * appelé lors de click sur le bouton Vidéo
@@ -478,17 +1058,24 @@ void ProjetSY25main::on_takepicBtn_clicked(){
 void ProjetSY25main::on_videoBtn_clicked(){
 
     takepicBtn->setEnabled(false); // On désactive le bouton pour prendre une photo.
+    if (minuterieVeille){ // la vidéo prend toutes les images : plus besoin de veille.
+        minuterieVeille->stop();
+    }
     initPort(); // On initialise la liaison série
-    if(camera.open()){ // si la caméra s'est bien ouverte.
+    if(source->ouvrir()){ // si la caméra s'est bien ouverte.
            videoBtn->setText("Stop");
+           if (parametres.calibrationAuto && !calibrationAuto){ // les premières secondes servent à la calibration.
+               calibrationAuto = new CalibrationAuto(controleurServo.calibration, parametres.amplitudeCalibration,
+                                                     ControleurServo::dureeDeplacement(parametres.amplitudeCalibration) + MARGE_CORRECTION);
+           }
            QTimer *timer = new QTimer();
            connect(timer, SIGNAL(timeout()), this, SLOT(capturePicture())); // lorsqu'on arrive à la fin du timer on prend une photo
-           timer->setInterval(120); // définition de l'intervalle du timer (on prendra une photo toutes les 120 ms).
+           timer->setInterval(intervalleCapture); // définition de l'intervalle du timer (on prendra une photo toutes les 120 ms).
            timer->start(); // on démarre le timer
     }else{
         videoBtn->setText("Video");
         takepicBtn->setEnabled(true); // On réactive le bouton pour prendre une photo
-        camera.release(); // On libère la caméra.
+        source->fermer(); // On libère la caméra.
     }
 }
 
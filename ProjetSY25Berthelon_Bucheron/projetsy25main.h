@@ -11,7 +11,7 @@
 #define PROJETSY25MAIN_H
 
 #include "ui_projetsy25main.h"
-#include <raspicam/raspicam_cv.h>
+#include "sourceimages.h"
 #include <QTimer>
 #include <QDebug>
 #include <QImage>
@@ -22,6 +22,25 @@
 #include <stdio.h>
 #include <cv.h>
 #include "SenseHat.h"
+#include "estimateurexpression.h"
+#include "classifieurexpression.h"
+#include "parametres.h"
+#include "enregistreur.h"
+#include "serveurmjpeg.h"
+#include "journalevenements.h"
+#include "mesurelatence.h"
+#include "detecteurmouvement.h"
+#include "controleurqualite.h"
+#include "detecteurvisage.h"
+#include "controleurservo.h"
+#include "simulateurnacelle.h"
+#include "suivivisage.h"
+#include "lecturegyroscope.h"
+#include "sessionphoto.h"
+#include "sauvegardephotos.h"
+#include "recadragevisage.h"
+#include "pistesvisages.h"
+#include "reconnaissancevisage.h"
 
 #include <QtSerialPort/QSerialPort>
 
@@ -35,6 +54,7 @@ class ProjetSY25main : public QMainWindow, private Ui::ProjetSY25main
 
 public:
     explicit ProjetSY25main(QWidget *parent = 0);
+    ~ProjetSY25main();
 
     /*
      * Fonction qui configure la raspicam au lancement de l'application
@@ -57,25 +77,13 @@ public:
      *
      */
     Mat detectFace(Mat);
-
-    /*
-     * Fonction de détection de sourire sur le visage détecté
-     * prend en entrée la zone image correspondant au visage détecté à analyser
-     * et retourne un boolean ( true si sourire détecté, false sinon)
-     */
-    bool detectSmile(Mat);
-    /*
-     * Fonction de détection de l'oeil droit sur le visage détecté
-     * prend en entrée la zone image correspondant à la moitié droite du visage à analyser
-     * et retourne un boolean ( true si oeil détecté, false sinon)
-     */
-    bool detectRightEye(Mat);
     /*
-     * Fonction de détection de sourire sur le visage détecté
-     * prend en entrée la zone image correspondant à la moitié gauche du visage à analyser
-     * et retourne un boolean ( true si oeil détecté, false sinon)
+     * Pistes et identités des visages de l'image, visages de qualité confiés à la reconnaissance (ou à l'enrôlement).
+     * zone : partie de l'image où les visages ont été cherchés. Retourne l'indice du visage à suivre.
      */
-    bool detectLeftEye(Mat);
+    int reconnaitreVisages(const Mat &frame, const vector<Rect> &faces, const Rect &zone);
+    // Nom des personnes reconnues (et similarité) au dessus de leur visage.
+    void annoterIdentites(Mat &frame, const vector<Rect> &faces);
 
     /*
      * Fonction ayant pour but de gérer et transmettre les commandes aux servomoteurs.
@@ -91,6 +99,35 @@ public:
      */
     void displaySmiley(bool smile, bool leftEye, bool rightEye);
 
+    /*
+     * Fonction qui affiche l'expression trouvée par le classifieur sur le SenseHat (panneau led)
+     * Les combinaisons sourire / yeux passent par displaySmiley(), la surprise et la tristesse ont leur propre motif.
+     */
+    void displayExpression(Expression expression);
+
+    /*
+     * Fonction qui ajoute le résultat de la détection au journal binaire (et une transition si l'état a changé).
+     * visage vaut null si aucun visage n'a été détecté.
+     */
+    void journaliserDetection(const Rect *visage);
+
+    /*
+     * Fonction appelée à la place de detectFace() quand la scène n'a pas bougé :
+     * le résultat précédent est gardé (rectangle redessiné, panneau led inchangé, aucune commande aux servos).
+     */
+    void reutiliserDetection(Mat frame);
+
+    /*
+     * Fonction qui transmet le temps de traitement de l'image au contrôleur de qualité
+     * et affiche / journalise ses décisions.
+     */
+    void ajusterQualite(uint64_t horodatageCapture);
+
+    /*
+     * Fonction appelée à la place de detectFace() pendant la calibration automatique (voir calibrationcamera.h).
+     */
+    void poursuivreCalibration(Mat image);
+
 
 private slots:
 
@@ -117,19 +154,68 @@ private slots:
 
     void on_videoBtn_clicked();
 
+    /*
+     * Lit les octets renvoyés par l'arduino (readyRead du port série) ou par la nacelle simulée :
+     * trames de télémétrie pour "telemetrie", texte affiché.
+     */
+    void lireRetourServo();
+
+    /*
+     * Veille de la session de capture entre deux photos : une image de temps en temps pour suivre l'exposition.
+     */
+    void entretenirSession();
+
 private:
 
     // port série utilisé pour communiquer avec la carte arduino qui controle les moteurs.
     QSerialPort port;
+    // Décision des commandes envoyées aux servomoteurs (voir handleServo()).
+    ControleurServo controleurServo;
+    // Nacelle simulée qui remplace l'arduino et la raspicam (null sauf avec [servo] simulation=true).
+    SimulateurNacelle *simulateur = 0;
+    // Télémétrie des servos renvoyée par l'arduino : angles datés, latences d'exécution des commandes.
+    TelemetrieServo telemetrie;
+    // Correction en une fois sans télémétrie : fin estimée du dernier mouvement (MesureLatence::horloge()).
+    uint64_t finCorrection = 0;
+    // Calibration automatique en cours (null sinon).
+    CalibrationAuto *calibrationAuto = 0;
+    // Suivi du visage : fenêtre de recherche autour de sa position prédite (null sauf avec [suivi] actif=true).
+    SuiviVisage *suivi = 0;
+    // Gyroscope du SenseHat monté sur la nacelle et thread qui le lit (null sauf avec [imu] actif=true).
+    Gyroscope *gyroscope = 0;
+    LectureGyroscope *lectureGyroscope = 0;
+    // Images brutes enregistrées avec le journal du gyroscope pour l'outil SuiviInertiel ([imu] video).
+    VideoWriter videoImu;
 
-    // Objet caméra pour utiliser la raspicam.
-    raspicam::RaspiCam_Cv camera;
-    // Image renvoyée par la camera.
-    cv::Mat image;
+    // Source des images : la raspicam (plan Y du YUV420, sans copie) ou un fichier vidéo rejoué.
+    SourceImages *source = 0;
+    // Trame en cours de traitement : son image est une vue sur le tampon de la source, rendue à la fin de capturePicture().
+    TrameCapture trame;
     // image affichée dans l'interface de l'application.
     QImage image2;
     // Timer utilisé pour la capture vidéo (intervalle entre chque prise d'image)
     QTimer* timer;
+    // Intervalle entre deux prises d'image en vidéo (ms).
+    int intervalleCapture = 120;
+    // Photos : exposition et rafale (voir sessionphoto.h), écriture en tâche de fond,
+    // et timer de la veille de la session (null sans [photo] session=true ou pendant la vidéo).
+    SessionPhoto sessionPhoto;
+    SauvegardePhotos *sauvegardePhotos = 0;
+    QTimer *minuterieVeille = 0;
+    // Recadrages pleine résolution du visage pendant la vidéo et leur écriture (null sans [visages] actif=true).
+    RecadrageVisage *recadrage = 0;
+    SauvegardePhotos *sauvegardeVisages = 0;
+    // Reconnaissance des visages (null sans [reconnaissance] actif=true) : pistes et identités gardées dans la boucle,
+    // descripteurs et recherche dans la base en tâche de fond.
+    ReconnaissanceVisage *reconnaissance = 0;
+    PistesVisages pistes;
+    vector<int> numerosPistes;
+    // suivi avec reconnaissance : images analysées depuis la dernière image entière, piste du visage suivi.
+    int imagesDepuisImageEntiere = 0;
+    int pisteSuivie = 0;
+    // enrôlement : images confiées, instant (µs) de la dernière.
+    int enrolementsSoumis = 0;
+    uint64_t dernierEnrolement = 0;
     //
     Mat frame;
     // SenseHat est utilisé pour afficher les smileys sur le panneau de leds.
@@ -137,14 +223,46 @@ private:
     // Compose chaque pixel du panneau led.
     uint16_t pixel;
 
-    // La base de données de la reconnaissance de visage
-    CascadeClassifier face_cascade;
-    // La base de données de la reconnaissance de sourire
-    CascadeClassifier smile_cascade;
-    // La base de données de la reconnaissance d'oeil gauche
-    CascadeClassifier left_eye_cascade;
-    // La base de données de la reconnaissance d'oeil droit
-    CascadeClassifier right_eye_cascade;
+    // Les cascades de visage, sourire et yeux, et la préparation de l'image de détection (partagées avec TraitementLot).
+    DetecteurVisage detecteur;
+    // Réglages de [detection] (niveau de qualité 0, éventuellement trouvés par ReglageDetection), réduits par le contrôleur de qualité.
+    ReglagesDetection reglagesDetection;
+
+    // Paramètres lus au lancement (voir parametres.h), et path jusqu'au fichier ini.
+    Parametres parametres;
+    QString config_path = "/home/pi/ProjetSY25.ini";
+
+    // Enregistrement des images annotées autour des évènements (null si désactivé dans les paramètres).
+    Enregistreur *enregistreur = 0;
+    // Diffusion MJPEG des images traitées (null si désactivée dans les paramètres).
+    ServeurMJPEG *serveurMJPEG = 0;
+
+    // Journal binaire des détections (null si désactivé dans les paramètres).
+    JournalEvenements *journal = 0;
+    // Numéro de l'image en cours (depuis le lancement) et état (bits ETAT_*) de l'image précédente pour le journal.
+    quint32 numeroImage = 0;
+    uint8_t etatPrecedent = 0;
+
+    // Latence de chaque étape, de la capture de l'image jusqu'à l'envoi de la commande aux servomoteurs.
+    MesureLatence latence;
+
+    // Détection de mouvement : les cascades ne tournent que si la scène a changé (null si désactivé dans les paramètres).
+    DetecteurMouvement *detecteurMouvement = 0;
+    // Dernier visage détecté, redessiné tant que la scène ne bouge pas.
+    Rect dernierVisage;
+
+    // Contrôleur de qualité (null si désactivé dans les paramètres) et dernière température du processeur lue.
+    ControleurQualite *controleurQualite = 0;
+    float temperatureCpu = 0;
+    uint64_t lectureTemperature = 0;
+    // Compteur pour n'analyser l'expression qu'une image sur periodeExpression, et dernière expression trouvée.
+    int compteurExpression = 0;
+    Expression derniereExpression = EXPRESSION_NEUTRE;
+    // L'image en cours est-elle passée par detectFace() ? (seules celles-là comptent pour le contrôleur)
+    bool imageAnalysee = false;
+
+    // Un visage était-il présent sur l'image précédente ? (pour signaler l'apparition d'un visage)
+    bool visagePresent = false;
 
     // path jusqu'aux bases de données associées.
     String face_cascade_path = "/usr/share/opencv/haarcascades/haarcascade_frontalface_default.xml";
@@ -153,9 +271,21 @@ private:
     String right_eye_cascade_path = "/usr/share/opencv/haarcascades/haarcascade_righteye_2splits.xml";
     String left_eye_cascade_path = "/usr/share/opencv/haarcascades/haarcascade_lefteye_2splits.xml";
 
-    // Rectangle de visage calculé ( ) qui définit la taille du visage détecté.
-    int plusGrandRectangle=0;
-    // Deux indices utilisés pour pointer vers le plus grand visage détecté dans le champ de la caméra.
+    // Estimation de l'expression par points caractéristiques (remplace les trois cascades si le modèle est présent).
+    EstimateurExpression estimateur;
+    // path jusqu'au modèle de points caractéristiques (https://github.com/kurnianggoro/GSOC2017/raw/master/data/lbfmodel.yaml)
+    String landmark_model_path = "/usr/share/opencv/lbfmodel.yaml";
+    // Dernière expression calculée (booléens et scores continus de sourire / ouverture des yeux).
+    EtatExpression etatExpression;
+
+    // Classifieur d'expression int8 (optionnel) : s'il est chargé, c'est lui qui décide du smiley affiché.
+    ClassifieurExpression classifieur;
+    // path jusqu'au fichier de poids du classifieur (format décrit dans classifieurexpression.h)
+    String expression_model_path = "/home/pi/expression_cnn8.bin";
+    // Nombre d'images classées, pour afficher régulièrement le temps passé dans chaque couche.
+    int nbImagesClassees = 0;
+
+    // Indice utilisé pour pointer vers le plus grand visage détecté dans le champ de la caméra.
     int indicePlusGrand =0;
 
     // définit le centre du visage détecté ( pour le suivi de visage)
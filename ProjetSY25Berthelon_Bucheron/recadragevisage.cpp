@@ -0,0 +1,72 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Zone du visage copiée de l'image pleine résolution.
+ */
+#include "recadragevisage.h"
+#include "mesurelatence.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+RecadrageVisage::RecadrageVisage(double marge, int periodeMs) :
+    marge(std::max(marge, 0.)),
+    periode((uint64_t)std::max(periodeMs, 0) * 1000)
+{
+}
+
+cv::Rect RecadrageVisage::versPleineResolution(const cv::Rect &visage, cv::Size detection, cv::Size pleine, double marge)
+{
+    double sx = (double)pleine.width / detection.width;
+    double sy = (double)pleine.height / detection.height;
+    double mx = visage.width * marge;
+    double my = visage.height * marge;
+    int x0 = std::max(0, (int)std::floor((visage.x - mx) * sx)) & ~1;
+    int y0 = std::max(0, (int)std::floor((visage.y - my) * sy)) & ~1;
+    int x1 = std::min(pleine.width, (int)std::ceil((visage.x + visage.width + mx) * sx)) & ~1;
+    int y1 = std::min(pleine.height, (int)std::ceil((visage.y + visage.height + my) * sy)) & ~1;
+    if (x1 <= x0 || y1 <= y0)
+        return cv::Rect();
+    return cv::Rect(x0, y0, x1 - x0, y1 - y0);
+}
+
+bool RecadrageVisage::recadrer(const TrameCapture &trame, const cv::Rect &visage, cv::Mat &y, cv::Mat &u, cv::Mat &v)
+{
+    if (!premier && trame.horodatage < dernier + periode)
+        return false;
+
+    uint64_t debut = MesureLatence::horloge();
+    const cv::Mat &pleine = trame.pleineY.empty() ? trame.luminance : trame.pleineY;
+    cv::Rect zone = versPleineResolution(visage, trame.luminance.size(), pleine.size(), marge);
+    if (zone.area() == 0)
+        return false;
+
+    // copies : les vues ne sont valides que sous le bail de la trame.
+    pleine(zone).copyTo(y);
+    if (!trame.pleineU.empty() && !trame.pleineV.empty()){
+        cv::Rect demi(zone.x / 2, zone.y / 2, zone.width / 2, zone.height / 2);
+        trame.pleineU(demi).copyTo(u);
+        trame.pleineV(demi).copyTo(v);
+    } else {
+        u.release();
+        v.release();
+    }
+
+    premier = false;
+    dernier = trame.horodatage;
+    nbRecadrages++;
+    sommePixels += zone.area();
+    sommeTemps += (MesureLatence::horloge() - debut) / 1000.;
+    return true;
+}
+
+std::string RecadrageVisage::rapport() const
+{
+    char texte[200];
+    snprintf(texte, sizeof(texte), "recadrages du visage : %llu pris, %.0f pixels en moyenne, copie %.2f ms en moyenne\n",
+             (unsigned long long)nbRecadrages, nbRecadrages > 0 ? sommePixels / nbRecadrages : 0.,
+             nbRecadrages > 0 ? sommeTemps / nbRecadrages : 0.);
+    return texte;
+}
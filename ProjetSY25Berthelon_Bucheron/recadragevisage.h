@@ -0,0 +1,60 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Recadrages pleine résolution du visage suivi, pris pendant la vidéo.
+ *
+ * La détection travaille en VGA, mais la caméra peut capturer plus grand ([camera] largeurCapteur / hauteurCapteur) :
+ * la source réduit alors elle-même l'image pour la détection et garde des vues sur l'image pleine résolution.
+ * Le rectangle du visage trouvé en coordonnées de détection est ramené à la pleine résolution, élargi d'une marge,
+ * et seule cette zone est copiée (plans Y, U, V du YUV420, sans conversion) : la conversion en couleur et la compression
+ * se font dans le thread de SauvegardePhotos, la boucle des images ne paie que la copie de quelques centaines de Ko.
+ *
+ * Le module photo de la raspicam (RaspiCam_Still) n'est pas utilisable ici : il ouvre son propre composant caméra,
+ * ce qui demande d'arrêter la vidéo pendant chaque photo.
+ */
+#ifndef RECADRAGEVISAGE_H
+#define RECADRAGEVISAGE_H
+
+#include "sourceimages.h"
+
+#include <opencv2/core/core.hpp>
+#include <stdint.h>
+#include <string>
+
+class RecadrageVisage
+{
+public:
+    /*
+     * marge : part de la taille du visage ajoutée de chaque côté ; periodeMs : intervalle minimum entre deux recadrages.
+     */
+    RecadrageVisage(double marge = 0.3, int periodeMs = 2000);
+
+    /*
+     * Copie la zone du visage (coordonnées de trame.luminance) dans y, u et v si le dernier recadrage date d'au moins periodeMs.
+     * u et v restent vides si la trame n'a pas de couleur. Sans image pleine résolution, la zone est prise dans la luminance.
+     * Retourne false si aucun recadrage n'est pris pour cette trame.
+     */
+    bool recadrer(const TrameCapture &trame, const cv::Rect &visage, cv::Mat &y, cv::Mat &u, cv::Mat &v);
+
+    /*
+     * Rectangle du visage en pleine résolution : mis à l'échelle, élargi de la marge, limité à l'image,
+     * coins sur des coordonnées paires pour tomber sur les pixels des plans U et V (demi résolution).
+     */
+    static cv::Rect versPleineResolution(const cv::Rect &visage, cv::Size detection, cv::Size pleine, double marge);
+
+    // Recadrages pris, taille moyenne, temps moyen de la copie, en texte.
+    std::string rapport() const;
+
+private:
+    double marge;
+    uint64_t periode; // µs
+    uint64_t dernier = 0;
+    bool premier = true;
+
+    uint64_t nbRecadrages = 0;
+    double sommePixels = 0;
+    double sommeTemps = 0; // ms
+};
+
+#endif // RECADRAGEVISAGE_H
@@ -0,0 +1,152 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Descripteurs et recherche dans la base des personnes en tâche de fond.
+ */
+#include "reconnaissancevisage.h"
+#include "descripteurvisage.h"
+#include "mesurelatence.h"
+
+#include <QDebug>
+#include <QMutexLocker>
+
+#include <cstdio>
+#include <ctime>
+
+ReconnaissanceVisage::ReconnaissanceVisage(const QString &fichierBase, const QString &format, double seuil, int listesSondees, int fileAttenteMax) :
+    fichierBase(fichierBase),
+    format(format == "demi" ? FORMAT_DEMI : FORMAT_INT8),
+    seuil(seuil),
+    listesSondees(listesSondees),
+    fileAttenteMax(fileAttenteMax)
+{
+}
+
+ReconnaissanceVisage::~ReconnaissanceVisage()
+{
+    arreter();
+}
+
+bool ReconnaissanceVisage::charger()
+{
+    bool ok = index.ouvrir(fichierBase.toStdString(), DIMENSION_DESCRIPTEUR, format);
+    QMutexLocker l(&verrou);
+    nbPersonnes = index.nombrePersonnes();
+    nbEchantillons = index.taille();
+    return ok;
+}
+
+bool ReconnaissanceVisage::confier(const Demande &demande)
+{
+    QMutexLocker l(&verrou);
+    if ((int)fileAttente.size() >= fileAttenteMax){ // la reconnaissance a pris du retard : ce visage attendra une autre image.
+        nbRefuses++;
+        return false;
+    }
+    fileAttente.push_back(demande);
+    visageDisponible.wakeOne();
+    return true;
+}
+
+bool ReconnaissanceVisage::soumettre(int piste, const cv::Mat &visage)
+{
+    Demande demande;
+    demande.piste = piste;
+    demande.visage = visage.clone();
+    return confier(demande);
+}
+
+bool ReconnaissanceVisage::enroler(const QString &nom, const cv::Mat &visage)
+{
+    Demande demande;
+    demande.piste = 0;
+    demande.visage = visage.clone();
+    demande.enrolement = nom;
+    return confier(demande);
+}
+
+void ReconnaissanceVisage::resultats(std::vector<ResultatReconnaissance> &nouveaux)
+{
+    QMutexLocker l(&verrou);
+    nouveaux.swap(sorties);
+    sorties.clear();
+}
+
+int ReconnaissanceVisage::nombrePersonnes()
+{
+    QMutexLocker l(&verrou);
+    return nbPersonnes;
+}
+
+std::string ReconnaissanceVisage::rapport()
+{
+    QMutexLocker l(&verrou);
+    char texte[250];
+    snprintf(texte, sizeof(texte), "reconnaissance : %llu visages (%llu reconnus), %.2f ms en moyenne, base de %d personnes "
+             "(%d échantillons), %d visages refusés (file pleine)\n",
+             (unsigned long long)nbReconnaissances, (unsigned long long)nbConnus,
+             nbReconnaissances > 0 ? sommeTemps / nbReconnaissances : 0., nbPersonnes, nbEchantillons, nbRefuses);
+    return texte;
+}
+
+/*
+ * Traite les visages en attente et arrête le thread.
+ */
+void ReconnaissanceVisage::arreter()
+{
+    {
+        QMutexLocker l(&verrou);
+        arret = true;
+        visageDisponible.wakeOne();
+    }
+    wait();
+}
+
+void ReconnaissanceVisage::run()
+{
+    std::vector<float> descripteur(DIMENSION_DESCRIPTEUR);
+
+    forever {
+        Demande demande;
+        {
+            QMutexLocker l(&verrou);
+            while (fileAttente.empty() && !arret)
+                visageDisponible.wait(&verrou);
+            if (fileAttente.empty()) // arrêt demandé et plus rien à traiter.
+                break;
+            demande = fileAttente.front();
+            fileAttente.pop_front();
+        }
+
+        uint64_t debut = MesureLatence::horloge();
+        DescripteurVisage::calculer(demande.visage, &descripteur[0]);
+
+        if (!demande.enrolement.isEmpty()){
+            if (!index.ajouter(demande.enrolement.toStdString(), &descripteur[0], (uint32_t)time(0))){
+                qWarning() << "impossible d'ajouter à l'index des personnes" << fichierBase;
+            }
+            QMutexLocker l(&verrou);
+            nbPersonnes = index.nombrePersonnes();
+            nbEchantillons = index.taille();
+            continue;
+        }
+
+        ResultatReconnaissance resultat;
+        resultat.piste = demande.piste;
+        VoisinIdentite voisin;
+        resultat.similarite = 0;
+        if (index.chercher(&descripteur[0], 1, &voisin, listesSondees) == 1){
+            resultat.similarite = voisin.similarite;
+            if (voisin.similarite >= seuil)
+                resultat.identite = index.nom(voisin.entree);
+        }
+        double duree = (MesureLatence::horloge() - debut) / 1000.;
+
+        QMutexLocker l(&verrou);
+        sorties.push_back(resultat);
+        nbReconnaissances++;
+        nbConnus += !resultat.identite.empty();
+        sommeTemps += duree;
+    }
+}
@@ -0,0 +1,108 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Reconnaissance des visages dans un thread : le descripteur (descripteurvisage.h) et la recherche dans la base
+ * des personnes enrôlées (indexidentites.h) ne retardent jamais la boucle des images ni la commande des servos.
+ * La boucle confie le visage normalisé d'une piste (pistesvisages.h) et relit les résultats aux images suivantes.
+ * Comme pour l'Enregistreur, si trop de visages attendent, les nouveaux sont refusés plutôt que de bloquer.
+ *
+ * Enrôlement : les visages confiés par enroler() sont ajoutés à la fin de l'index sous le nom donné, sans le réécrire.
+ */
+#ifndef RECONNAISSANCEVISAGE_H
+#define RECONNAISSANCEVISAGE_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QString>
+
+#include <opencv2/core/core.hpp>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "indexidentites.h"
+
+struct ResultatReconnaissance {
+    int piste;
+    // nom de la personne, vide si le visage n'est pas assez proche d'une personne enrôlée.
+    std::string identite;
+    double similarite;
+};
+
+class ReconnaissanceVisage : public QThread
+{
+    Q_OBJECT
+
+public:
+    /*
+     * fichierBase : index des personnes enrôlées ; format : "int8" ou "demi" (float16), pour un index à créer ;
+     * seuil : similarité (cosinus) au dessus de laquelle le visage est reconnu ;
+     * listesSondees : listes parcourues si l'index a un quantifieur grossier (0 : recherche exhaustive) ;
+     * fileAttenteMax : visages en attente au delà desquels les nouveaux sont refusés.
+     */
+    ReconnaissanceVisage(const QString &fichierBase, const QString &format, double seuil, int listesSondees, int fileAttenteMax);
+    ~ReconnaissanceVisage();
+
+    // Ouvre l'index (ou le crée vide), avant start(). Retourne false si le fichier existe mais n'est pas un index de personnes.
+    bool charger();
+
+    /*
+     * Confie le visage normalisé (DescripteurVisage::normaliser(), il est copié) de la piste "piste". Ne bloque jamais :
+     * retourne false si la file est pleine.
+     */
+    bool soumettre(int piste, const cv::Mat &visage);
+
+    // Même chose pour l'enrôlement de "nom".
+    bool enroler(const QString &nom, const cv::Mat &visage);
+
+    // Résultats arrivés depuis le dernier appel.
+    void resultats(std::vector<ResultatReconnaissance> &nouveaux);
+
+    // Personnes dans la base.
+    int nombrePersonnes();
+
+    // Reconnaissances, temps moyen (descripteur et recherche), taille de la base, visages refusés, en texte.
+    std::string rapport();
+
+    /*
+     * Traite les visages en attente et arrête le thread.
+     */
+    void arreter();
+
+protected:
+    void run();
+
+private:
+    struct Demande {
+        int piste;
+        cv::Mat visage;
+        QString enrolement;
+    };
+
+    bool confier(const Demande &demande);
+
+    QString fichierBase;
+    FormatIndex format;
+    double seuil;
+    int listesSondees;
+    int fileAttenteMax;
+    // utilisé par le thread seul après start().
+    IndexIdentites index;
+
+    // Partagé entre le thread de l'interface et celui de la reconnaissance.
+    QMutex verrou;
+    QWaitCondition visageDisponible;
+    std::deque<Demande> fileAttente;
+    std::vector<ResultatReconnaissance> sorties;
+    bool arret = false;
+    int nbPersonnes = 0;
+    int nbEchantillons = 0;
+    int nbRefuses = 0;
+    uint64_t nbReconnaissances = 0;
+    uint64_t nbConnus = 0;
+    double sommeTemps = 0; // ms
+};
+
+#endif // RECONNAISSANCEVISAGE_H
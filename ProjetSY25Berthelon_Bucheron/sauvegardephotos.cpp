@@ -0,0 +1,106 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Ecriture des photos en tâche de fond.
+ */
+#include "sauvegardephotos.h"
+
+#include <opencv2/imgcodecs/imgcodecs.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QMutexLocker>
+
+#include <vector>
+
+SauvegardePhotos::SauvegardePhotos(const QString &dossier, const QString &prefixe, const QString &extension, int qualite, int fileAttenteMax) :
+    dossier(dossier),
+    prefixe(prefixe),
+    extension(extension),
+    qualite(qualite),
+    fileAttenteMax(fileAttenteMax)
+{
+}
+
+SauvegardePhotos::~SauvegardePhotos()
+{
+    arreter();
+}
+
+/*
+ * Confie une photo au thread d'écriture. Le nom est pris au clic (à la milliseconde), pas à l'écriture.
+ */
+QString SauvegardePhotos::ajouter(const cv::Mat &photo, const cv::Mat &u, const cv::Mat &v)
+{
+    PhotoEnAttente nouvelle;
+    nouvelle.image = photo;
+    nouvelle.u = u;
+    nouvelle.v = v;
+    nouvelle.chemin = dossier + "/" + prefixe + "_" + QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss_zzz") + "." + extension;
+
+    QMutexLocker l(&verrou);
+    if ((int)fileAttente.size() >= fileAttenteMax){ // l'écriture a pris du retard : cette photo est perdue.
+        nbPerdues++;
+        return QString();
+    }
+    fileAttente.push_back(nouvelle);
+    photoDisponible.wakeOne();
+    return nouvelle.chemin;
+}
+
+/*
+ * Ecrit les photos en attente et arrête le thread.
+ */
+void SauvegardePhotos::arreter()
+{
+    {
+        QMutexLocker l(&verrou);
+        arret = true;
+        photoDisponible.wakeOne();
+    }
+    wait();
+}
+
+void SauvegardePhotos::run()
+{
+    QDir().mkpath(dossier);
+    std::vector<int> options;
+    if (extension == "jpg" || extension == "jpeg"){
+        options.push_back(cv::IMWRITE_JPEG_QUALITY);
+        options.push_back(qualite);
+    }
+
+    forever {
+        PhotoEnAttente photo;
+        {
+            QMutexLocker l(&verrou);
+            while (fileAttente.empty() && !arret)
+                photoDisponible.wait(&verrou);
+            if (fileAttente.empty()) // arrêt demandé et plus rien à écrire.
+                break;
+            photo = fileAttente.front();
+            fileAttente.pop_front();
+        }
+
+        if (!photo.u.empty() && !photo.v.empty()){ // YUV420 : chrominance remise à la taille de Y, puis conversion en BGR.
+            cv::Mat u, v, yuv;
+            cv::resize(photo.u, u, photo.image.size(), 0, 0, cv::INTER_LINEAR);
+            cv::resize(photo.v, v, photo.image.size(), 0, 0, cv::INTER_LINEAR);
+            std::vector<cv::Mat> plans;
+            plans.push_back(photo.image);
+            plans.push_back(u);
+            plans.push_back(v);
+            cv::merge(plans, yuv);
+            cv::cvtColor(yuv, photo.image, cv::COLOR_YUV2BGR);
+        }
+
+        if (!cv::imwrite(photo.chemin.toStdString(), photo.image, options)){
+            qWarning() << "impossible d'écrire la photo" << photo.chemin;
+            QMutexLocker l(&verrou);
+            nbPerdues++;
+        }
+    }
+}
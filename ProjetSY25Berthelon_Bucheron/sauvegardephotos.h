@@ -0,0 +1,77 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Ecriture des photos sur la carte SD dans un thread : la compression et l'écriture (plusieurs dizaines de ms
+ * pour un jpeg VGA sur la raspi) ne retardent ni l'affichage de la photo ni la boucle des images.
+ * Comme pour l'Enregistreur, si trop de photos attendent, les nouvelles sont perdues plutôt que de bloquer l'interface.
+ * Sert aussi aux recadrages du visage (voir recadragevisage.h), confiés en plans YUV : la conversion en couleur
+ * se fait alors dans ce thread.
+ */
+#ifndef SAUVEGARDEPHOTOS_H
+#define SAUVEGARDEPHOTOS_H
+
+#include <QThread>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <QString>
+
+#include <opencv2/core/core.hpp>
+#include <deque>
+
+class SauvegardePhotos : public QThread
+{
+    Q_OBJECT
+
+public:
+    /*
+     * dossier : répertoire des photos (créé si besoin), prefixe : début du nom des fichiers ("photo" : photo_date_heure.jpg),
+     * extension : "jpg" ou "png", qualite : qualité jpeg (0 à 100),
+     * fileAttenteMax : photos en attente au delà desquelles les suivantes sont perdues.
+     */
+    SauvegardePhotos(const QString &dossier, const QString &prefixe, const QString &extension, int qualite, int fileAttenteMax);
+    ~SauvegardePhotos();
+
+    /*
+     * Confie une photo à écrire (l'image n'est pas copiée : elle ne doit plus être modifiée par l'appelant).
+     * u et v : plans de chrominance à demi résolution (YUV420) ; s'ils sont donnés, "photo" est le plan Y
+     * et la photo est écrite en couleur.
+     * Ne bloque jamais. Retourne le chemin du fichier qui sera écrit, vide si la photo est perdue.
+     */
+    QString ajouter(const cv::Mat &photo, const cv::Mat &u = cv::Mat(), const cv::Mat &v = cv::Mat());
+
+    /*
+     * Ecrit les photos en attente et arrête le thread.
+     */
+    void arreter();
+
+    // Photos perdues (file pleine) ou non écrites (erreur d'écriture) depuis le lancement.
+    int photosPerdues() const { QMutexLocker l(&verrou); return nbPerdues; }
+
+protected:
+    void run();
+
+private:
+    struct PhotoEnAttente {
+        cv::Mat image;
+        cv::Mat u;
+        cv::Mat v;
+        QString chemin;
+    };
+
+    QString dossier;
+    QString prefixe;
+    QString extension;
+    int qualite;
+    int fileAttenteMax;
+
+    // protège la file, arret et nbPerdues (le thread d'écriture et celui de la capture comptent les pertes).
+    mutable QMutex verrou;
+    QWaitCondition photoDisponible;
+    std::deque<PhotoEnAttente> fileAttente;
+    bool arret = false;
+    int nbPerdues = 0;
+};
+
+#endif // SAUVEGARDEPHOTOS_H
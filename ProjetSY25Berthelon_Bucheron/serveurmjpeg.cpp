@@ -0,0 +1,221 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Petit serveur HTTP qui diffuse les images traitées en MJPEG, encodées une seule fois pour tous les clients.
+ */
+#include "serveurmjpeg.h"
+
+#include "opencv2/imgproc/imgproc.hpp"
+#include "opencv2/imgcodecs/imgcodecs.hpp"
+
+#include <QDebug>
+#include <vector>
+
+// Taille maximum d'une requête HTTP (on n'attend qu'un GET).
+#define TAILLE_REQUETE_MAX 4096
+
+static const char ENTETE_FLUX[] =
+        "HTTP/1.0 200 OK\r\n"
+        "Content-Type: multipart/x-mixed-replace; boundary=image\r\n"
+        "Cache-Control: no-cache\r\n"
+        "Connection: close\r\n\r\n";
+
+static const char ENTETE_IMAGE[] =
+        "HTTP/1.0 200 OK\r\n"
+        "Content-Type: image/jpeg\r\n"
+        "Cache-Control: no-cache\r\n"
+        "Connection: close\r\n";
+
+static const char ENTETE_TEXTE[] =
+        "HTTP/1.0 200 OK\r\n"
+        "Content-Type: text/plain; charset=utf-8\r\n"
+        "Cache-Control: no-cache\r\n"
+        "Connection: close\r\n\r\n";
+
+static const char REPONSE_INTROUVABLE[] =
+        "HTTP/1.0 404 Not Found\r\n"
+        "Content-Type: text/plain\r\n"
+        "Connection: close\r\n\r\n"
+        "chemins disponibles : /flux.mjpg, /image.jpg, /latence.txt et /qualite.txt\r\n";
+
+ServeurMJPEG::ServeurMJPEG(int qualite, int largeur, int octetsEnAttenteMax, QObject *parent) :
+    QObject(parent),
+    qualite(qualite),
+    largeur(largeur),
+    octetsEnAttenteMax(octetsEnAttenteMax)
+{
+    connect(&serveur, SIGNAL(newConnection()), this, SLOT(nouvelleConnexion()));
+}
+
+ServeurMJPEG::~ServeurMJPEG()
+{
+    serveur.close();
+    for (int i = 0; i < clients.size(); i++){
+        clients[i].socket->disconnect(this); // plus de deconnexion() pendant qu'on parcourt la liste.
+        clients[i].socket->abort();
+    }
+}
+
+bool ServeurMJPEG::ecouter(const QHostAddress &adresse, quint16 port)
+{
+    if (!serveur.listen(adresse, port)){
+        qWarning() << "serveur MJPEG : impossible d'écouter sur" << adresse.toString() << port << serveur.errorString();
+        return false;
+    }
+    qDebug() << "serveur MJPEG : http://" + adresse.toString() + ":" + QString::number(port) + "/flux.mjpg";
+    return true;
+}
+
+ServeurMJPEG::Client *ServeurMJPEG::trouverClient(QTcpSocket *socket)
+{
+    for (int i = 0; i < clients.size(); i++){
+        if (clients[i].socket == socket)
+            return &clients[i];
+    }
+    return 0;
+}
+
+void ServeurMJPEG::nouvelleConnexion()
+{
+    while (serveur.hasPendingConnections()){
+        Client client;
+        client.socket = serveur.nextPendingConnection();
+        client.etat = ATTENTE_REQUETE;
+        client.imagesPerdues = 0;
+        clients.append(client);
+
+        connect(client.socket, SIGNAL(readyRead()), this, SLOT(lireRequete()));
+        connect(client.socket, SIGNAL(bytesWritten(qint64)), this, SLOT(octetsEcrits()));
+        connect(client.socket, SIGNAL(disconnected()), this, SLOT(deconnexion()));
+    }
+}
+
+/*
+ * Lecture de la requête : seule la première ligne (GET /chemin HTTP/1.x) nous intéresse.
+ */
+void ServeurMJPEG::lireRequete()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+    Client *client = trouverClient(socket);
+    if (!client)
+        return;
+
+    if (client->etat != ATTENTE_REQUETE){ // on ignore ce que le client envoie après sa requête.
+        socket->readAll();
+        return;
+    }
+
+    client->requete += socket->readAll();
+    if (!client->requete.contains("\r\n\r\n")){
+        if (client->requete.size() > TAILLE_REQUETE_MAX)
+            socket->abort();
+        return;
+    }
+
+    QList<QByteArray> ligne = client->requete.left(client->requete.indexOf("\r\n")).split(' ');
+    QByteArray chemin = ligne.size() >= 2 ? ligne[1] : QByteArray();
+    client->requete.clear();
+
+    if (chemin == "/" || chemin == "/flux.mjpg"){
+        client->etat = FLUX;
+        socket->write(ENTETE_FLUX);
+    } else if (chemin == "/image.jpg"){
+        client->etat = IMAGE_SEULE; // la réponse partira avec la prochaine image publiée.
+    } else if (textes.contains(chemin)){
+        client->etat = TERMINE;
+        socket->write(ENTETE_TEXTE);
+        socket->write(textes.value(chemin));
+        socket->disconnectFromHost();
+    } else {
+        client->etat = TERMINE;
+        socket->write(REPONSE_INTROUVABLE);
+        socket->disconnectFromHost();
+    }
+}
+
+/*
+ * Envoi d'une partie à un client, en ne gardant que la plus récente si le client est en retard.
+ */
+void ServeurMJPEG::envoyer(Client &client, const QByteArray &partie)
+{
+    if (client.socket->bytesToWrite() > octetsEnAttenteMax){
+        if (!client.enAttente.isEmpty())
+            client.imagesPerdues++;
+        client.enAttente = partie; // simple référence sur le tampon partagé, pas de copie.
+        return;
+    }
+    client.socket->write(partie);
+}
+
+void ServeurMJPEG::octetsEcrits()
+{
+    Client *client = trouverClient(qobject_cast<QTcpSocket *>(sender()));
+    if (!client || client->enAttente.isEmpty() || client->socket->bytesToWrite() > octetsEnAttenteMax)
+        return;
+
+    client->socket->write(client->enAttente);
+    client->enAttente.clear();
+}
+
+void ServeurMJPEG::deconnexion()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+    for (int i = 0; i < clients.size(); i++){
+        if (clients[i].socket == socket){
+            if (clients[i].imagesPerdues > 0)
+                qDebug() << "serveur MJPEG : client" << socket->peerAddress().toString() << "déconnecté," << clients[i].imagesPerdues << "images perdues";
+            clients.removeAt(i);
+            break;
+        }
+    }
+    socket->deleteLater();
+}
+
+/*
+ * Publie une image traitée : un seul encodage JPEG, partagé par tous les clients.
+ */
+void ServeurMJPEG::publierImage(const cv::Mat &image)
+{
+    bool attendue = false;
+    for (int i = 0; i < clients.size(); i++){
+        if (clients[i].etat == FLUX || clients[i].etat == IMAGE_SEULE)
+            attendue = true;
+    }
+    if (!attendue) // personne ne regarde : on n'encode rien.
+        return;
+
+    const cv::Mat *source = &image;
+    if (largeur > 0 && largeur < image.cols){
+        cv::resize(image, imageReduite, cv::Size(largeur, image.rows * largeur / image.cols), 0, 0, cv::INTER_AREA);
+        source = &imageReduite;
+    }
+
+    std::vector<uchar> jpeg;
+    std::vector<int> options;
+    options.push_back(cv::IMWRITE_JPEG_QUALITY);
+    options.push_back(qualite);
+    if (!cv::imencode(".jpg", *source, jpeg, options))
+        return;
+
+    QByteArray dernierJpeg((const char *)jpeg.data(), jpeg.size());
+    QByteArray dernierePartie = "--image\r\nContent-Type: image/jpeg\r\nContent-Length: " + QByteArray::number(dernierJpeg.size())
+            + "\r\n\r\n" + dernierJpeg + "\r\n";
+
+    // Les déconnexions se font après la boucle : elles peuvent retirer des clients de la liste.
+    QList<QTcpSocket *> aFermer;
+    for (int i = 0; i < clients.size(); i++){
+        Client &client = clients[i];
+        if (client.etat == FLUX){
+            envoyer(client, dernierePartie);
+        } else if (client.etat == IMAGE_SEULE){
+            client.socket->write(ENTETE_IMAGE);
+            client.socket->write("Content-Length: " + QByteArray::number(dernierJpeg.size()) + "\r\n\r\n");
+            client.socket->write(dernierJpeg);
+            client.etat = TERMINE;
+            aFermer.append(client.socket);
+        }
+    }
+    for (int i = 0; i < aFermer.size(); i++)
+        aFermer[i]->disconnectFromHost();
+}
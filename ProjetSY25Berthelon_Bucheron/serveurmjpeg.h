@@ -0,0 +1,85 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Petit serveur HTTP qui diffuse les images traitées en MJPEG (multipart/x-mixed-replace).
+ * Chaque image est encodée en JPEG une seule fois, puis le même tampon (QByteArray, partagé par compteur de références)
+ * est envoyé à tous les clients. Un client lent ne garde que l'image la plus récente en attente : les autres sont perdues pour lui.
+ *
+ * Test sur la raspi : curl http://127.0.0.1:8080/flux.mjpg > flux.mjpg, ou http://<ip>:8080/ dans un navigateur.
+ * http://<ip>:8080/image.jpg renvoie une seule image, /latence.txt et /qualite.txt les derniers rapports de l'application.
+ */
+#ifndef SERVEURMJPEG_H
+#define SERVEURMJPEG_H
+
+#include <QObject>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QHostAddress>
+#include <QList>
+#include <QMap>
+
+#include <opencv2/core/core.hpp>
+
+class ServeurMJPEG : public QObject
+{
+    Q_OBJECT
+
+public:
+    /*
+     * qualite : qualité JPEG (0-100), largeur : largeur des images diffusées (0 pour garder la taille d'origine),
+     * octetsEnAttenteMax : au delà de ce nombre d'octets non envoyés, le client est considéré comme lent.
+     */
+    ServeurMJPEG(int qualite, int largeur, int octetsEnAttenteMax, QObject *parent = 0);
+    ~ServeurMJPEG();
+
+    bool ecouter(const QHostAddress &adresse, quint16 port);
+
+    /*
+     * Publie une image traitée. Elle n'est encodée que si au moins un client l'attend.
+     */
+    void publierImage(const cv::Mat &image);
+
+    /*
+     * Texte renvoyé sur "chemin" (par exemple "/latence.txt" pour le rapport de MesureLatence).
+     */
+    void publierTexte(const QByteArray &chemin, const QByteArray &texte) { textes[chemin] = texte; }
+
+    int nombreClients() const { return clients.size(); }
+
+private slots:
+    void nouvelleConnexion();
+    void lireRequete();
+    void octetsEcrits();
+    void deconnexion();
+
+private:
+    enum EtatClient { ATTENTE_REQUETE, FLUX, IMAGE_SEULE, TERMINE };
+
+    struct Client {
+        QTcpSocket *socket;
+        EtatClient etat;
+        QByteArray requete;
+        // Image suivante à envoyer quand le client aura vidé son tampon (partagée avec les autres clients).
+        QByteArray enAttente;
+        int imagesPerdues;
+    };
+
+    Client *trouverClient(QTcpSocket *socket);
+    void envoyer(Client &client, const QByteArray &partie);
+
+    QTcpServer serveur;
+    QList<Client> clients;
+
+    int qualite;
+    int largeur;
+    qint64 octetsEnAttenteMax;
+
+    // Rapports texte publiés, par chemin.
+    QMap<QByteArray, QByteArray> textes;
+
+    // Image réduite à la largeur de diffusion (réutilisée d'une image à l'autre).
+    cv::Mat imageReduite;
+};
+
+#endif // SERVEURMJPEG_H
@@ -0,0 +1,97 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Exposition stable et image la plus nette d'une rafale pour les photos.
+ */
+#include "sessionphoto.h"
+
+#include <opencv2/imgproc/imgproc.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+SessionPhoto::SessionPhoto(double toleranceExposition, int imagesStables) :
+    toleranceExposition(toleranceExposition),
+    imagesStables(imagesStables)
+{
+}
+
+void SessionPhoto::observer(const cv::Mat &luminance, uint64_t instant)
+{
+    double luminosite = cv::mean(luminance)[0];
+    // l'exposition automatique converge : la luminosité moyenne ne bouge presque plus d'une image à l'autre.
+    if (luminositePrecedente >= 0 && std::fabs(luminosite - luminositePrecedente) <= toleranceExposition * std::max(luminositePrecedente, 1.))
+        stables++;
+    else
+        stables = 0;
+    luminositePrecedente = luminosite;
+    if (expositionStable()){
+        luminance.copyTo(exposee);
+        instantExpose = instant;
+    }
+}
+
+void SessionPhoto::reinitialiser()
+{
+    luminositePrecedente = -1;
+    stables = 0;
+    exposee.release();
+}
+
+void SessionPhoto::debutRafale(uint64_t instantClic, int taille)
+{
+    clic = instantClic;
+    tailleRafale = std::max(taille, 1);
+    nbRafale = 0;
+    meilleure.release();
+    meilleureNettete = -1;
+}
+
+void SessionPhoto::proposer(const cv::Mat &luminance, uint64_t instant)
+{
+    nbRafale++;
+    double n = tailleRafale > 1 ? nettete(luminance) : 0; // une seule image : pas besoin de la mesurer.
+    if (n > meilleureNettete){
+        meilleureNettete = n;
+        luminance.copyTo(meilleure);
+        instantMeilleure = instant;
+    }
+}
+
+bool SessionPhoto::photo(cv::Mat &image)
+{
+    uint64_t instant;
+    if (!meilleure.empty()){
+        image = meilleure;
+        instant = instantMeilleure;
+    } else if (!exposee.empty()){
+        image = exposee.clone();
+        instant = instantExpose;
+        photosSecours++;
+    } else {
+        return false;
+    }
+    photos++;
+    sommeDelais += instant > clic ? (instant - clic) / 1000. : 0.;
+    meilleure.release();
+    return true;
+}
+
+double SessionPhoto::nettete(const cv::Mat &luminance)
+{
+    cv::Mat reduite, laplacien;
+    cv::resize(luminance, reduite, cv::Size(), 0.5, 0.5, cv::INTER_AREA);
+    cv::Laplacian(reduite, laplacien, CV_16S);
+    cv::Scalar moyenne, ecartType;
+    cv::meanStdDev(laplacien, moyenne, ecartType);
+    return ecartType[0] * ecartType[0];
+}
+
+std::string SessionPhoto::rapport() const
+{
+    char texte[200];
+    snprintf(texte, sizeof(texte), "photos : %llu prises, %.0f ms en moyenne entre le clic et l'image, %llu images de secours (veille)\n",
+             (unsigned long long)photos, photos > 0 ? sommeDelais / photos : 0., (unsigned long long)photosSecours);
+    return texte;
+}
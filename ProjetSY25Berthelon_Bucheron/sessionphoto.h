@@ -0,0 +1,87 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Choix de l'image d'une photo dans une session de capture gardée ouverte.
+ *
+ * Ouvrir la caméra à chaque photo coûte son initialisation, puis le temps que l'exposition automatique se stabilise :
+ * la première image est souvent mal exposée. L'application garde donc la source ouverte entre deux photos ([photo] du
+ * fichier ini) et lui prend une image de temps en temps (veille) : SessionPhoto suit la luminosité moyenne de ces images
+ * pour savoir si l'exposition est stable, et garde une copie de la dernière image bien exposée.
+ *
+ * Au clic, une rafale de quelques images est prise (une seule par défaut : la photo part à l'image suivante) et la plus
+ * nette est retenue (variance du laplacien). Si la source ne rend aucune image bien exposée à temps,
+ * la dernière image bien exposée de la veille sert de photo.
+ */
+#ifndef SESSIONPHOTO_H
+#define SESSIONPHOTO_H
+
+#include <opencv2/core/core.hpp>
+#include <stdint.h>
+#include <string>
+
+class SessionPhoto
+{
+public:
+    /*
+     * L'exposition est stable après "imagesStables" images successives dont la luminosité moyenne varie de moins de
+     * "toleranceExposition" (relative) d'une image à l'autre.
+     */
+    SessionPhoto(double toleranceExposition = 0.03, int imagesStables = 3);
+
+    /*
+     * Image de la source (veille ou rafale), à "instant" (µs) : met à jour l'état de l'exposition
+     * et copie l'image si elle est bien exposée.
+     */
+    void observer(const cv::Mat &luminance, uint64_t instant);
+    bool expositionStable() const { return stables >= imagesStables; }
+
+    // Dernière image bien exposée (vide s'il n'y en a pas encore) et son instant (µs).
+    const cv::Mat &derniereExposee() const { return exposee; }
+    uint64_t instantExposee() const { return instantExpose; }
+
+    // Oublie l'exposition : à appeler quand la source a été fermée.
+    void reinitialiser();
+
+    /*
+     * Rafale : debutRafale() au clic (instant en µs, nombre d'images), puis proposer() pour chaque image bien exposée
+     * jusqu'à rafaleComplete() ; la plus nette est gardée.
+     */
+    void debutRafale(uint64_t instantClic, int taille);
+    void proposer(const cv::Mat &luminance, uint64_t instant);
+    bool rafaleComplete() const { return nbRafale >= tailleRafale; }
+
+    /*
+     * Photo retenue : la plus nette de la rafale, sinon la dernière image bien exposée de la veille.
+     * Retourne false s'il n'y a aucune des deux. La photo compte dans le rapport.
+     */
+    bool photo(cv::Mat &image);
+
+    // Netteté d'une image : variance du laplacien de l'image réduite de moitié (le bruit du capteur compte moins).
+    static double nettete(const cv::Mat &luminance);
+
+    // Photos prises, délai moyen entre le clic et l'image retenue, photos de secours, en texte.
+    std::string rapport() const;
+
+private:
+    double toleranceExposition;
+    int imagesStables;
+
+    double luminositePrecedente = -1;
+    int stables = 0;
+    cv::Mat exposee;
+    uint64_t instantExpose = 0;
+
+    uint64_t clic = 0;
+    int tailleRafale = 1;
+    int nbRafale = 0;
+    cv::Mat meilleure;
+    double meilleureNettete = -1;
+    uint64_t instantMeilleure = 0;
+
+    uint64_t photos = 0;
+    uint64_t photosSecours = 0;
+    double sommeDelais = 0; // ms
+};
+
+#endif // SESSIONPHOTO_H
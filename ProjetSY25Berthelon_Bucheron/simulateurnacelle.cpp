@@ -0,0 +1,305 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Nacelle pan / tilt virtuelle : même interprétation des commandes que ControlMoteurArduino.ino (actuel ou précédent).
+ */
+#include "simulateurnacelle.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Un octet à 115200 bauds (10 bits avec le start et le stop) : 87 µs.
+#define DUREE_OCTET_US 87
+// delay(15) du programme arduino après chaque Servo.write().
+#define DELAI_ECRITURE_US 15000
+// Tampon de réception de la liaison série de l'arduino.
+#define TAILLE_TAMPON_RECEPTION 64
+// Tampon d'émission de la liaison série de l'arduino.
+#define TAILLE_TAMPON_EMISSION 64
+// Emissions gardées tant que personne ne lit la sortie.
+#define EMISSIONS_MAX 1024
+
+SimulateurNacelle::SimulateurNacelle(double vitesse, double pixelsParDegre, cv::Size tailleFenetre, FirmwareNacelle firmware) :
+    vitesse(vitesse),
+    pixelsParDegre(pixelsParDegre),
+    tailleFenetre(tailleFenetre),
+    firmware(firmware)
+{
+}
+
+void SimulateurNacelle::recevoir(const char *octets, size_t n, uint64_t instant)
+{
+    for (size_t i = 0; i < n; i++){
+        Octet o = { octets[i], instant + (i + 1)*DUREE_OCTET_US };
+        // les octets déjà lus ont quitté le tampon : on fait avancer la lecture jusqu'à l'arrivée de celui-ci.
+        avancer(std::max(instantCourant, o.arrivee));
+        if (reception.size() >= TAILLE_TAMPON_RECEPTION){
+            perdus++;
+            continue;
+        }
+        reception.push_back(o);
+    }
+}
+
+void SimulateurNacelle::avancer(uint64_t instant)
+{
+    if (instant < instantCourant)
+        return;
+    if (firmware == FIRMWARE_PLANIFIE)
+        avancerPlanifie(instant);
+    else
+        avancerBloquant(instant);
+}
+
+/*
+ * Programme précédent : une commande à la fois, delay(15) après chaque Servo.write().
+ */
+void SimulateurNacelle::avancerBloquant(uint64_t instant)
+{
+    for (;;){
+        if (retourVerticalEnAttente){ // deuxième moitié de 'r' : Servo.write(90) vertical après le premier delay(15).
+            if (occupeJusqua > instant)
+                break;
+            deplacerServos(occupeJusqua);
+            ecrire(vertical, 90);
+            occupeJusqua += DELAI_ECRITURE_US;
+            retourVerticalEnAttente = false;
+            continue;
+        }
+        if (reception.empty())
+            break;
+        uint64_t lecture = std::max(reception.front().arrivee, occupeJusqua);
+        if (lecture > instant)
+            break;
+
+        char octet = reception.front().valeur;
+        reception.pop_front();
+        deplacerServos(lecture);
+        commandes++;
+
+        switch (octet){
+        case 'l':
+            emettre("Ol\r\n", 4, lecture);
+            break;
+        case 'L':
+            emettre("OL\r\n", 4, lecture);
+            break;
+        case 'v':
+            ecrire(vertical, vertical.position - 2);
+            occupeJusqua = lecture + DELAI_ECRITURE_US;
+            break;
+        case 'V':
+            ecrire(vertical, vertical.position + 2);
+            occupeJusqua = lecture + DELAI_ECRITURE_US;
+            break;
+        case 'h':
+            ecrire(horizontal, horizontal.position - 2);
+            occupeJusqua = lecture + DELAI_ECRITURE_US;
+            break;
+        case 'H':
+            ecrire(horizontal, horizontal.position + 2);
+            occupeJusqua = lecture + DELAI_ECRITURE_US;
+            break;
+        case 'r':
+            ecrire(horizontal, 90);
+            occupeJusqua = lecture + DELAI_ECRITURE_US;
+            retourVerticalEnAttente = true;
+            break;
+        default:
+            emettre("Err\r\n", 5, lecture);
+            erreurs++;
+            break;
+        }
+    }
+    deplacerServos(instant);
+}
+
+/*
+ * Programme actuel : les octets sont lus au tour de loop() qui suit leur arrivée (quelques µs, négligé),
+ * la consigne des servos avance d'un pas de trajectoire toutes les PERIODE_MOUVEMENT_US,
+ * une trame de télémétrie part toutes les PERIODE_TELEMETRIE_US (après le pas du même tour de loop()).
+ */
+void SimulateurNacelle::avancerPlanifie(uint64_t instant)
+{
+    // premier appel : la télémétrie démarre maintenant, plutôt que de rattraper les trames depuis l'origine de l'horloge.
+    if (prochaineTelemetrie == 0)
+        prochaineTelemetrie = std::max(instantCourant, instant);
+    if (prochainPas == 0)
+        prochainPas = instantCourant + PERIODE_MOUVEMENT_US;
+    for (;;){
+        // servos arrêtés : les pas sans effet jusqu'au prochain octet (ou à la prochaine trame) sont sautés d'un coup.
+        if (horizontal.trajectoire.estArrive() && vertical.trajectoire.estArrive()){
+            uint64_t limite = std::min(instant, prochaineTelemetrie);
+            if (!reception.empty())
+                limite = std::min(limite, reception.front().arrivee);
+            if (limite > prochainPas)
+                prochainPas += (limite - prochainPas) / PERIODE_MOUVEMENT_US * PERIODE_MOUVEMENT_US;
+        }
+        bool octet = !reception.empty() && reception.front().arrivee <= prochainPas;
+        uint64_t evenement = octet ? reception.front().arrivee : prochainPas;
+        bool telemetrie = prochaineTelemetrie < evenement;
+        if (telemetrie)
+            evenement = prochaineTelemetrie;
+        if (evenement > instant)
+            break;
+        deplacerServos(evenement);
+        if (telemetrie){
+            envoyerTelemetrie(evenement);
+            prochaineTelemetrie += PERIODE_TELEMETRIE_US;
+        } else if (octet){
+            executerPlanifie(reception.front().valeur);
+            reception.pop_front();
+        } else {
+            Axe *axes[2] = { &horizontal, &vertical };
+            for (int i = 0; i < 2; i++){
+                axes[i]->trajectoire.avancer(PERIODE_MOUVEMENT_US * 1e-6f);
+                axes[i]->consigne = axes[i]->trajectoire.position();
+            }
+            prochainPas += PERIODE_MOUVEMENT_US;
+        }
+    }
+    deplacerServos(instant);
+}
+
+void SimulateurNacelle::executerPlanifie(char octet)
+{
+    commandes++;
+    commandesExecutees++;
+    switch (octet){
+    case 'l':
+        emettre("Ol\r\n", 4, instantCourant);
+        break;
+    case 'L':
+        emettre("OL\r\n", 4, instantCourant);
+        break;
+    case 'v':
+        vertical.trajectoire.decaler(-PAS_COMMANDE_SERVO);
+        break;
+    case 'V':
+        vertical.trajectoire.decaler(PAS_COMMANDE_SERVO);
+        break;
+    case 'h':
+        horizontal.trajectoire.decaler(-PAS_COMMANDE_SERVO);
+        break;
+    case 'H':
+        horizontal.trajectoire.decaler(PAS_COMMANDE_SERVO);
+        break;
+    case 'r':
+        horizontal.trajectoire.viser(90);
+        vertical.trajectoire.viser(90);
+        break;
+    default:
+        emettre("Err\r\n", 5, instantCourant);
+        erreurs++;
+        break;
+    }
+}
+
+void SimulateurNacelle::placer(int angleHorizontal, int angleVertical, uint64_t instant)
+{
+    reception.clear();
+    retourVerticalEnAttente = false;
+    instantCourant = std::max(instantCourant, instant);
+    occupeJusqua = instantCourant;
+    prochainPas = 0;
+    horizontal.position = angleHorizontal;
+    vertical.position = angleVertical;
+    horizontal.consigne = horizontal.angle = std::min(std::max(angleHorizontal, 0), 180);
+    vertical.consigne = vertical.angle = std::min(std::max(angleVertical, 0), 180);
+    horizontal.trajectoire.placer(angleHorizontal);
+    vertical.trajectoire.placer(angleVertical);
+}
+
+/*
+ * Servo.write() : la position du programme suit la commande, la consigne du servo est bornée à 0 - 180°.
+ */
+void SimulateurNacelle::ecrire(Axe &axe, int position)
+{
+    axe.position = position;
+    axe.consigne = std::min(std::max(position, 0), 180);
+}
+
+/*
+ * Les servos rejoignent leur consigne à vitesse constante.
+ */
+void SimulateurNacelle::deplacerServos(uint64_t instant)
+{
+    if (instant <= instantCourant)
+        return;
+    double pas = vitesse * (instant - instantCourant) / 1e6;
+    Axe *axes[2] = { &horizontal, &vertical };
+    for (int i = 0; i < 2; i++){
+        double ecart = axes[i]->consigne - axes[i]->angle;
+        axes[i]->angle += std::min(std::max(ecart, -pas), pas);
+    }
+    instantCourant = instant;
+}
+
+cv::Rect SimulateurNacelle::fenetre(cv::Size source) const
+{
+    int largeur = std::min(tailleFenetre.width, source.width);
+    int hauteur = std::min(tailleFenetre.height, source.height);
+    // à 90° / 90°, la fenêtre est au centre de l'image source.
+    double centreX = source.width/2.0 - (horizontal.angle - 90)*pixelsParDegre;
+    double centreY = source.height/2.0 - (vertical.angle - 90)*pixelsParDegre;
+    int x = (int)std::lround(centreX - largeur/2.0);
+    int y = (int)std::lround(centreY - hauteur/2.0);
+    x = std::min(std::max(x, 0), source.width - largeur);
+    y = std::min(std::max(y, 0), source.height - hauteur);
+    return cv::Rect(x, y, largeur, hauteur);
+}
+
+/*
+ * Angle en centièmes de degré, comme centiemes() du programme de l'arduino.
+ */
+static int16_t centiemes(float angle)
+{
+    return (int16_t)(angle * 100.0f + (angle >= 0.0f ? 0.5f : -0.5f));
+}
+
+void SimulateurNacelle::envoyerTelemetrie(uint64_t instant)
+{
+    // Serial.availableForWrite() : octets encore à émettre.
+    uint64_t restants = finEmission > instant ? (finEmission - instant + DUREE_OCTET_US - 1) / DUREE_OCTET_US : 0;
+    if (TAILLE_TAMPON_EMISSION - (int64_t)restants < TAILLE_TRAME_TELEMETRIE)
+        return;
+    TrameTelemetrie t;
+    t.numero = numeroTrame++;
+    t.instant = (uint32_t)instant;
+    t.cibleH = centiemes(horizontal.trajectoire.cible());
+    t.cibleV = centiemes(vertical.trajectoire.cible());
+    t.angleH = centiemes(horizontal.trajectoire.position());
+    t.angleV = centiemes(vertical.trajectoire.position());
+    size_t enAttente = 0;
+    for (size_t i = 0; i < reception.size() && reception[i].arrivee <= instant; i++)
+        enAttente++;
+    t.enAttente = (uint8_t)std::min(enAttente, (size_t)255);
+    t.commandes = commandesExecutees;
+    uint8_t trame[TAILLE_TRAME_TELEMETRIE];
+    encoderTelemetrie(t, trame);
+    emettre((const char *)trame, TAILLE_TRAME_TELEMETRIE, instant);
+}
+
+/*
+ * Octets écrits sur la liaison vers la raspi à "instant" : ils partent après ceux déjà en cours d'émission.
+ */
+void SimulateurNacelle::emettre(const char *octets, size_t n, uint64_t instant)
+{
+    finEmission = std::max(finEmission, instant) + n*DUREE_OCTET_US;
+    Emission e = { std::string(octets, n), finEmission };
+    sortie.push_back(e);
+    if (sortie.size() > EMISSIONS_MAX)
+        sortie.pop_front();
+}
+
+std::string SimulateurNacelle::lireSortie(uint64_t instant)
+{
+    avancer(instant);
+    std::string octets;
+    while (!sortie.empty() && sortie.front().arrivee <= instant){
+        octets += sortie.front().octets;
+        sortie.pop_front();
+    }
+    return octets;
+}
@@ -0,0 +1,140 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Nacelle pan / tilt virtuelle, pour régler la boucle des servomoteurs sans le montage.
+ *
+ * Le simulateur interprète les octets envoyés à l'arduino comme ControlMoteurArduino.ino ('H' / 'h', 'V' / 'v' : cible de ±2°,
+ * 'r' : retour à 90°, 'L' / 'l' : led, réponse "OL" / "Ol", tout autre octet : réponse "Err"), au choix :
+ *  - FIRMWARE_PLANIFIE (programme actuel) : les octets sont lus dès leur arrivée et ne font que déplacer les cibles,
+ *    la consigne des servos suit la trajectoire de PlanificateurMouvement (même code que l'arduino), un pas toutes les 5 ms ;
+ *  - FIRMWARE_BLOQUANT (programme précédent) : chaque commande fait un Servo.write() de 2° puis delay(15), 'r' deux delay(15) ;
+ *    un octet reçu pendant un delay() attend, le tampon de réception (64 octets) déborde sur une rafale. Comme Servo.write(),
+ *    la consigne est bornée à 0 - 180° alors que la position gardée par le programme continue de compter.
+ * Les octets arrivent au rythme de la liaison (115200 bauds). Le servo rejoint sa consigne à vitesse constante (sa vitesse propre).
+ * Le programme planifié envoie aussi sa trame de télémétrie (trametelemetrie.h) toutes les PERIODE_TELEMETRIE_US, sautée
+ * si le tampon d'émission (64 octets) n'a pas la place ; les réponses et les trames reviennent au rythme de la liaison.
+ *
+ * Les angles déplacent une fenêtre dans une image source plus grande (vidéo grand angle, haute résolution) :
+ * fenetre() donne le rectangle vu par la caméra virtuelle. Les signes sont ceux de la boucle réelle : 'H' est envoyé
+ * quand le visage est à gauche du centre, la fenêtre part donc vers la gauche ; 'V' quand il est au dessus, elle monte.
+ *
+ * Le temps est donné par l'appelant (µs, même origine pour recevoir() et avancer()) : horloge réelle dans l'application,
+ * horloge simulée dans l'outil SimulationNacelle, qui rejoue alors la boucle plus vite que le temps réel.
+ */
+#ifndef SIMULATEURNACELLE_H
+#define SIMULATEURNACELLE_H
+
+#include "planificateurmouvement.h"
+#include "trametelemetrie.h"
+
+#include <opencv2/core/core.hpp>
+#include <deque>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+// Programme de l'arduino simulé.
+enum FirmwareNacelle {
+    FIRMWARE_PLANIFIE = 0,
+    FIRMWARE_BLOQUANT = 1
+};
+
+class SimulateurNacelle
+{
+public:
+    /*
+     * vitesse : vitesse des servos (°/s).
+     * pixelsParDegre : déplacement de la fenêtre dans l'image source pour un degré (largeur de la fenêtre / champ horizontal de la caméra).
+     * tailleFenetre : taille des images rendues par la caméra virtuelle.
+     */
+    SimulateurNacelle(double vitesse = 300, double pixelsParDegre = 12, cv::Size tailleFenetre = cv::Size(640, 480),
+                      FirmwareNacelle firmware = FIRMWARE_PLANIFIE);
+
+    /*
+     * Octets envoyés sur la liaison série à l'instant "instant" (µs).
+     */
+    void recevoir(const char *octets, size_t n, uint64_t instant);
+
+    /*
+     * Traite les octets arrivés et déplace les servos jusqu'à "instant" (µs). Le temps ne recule pas.
+     */
+    void avancer(uint64_t instant);
+
+    /*
+     * Place les deux servos (et les positions du programme) à ces angles, sans délai. Vide le tampon de réception.
+     */
+    void placer(int angleHorizontal, int angleVertical, uint64_t instant);
+
+    // Angles réels des servos (°) à l'instant du dernier avancer().
+    double angleHorizontal() const { return horizontal.angle; }
+    double angleVertical() const { return vertical.angle; }
+
+    /*
+     * Rectangle vu par la caméra virtuelle dans une image source de taille "source" (borné à l'image source).
+     */
+    cv::Rect fenetre(cv::Size source) const;
+
+    /*
+     * Octets renvoyés par l'arduino arrivés à la raspi depuis le dernier appel, jusqu'à "instant" (µs) :
+     * texte (lignes terminées par "\r\n" comme Serial.println()) et trames de télémétrie.
+     */
+    std::string lireSortie(uint64_t instant);
+
+    uint64_t nombreCommandes() const { return commandes; }
+    uint64_t nombreErreurs() const { return erreurs; }
+    uint64_t octetsPerdus() const { return perdus; }
+
+    double vitesse;
+    double pixelsParDegre;
+    cv::Size tailleFenetre;
+    FirmwareNacelle firmware;
+
+private:
+    struct Axe {
+        int position = 90;   // posH / posV du programme bloquant
+        double consigne = 90; // dernière consigne écrite au servo (bornée à 0 - 180)
+        double angle = 90;    // angle réel du servo
+        PlanificateurMouvement trajectoire; // programme planifié
+    };
+    struct Octet {
+        char valeur;
+        uint64_t arrivee;
+    };
+    // Octets émis par l'arduino, tous arrivés à la raspi à "arrivee".
+    struct Emission {
+        std::string octets;
+        uint64_t arrivee;
+    };
+
+    void avancerBloquant(uint64_t instant);
+    void avancerPlanifie(uint64_t instant);
+    void executerPlanifie(char octet);
+    void ecrire(Axe &axe, int position);
+    void deplacerServos(uint64_t instant);
+    void emettre(const char *octets, size_t n, uint64_t instant);
+    void envoyerTelemetrie(uint64_t instant);
+
+    Axe horizontal;
+    Axe vertical;
+    std::deque<Octet> reception;
+    uint64_t instantCourant = 0;
+    // Fin du delay() en cours : l'octet suivant n'est pas lu avant.
+    uint64_t occupeJusqua = 0;
+    // 'r' : la consigne verticale est écrite 15 ms après l'horizontale.
+    bool retourVerticalEnAttente = false;
+    // Prochain pas de la boucle de mouvement du programme planifié.
+    uint64_t prochainPas = 0;
+    // Prochaine trame de télémétrie (0 : pas encore démarré).
+    uint64_t prochaineTelemetrie = 0;
+    uint8_t numeroTrame = 0;
+    uint8_t commandesExecutees = 0;
+    // Fin de l'émission en cours sur la liaison vers la raspi.
+    uint64_t finEmission = 0;
+    std::deque<Emission> sortie;
+    uint64_t commandes = 0;
+    uint64_t erreurs = 0;
+    uint64_t perdus = 0;
+};
+
+#endif // SIMULATEURNACELLE_H
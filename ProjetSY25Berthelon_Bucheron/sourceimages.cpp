@@ -0,0 +1,288 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Sources d'images en niveaux de gris pour la détection (raspicam sans copie, relecture d'un fichier, ou nacelle simulée).
+ */
+#include "sourceimages.h"
+#include "mesurelatence.h"
+
+#include "opencv2/imgproc/imgproc.hpp"
+
+/*
+ * Allocateur des vues d'une trame : il ne possède pas la mémoire (tampon de la source), seulement une copie du bail,
+ * rendue quand la dernière vue (copie de cv::Mat, sous-image...) est détruite. Les images que l'on crée avec cet
+ * allocateur (create() d'une autre taille) sont allouées normalement.
+ */
+#if CV_VERSION_MAJOR >= 4
+typedef cv::AccessFlag DroitsAcces;
+#else
+typedef int DroitsAcces;
+#endif
+
+class AllocateurBail : public cv::MatAllocator
+{
+public:
+    cv::UMatData *allocate(int dims, const int *tailles, int type, void *donnees, size_t *pas, DroitsAcces droits,
+                           cv::UMatUsageFlags usage) const
+    {
+        return cv::Mat::getStdAllocator()->allocate(dims, tailles, type, donnees, pas, droits, usage);
+    }
+
+    bool allocate(cv::UMatData *u, DroitsAcces droits, cv::UMatUsageFlags usage) const
+    {
+        return cv::Mat::getStdAllocator()->allocate(u, droits, usage);
+    }
+
+    void deallocate(cv::UMatData *u) const
+    {
+        delete static_cast<std::shared_ptr<int> *>(u->userdata); // rend le bail, le tampon reste à la source.
+        delete u;
+    }
+};
+
+static AllocateurBail allocateurBail;
+
+/*
+ * Vue sur le tampon de la source qui tient le bail tant qu'elle (ou une de ses copies) existe.
+ */
+static cv::Mat vueSousBail(const cv::Mat &vue, const std::shared_ptr<int> &bail)
+{
+    if (vue.empty())
+        return cv::Mat();
+    cv::Mat m(vue.rows, vue.cols, vue.type(), vue.data, vue.step);
+    cv::UMatData *u = new cv::UMatData(&allocateurBail);
+    u->data = u->origdata = m.data;
+    u->size = m.step * m.rows;
+    u->refcount = 1;
+    u->userdata = new std::shared_ptr<int>(bail);
+    m.u = u;
+    m.allocator = &allocateurBail;
+    return m;
+}
+
+/*
+ * Capture la trame suivante, si la précédente a bien été rendue : la trame passée en paramètre
+ * et toutes les vues tirées d'elle doivent avoir été libérées.
+ */
+bool SourceImages::acquerir(TrameCapture &trame)
+{
+    if (!bailCourant.expired()){ // quelqu'un utilise encore le tampon : on ne l'écrase pas.
+        nbRefus++;
+        return false;
+    }
+    trame.liberer(); // trame vide ou déjà rendue (vues d'une autre source, copies...).
+
+    cv::Mat vue;
+    uint64_t debutLecture = MesureLatence::horloge();
+    uint64_t horodatage;
+    if (!lire(vue, horodatage))
+        return false;
+
+    std::shared_ptr<int> bail = std::make_shared<int>(0);
+    bailCourant = bail;
+
+    trame.luminance = vueSousBail(vue, bail);
+    trame.pleineY = vueSousBail(pleineY, bail);
+    trame.pleineU = vueSousBail(pleineU, bail);
+    trame.pleineV = vueSousBail(pleineV, bail);
+    trame.numero = ++compteur;
+    trame.horodatage = horodatage;
+    trame.debutLecture = debutLecture;
+    trame.bail = bail;
+    return true;
+}
+
+#ifndef SANS_RASPICAM
+SourceRaspiCam::SourceRaspiCam(int largeur, int hauteur, bool retournementVertical, int largeurCapteur, int hauteurCapteur) :
+    largeur(largeur),
+    hauteur(hauteur),
+    hauteResolution(largeurCapteur > largeur && hauteurCapteur > hauteur)
+{
+    cam.setFormat(raspicam::RASPICAM_FORMAT_YUV420); // format natif de la caméra : pas de conversion.
+    if (hauteResolution)
+        cam.setCaptureSize(largeurCapteur, hauteurCapteur);
+    else
+        cam.setCaptureSize(largeur, hauteur);
+    cam.setVerticalFlip(retournementVertical); // caméra montée à l'envers : c'est elle qui retourne l'image.
+}
+
+bool SourceRaspiCam::ouvrir()
+{
+    return cam.isOpened() || cam.open();
+}
+
+void SourceRaspiCam::fermer()
+{
+    cam.release();
+}
+
+bool SourceRaspiCam::estOuverte() const
+{
+    return cam.isOpened();
+}
+
+/*
+ * Le tampon YUV420 commence par le plan Y (largeur alignée sur 32 pixels par la caméra) :
+ * on le présente directement comme une image 8 bits, sans copie.
+ * Suivent les plans U puis V, de demi largeur (pas divisé par deux) et demi hauteur, après la hauteur alignée sur 16.
+ * En haute résolution, la détection reçoit une copie réduite du plan Y (INTER_AREA : quelques ms pour 1640x1232 -> 640x480)
+ * et les trois plans restent des vues pour les recadrages.
+ * La librairie ne réécrit ce tampon que pendant grab(), d'où le bail géré par acquerir().
+ */
+bool SourceRaspiCam::lire(cv::Mat &luminance, uint64_t &horodatage)
+{
+    if (!cam.grab())
+        return false;
+    horodatage = MesureLatence::horloge(); // grab() vient de rendre l'image : la réduction compte dans la latence.
+
+    unsigned char *donnees = cam.getImageBufferData();
+    if (!donnees)
+        return false;
+
+    size_t pas = (cam.getWidth() + 31) & ~31u;
+    luminance = cv::Mat(cam.getHeight(), cam.getWidth(), CV_8UC1, donnees, pas);
+    if (!hauteResolution)
+        return true;
+
+    size_t hauteurAlignee = (cam.getHeight() + 15) & ~15u;
+    unsigned char *u = donnees + pas * hauteurAlignee;
+    unsigned char *v = u + (pas / 2) * (hauteurAlignee / 2);
+    pleineY = luminance;
+    pleineU = cv::Mat(cam.getHeight() / 2, cam.getWidth() / 2, CV_8UC1, u, pas / 2);
+    pleineV = cv::Mat(cam.getHeight() / 2, cam.getWidth() / 2, CV_8UC1, v, pas / 2);
+    cv::resize(pleineY, reduite, cv::Size(largeur, hauteur), 0, 0, cv::INTER_AREA);
+    luminance = cv::Mat(reduite.rows, reduite.cols, CV_8UC1, reduite.data, reduite.step);
+    return true;
+}
+#endif
+
+SourceFichier::SourceFichier(const std::string &chemin, bool reboucler, bool retournementVertical, int largeurDetection, int hauteurDetection) :
+    chemin(chemin),
+    reboucler(reboucler),
+    retournementVertical(retournementVertical),
+    detection(largeurDetection, hauteurDetection)
+{
+}
+
+bool SourceFichier::ouvrir()
+{
+    return video.isOpened() || video.open(chemin);
+}
+
+void SourceFichier::fermer()
+{
+    video.release();
+}
+
+bool SourceFichier::estOuverte() const
+{
+    return video.isOpened();
+}
+
+bool SourceFichier::lire(cv::Mat &luminance, uint64_t &horodatage)
+{
+    if (!video.read(image)){
+        if (!reboucler)
+            return false;
+        video.set(cv::CAP_PROP_POS_FRAMES, 0); // fin du fichier : on recommence au début.
+        if (!video.read(image))
+            return false;
+    }
+    horodatage = MesureLatence::horloge(); // image décodée, comme au retour de grab() pour la caméra.
+
+    if (!retournementVertical){
+        if (image.channels() == 1)
+            image.copyTo(tampon);
+        else
+            cv::cvtColor(image, tampon, cv::COLOR_BGR2GRAY); // le tampon garde sa mémoire d'une image à l'autre.
+    } else if (image.channels() == 1){
+        cv::flip(image, tampon, 0); // copie et retournement en une seule passe.
+    } else {
+        // Conversion ligne par ligne vers la ligne symétrique : retournement et niveaux de gris en une seule passe.
+        tampon.create(image.rows, image.cols, CV_8UC1);
+        for (int y = 0; y < image.rows; y++){
+            cv::Mat ligne = tampon.row(image.rows - 1 - y);
+            cv::cvtColor(image.row(y), ligne, cv::COLOR_BGR2GRAY);
+        }
+    }
+
+    // Vue sans propriété sur le tampon, comme pour la caméra.
+    luminance = cv::Mat(tampon.rows, tampon.cols, CV_8UC1, tampon.data, tampon.step);
+    if (detection.width > 0 && detection.height > 0 && detection.width < tampon.cols && detection.height < tampon.rows){
+        pleineY = luminance;
+        cv::resize(tampon, reduite, detection, 0, 0, cv::INTER_AREA);
+        luminance = cv::Mat(reduite.rows, reduite.cols, CV_8UC1, reduite.data, reduite.step);
+    }
+    return true;
+}
+
+SourceNacelle::SourceNacelle(const std::string &chemin, bool reboucler, SimulateurNacelle *simulateur) :
+    chemin(chemin),
+    reboucler(reboucler),
+    simulateur(simulateur)
+{
+}
+
+bool SourceNacelle::ouvrir()
+{
+    if (video.isOpened())
+        return true;
+    if (!video.open(chemin))
+        return false;
+    double fps = video.get(cv::CAP_PROP_FPS);
+    imagesParSeconde = fps > 0 ? fps : 30;
+    debut = 0;
+    suivante = 0;
+    return true;
+}
+
+void SourceNacelle::fermer()
+{
+    video.release();
+}
+
+bool SourceNacelle::estOuverte() const
+{
+    return video.isOpened();
+}
+
+bool SourceNacelle::lire(cv::Mat &luminance, uint64_t &horodatage)
+{
+    uint64_t maintenant = MesureLatence::horloge();
+    horodatage = maintenant; // la fenêtre est prise à cet instant (position des servos simulés).
+    if (debut == 0)
+        debut = maintenant;
+
+    // Image de la vidéo à cet instant : les images passées pendant le traitement sont sautées sans être décodées.
+    int64_t courante = (int64_t)((maintenant - debut) * imagesParSeconde / 1e6);
+    bool nouvelle = false;
+    while (suivante <= courante){
+        if (!video.grab()){
+            if (!reboucler)
+                return false;
+            video.set(cv::CAP_PROP_POS_FRAMES, 0); // fin du fichier : on recommence au début.
+            debut = maintenant;
+            suivante = courante = 0;
+            if (!video.grab())
+                return false;
+        }
+        suivante++;
+        nouvelle = true;
+    }
+    if (nouvelle && !video.retrieve(image))
+        return false;
+    if (image.empty())
+        return false;
+
+    // La fenêtre suit les servos tels qu'ils sont à l'instant de la capture.
+    simulateur->avancer(maintenant);
+    cv::Mat vue = image(simulateur->fenetre(image.size()));
+    if (vue.channels() == 1)
+        vue.copyTo(tampon);
+    else
+        cv::cvtColor(vue, tampon, cv::COLOR_BGR2GRAY); // seule la fenêtre est convertie.
+
+    luminance = cv::Mat(tampon.rows, tampon.cols, CV_8UC1, tampon.data, tampon.step);
+    return true;
+}
@@ -0,0 +1,186 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Sources d'images en niveaux de gris pour la détection.
+ * La trame rendue par acquerir() est une simple vue (cv::Mat sans copie) sur le tampon de la source :
+ * pour la raspicam, c'est le plan de luminance (Y) du tampon YUV420, sans conversion ni copie.
+ * Tant que le bail de la trame est tenu, la source refuse de capturer une nouvelle image dans ce tampon : chaque vue
+ * (luminance, plans pleine résolution, et leurs copies cv::Mat ou sous-images) tient le bail jusqu'à sa destruction.
+ *
+ * La caméra est montée à l'envers : les sources rendent directement des images à l'endroit
+ * (retournement fait par la caméra elle-même, ou pendant la conversion en niveaux de gris pour un fichier),
+ * il n'y a donc plus de passe flip() sur chaque image.
+ *
+ * Haute résolution ([camera] largeurCapteur / hauteurCapteur) : la caméra capture en plus grand que l'image de détection,
+ * la trame rend alors une copie réduite pour la détection (luminance) et des vues sur l'image pleine résolution
+ * (plans Y, U, V), d'où les recadrages du visage sont tirés sans arrêter la vidéo (voir recadragevisage.h).
+ */
+#ifndef SOURCEIMAGES_H
+#define SOURCEIMAGES_H
+
+#include "simulateurnacelle.h"
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/videoio/videoio.hpp>
+#ifndef SANS_RASPICAM // outils hors de la raspi (BancSources) : relecture de fichiers et nacelle simulée seulement.
+#include <raspicam/raspicam.h>
+#endif
+#include <memory>
+#include <stdint.h>
+#include <string>
+
+/*
+ * Trame capturée. Les vues tiennent le bail, comme "bail" lui-même : tant que l'une d'elles existe, la source
+ * ne réécrit pas son tampon. Une copie (clone, copyTo) ne tient pas le bail : c'est ce qu'il faut garder au delà de l'image.
+ */
+struct TrameCapture {
+    cv::Mat luminance;
+    unsigned int numero = 0;
+    // instant de la capture (MesureLatence::horloge(), en µs), pris dès que la source a rendu l'image.
+    uint64_t horodatage = 0;
+    // instant où la source a commencé à attendre l'image (avant grab()).
+    uint64_t debutLecture = 0;
+    // Image pleine résolution (haute résolution seulement, vides sinon) : plans Y, U et V (U et V vides pour un fichier,
+    // en niveaux de gris). Vues sur le tampon de la source, valides sous le même bail que "luminance".
+    cv::Mat pleineY;
+    cv::Mat pleineU;
+    cv::Mat pleineV;
+    std::shared_ptr<int> bail;
+
+    // Rend le tampon à la source.
+    void liberer() { luminance.release(); pleineY.release(); pleineU.release(); pleineV.release(); bail.reset(); }
+};
+
+class SourceImages
+{
+public:
+    virtual ~SourceImages() {}
+
+    virtual bool ouvrir() = 0;
+    virtual void fermer() = 0;
+    virtual bool estOuverte() const = 0;
+
+    /*
+     * Capture la trame suivante. Retourne false si la source n'a pas d'image, ou si la trame précédente est encore utilisée :
+     * son bail n'est pas rendu tant que la trame (y compris celle passée en paramètre) ou l'une de ses vues n'est pas libérée.
+     */
+    bool acquerir(TrameCapture &trame);
+
+    // Nombre de captures refusées parce que la trame précédente était encore utilisée.
+    int capturesRefusees() const { return nbRefus; }
+
+protected:
+    /*
+     * Capture une image dans le tampon de la source et renvoie une vue dessus, avec l'instant de la capture
+     * (MesureLatence::horloge(), pris dès que l'image est rendue, avant réduction ou conversion).
+     * En haute résolution, remplit aussi pleineY / pleineU / pleineV (laissés vides sinon).
+     */
+    virtual bool lire(cv::Mat &luminance, uint64_t &horodatage) = 0;
+
+    cv::Mat pleineY;
+    cv::Mat pleineU;
+    cv::Mat pleineV;
+
+private:
+    std::weak_ptr<int> bailCourant;
+    unsigned int compteur = 0;
+    int nbRefus = 0;
+};
+
+#ifndef SANS_RASPICAM
+/*
+ * Raspicam en YUV420 : la trame est le plan Y du tampon de la caméra.
+ */
+class SourceRaspiCam : public SourceImages
+{
+public:
+    /*
+     * retournementVertical : l'image est retournée par la caméra (processeur d'image du GPU), sans coût pour la raspi.
+     * largeurCapteur / hauteurCapteur : taille de capture si elle dépasse celle de la détection (haute résolution,
+     * mêmes proportions ; hauteurs multiples de 16), 0 sinon.
+     */
+    SourceRaspiCam(int largeur, int hauteur, bool retournementVertical, int largeurCapteur = 0, int hauteurCapteur = 0);
+
+    bool ouvrir();
+    void fermer();
+    bool estOuverte() const;
+
+    raspicam::RaspiCam &camera() { return cam; }
+
+protected:
+    bool lire(cv::Mat &luminance, uint64_t &horodatage);
+
+private:
+    raspicam::RaspiCam cam;
+    int largeur;
+    int hauteur;
+    bool hauteResolution;
+    // image de détection réduite (haute résolution).
+    cv::Mat reduite;
+};
+#endif
+
+/*
+ * Relecture d'un fichier vidéo (ou d'une suite d'images "img_%04d.png"), pour travailler sans la raspi.
+ * Les images sont converties en niveaux de gris dans un tampon unique, avec le même contrat que la caméra.
+ * Si le fichier a été filmé avec la caméra à l'envers, le retournement se fait dans la même passe que la conversion.
+ */
+class SourceFichier : public SourceImages
+{
+public:
+    /*
+     * largeurDetection / hauteurDetection : si non nulles et plus petites que les images du fichier, la détection reçoit
+     * une copie réduite et la trame garde l'image entière (haute résolution, en niveaux de gris).
+     */
+    SourceFichier(const std::string &chemin, bool reboucler, bool retournementVertical, int largeurDetection = 0, int hauteurDetection = 0);
+
+    bool ouvrir();
+    void fermer();
+    bool estOuverte() const;
+
+protected:
+    bool lire(cv::Mat &luminance, uint64_t &horodatage);
+
+private:
+    std::string chemin;
+    bool reboucler;
+    bool retournementVertical;
+    cv::Size detection;
+    cv::VideoCapture video;
+    cv::Mat image;
+    cv::Mat tampon;
+    cv::Mat reduite;
+};
+
+/*
+ * Caméra virtuelle d'une nacelle simulée : fenêtre de la taille de la caméra, déplacée par les servos du simulateur
+ * dans une vidéo grand angle. Comme une caméra, la vidéo avance avec l'horloge (les images en retard sont sautées)
+ * au lieu d'avancer d'une image par capture. La vidéo doit être à l'endroit.
+ */
+class SourceNacelle : public SourceImages
+{
+public:
+    SourceNacelle(const std::string &chemin, bool reboucler, SimulateurNacelle *simulateur);
+
+    bool ouvrir();
+    void fermer();
+    bool estOuverte() const;
+
+protected:
+    bool lire(cv::Mat &luminance, uint64_t &horodatage);
+
+private:
+    std::string chemin;
+    bool reboucler;
+    SimulateurNacelle *simulateur;
+    cv::VideoCapture video;
+    double imagesParSeconde = 30;
+    // instant (MesureLatence::horloge()) de l'image 0 de la vidéo, et numéro de la prochaine image décodée.
+    uint64_t debut = 0;
+    int64_t suivante = 0;
+    cv::Mat image;
+    cv::Mat tampon;
+};
+
+#endif // SOURCEIMAGES_H
@@ -0,0 +1,114 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Prédiction de la position du visage (rotation de la caméra et vitesse propre) et fenêtre de recherche.
+ */
+#include "suivivisage.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+// Durée maximum (s) sur laquelle la vitesse propre du visage est prolongée.
+#define DUREE_PREDICTION_MAX 0.5
+
+SuiviVisage::SuiviVisage(const CalibrationCamera &calibration, double marge, int echecsMax) :
+    calibration(calibration),
+    marge(marge),
+    echecsMax(echecsMax)
+{
+}
+
+cv::Rect SuiviVisage::zoneRecherche(uint64_t instant, const Gyroscope *gyroscope, bool imageEntiere)
+{
+    cv::Rect entiere(0, 0, calibration.largeur, calibration.hauteur);
+    images++;
+    instantImage = instant;
+    fenetre = false;
+    if (!suivi){
+        sommeSurface += 1;
+        return entiere;
+    }
+
+    // points de la scène déplacés par la rotation de la caméra depuis la dernière détection...
+    rotationMesuree = gyroscope && instant >= instantDetection && gyroscope->rotation(instantDetection, instant, rotationH, rotationV);
+    if (rotationMesuree){
+        rotations++;
+    } else {
+        rotationH = 0;
+        rotationV = 0;
+    }
+    predit = calibration.deplacer(centre, rotationH, rotationV);
+    // ... puis par le mouvement propre du visage.
+    if (vitesseConnue){
+        double dt = std::min((instant - instantDetection) / 1e6, DUREE_PREDICTION_MAX);
+        predit += vitesse * dt;
+    }
+
+    if (imageEntiere){ // la prédiction sert à resultat(), mais toute l'image est analysée.
+        sommeSurface += 1;
+        return entiere;
+    }
+
+    // chaque image manquée élargit la fenêtre.
+    double elargissement = 0.5 + marge * (1 + echecs);
+    double demiLargeur = taille.width * elargissement;
+    double demiHauteur = taille.height * elargissement;
+    cv::Rect zone = cv::Rect(cvRound(predit.x - demiLargeur), cvRound(predit.y - demiHauteur),
+                             cvRound(2 * demiLargeur), cvRound(2 * demiHauteur)) & entiere;
+    if (zone.width < taille.width || zone.height < taille.height){ // visage prédit hors de l'image : recherche partout.
+        sommeSurface += 1;
+        return entiere;
+    }
+    fenetre = zone != entiere;
+    if (fenetre)
+        imagesFenetre++;
+    sommeSurface += (double)zone.area() / entiere.area();
+    return zone;
+}
+
+void SuiviVisage::resultat(const cv::Rect *visage)
+{
+    if (!visage){
+        if (suivi && ++echecs > echecsMax){ // visage perdu : retour à l'image entière.
+            suivi = false;
+            vitesseConnue = false;
+            echecs = 0;
+            pertes++;
+        }
+        return;
+    }
+
+    cv::Point2d mesure(visage->x + visage->width / 2.0, visage->y + visage->height / 2.0);
+    if (fenetre){
+        double ecart = std::sqrt((mesure.x - predit.x) * (mesure.x - predit.x) + (mesure.y - predit.y) * (mesure.y - predit.y));
+        sommeEcarts += ecart;
+        nombreEcarts++;
+        plusGrandEcart = std::max(plusGrandEcart, ecart);
+    }
+    double dt = (instantImage - instantDetection) / 1e6;
+    if (suivi && instantImage > instantDetection && dt <= DUREE_PREDICTION_MAX){
+        // vitesse propre : ce qui reste du déplacement une fois celui dû à la rotation de la caméra retiré.
+        cv::Point2d propre = (mesure - calibration.deplacer(centre, rotationH, rotationV)) * (1 / dt);
+        vitesse = vitesseConnue ? (vitesse + propre) * 0.5 : propre;
+        vitesseConnue = true;
+    } else {
+        vitesseConnue = false;
+    }
+    centre = mesure;
+    taille = visage->size();
+    instantDetection = instantImage;
+    echecs = 0;
+    suivi = true;
+}
+
+std::string SuiviVisage::rapport() const
+{
+    char texte[300];
+    snprintf(texte, sizeof(texte), "suivi du visage : fenêtre sur %.0f %% des images, surface analysée %.0f %%, %llu pertes, "
+             "écart à la prédiction %.1f px (max %.1f), rotation mesurée sur %llu images\n",
+             images > 0 ? 100. * imagesFenetre / images : 0., 100 * surfaceMoyenne(), (unsigned long long)pertes,
+             ecartMoyen(), plusGrandEcart, (unsigned long long)rotations);
+    return texte;
+}
@@ -0,0 +1,104 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Suivi du visage d'une image à l'autre : la position du visage dans l'image suivante est prédite, et la détection
+ * ne cherche que dans une fenêtre autour de cette prédiction (DetecteurVisage::detecterVisages() sur une zone),
+ * bien plus petite que l'image.
+ *
+ * Quand la nacelle tourne, tous les pixels de l'image suivante se déplacent. Avec le gyroscope (gyroscope.h),
+ * la dernière position du visage est d'abord déplacée de la rotation de la caméra mesurée entre les deux images
+ * (CalibrationCamera::deplacer()), puis de la vitesse propre du visage. Celle-ci est estimée sur les détections
+ * successives, rotation de la caméra retirée : sans gyroscope, le mouvement de la nacelle passe dans cette vitesse,
+ * la prédiction est en retard puis dépasse pendant les mouvements et la fenêtre manque le visage.
+ *
+ * Chaque image sans visage élargit la fenêtre ; après "echecsMax" images sans visage, la recherche repart sur l'image entière.
+ */
+#ifndef SUIVIVISAGE_H
+#define SUIVIVISAGE_H
+
+#include "calibrationcamera.h"
+#include "gyroscope.h"
+
+#include <opencv2/core/core.hpp>
+#include <stdint.h>
+#include <string>
+
+class SuiviVisage
+{
+public:
+    /*
+     * calibration : taille des images et champ de la caméra (conversion des rotations en pixels).
+     * marge : la fenêtre dépasse le visage prédit de "marge" fois sa taille de chaque côté.
+     */
+    SuiviVisage(const CalibrationCamera &calibration = CalibrationCamera(), double marge = 0.75, int echecsMax = 2);
+
+    /*
+     * Zone où chercher le visage dans l'image prise à "instant" (µs) : fenêtre autour de la prédiction,
+     * ou l'image entière si aucun visage n'est suivi. "gyroscope" peut être nul (prédiction sans rotation de la caméra).
+     * imageEntiere : l'image entière est demandée pour cette image (recherche des autres visages), la prédiction est gardée.
+     */
+    cv::Rect zoneRecherche(uint64_t instant, const Gyroscope *gyroscope, bool imageEntiere = false);
+
+    /*
+     * Résultat de la détection dans la zone rendue par le dernier zoneRecherche() : visage retenu
+     * (coordonnées de l'image), ou nul si aucun visage n'a été trouvé.
+     */
+    void resultat(const cv::Rect *visage);
+
+    /*
+     * Le visage suivi change de personne (avant resultat()) : la position et la vitesse du précédent ne valent pas pour lui.
+     */
+    void changerVisage() { suivi = false; vitesseConnue = false; echecs = 0; }
+
+    // Un visage est-il suivi (la prochaine zone sera une fenêtre) ?
+    bool enSuivi() const { return suivi; }
+
+    // Position prédite du centre du visage lors du dernier zoneRecherche() (valable si la zone était une fenêtre).
+    cv::Point2d prediction() const { return predit; }
+
+    /*
+     * Part réduite de l'image analysée, pertes du visage, écart entre prédiction et détection, rotations mesurées, en texte.
+     */
+    std::string rapport() const;
+
+    // Statistiques depuis le lancement.
+    uint64_t nombreImages() const { return images; }
+    uint64_t nombrePertes() const { return pertes; }
+    double surfaceMoyenne() const { return images > 0 ? sommeSurface / images : 1.; }
+    double ecartMoyen() const { return nombreEcarts > 0 ? sommeEcarts / nombreEcarts : 0.; }
+    double ecartMaximum() const { return plusGrandEcart; }
+
+    CalibrationCamera calibration;
+    double marge;
+    int echecsMax;
+
+private:
+    bool suivi = false;
+    // dernière détection : centre (px), taille, instant (µs).
+    cv::Point2d centre;
+    cv::Size taille;
+    uint64_t instantDetection = 0;
+    // vitesse propre du visage (px/s), rotation de la caméra retirée ; false tant qu'une seule détection est connue.
+    cv::Point2d vitesse;
+    bool vitesseConnue = false;
+    int echecs = 0;
+    // image en cours : instant, rotation de la caméra depuis la dernière détection, prédiction, zone.
+    uint64_t instantImage = 0;
+    double rotationH = 0;
+    double rotationV = 0;
+    bool rotationMesuree = false;
+    cv::Point2d predit;
+    bool fenetre = false;
+
+    uint64_t images = 0;
+    uint64_t imagesFenetre = 0;
+    uint64_t pertes = 0;
+    uint64_t rotations = 0;
+    double sommeSurface = 0;
+    double sommeEcarts = 0;
+    uint64_t nombreEcarts = 0;
+    double plusGrandEcart = 0;
+};
+
+#endif // SUIVIVISAGE_H
@@ -0,0 +1,203 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Lecture de la télémétrie des servomoteurs : trames, datation sur l'horloge de la raspi, latences des commandes.
+ */
+#include "telemetrieservo.h"
+#include "planificateurmouvement.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+// Durée d'une trame sur la liaison à 115200 bauds (87 µs par octet).
+#define DUREE_TRAME_US (TAILLE_TRAME_TELEMETRIE * 87)
+// Trames sur lesquelles l'écart entre les horloges est cherché (1 s à 50 Hz).
+#define FENETRE_HORLOGE 50
+// Commandes gardées sans télémétrie (ancien programme de l'arduino) : au delà, les plus anciennes sont oubliées.
+#define COMMANDES_EN_VOL_MAX 256
+
+TelemetrieServo::TelemetrieServo(size_t historique) :
+    tailleHistorique(std::max(historique, (size_t)2))
+{
+}
+
+void TelemetrieServo::recevoir(const char *octets, size_t n, uint64_t instantLecture)
+{
+    for (size_t i = 0; i < n; i++){
+        uint8_t octet = (uint8_t)octets[i];
+
+        if (trameEnCours.empty()){ // hors trame : texte ASCII, ou début de trame.
+            if (octet == SYNCHRO_TELEMETRIE_1)
+                trameEnCours.push_back(octet);
+            else if (octet < 0x80)
+                texte += (char)octet;
+            continue;
+        }
+
+        trameEnCours.push_back(octet);
+        if (trameEnCours.size() == 2 && octet != SYNCHRO_TELEMETRIE_2){ // 0xA5 isolé : pas une trame.
+            trameEnCours.clear();
+            recevoir((const char *)&octet, 1, instantLecture);
+            continue;
+        }
+        if (trameEnCours.size() < TAILLE_TRAME_TELEMETRIE)
+            continue;
+
+        TrameTelemetrie trame;
+        if (decoderTelemetrie(trameEnCours.data(), trame)){
+            trameEnCours.clear();
+            traiterTrame(trame, instantLecture);
+        } else {
+            // trame abîmée : on reprend la recherche juste après son premier octet de synchronisation.
+            invalides++;
+            std::vector<uint8_t> reste(trameEnCours.begin() + 1, trameEnCours.end());
+            trameEnCours.clear();
+            size_t debut = std::find(reste.begin(), reste.end(), (uint8_t)SYNCHRO_TELEMETRIE_1) - reste.begin();
+            if (debut < reste.size())
+                recevoir((const char *)reste.data() + debut, reste.size() - debut, instantLecture);
+        }
+    }
+}
+
+void TelemetrieServo::traiterTrame(const TrameTelemetrie &trame, uint64_t instantLecture)
+{
+    trames++;
+    if (premiere){
+        instantArduino = trame.instant;
+        commandesExecutees = trame.commandes; // les commandes envoyées avant la première trame sont oubliées.
+        enVol.clear();
+    } else {
+        perdues += (uint8_t)(trame.numero - dernierNumero - 1);
+        instantArduino += (uint32_t)(trame.instant - dernierInstantArduino); // micros() repasse par zéro toutes les 70 minutes.
+    }
+    premiere = false;
+    dernierNumero = trame.numero;
+    dernierInstantArduino = trame.instant;
+
+    // Ecart entre les horloges : le plus petit des dernières trames (celle qui a attendu le moins avant d'être lue).
+    Reception reception = { instantLecture, instantArduino };
+    receptions.push_back(reception);
+    if (receptions.size() > FENETRE_HORLOGE)
+        receptions.pop_front();
+    ecartHorloges = (int64_t)receptions.front().lecture - DUREE_TRAME_US - (int64_t)receptions.front().instantArduino;
+    for (size_t i = 1; i < receptions.size(); i++)
+        ecartHorloges = std::min(ecartHorloges, (int64_t)receptions[i].lecture - DUREE_TRAME_US - (int64_t)receptions[i].instantArduino);
+
+    EtatServos e;
+    e.instant = (uint64_t)((int64_t)instantArduino + ecartHorloges);
+    if (!historique.empty() && e.instant < historique.back().instant) // l'écart vient de diminuer : on reste dans l'ordre.
+        e.instant = historique.back().instant;
+    e.cibleH = trame.cibleH / 100.;
+    e.cibleV = trame.cibleV / 100.;
+    e.angleH = trame.angleH / 100.;
+    e.angleV = trame.angleV / 100.;
+    e.enAttente = trame.enAttente;
+    historique.push_back(e);
+    if (historique.size() > tailleHistorique)
+        historique.pop_front();
+
+    // Commandes exécutées depuis la trame précédente.
+    uint8_t executees = (uint8_t)(trame.commandes - commandesExecutees);
+    commandesExecutees = trame.commandes;
+    for (uint8_t i = 0; i < executees && !enVol.empty(); i++){
+        execution.ajouter(e.instant > enVol.front().instant ? e.instant - enVol.front().instant : 0);
+        enMouvement.push_back(enVol.front());
+        enVol.pop_front();
+    }
+
+    // Servos arrivés sur leur cible : fin du mouvement des commandes exécutées.
+    if (e.enAttente == 0 && std::fabs(e.angleH - e.cibleH) < 0.01 && std::fabs(e.angleV - e.cibleV) < 0.01){
+        for (size_t i = 0; i < enMouvement.size(); i++)
+            mouvement.ajouter(e.instant > enMouvement[i].instant ? e.instant - enMouvement[i].instant : 0);
+        enMouvement.clear();
+    }
+}
+
+void TelemetrieServo::commandesEnvoyees(const char *octets, size_t n, uint64_t instant)
+{
+    for (size_t i = 0; i < n; i++){
+        Envoi envoi = { octets[i], instant };
+        enVol.push_back(envoi);
+    }
+    while (enVol.size() > COMMANDES_EN_VOL_MAX)
+        enVol.pop_front();
+}
+
+bool TelemetrieServo::etat(uint64_t instant, EtatServos &etat) const
+{
+    if (historique.empty() || instant < historique.front().instant)
+        return false;
+    if (instant >= historique.back().instant){
+        if (instant - historique.back().instant > 2*PERIODE_TELEMETRIE_US)
+            return false;
+        etat = historique.back();
+        etat.instant = instant;
+        return true;
+    }
+
+    // première trame après "instant", et celle d'avant.
+    std::deque<EtatServos>::const_iterator apres = std::upper_bound(historique.begin(), historique.end(), instant,
+        [](uint64_t t, const EtatServos &e){ return t < e.instant; });
+    const EtatServos &a = *(apres - 1);
+    const EtatServos &b = *apres;
+    double f = b.instant > a.instant ? (double)(instant - a.instant) / (b.instant - a.instant) : 0.;
+    etat = a;
+    etat.instant = instant;
+    etat.angleH = a.angleH + f*(b.angleH - a.angleH);
+    etat.angleV = a.angleV + f*(b.angleV - a.angleV);
+    return true;
+}
+
+bool TelemetrieServo::ciblesAttendues(uint64_t instant, double &cibleH, double &cibleV) const
+{
+    if (historique.empty() || instant > historique.back().instant + 2*PERIODE_TELEMETRIE_US)
+        return false;
+    cibleH = historique.back().cibleH;
+    cibleV = historique.back().cibleV;
+    // mêmes règles que executer() dans ControlMoteurArduino.ino.
+    for (size_t i = 0; i < enVol.size(); i++){
+        switch (enVol[i].octet){
+        case 'H': cibleH += PAS_COMMANDE_SERVO; break;
+        case 'h': cibleH -= PAS_COMMANDE_SERVO; break;
+        case 'V': cibleV += PAS_COMMANDE_SERVO; break;
+        case 'v': cibleV -= PAS_COMMANDE_SERVO; break;
+        case 'r': cibleH = cibleV = 90; break;
+        default: break;
+        }
+        cibleH = std::min(std::max(cibleH, 0.), 180.);
+        cibleV = std::min(std::max(cibleV, 0.), 180.);
+    }
+    return true;
+}
+
+std::string TelemetrieServo::lireTexte()
+{
+    std::string t;
+    t.swap(texte);
+    return t;
+}
+
+/*
+ * Même présentation que les lignes de MesureLatence::rapport().
+ */
+static void ligneRapport(std::string &texte, const char *nom, const HistogrammeLatence &h)
+{
+    char ligne[160];
+    snprintf(ligne, sizeof(ligne), "%-12s n=%-7llu moy=%7.2f med=%7.2f p90=%7.2f p99=%7.2f max=%7.2f ms\n",
+             nom, (unsigned long long)h.nombre(), h.moyenne() / 1000., h.centile(50) / 1000.,
+             h.centile(90) / 1000., h.centile(99) / 1000., h.maximum() / 1000.);
+    texte += ligne;
+}
+
+std::string TelemetrieServo::rapport() const
+{
+    char ligne[160];
+    snprintf(ligne, sizeof(ligne), "télémétrie servos : %llu trames, %llu perdues, %llu invalides\n",
+             (unsigned long long)trames, (unsigned long long)perdues, (unsigned long long)invalides);
+    std::string texte = ligne;
+    ligneRapport(texte, "exécution", execution);
+    ligneRapport(texte, "mouvement", mouvement);
+    return texte;
+}
@@ -0,0 +1,123 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Lecture de la télémétrie des servomoteurs (trames de trametelemetrie.h) sur la liaison série de l'arduino.
+ *
+ * Les octets sont donnés au fil de leur arrivée (readyRead du port série, ou sortie du simulateur de nacelle), avec l'instant
+ * de leur lecture (MesureLatence::horloge()). Les trames sont retrouvées au milieu du texte ("OL", "Err"...) par leurs
+ * octets de synchronisation et leur CRC ; le texte est gardé à part.
+ *
+ * Chaque trame est datée sur l'horloge de la raspi : l'écart entre les deux horloges est le plus petit écart
+ * (lecture - durée de la trame sur la liaison - micros() de l'arduino) des dernières trames, celle arrivée sans attendre
+ * donnant l'écart le plus juste ; une fenêtre glissante suit la dérive du quartz de l'arduino.
+ *
+ * Les commandes envoyées sont notées (commandesEnvoyees()) : le compteur de commandes exécutées des trames donne
+ * la latence d'exécution (envoi -> exécution par l'arduino, à une période de télémétrie près) et la latence de mouvement
+ * (envoi -> servo arrivé sur sa cible).
+ */
+#ifndef TELEMETRIESERVO_H
+#define TELEMETRIESERVO_H
+
+#include "mesurelatence.h"
+#include "trametelemetrie.h"
+
+#include <deque>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Etat des servos à un instant (angles en degrés, instant sur l'horloge de la raspi en µs).
+struct EtatServos {
+    uint64_t instant = 0;
+    double cibleH = 90;
+    double cibleV = 90;
+    double angleH = 90;
+    double angleV = 90;
+    int enAttente = 0;
+};
+
+class TelemetrieServo
+{
+public:
+    /*
+     * historique : nombre de trames gardées pour etat() (256 trames : 5 s à 50 Hz).
+     */
+    TelemetrieServo(size_t historique = 256);
+
+    /*
+     * Octets lus sur la liaison à l'instant "instantLecture" (µs, MesureLatence::horloge()).
+     */
+    void recevoir(const char *octets, size_t n, uint64_t instantLecture);
+
+    /*
+     * "n" octets de commande envoyés à l'arduino à l'instant "instant".
+     */
+    void commandesEnvoyees(const char *octets, size_t n, uint64_t instant);
+
+    /*
+     * Etat des servos à "instant" (interpolé entre les deux trames qui l'encadrent). Retourne false si aucune trame
+     * ne couvre cet instant (avant la première trame gardée, ou plus de deux périodes après la dernière).
+     */
+    bool etat(uint64_t instant, EtatServos &etat) const;
+
+    /*
+     * Cibles que les servos auront quand les commandes déjà envoyées mais pas encore exécutées le seront.
+     * Retourne false sans trame récente.
+     */
+    bool ciblesAttendues(uint64_t instant, double &cibleH, double &cibleV) const;
+
+    // Texte reçu hors des trames depuis le dernier appel.
+    std::string lireTexte();
+
+    uint64_t nombreTrames() const { return trames; }
+    uint64_t tramesInvalides() const { return invalides; }
+    uint64_t tramesPerdues() const { return perdues; }
+
+    // envoi -> exécution, envoi -> servo arrivé sur la cible.
+    const HistogrammeLatence &latenceExecution() const { return execution; }
+    const HistogrammeLatence &latenceMouvement() const { return mouvement; }
+
+    /*
+     * Résumé texte (trames, pertes, latences), pour le rapport de latence.
+     */
+    std::string rapport() const;
+
+private:
+    struct Envoi {
+        char octet;
+        uint64_t instant;
+    };
+    struct Reception {
+        uint64_t lecture;      // horloge de la raspi
+        uint64_t instantArduino; // micros() déroulé sur 64 bits
+    };
+
+    void traiterTrame(const TrameTelemetrie &trame, uint64_t instantLecture);
+
+    size_t tailleHistorique;
+    std::deque<EtatServos> historique;
+    std::deque<Reception> receptions;
+    std::vector<uint8_t> trameEnCours;
+    std::string texte;
+
+    bool premiere = true;
+    uint8_t dernierNumero = 0;
+    uint32_t dernierInstantArduino = 0;
+    uint64_t instantArduino = 0;
+    int64_t ecartHorloges = 0;
+
+    // Commandes envoyées pas encore vues exécutées, puis exécutées pas encore arrivées.
+    std::deque<Envoi> enVol;
+    std::deque<Envoi> enMouvement;
+    uint8_t commandesExecutees = 0;
+
+    uint64_t trames = 0;
+    uint64_t invalides = 0;
+    uint64_t perdues = 0;
+    HistogrammeLatence execution;
+    HistogrammeLatence mouvement;
+};
+
+#endif // TELEMETRIESERVO_H
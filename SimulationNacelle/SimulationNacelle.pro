@@ -0,0 +1,53 @@
+#-------------------------------------------------
+#
+# Boucle fermée de la nacelle simulée, plus vite que le temps réel
+# (voir ../ProjetSY25Berthelon_Bucheron/simulateurnacelle.h)
+#
+#-------------------------------------------------
+
+TEMPLATE = app
+TARGET = SimulationNacelle
+CONFIG += console c++11 thread
+CONFIG -= qt app_bundle
+
+INCLUDEPATH += ../ProjetSY25Berthelon_Bucheron ../ControlMoteurArduino
+
+SOURCES += main.cpp \
+    ../ProjetSY25Berthelon_Bucheron/simulateurnacelle.cpp \
+    ../ProjetSY25Berthelon_Bucheron/controleurservo.cpp \
+    ../ProjetSY25Berthelon_Bucheron/telemetrieservo.cpp \
+    ../ProjetSY25Berthelon_Bucheron/calibrationcamera.cpp \
+    ../ProjetSY25Berthelon_Bucheron/gyroscope.cpp \
+    ../ProjetSY25Berthelon_Bucheron/suivivisage.cpp \
+    ../ControlMoteurArduino/planificateurmouvement.cpp \
+    ../ProjetSY25Berthelon_Bucheron/detecteurvisage.cpp \
+    ../ProjetSY25Berthelon_Bucheron/noyauxpretraitement.cpp \
+    ../ProjetSY25Berthelon_Bucheron/mesurelatence.cpp \
+    ../ProjetSY25Berthelon_Bucheron/evaluateurcascade.cpp \
+    ../ProjetSY25Berthelon_Bucheron/contextedetection.cpp \
+    ../ProjetSY25Berthelon_Bucheron/cascadehaar.cpp \
+    ../ProjetSY25Berthelon_Bucheron/noyauxcascade.cpp
+
+HEADERS += ../ProjetSY25Berthelon_Bucheron/simulateurnacelle.h \
+    ../ProjetSY25Berthelon_Bucheron/controleurservo.h \
+    ../ProjetSY25Berthelon_Bucheron/telemetrieservo.h \
+    ../ProjetSY25Berthelon_Bucheron/calibrationcamera.h \
+    ../ProjetSY25Berthelon_Bucheron/gyroscope.h \
+    ../ProjetSY25Berthelon_Bucheron/suivivisage.h \
+    ../ControlMoteurArduino/planificateurmouvement.h \
+    ../ControlMoteurArduino/trametelemetrie.h \
+    ../ProjetSY25Berthelon_Bucheron/detecteurvisage.h \
+    ../ProjetSY25Berthelon_Bucheron/estimateurexpression.h \
+    ../ProjetSY25Berthelon_Bucheron/noyauxpretraitement.h \
+    ../ProjetSY25Berthelon_Bucheron/mesurelatence.h \
+    ../ProjetSY25Berthelon_Bucheron/evaluateurcascade.h \
+    ../ProjetSY25Berthelon_Bucheron/contextedetection.h \
+    ../ProjetSY25Berthelon_Bucheron/cascadehaar.h \
+    ../ProjetSY25Berthelon_Bucheron/noyauxcascade.h
+
+CONFIG += link_pkgconfig
+PKGCONFIG += opencv
+
+# Mêmes options de compilation que l'application pour les noyaux vectorisés et les cascades internes.
+contains(QMAKE_HOST.arch, armv7l): QMAKE_CXXFLAGS += -mfpu=neon-vfpv4
+QMAKE_CXXFLAGS += -ffp-contract=off
@@ -0,0 +1,505 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Boucle fermée de la nacelle, hors ligne et plus vite que le temps réel : une vidéo grand angle (plus grande que
+ * les images de la caméra) sert de scène, la caméra virtuelle en voit une fenêtre déplacée par SimulateurNacelle,
+ * qui interprète les commandes comme ControlMoteurArduino.ino (trajectoires limitées en vitesse et en accélération,
+ * ou programme précédent avec --firmware bloquant : pas de 2° et delay(15)), servos à vitesse limitée.
+ * Chaque fenêtre passe par la même détection que l'application (DetecteurVisage) et la même décision (ControleurServo),
+ * et les commandes repartent au simulateur. Le temps est simulé : chaque image est prise "periode" ms après la précédente
+ * (timer de l'application), la commande part "latence" ms après la capture (temps de traitement),
+ * quelle que soit la vitesse réelle de la machine.
+ *
+ * Pour chaque réglage du contrôleur (--tolerances), la boucle repart du début de la vidéo et des mêmes angles, puis affiche :
+ *  - le temps de convergence : instant où l'écart visage / centre entre dans la tolérance sur les deux axes
+ *    et y reste pendant --stable détections consécutives ;
+ *  - le dépassement : plus grand écart (px) du côté opposé à l'écart initial, par axe ;
+ *  - l'erreur statique : écart moyen et maximum (px) après la convergence, par axe ;
+ *  - les octets envoyés, les réponses "Err", les octets perdus (tampon de l'arduino plein), les images sans visage ;
+ *  - avec le programme planifié, les latences médianes lues par la télémétrie : envoi -> exécution, envoi -> servo arrivé ;
+ *  - avec --suivi, le rapport de SuiviVisage : surface analysée, pertes du visage, écart entre prédiction et détection.
+ *
+ * Utilisation : SimulationNacelle [options] <vidéo grand angle>
+ *   --tolerances t1,t2... : réglages du contrôleur comparés (défaut 20, celui de l'application)
+ *   --periode ms : intervalle entre deux images (défaut 120, timer de l'application)
+ *   --latence ms : de la capture à l'envoi de la commande (défaut 80 ; 0 : temps de traitement mesuré)
+ *   --firmware planifie|bloquant : programme de l'arduino simulé (défaut planifie, ControlMoteurArduino.ino actuel)
+ *   --compensation : commande compensée avec la télémétrie (ControleurServo::commanderCompense(), programme planifié seulement)
+ *   --correction directe|pas : sans compensation, correction en une fois avec la calibration (défaut, comme l'application)
+ *                              ou un pas de 2° par image
+ *   --champ h,v : champ de la caméra (°) connu du contrôleur (défaut 53.50,41.41 : raspicam v1 ; la nacelle simulée
+ *                 correspond à 2 * atan(largeur / 2 / (pixels-par-degre * 57.3)))
+ *   --suivi sans|gyroscope : détection dans une fenêtre autour de la position prédite du visage (SuiviVisage), sans
+ *                            ou avec la rotation de la caméra mesurée par un gyroscope simulé sur la nacelle
+ *                            (vitesses des servos échantillonnées toutes les --periode-imu ms, défaut 5, plus un bruit
+ *                            blanc de --bruit-imu °/s, défaut 0.5)
+ *   --marge m, --echecs n : réglages du suivi (défaut 0.75 et 2, comme [suivi] du fichier ini)
+ *   --calibrer : calibration automatique (CalibrationAuto) au début de chaque passage, puis suivi avec le champ mesuré ;
+ *                les mesures du suivi partent de la fin de la calibration
+ *   --vitesse deg/s (défaut 300), --pixels-par-degre p (défaut 12), --fenetre LxH (défaut 640x480)
+ *   --depart h,v : angles de départ des servos (défaut 90,90 : fenêtre au centre de la vidéo)
+ *   --stable n (défaut 5), --images n : nombre maximum d'images par passage
+ *   --cascades dossier, --internes, --echelle e, --facteur f : détection (comme TraitementLot)
+ *   --trace prefixe : une trace csv par réglage (prefixe_<tolérance>.csv), image par image
+ */
+#include "calibrationcamera.h"
+#include "controleurservo.h"
+#include "detecteurvisage.h"
+#include "gyroscope.h"
+#include "mesurelatence.h"
+#include "noyauxpretraitement.h"
+#include "simulateurnacelle.h"
+#include "suivivisage.h"
+#include "telemetrieservo.h"
+
+#include "opencv2/core/core.hpp"
+#include "opencv2/imgproc/imgproc.hpp"
+#include "opencv2/videoio/videoio.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#define DEGRES (180.0 / CV_PI)
+
+// Fenêtre de recherche du visage.
+enum ModeSuivi {
+    SUIVI_AUCUN = 0,     // détection sur toute l'image
+    SUIVI_SANS = 1,      // fenêtre prédite sans gyroscope
+    SUIVI_GYROSCOPE = 2  // fenêtre prédite avec la rotation mesurée de la caméra
+};
+
+struct Options {
+    std::string video;
+    std::vector<int> tolerances;
+    double periode = 120;
+    double latence = 80;
+    FirmwareNacelle firmware = FIRMWARE_PLANIFIE;
+    bool compensation = false;
+    bool correctionDirecte = true;
+    double champH = 53.50;
+    double champV = 41.41;
+    bool calibrer = false;
+    ModeSuivi suivi = SUIVI_AUCUN;
+    double periodeImu = 5;
+    double bruitImu = 0.5;
+    double marge = 0.75;
+    int echecs = 2;
+    double vitesse = 300;
+    double pixelsParDegre = 12;
+    cv::Size fenetre = cv::Size(640, 480);
+    int departH = 90;
+    int departV = 90;
+    int stable = 5;
+    int imagesMax = 0;
+    std::string dossierCascades = "/usr/share/opencv/haarcascades";
+    bool internes = false;
+    ReglagesDetection reglages;
+    std::string trace;
+};
+
+// Mesures d'un passage de la boucle.
+struct Bilan {
+    int images = 0;
+    int sansVisage = 0;
+    double dureeSimulee = 0;  // s
+    double dureeReelle = 0;   // s
+    double convergence = -1;  // s depuis le début, -1 : jamais
+    double depassement[2] = { 0, 0 };
+    double erreurMoyenne[2] = { 0, 0 };
+    double erreurMax[2] = { 0, 0 };
+    uint64_t octets = 0;
+    uint64_t erreurs = 0;
+    uint64_t perdus = 0;
+    double latenceExecution = 0; // ms, médiane
+    double latenceMouvement = 0; // ms, médiane
+    std::string suivi;           // rapport de SuiviVisage
+};
+
+// Une détection de la boucle : instant simulé (s) et écart du visage au centre de la fenêtre (px).
+struct Ecart {
+    double instant;
+    int erreur[2];
+};
+
+/*
+ * Convergence, dépassement et erreur statique à partir des écarts de toutes les détections.
+ */
+static void analyser(const std::vector<Ecart> &ecarts, int tolerance, int stable, Bilan &bilan)
+{
+    // convergence : début de la première suite de "stable" détections dans la tolérance.
+    size_t debutStable = ecarts.size();
+    int suite = 0;
+    for (size_t i = 0; i < ecarts.size(); i++){
+        bool centre = std::abs(ecarts[i].erreur[0]) <= tolerance && std::abs(ecarts[i].erreur[1]) <= tolerance;
+        suite = centre ? suite + 1 : 0;
+        if (suite >= stable){
+            debutStable = i + 1 - suite;
+            break;
+        }
+    }
+    if (debutStable < ecarts.size())
+        bilan.convergence = ecarts[debutStable].instant;
+
+    for (int axe = 0; axe < 2; axe++){
+        // dépassement : écart de signe opposé au premier écart hors tolérance.
+        int signe = 0;
+        for (size_t i = 0; i < ecarts.size(); i++){
+            int e = ecarts[i].erreur[axe];
+            if (signe == 0 && std::abs(e) > tolerance)
+                signe = e > 0 ? 1 : -1;
+            else if (signe != 0)
+                bilan.depassement[axe] = std::max(bilan.depassement[axe], (double)(-signe * e));
+        }
+
+        // erreur statique, après la convergence.
+        double somme = 0;
+        for (size_t i = debutStable; i < ecarts.size(); i++){
+            double e = std::abs(ecarts[i].erreur[axe]);
+            somme += e;
+            bilan.erreurMax[axe] = std::max(bilan.erreurMax[axe], e);
+        }
+        if (debutStable < ecarts.size())
+            bilan.erreurMoyenne[axe] = somme / (ecarts.size() - debutStable);
+    }
+}
+
+/*
+ * Gyroscope simulé, monté sur la nacelle : vitesses des servos échantillonnées toutes les "periode" µs (comme le thread
+ * LectureGyroscope de l'application), plus un bruit blanc. Axe z pour le servo horizontal, x pour le vertical
+ * (les défauts de [imu]) ; pas de biais, donc pas de mesure du biais au départ.
+ */
+struct ImuSimulee {
+    ImuSimulee(uint64_t periode, double bruit) : gyroscope(2, 1, 0, 1, 0), periode(periode), bruit(0, bruit / DEGRES) {}
+
+    void echantillonner(const SimulateurNacelle &simulateur, uint64_t instant)
+    {
+        double h = simulateur.angleHorizontal(), v = simulateur.angleVertical();
+        if (instant > precedent){
+            double dt = (instant - precedent) / 1e6;
+            EchantillonGyro e;
+            e.instant = instant;
+            e.x = (float)((v - verticalPrecedent) / dt / DEGRES + bruit(generateur));
+            e.y = (float)bruit(generateur);
+            e.z = (float)((h - horizontalPrecedent) / dt / DEGRES + bruit(generateur));
+            gyroscope.ajouter(e);
+        }
+        precedent = instant;
+        horizontalPrecedent = h;
+        verticalPrecedent = v;
+        prochain = instant + periode;
+    }
+
+    Gyroscope gyroscope;
+    uint64_t periode;
+    uint64_t prochain = 0;
+    uint64_t precedent = 0;
+    double horizontalPrecedent = 90;
+    double verticalPrecedent = 90;
+    std::normal_distribution<double> bruit;
+    std::mt19937 generateur;
+};
+
+/*
+ * Sortie de l'arduino simulé lue de "debut" à "fin" (µs) par pas de 1 ms, comme les readyRead du port série
+ * de l'application : chaque trame est datée à peu près à son arrivée. Le gyroscope simulé (s'il y en a un) est lu en même temps.
+ */
+static void lireTelemetrie(SimulateurNacelle &simulateur, TelemetrieServo &telemetrie, ImuSimulee *imu, uint64_t debut, uint64_t fin)
+{
+    for (uint64_t t = debut; ; t = std::min(t + 1000, fin)){
+        std::string sortie = simulateur.lireSortie(t);
+        telemetrie.recevoir(sortie.data(), sortie.size(), t);
+        if (imu && t >= imu->prochain)
+            imu->echantillonner(simulateur, t);
+        if (t >= fin)
+            break;
+    }
+}
+
+/*
+ * Un passage de la boucle fermée sur toute la vidéo avec une tolérance du contrôleur.
+ */
+static bool simuler(const Options &options, DetecteurVisage &detecteur, int tolerance, Bilan &bilan)
+{
+    cv::VideoCapture video(options.video);
+    if (!video.isOpened()){
+        fprintf(stderr, "%s : vidéo illisible\n", options.video.c_str());
+        return false;
+    }
+    double imagesParSeconde = video.get(cv::CAP_PROP_FPS);
+    if (imagesParSeconde <= 0)
+        imagesParSeconde = 30;
+
+    FILE *trace = 0;
+    if (!options.trace.empty()){
+        std::string chemin = options.trace + "_" + std::to_string(tolerance) + ".csv";
+        trace = fopen(chemin.c_str(), "w");
+        if (!trace){
+            perror(chemin.c_str());
+            return false;
+        }
+        fprintf(trace, "instant_ms,image_video,angle_h,angle_v,fenetre_x,fenetre_y,visage,erreur_x,erreur_y,commande\n");
+    }
+
+    SimulateurNacelle simulateur(options.vitesse, options.pixelsParDegre, options.fenetre, options.firmware);
+    simulateur.placer(options.departH, options.departV, 0);
+    ControleurServo controleur(CalibrationCamera(options.fenetre.width, options.fenetre.height, options.champH, options.champV), tolerance);
+    TelemetrieServo telemetrie;
+    CalibrationAuto calibration(controleur.calibration, 6, ControleurServo::dureeDeplacement(6) + MARGE_CORRECTION);
+    bool calibrationEnCours = options.calibrer;
+    SuiviVisage suiviVisage(controleur.calibration, options.marge, options.echecs);
+    ImuSimulee imu((uint64_t)(options.periodeImu * 1000), options.bruitImu);
+    imu.echantillonner(simulateur, 0);
+    ImuSimulee *gyroscope = options.suivi == SUIVI_GYROSCOPE ? &imu : 0;
+    uint64_t debutSuivi = 0;     // instant de la fin de la calibration
+    uint64_t finCorrection = 0;  // correction directe : fin estimée du dernier mouvement
+
+    std::vector<Ecart> ecarts;
+    std::vector<cv::Rect> visages;
+    cv::Mat image, gris;
+    uint64_t instant = 0;  // µs simulées
+    uint64_t lu = 0;       // sortie de l'arduino lue jusque là
+    int64_t suivante = 0;   // prochaine image de la vidéo à décoder
+    uint64_t debutReel = MesureLatence::horloge();
+
+    while (options.imagesMax <= 0 || bilan.images < options.imagesMax){
+        // Image de la scène à cet instant (les images passées pendant le traitement sont sautées, comme avec la caméra).
+        int64_t courante = (int64_t)(instant * imagesParSeconde / 1e6);
+        bool fin = false;
+        while (suivante <= courante && !fin){
+            fin = !video.grab();
+            suivante++;
+        }
+        if (fin || !video.retrieve(image) || image.empty())
+            break;
+
+        lireTelemetrie(simulateur, telemetrie, gyroscope, lu, instant);
+        lu = instant;
+        EtatServos capture;
+        bool etatConnu = telemetrie.etat(instant, capture);
+        cv::Rect rect = simulateur.fenetre(image.size());
+        if (image.channels() == 1)
+            image(rect).copyTo(gris);
+        else
+            cv::cvtColor(image(rect), gris, cv::COLOR_BGR2GRAY);
+
+        uint64_t debut = MesureLatence::horloge();
+        char commande[2*MAX_PAS_PAR_AXE + 1] = { 0 };
+        int n = 0;
+        int plusGrand = -1;
+        bool suivi = !calibrationEnCours; // image analysée par la détection
+        if (calibrationEnCours){ // la nacelle suit la séquence de calibration, pas de détection.
+            n = calibration.image(gris, instant, commande);
+            if (calibration.terminee()){
+                fprintf(stderr, "tolérance %d px, calibration :\n%s", tolerance, calibration.rapport().c_str());
+                if (calibration.reussie())
+                    controleur.calibration = calibration.resultat();
+                suiviVisage.calibration = controleur.calibration;
+                calibrationEnCours = false;
+                debutSuivi = instant;
+            }
+        } else {
+            cv::Rect zone(0, 0, gris.cols, gris.rows);
+            if (options.suivi != SUIVI_AUCUN)
+                zone = suiviVisage.zoneRecherche(instant, gyroscope ? &gyroscope->gyroscope : 0);
+            detecteur.detecterVisages(gris, zone, visages);
+            plusGrand = DetecteurVisage::plusGrand(visages);
+            if (options.suivi != SUIVI_AUCUN)
+                suiviVisage.resultat(plusGrand >= 0 ? &visages[plusGrand] : 0);
+        }
+        uint64_t traitement = options.latence > 0 ? (uint64_t)(options.latence * 1000) : MesureLatence::horloge() - debut;
+        Ecart ecart = { (instant - debutSuivi) / 1e6, { 0, 0 } };
+        if (plusGrand >= 0){
+            int centreX = visages[plusGrand].x + visages[plusGrand].width/2;
+            int centreY = visages[plusGrand].y + visages[plusGrand].height/2;
+            // trames arrivées pendant le traitement, comme handleServo().
+            lireTelemetrie(simulateur, telemetrie, gyroscope, lu, instant + traitement);
+            lu = instant + traitement;
+            double cibleH, cibleV;
+            double duree;
+            if (options.compensation && etatConnu && telemetrie.ciblesAttendues(instant + traitement, cibleH, cibleV)){
+                n = controleur.commanderCompense(centreX, centreY, capture, cibleH, cibleV, commande);
+            } else if (!options.correctionDirecte){
+                n = controleur.commander(centreX, centreY, commande);
+            } else if (instant >= finCorrection){ // même attente de la fin du mouvement que handleServo().
+                n = controleur.commanderDirect(centreX, centreY, commande, duree);
+                if (n > 0)
+                    finCorrection = instant + traitement + (uint64_t)((duree + MARGE_CORRECTION) * 1e6);
+            }
+            ecart.erreur[0] = centreX - options.fenetre.width/2;
+            ecart.erreur[1] = centreY - options.fenetre.height/2;
+            ecarts.push_back(ecart);
+        } else if (suivi){
+            bilan.sansVisage++;
+        }
+        if (n > 0){
+            simulateur.recevoir(commande, n, instant + traitement);
+            telemetrie.commandesEnvoyees(commande, n, instant + traitement);
+        }
+
+        if (trace){
+            fprintf(trace, "%.1f,%lld,%.1f,%.1f,%d,%d,%d,%d,%d,%s\n", instant / 1000., (long long)(suivante - 1),
+                    simulateur.angleHorizontal(), simulateur.angleVertical(), rect.x, rect.y, plusGrand >= 0,
+                    ecart.erreur[0], ecart.erreur[1], commande);
+        }
+        bilan.images++;
+        // image suivante : au prochain tour du timer, ou à la fin du traitement s'il est plus long.
+        instant += std::max((uint64_t)(options.periode * 1000), traitement);
+    }
+
+    if (trace)
+        fclose(trace);
+    lireTelemetrie(simulateur, telemetrie, gyroscope, lu, std::max(lu, instant));
+    bilan.dureeSimulee = instant / 1e6;
+    bilan.dureeReelle = (MesureLatence::horloge() - debutReel) / 1e6;
+    bilan.octets = simulateur.nombreCommandes();
+    bilan.erreurs = simulateur.nombreErreurs();
+    bilan.perdus = simulateur.octetsPerdus();
+    bilan.latenceExecution = telemetrie.latenceExecution().centile(50) / 1000.;
+    bilan.latenceMouvement = telemetrie.latenceMouvement().centile(50) / 1000.;
+    if (options.suivi != SUIVI_AUCUN)
+        bilan.suivi = suiviVisage.rapport();
+    analyser(ecarts, tolerance, options.stable, bilan);
+    return bilan.images > 0;
+}
+
+static void utilisation(const char *programme)
+{
+    fprintf(stderr, "utilisation : %s [--tolerances t1,t2...] [--periode ms] [--latence ms] [--firmware planifie|bloquant] [--compensation] [--correction directe|pas]\n"
+                    "       [--champ h,v] [--suivi sans|gyroscope] [--periode-imu ms] [--bruit-imu deg/s] [--marge m] [--echecs n] [--calibrer] [--vitesse deg/s] [--pixels-par-degre p]\n"
+                    "       [--fenetre LxH] [--depart h,v] [--stable n] [--images n] [--cascades dossier] [--internes]\n"
+                    "       [--echelle e] [--facteur f] [--trace prefixe] <vidéo grand angle>\n", programme);
+}
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    for (int i = 1; i < argc; i++){
+        bool suivant = i + 1 < argc;
+        if (!strcmp(argv[i], "--tolerances") && suivant){
+            std::stringstream liste(argv[++i]);
+            std::string valeur;
+            while (std::getline(liste, valeur, ','))
+                options.tolerances.push_back(atoi(valeur.c_str()));
+        } else if (!strcmp(argv[i], "--periode") && suivant){
+            options.periode = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--latence") && suivant){
+            options.latence = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--firmware") && suivant){
+            const char *nom = argv[++i];
+            if (strcmp(nom, "planifie") && strcmp(nom, "bloquant")){
+                utilisation(argv[0]);
+                return 1;
+            }
+            options.firmware = strcmp(nom, "bloquant") ? FIRMWARE_PLANIFIE : FIRMWARE_BLOQUANT;
+        } else if (!strcmp(argv[i], "--compensation")){
+            options.compensation = true;
+        } else if (!strcmp(argv[i], "--correction") && suivant){
+            const char *nom = argv[++i];
+            if (strcmp(nom, "directe") && strcmp(nom, "pas")){
+                utilisation(argv[0]);
+                return 1;
+            }
+            options.correctionDirecte = !strcmp(nom, "directe");
+        } else if (!strcmp(argv[i], "--champ") && suivant){
+            if (sscanf(argv[++i], "%lf,%lf", &options.champH, &options.champV) != 2){
+                utilisation(argv[0]);
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "--suivi") && suivant){
+            const char *nom = argv[++i];
+            if (strcmp(nom, "sans") && strcmp(nom, "gyroscope")){
+                utilisation(argv[0]);
+                return 1;
+            }
+            options.suivi = strcmp(nom, "sans") ? SUIVI_GYROSCOPE : SUIVI_SANS;
+        } else if (!strcmp(argv[i], "--periode-imu") && suivant){
+            options.periodeImu = std::max(1., atof(argv[++i]));
+        } else if (!strcmp(argv[i], "--bruit-imu") && suivant){
+            options.bruitImu = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--marge") && suivant){
+            options.marge = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--echecs") && suivant){
+            options.echecs = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--calibrer")){
+            options.calibrer = true;
+        } else if (!strcmp(argv[i], "--vitesse") && suivant){
+            options.vitesse = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--pixels-par-degre") && suivant){
+            options.pixelsParDegre = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--fenetre") && suivant){
+            if (sscanf(argv[++i], "%dx%d", &options.fenetre.width, &options.fenetre.height) != 2){
+                utilisation(argv[0]);
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "--depart") && suivant){
+            if (sscanf(argv[++i], "%d,%d", &options.departH, &options.departV) != 2){
+                utilisation(argv[0]);
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "--stable") && suivant){
+            options.stable = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--images") && suivant){
+            options.imagesMax = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--cascades") && suivant){
+            options.dossierCascades = argv[++i];
+        } else if (!strcmp(argv[i], "--internes")){
+            options.internes = true;
+        } else if (!strcmp(argv[i], "--echelle") && suivant){
+            options.reglages.echelle = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--facteur") && suivant){
+            options.reglages.facteurEchelle = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--trace") && suivant){
+            options.trace = argv[++i];
+        } else if (argv[i][0] == '-'){
+            fprintf(stderr, "option inconnue : %s\n", argv[i]);
+            utilisation(argv[0]);
+            return 1;
+        } else {
+            options.video = argv[i];
+        }
+    }
+    if (options.video.empty() || options.periode <= 0 || options.fenetre.width <= 0 || options.fenetre.height <= 0){
+        utilisation(argv[0]);
+        return 1;
+    }
+    if (options.tolerances.empty())
+        options.tolerances.push_back(20);
+
+    DetecteurVisage detecteur;
+    if (!detecteur.charger(options.dossierCascades + "/haarcascade_frontalface_default.xml", options.dossierCascades + "/haarcascade_smile.xml",
+                           options.dossierCascades + "/haarcascade_lefteye_2splits.xml", options.dossierCascades + "/haarcascade_righteye_2splits.xml")){
+        fprintf(stderr, "%s : cascade de visage introuvable\n", options.dossierCascades.c_str());
+        return 1;
+    }
+    if (options.internes && !detecteur.activerCascadesInternes())
+        fprintf(stderr, "cascades illisibles par l'évaluateur interne, utilisation de detectMultiScale\n");
+    detecteur.reglages = options.reglages;
+    detecteur.pretraitementVectorise = verifierPretraitement();
+
+    printf("tolérance  convergence  dépassement x/y  erreur statique x/y (moy/max)  octets  Err  perdus  sans visage  exécution/mouvement  accélération\n");
+    for (size_t t = 0; t < options.tolerances.size(); t++){
+        Bilan bilan;
+        if (!simuler(options, detecteur, options.tolerances[t], bilan))
+            return 1;
+        char convergence[32];
+        if (bilan.convergence >= 0)
+            snprintf(convergence, sizeof(convergence), "%.2f s", bilan.convergence);
+        else
+            snprintf(convergence, sizeof(convergence), "jamais");
+        printf("%6d px  %11s  %6.0f / %-6.0f  %5.1f / %-5.1f  (%4.0f / %-4.0f)  %6llu  %3llu  %6llu  %6d / %-5d  %5.0f / %-5.0f ms  x%.1f\n",
+               options.tolerances[t], convergence, bilan.depassement[0], bilan.depassement[1],
+               bilan.erreurMoyenne[0], bilan.erreurMoyenne[1], bilan.erreurMax[0], bilan.erreurMax[1],
+               (unsigned long long)bilan.octets, (unsigned long long)bilan.erreurs, (unsigned long long)bilan.perdus,
+               bilan.sansVisage, bilan.images, bilan.latenceExecution, bilan.latenceMouvement, bilan.dureeReelle > 0 ? bilan.dureeSimulee / bilan.dureeReelle : 0.);
+        if (!bilan.suivi.empty())
+            printf("           %s", bilan.suivi.c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,44 @@
+#-------------------------------------------------
+#
+# Rejeu hors ligne d'une vidéo et du journal du gyroscope enregistrés par l'application :
+# suivi du visage avec et sans la rotation mesurée de la caméra (voir ../ProjetSY25Berthelon_Bucheron/suivivisage.h)
+#
+#-------------------------------------------------
+
+TEMPLATE = app
+TARGET = SuiviInertiel
+CONFIG += console c++11 thread
+CONFIG -= qt app_bundle
+
+INCLUDEPATH += ../ProjetSY25Berthelon_Bucheron ../ControlMoteurArduino
+
+SOURCES += main.cpp \
+    ../ProjetSY25Berthelon_Bucheron/suivivisage.cpp \
+    ../ProjetSY25Berthelon_Bucheron/gyroscope.cpp \
+    ../ProjetSY25Berthelon_Bucheron/calibrationcamera.cpp \
+    ../ProjetSY25Berthelon_Bucheron/detecteurvisage.cpp \
+    ../ProjetSY25Berthelon_Bucheron/noyauxpretraitement.cpp \
+    ../ProjetSY25Berthelon_Bucheron/mesurelatence.cpp \
+    ../ProjetSY25Berthelon_Bucheron/evaluateurcascade.cpp \
+    ../ProjetSY25Berthelon_Bucheron/contextedetection.cpp \
+    ../ProjetSY25Berthelon_Bucheron/cascadehaar.cpp \
+    ../ProjetSY25Berthelon_Bucheron/noyauxcascade.cpp
+
+HEADERS += ../ProjetSY25Berthelon_Bucheron/suivivisage.h \
+    ../ProjetSY25Berthelon_Bucheron/gyroscope.h \
+    ../ProjetSY25Berthelon_Bucheron/calibrationcamera.h \
+    ../ProjetSY25Berthelon_Bucheron/detecteurvisage.h \
+    ../ProjetSY25Berthelon_Bucheron/estimateurexpression.h \
+    ../ProjetSY25Berthelon_Bucheron/noyauxpretraitement.h \
+    ../ProjetSY25Berthelon_Bucheron/mesurelatence.h \
+    ../ProjetSY25Berthelon_Bucheron/evaluateurcascade.h \
+    ../ProjetSY25Berthelon_Bucheron/contextedetection.h \
+    ../ProjetSY25Berthelon_Bucheron/cascadehaar.h \
+    ../ProjetSY25Berthelon_Bucheron/noyauxcascade.h
+
+CONFIG += link_pkgconfig
+PKGCONFIG += opencv
+
+# Mêmes options de compilation que l'application pour les noyaux vectorisés et les cascades internes.
+contains(QMAKE_HOST.arch, armv7l): QMAKE_CXXFLAGS += -mfpu=neon-vfpv4
+QMAKE_CXXFLAGS += -ffp-contract=off
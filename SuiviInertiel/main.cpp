@@ -0,0 +1,266 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Rejeu hors ligne d'un enregistrement de l'application ([imu] journal et [imu] video) : la vidéo des images brutes
+ * et le journal du gyroscope (échantillons et instants des images, même horloge). L'image k de la vidéo est celle
+ * de la k-ième ligne "i" du journal ; le gyroscope reçoit les échantillons lus jusqu'à l'instant de chaque image.
+ *
+ * La même vidéo est traitée trois fois, avec la détection de l'application (DetecteurVisage) :
+ *  - image entière : détection sur toute l'image, la référence ;
+ *  - suivi : fenêtre autour de la position prédite (SuiviVisage) sans le gyroscope ;
+ *  - suivi + gyroscope : prédiction déplacée de la rotation de la caméra mesurée entre les images.
+ * Pour chaque passage : images avec un visage, visages manqués (trouvés sur l'image entière mais pas dans la fenêtre),
+ * pertes du suivi, surface analysée, écart entre prédiction et détection, temps de détection médian et 90e centile.
+ *
+ * Utilisation : SuiviInertiel [options] <vidéo> <journal.csv>
+ *   --marge m (défaut 0.75), --echecs n (défaut 2) : réglages du suivi ([suivi] du fichier ini)
+ *   --axes h,v (défaut z,x), --signes h,v (défaut 1,1), --biais s (défaut 1) : montage du gyroscope ([imu])
+ *   --champ h,v : champ de la caméra (défaut 53.50,41.41)
+ *   --cascades dossier, --internes, --echelle e, --facteur f : détection (comme TraitementLot)
+ *   --trace fichier.csv : image par image, centres trouvés et prédits des trois passages
+ */
+#include "calibrationcamera.h"
+#include "detecteurvisage.h"
+#include "gyroscope.h"
+#include "mesurelatence.h"
+#include "noyauxpretraitement.h"
+#include "suivivisage.h"
+
+#include "opencv2/core/core.hpp"
+#include "opencv2/imgproc/imgproc.hpp"
+#include "opencv2/videoio/videoio.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+struct Options {
+    std::string video;
+    std::string journal;
+    double marge = 0.75;
+    int echecs = 2;
+    char axes[2] = { 'z', 'x' };
+    int signes[2] = { 1, 1 };
+    double biais = 1.0;
+    double champH = 53.50;
+    double champV = 41.41;
+    std::string dossierCascades = "/usr/share/opencv/haarcascades";
+    bool internes = false;
+    ReglagesDetection reglages;
+    std::string trace;
+};
+
+enum Passage {
+    PASSAGE_ENTIERE = 0,
+    PASSAGE_SUIVI = 1,
+    PASSAGE_GYROSCOPE = 2,
+    NB_PASSAGES = 3
+};
+
+static const char *nomsPassages[NB_PASSAGES] = { "image entière", "suivi", "suivi + gyroscope" };
+
+// Résultat d'un passage pour une image : centre du visage trouvé (x < 0 : aucun) et centre prédit.
+struct ResultatImage {
+    cv::Point centre = cv::Point(-1, -1);
+    cv::Point2d prediction = cv::Point2d(-1, -1);
+};
+
+struct Bilan {
+    int images = 0;
+    int visages = 0;
+    int manques = 0;
+    HistogrammeLatence temps;
+    std::string suivi;
+};
+
+static int axe(char nom)
+{
+    return nom == 'x' ? 0 : nom == 'y' ? 1 : 2;
+}
+
+/*
+ * Un passage sur toute la vidéo. "resultats" reçoit le résultat de chaque image ; pour les passages avec suivi,
+ * "reference" (celui de l'image entière) sert à compter les visages manqués.
+ */
+static bool rejouer(const Options &options, Passage passage, DetecteurVisage &detecteur, const std::vector<EchantillonGyro> &echantillons,
+                    const std::vector<uint64_t> &instants, const std::vector<ResultatImage> *reference,
+                    std::vector<ResultatImage> &resultats, Bilan &bilan)
+{
+    cv::VideoCapture video(options.video);
+    if (!video.isOpened()){
+        fprintf(stderr, "%s : vidéo illisible\n", options.video.c_str());
+        return false;
+    }
+    Gyroscope gyroscope(axe(options.axes[0]), options.signes[0], axe(options.axes[1]), options.signes[1], options.biais);
+    SuiviVisage *suivi = 0;
+    size_t suivant = 0; // prochain échantillon du gyroscope
+    cv::Mat image, gris;
+    std::vector<cv::Rect> visages;
+    resultats.clear();
+
+    for (size_t k = 0; k < instants.size() && video.read(image) && !image.empty(); k++){
+        if (image.channels() == 1)
+            gris = image;
+        else
+            cv::cvtColor(image, gris, cv::COLOR_BGR2GRAY);
+        if (!suivi && passage != PASSAGE_ENTIERE)
+            suivi = new SuiviVisage(CalibrationCamera(gris.cols, gris.rows, options.champH, options.champV), options.marge, options.echecs);
+
+        // échantillons lus par le thread du gyroscope avant cette image.
+        while (suivant < echantillons.size() && echantillons[suivant].instant <= instants[k])
+            gyroscope.ajouter(echantillons[suivant++]);
+
+        ResultatImage resultat;
+        uint64_t debut = MesureLatence::horloge();
+        cv::Rect zone(0, 0, gris.cols, gris.rows);
+        if (suivi)
+            zone = suivi->zoneRecherche(instants[k], passage == PASSAGE_GYROSCOPE ? &gyroscope : 0);
+        detecteur.detecterVisages(gris, zone, visages);
+        bilan.temps.ajouter(MesureLatence::horloge() - debut);
+        int plusGrand = DetecteurVisage::plusGrand(visages);
+        if (suivi){
+            if (zone.area() < gris.cols * gris.rows)
+                resultat.prediction = suivi->prediction();
+            suivi->resultat(plusGrand >= 0 ? &visages[plusGrand] : 0);
+        }
+        if (plusGrand >= 0){
+            resultat.centre = cv::Point(visages[plusGrand].x + visages[plusGrand].width/2, visages[plusGrand].y + visages[plusGrand].height/2);
+            bilan.visages++;
+        } else if (reference && k < reference->size() && (*reference)[k].centre.x >= 0){
+            bilan.manques++;
+        }
+        resultats.push_back(resultat);
+        bilan.images++;
+    }
+    if (suivi){
+        bilan.suivi = suivi->rapport();
+        delete suivi;
+    }
+    if ((size_t)bilan.images < instants.size())
+        fprintf(stderr, "%s : %d images dans la vidéo pour %zu dans le journal\n", nomsPassages[passage], bilan.images, instants.size());
+    return bilan.images > 0;
+}
+
+static void utilisation(const char *programme)
+{
+    fprintf(stderr, "utilisation : %s [--marge m] [--echecs n] [--axes h,v] [--signes h,v] [--biais s] [--champ h,v]\n"
+                    "       [--cascades dossier] [--internes] [--echelle e] [--facteur f] [--trace fichier.csv] <vidéo> <journal.csv>\n", programme);
+}
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    std::vector<std::string> fichiers;
+    for (int i = 1; i < argc; i++){
+        bool suivant = i + 1 < argc;
+        if (!strcmp(argv[i], "--marge") && suivant){
+            options.marge = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--echecs") && suivant){
+            options.echecs = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--axes") && suivant){
+            if (sscanf(argv[++i], "%c,%c", &options.axes[0], &options.axes[1]) != 2){
+                utilisation(argv[0]);
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "--signes") && suivant){
+            if (sscanf(argv[++i], "%d,%d", &options.signes[0], &options.signes[1]) != 2){
+                utilisation(argv[0]);
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "--biais") && suivant){
+            options.biais = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--champ") && suivant){
+            if (sscanf(argv[++i], "%lf,%lf", &options.champH, &options.champV) != 2){
+                utilisation(argv[0]);
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "--cascades") && suivant){
+            options.dossierCascades = argv[++i];
+        } else if (!strcmp(argv[i], "--internes")){
+            options.internes = true;
+        } else if (!strcmp(argv[i], "--echelle") && suivant){
+            options.reglages.echelle = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--facteur") && suivant){
+            options.reglages.facteurEchelle = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--trace") && suivant){
+            options.trace = argv[++i];
+        } else if (argv[i][0] == '-'){
+            fprintf(stderr, "option inconnue : %s\n", argv[i]);
+            utilisation(argv[0]);
+            return 1;
+        } else {
+            fichiers.push_back(argv[i]);
+        }
+    }
+    if (fichiers.size() != 2){
+        utilisation(argv[0]);
+        return 1;
+    }
+    options.video = fichiers[0];
+    options.journal = fichiers[1];
+
+    std::vector<EchantillonGyro> echantillons;
+    std::vector<uint64_t> instants;
+    if (!Gyroscope::lireJournal(options.journal, echantillons, instants)){
+        perror(options.journal.c_str());
+        return 1;
+    }
+    if (instants.empty()){
+        fprintf(stderr, "%s : aucune image dans le journal\n", options.journal.c_str());
+        return 1;
+    }
+    printf("%zu images, %zu échantillons du gyroscope", instants.size(), echantillons.size());
+    if (echantillons.size() > 1)
+        printf(" (un toutes les %.1f ms)", (echantillons.back().instant - echantillons.front().instant) / 1000. / (echantillons.size() - 1));
+    printf("\n");
+
+    DetecteurVisage detecteur;
+    if (!detecteur.charger(options.dossierCascades + "/haarcascade_frontalface_default.xml", options.dossierCascades + "/haarcascade_smile.xml",
+                           options.dossierCascades + "/haarcascade_lefteye_2splits.xml", options.dossierCascades + "/haarcascade_righteye_2splits.xml")){
+        fprintf(stderr, "%s : cascade de visage introuvable\n", options.dossierCascades.c_str());
+        return 1;
+    }
+    if (options.internes && !detecteur.activerCascadesInternes())
+        fprintf(stderr, "cascades illisibles par l'évaluateur interne, utilisation de detectMultiScale\n");
+    detecteur.reglages = options.reglages;
+    detecteur.pretraitementVectorise = verifierPretraitement();
+
+    std::vector<ResultatImage> resultats[NB_PASSAGES];
+    Bilan bilans[NB_PASSAGES];
+    for (int p = 0; p < NB_PASSAGES; p++){
+        if (!rejouer(options, (Passage)p, detecteur, echantillons, instants, p == PASSAGE_ENTIERE ? 0 : &resultats[PASSAGE_ENTIERE],
+                     resultats[p], bilans[p]))
+            return 1;
+    }
+
+    printf("passage             visages  manqués  détection médiane / 90e (ms)\n");
+    for (int p = 0; p < NB_PASSAGES; p++){
+        const Bilan &b = bilans[p];
+        printf("%-18s  %4d / %-4d  %5d  %6.1f / %-6.1f\n", nomsPassages[p], b.visages, b.images, b.manques,
+               b.temps.centile(50) / 1000., b.temps.centile(90) / 1000.);
+    }
+    for (int p = PASSAGE_SUIVI; p < NB_PASSAGES; p++)
+        printf("%s : %s", nomsPassages[p], bilans[p].suivi.c_str());
+
+    if (!options.trace.empty()){
+        FILE *trace = fopen(options.trace.c_str(), "w");
+        if (!trace){
+            perror(options.trace.c_str());
+            return 1;
+        }
+        fprintf(trace, "image,instant_ms,entiere_x,entiere_y,suivi_x,suivi_y,suivi_prediction_x,suivi_prediction_y,"
+                       "gyroscope_x,gyroscope_y,gyroscope_prediction_x,gyroscope_prediction_y\n");
+        size_t n = std::min(resultats[0].size(), std::min(resultats[1].size(), resultats[2].size()));
+        for (size_t k = 0; k < n; k++){
+            fprintf(trace, "%zu,%.1f,%d,%d,%d,%d,%.1f,%.1f,%d,%d,%.1f,%.1f\n", k, (instants[k] - instants[0]) / 1000.,
+                    resultats[0][k].centre.x, resultats[0][k].centre.y, resultats[1][k].centre.x, resultats[1][k].centre.y,
+                    resultats[1][k].prediction.x, resultats[1][k].prediction.y, resultats[2][k].centre.x, resultats[2][k].centre.y,
+                    resultats[2][k].prediction.x, resultats[2][k].prediction.y);
+        }
+        fclose(trace);
+    }
+    return 0;
+}
@@ -0,0 +1,90 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Format du fichier de résultats écrit par TraitementLot : une ligne par image traitée, rangée en colonnes.
+ *
+ * Le fichier commence par un EnTeteLot de 64 octets, suivi du répertoire des colonnes (un DescripteurColonne
+ * de 32 octets par colonne), des noms des vidéos (chaînes terminées par un zéro, dans l'ordre de leur indice),
+ * puis des colonnes elles-mêmes : nbImages valeurs contiguës chacune, alignées sur 64 octets.
+ * Les lignes sont triées par vidéo puis par numéro d'image. Une colonne se lit directement (mmap) sans lire les autres.
+ * Un morceau de vidéo illisible (ouverture ou déplacement impossible, images manquantes) laisse un trou dans les numéros
+ * d'image : nbMorceauxEchoues de l'en-tête le signale (0 : toutes les images de toutes les vidéos sont là).
+ */
+#ifndef FORMATLOT_H
+#define FORMATLOT_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define MAGIE_LOT 0x544f4c44 // "DLOT"
+#define VERSION_LOT 1
+#define ALIGNEMENT_COLONNE 64
+
+// Type des valeurs d'une colonne.
+enum TypeColonne {
+    COLONNE_U8 = 1,
+    COLONNE_U16 = 2,
+    COLONNE_U32 = 3,
+    COLONNE_I16 = 4
+};
+
+/*
+ * Colonnes écrites (nom : type, contenu) :
+ *   video : u16, indice de la vidéo (voir les noms)
+ *   image : u32, numéro de l'image dans la vidéo (à partir de 0)
+ *   etat : u8, bits ETAT_* de formatjournal.h (visage, sourire, oeil gauche, oeil droit)
+ *   visages : u8, nombre de visages trouvés (plafonné à 255)
+ *   x, y, largeur, hauteur : i16, plus grand visage en pixels de l'image d'origine (0 si pas de visage)
+ *   score_sourire, score_oeil_gauche, score_oeil_droit : u8, scores de EtatExpression ramenés sur 0-255
+ *   duree_us : u32, temps de traitement de l'image (détection et expression, sans le décodage)
+ */
+
+struct EnTeteLot {
+    uint32_t magie;
+    uint32_t version;
+    uint64_t nbImages;
+    uint32_t nbColonnes;
+    uint32_t nbVideos;
+    uint64_t decalageNoms;     // position des noms des vidéos depuis le début du fichier
+    uint64_t tailleNoms;
+    uint64_t horodatageCreation; // microsecondes depuis le 1er janvier 1970
+    uint32_t nbMorceaux;         // morceaux de vidéo traités par TraitementLot...
+    uint32_t nbMorceauxEchoues;  // ... dont illisibles en tout ou partie
+    uint8_t reserve[8];
+};
+
+struct DescripteurColonne {
+    char nom[20];          // terminé par un zéro
+    uint32_t type;         // TypeColonne
+    uint64_t decalage;     // position des valeurs depuis le début du fichier
+};
+
+static_assert(sizeof(EnTeteLot) == 64, "en-tête du fichier de lot : 64 octets");
+static_assert(sizeof(DescripteurColonne) == 32, "descripteur de colonne : 32 octets");
+
+static inline size_t tailleType(uint32_t type)
+{
+    switch (type){
+    case COLONNE_U8: return 1;
+    case COLONNE_U16: return 2;
+    case COLONNE_U32: return 4;
+    case COLONNE_I16: return 2;
+    }
+    return 0;
+}
+
+/*
+ * Cherche la colonne "nom" dans le répertoire (qui suit l'en-tête). Retourne null si elle est absente.
+ */
+static inline const DescripteurColonne *trouverColonne(const EnTeteLot *entete, const char *nom)
+{
+    const DescripteurColonne *colonnes = (const DescripteurColonne *)(entete + 1);
+    for (uint32_t i = 0; i < entete->nbColonnes; i++){
+        if (strncmp(colonnes[i].nom, nom, sizeof(colonnes[i].nom)) == 0)
+            return &colonnes[i];
+    }
+    return 0;
+}
+
+#endif // FORMATLOT_H
@@ -0,0 +1,549 @@
+/*
+ *
+ *  Created by Pierre-Jean Berthelon & Florian Bucheron - 2019
+ *
+ * Traitement hors ligne de vidéos enregistrées, sur tous les coeurs : le même traitement que detectFace()
+ * (DetecteurVisage : image de détection, cascade de visage, sourire et yeux) sur chaque image, sans l'interface,
+ * la détection de mouvement ni le contrôleur de qualité. Sert à rejouer des heures d'enregistrement pour régler les seuils.
+ *
+ * Chaque vidéo est découpée en morceaux d'images consécutives. Des threads (un par coeur par défaut) prennent les morceaux
+ * un par un ; chacun a son propre DetecteurVisage (ses cascades, son contexte) et sa propre cv::VideoCapture,
+ * rien n'est partagé pendant le traitement. Un morceau commence par un déplacement dans la vidéo, qui décode depuis
+ * l'image clé précédente : avec des morceaux bien plus longs qu'un GOP, ce surcoût reste faible
+ * (et nul en MJPEG, où toutes les images sont des images clés, comme les vidéos de l'Enregistreur).
+ *
+ * Les résultats sont écrits en colonnes (voir formatlot.h), dans l'ordre des vidéos et des images.
+ * Les morceaux illisibles sont listés à la fin et comptés dans l'en-tête du fichier.
+ *
+ * Code de retour : 0, 1 en cas d'erreur (options, cascades, écriture), 3 si des morceaux sont illisibles
+ * (le fichier est écrit, sans leurs images).
+ *
+ * Utilisation : TraitementLot [options] -o resultats.lot <vidéos...>
+ *   --threads n[,n...] : nombre de threads (défaut : nombre de coeurs). Avec plusieurs valeurs, le lot est traité une fois
+ *                 par valeur et le débit (images/s) de chacune est donné, pour voir le gain des threads sur la machine ;
+ *                 le fichier est celui du dernier passage (les résultats ne dépendent pas du nombre de threads).
+ *   --morceau n : images par morceau (défaut 250)
+ *   --cascades dossier : dossier des haarcascade_*.xml (défaut /usr/share/opencv/haarcascades)
+ *   --internes : cascades évaluées par l'application ([detection] cascadeInterne)
+ *   --points modele : expression par points caractéristiques (lbfmodel.yaml), comme l'application si le modèle est présent
+ *   --echelle e, --facteur f, --voisins n, --taille-min px : réglages de la cascade de visage (ReglagesDetection)
+ *   --retourner : vidéo filmée caméra à l'envers ([camera] retournementFichier)
+ */
+#include "formatlot.h"
+#include "formatjournal.h"
+#include "detecteurvisage.h"
+#include "estimateurexpression.h"
+#include "mesurelatence.h"
+#include "noyauxpretraitement.h"
+
+#include "opencv2/core/core.hpp"
+#include "opencv2/imgproc/imgproc.hpp"
+#include "opencv2/videoio/videoio.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/time.h>
+
+struct Options {
+    std::string sortie;
+    std::vector<int> threads;
+    int imagesParMorceau = 250;
+    std::string dossierCascades = "/usr/share/opencv/haarcascades";
+    bool internes = false;
+    std::string modelePoints;
+    bool retourner = false;
+    ReglagesDetection reglages;
+};
+
+// Résultat d'une image : une ligne du fichier de sortie.
+struct ResultatImage {
+    uint32_t image;
+    uint8_t etat;
+    uint8_t visages;
+    int16_t x, y, largeur, hauteur;
+    uint8_t scoreSourire, scoreOeilGauche, scoreOeilDroit;
+    uint32_t duree;
+};
+
+// Images [premiere, derniere] d'une vidéo (derniere = -1 : jusqu'à la fin).
+struct Morceau {
+    uint16_t video;
+    int premiere;
+    int derniere;
+    std::vector<ResultatImage> resultats;
+    bool lu = false; // toutes les images du morceau ont été lues
+};
+
+// Compteurs d'un thread (chacun a les siens, additionnés à la fin).
+struct Statistiques {
+    uint64_t images = 0;
+    uint64_t morceaux = 0;
+    uint64_t deplacements = 0;  // déplacements dans une vidéo refaits par une lecture depuis le début
+    uint64_t tempsDecodage = 0;  // µs
+    uint64_t tempsDetection = 0;
+};
+
+/*
+ * Détection et expression sur une image en niveaux de gris, comme detectFace() (expression à chaque image).
+ */
+static void traiterImage(DetecteurVisage &detecteur, EstimateurExpression &estimateur, const cv::Mat &image, ResultatImage &r)
+{
+    std::vector<cv::Rect> visages;
+    detecteur.detecterVisages(image, visages);
+    r.visages = (uint8_t)std::min<size_t>(visages.size(), 255);
+
+    int i = DetecteurVisage::plusGrand(visages);
+    if (i < 0)
+        return;
+    const cv::Rect &visage = visages[i];
+
+    EtatExpression etat;
+    if (!estimateur.estimer(image, visage, etat)) // sans modèle de points : les cascades sourire / yeux.
+        detecteur.detecterExpression(image, visage, etat);
+
+    r.etat = ETAT_VISAGE | (etat.smile ? ETAT_SOURIRE : 0) | (etat.leftEye ? ETAT_OEIL_GAUCHE : 0) | (etat.rightEye ? ETAT_OEIL_DROIT : 0);
+    r.x = (int16_t)visage.x;
+    r.y = (int16_t)visage.y;
+    r.largeur = (int16_t)visage.width;
+    r.hauteur = (int16_t)visage.height;
+    r.scoreSourire = (uint8_t)(etat.scoreSourire*255);
+    r.scoreOeilGauche = (uint8_t)(etat.scoreOeilGauche*255);
+    r.scoreOeilDroit = (uint8_t)(etat.scoreOeilDroit*255);
+}
+
+/*
+ * Image lue dans la vidéo ramenée en niveaux de gris (et à l'endroit), comme SourceFichier.
+ */
+static void convertirImage(const cv::Mat &image, bool retourner, cv::Mat &gris)
+{
+    if (image.channels() == 1)
+        image.copyTo(gris);
+    else
+        cv::cvtColor(image, gris, cv::COLOR_BGR2GRAY);
+    if (retourner)
+        cv::flip(gris, gris, 0);
+}
+
+/*
+ * Place la vidéo sur l'image "numero". Si le déplacement n'est pas exact (certains codecs),
+ * la vidéo est rouverte et les images précédentes sont passées sans être décodées en entier.
+ */
+static bool deplacer(cv::VideoCapture &video, const std::string &chemin, int numero, Statistiques &statistiques)
+{
+    if (video.set(cv::CAP_PROP_POS_FRAMES, numero) && (int)video.get(cv::CAP_PROP_POS_FRAMES) == numero)
+        return true;
+
+    statistiques.deplacements++;
+    video.release();
+    if (!video.open(chemin))
+        return false;
+    for (int n = 0; n < numero; n++){
+        if (!video.grab())
+            return false;
+    }
+    return true;
+}
+
+/*
+ * Boucle d'un thread : prend le morceau suivant tant qu'il en reste.
+ */
+static void travailler(const Options &options, bool pretraitementVectorise, const std::vector<std::string> &videos,
+                       std::vector<Morceau> &morceaux, std::atomic<size_t> &suivant, std::atomic<uint64_t> &imagesTraitees,
+                       std::atomic<int> &termines, Statistiques &statistiques)
+{
+    // Les cascades (et les niveaux de pyramide) de ce thread. Sans elles, le thread ne prend aucun morceau
+    // (les autres les traitent ; ceux qui restent sont comptés illisibles).
+    DetecteurVisage detecteur;
+    if (!detecteur.charger(options.dossierCascades + "/haarcascade_frontalface_default.xml", options.dossierCascades + "/haarcascade_smile.xml",
+                           options.dossierCascades + "/haarcascade_lefteye_2splits.xml", options.dossierCascades + "/haarcascade_righteye_2splits.xml")
+            || (options.internes && !detecteur.activerCascadesInternes())){
+        fprintf(stderr, "%s : cascades illisibles dans un thread\n", options.dossierCascades.c_str());
+        termines++;
+        return;
+    }
+    detecteur.reglages = options.reglages;
+    detecteur.pretraitementVectorise = pretraitementVectorise;
+    EstimateurExpression estimateur;
+    if (!options.modelePoints.empty())
+        estimateur.charger(options.modelePoints);
+
+    cv::VideoCapture video;
+    int videoOuverte = -1;
+    int position = 0; // image que la vidéo rendra au prochain read()
+    cv::Mat image, gris;
+
+    size_t i;
+    while ((i = suivant++) < morceaux.size()){
+        Morceau &m = morceaux[i];
+        statistiques.morceaux++;
+
+        uint64_t debut = MesureLatence::horloge();
+        if (m.video != videoOuverte){
+            video.release();
+            videoOuverte = -1;
+            if (!video.open(videos[m.video])){
+                fprintf(stderr, "%s : impossible d'ouvrir la vidéo\n", videos[m.video].c_str());
+                continue;
+            }
+            videoOuverte = m.video;
+            position = 0;
+        }
+        if (position != m.premiere){
+            if (!deplacer(video, videos[m.video], m.premiere, statistiques)){
+                fprintf(stderr, "%s : image %d introuvable\n", videos[m.video].c_str(), m.premiere);
+                videoOuverte = -1;
+                continue;
+            }
+            position = m.premiere;
+        }
+        statistiques.tempsDecodage += MesureLatence::horloge() - debut;
+
+        int n;
+        for (n = m.premiere; m.derniere < 0 || n <= m.derniere; n++){
+            uint64_t t0 = MesureLatence::horloge();
+            if (!video.read(image))
+                break;
+            position = n + 1;
+            convertirImage(image, options.retourner, gris);
+            uint64_t t1 = MesureLatence::horloge();
+
+            ResultatImage r;
+            memset(&r, 0, sizeof(r));
+            r.image = n;
+            traiterImage(detecteur, estimateur, gris, r);
+            uint64_t t2 = MesureLatence::horloge();
+            r.duree = (uint32_t)(t2 - t1);
+            m.resultats.push_back(r);
+
+            statistiques.images++;
+            statistiques.tempsDecodage += t1 - t0;
+            statistiques.tempsDetection += t2 - t1;
+            imagesTraitees++;
+        }
+        m.lu = m.derniere < 0 || n > m.derniere;
+        if (!m.lu)
+            fprintf(stderr, "%s : image %d illisible\n", videos[m.video].c_str(), n);
+    }
+    termines++;
+}
+
+/*
+ * Découpe chaque vidéo en morceaux. Le dernier morceau d'une vidéo va jusqu'à la fin du fichier
+ * (le nombre d'images annoncé par le conteneur n'est pas toujours exact) ; sans nombre d'images, la vidéo est un seul morceau.
+ */
+static bool decouper(const std::vector<std::string> &videos, int imagesParMorceau, std::vector<Morceau> &morceaux)
+{
+    for (size_t v = 0; v < videos.size(); v++){
+        cv::VideoCapture video(videos[v]);
+        if (!video.isOpened()){
+            fprintf(stderr, "%s : impossible d'ouvrir la vidéo\n", videos[v].c_str());
+            return false;
+        }
+        int nbImages = (int)video.get(cv::CAP_PROP_FRAME_COUNT);
+
+        Morceau m;
+        m.video = (uint16_t)v;
+        m.premiere = 0;
+        while (nbImages > 0 && m.premiere + imagesParMorceau < nbImages){
+            m.derniere = m.premiere + imagesParMorceau - 1;
+            morceaux.push_back(m);
+            m.premiere += imagesParMorceau;
+        }
+        m.derniere = -1;
+        morceaux.push_back(m);
+    }
+    return true;
+}
+
+// Colonnes écrites, dans l'ordre (voir formatlot.h).
+struct Colonne {
+    const char *nom;
+    uint32_t type;
+};
+
+static const Colonne COLONNES[] = {
+    {"video", COLONNE_U16}, {"image", COLONNE_U32}, {"etat", COLONNE_U8}, {"visages", COLONNE_U8},
+    {"x", COLONNE_I16}, {"y", COLONNE_I16}, {"largeur", COLONNE_I16}, {"hauteur", COLONNE_I16},
+    {"score_sourire", COLONNE_U8}, {"score_oeil_gauche", COLONNE_U8}, {"score_oeil_droit", COLONNE_U8},
+    {"duree_us", COLONNE_U32}
+};
+static const int NB_COLONNES = sizeof(COLONNES) / sizeof(COLONNES[0]);
+
+static uint32_t valeurColonne(int colonne, const Morceau &m, const ResultatImage &r)
+{
+    switch (colonne){
+    case 0: return m.video;
+    case 1: return r.image;
+    case 2: return r.etat;
+    case 3: return r.visages;
+    case 4: return (uint16_t)r.x;
+    case 5: return (uint16_t)r.y;
+    case 6: return (uint16_t)r.largeur;
+    case 7: return (uint16_t)r.hauteur;
+    case 8: return r.scoreSourire;
+    case 9: return r.scoreOeilGauche;
+    case 10: return r.scoreOeilDroit;
+    case 11: return r.duree;
+    }
+    return 0;
+}
+
+static uint64_t aligner(uint64_t position)
+{
+    return (position + ALIGNEMENT_COLONNE - 1) / ALIGNEMENT_COLONNE * ALIGNEMENT_COLONNE;
+}
+
+/*
+ * Ecrit l'en-tête, le répertoire, les noms puis les colonnes une par une.
+ */
+static bool ecrireResultats(const std::string &chemin, const std::vector<std::string> &videos, const std::vector<Morceau> &morceaux)
+{
+    uint64_t nbImages = 0;
+    uint32_t nbEchoues = 0;
+    for (size_t i = 0; i < morceaux.size(); i++){
+        nbImages += morceaux[i].resultats.size();
+        nbEchoues += !morceaux[i].lu;
+    }
+
+    std::string noms;
+    for (size_t v = 0; v < videos.size(); v++){
+        noms += videos[v];
+        noms.push_back('\0');
+    }
+
+    EnTeteLot entete;
+    memset(&entete, 0, sizeof(entete));
+    entete.magie = MAGIE_LOT;
+    entete.version = VERSION_LOT;
+    entete.nbImages = nbImages;
+    entete.nbColonnes = NB_COLONNES;
+    entete.nbVideos = (uint32_t)videos.size();
+    entete.decalageNoms = sizeof(EnTeteLot) + NB_COLONNES * sizeof(DescripteurColonne);
+    entete.tailleNoms = noms.size();
+    struct timeval maintenant;
+    gettimeofday(&maintenant, 0);
+    entete.horodatageCreation = (uint64_t)maintenant.tv_sec * 1000000 + maintenant.tv_usec;
+    entete.nbMorceaux = (uint32_t)morceaux.size();
+    entete.nbMorceauxEchoues = nbEchoues;
+
+    DescripteurColonne repertoire[NB_COLONNES];
+    memset(repertoire, 0, sizeof(repertoire));
+    uint64_t position = aligner(entete.decalageNoms + entete.tailleNoms);
+    for (int c = 0; c < NB_COLONNES; c++){
+        strncpy(repertoire[c].nom, COLONNES[c].nom, sizeof(repertoire[c].nom) - 1);
+        repertoire[c].type = COLONNES[c].type;
+        repertoire[c].decalage = position;
+        position = aligner(position + nbImages * tailleType(COLONNES[c].type));
+    }
+
+    FILE *f = fopen(chemin.c_str(), "wb");
+    if (!f){
+        perror(chemin.c_str());
+        return false;
+    }
+    bool ok = fwrite(&entete, sizeof(entete), 1, f) == 1 && fwrite(repertoire, sizeof(repertoire), 1, f) == 1
+            && fwrite(noms.data(), 1, noms.size(), f) == noms.size();
+
+    std::vector<uint8_t> tampon;
+    for (int c = 0; c < NB_COLONNES && ok; c++){
+        size_t taille = tailleType(COLONNES[c].type);
+        tampon.assign(repertoire[c].decalage - ftell(f), 0); // bourrage jusqu'à l'alignement de la colonne
+        tampon.reserve(tampon.size() + nbImages * taille);
+        for (size_t i = 0; i < morceaux.size(); i++){
+            for (size_t k = 0; k < morceaux[i].resultats.size(); k++){
+                uint32_t valeur = valeurColonne(c, morceaux[i], morceaux[i].resultats[k]);
+                const uint8_t *octets = (const uint8_t *)&valeur; // petit boutiste, comme le journal
+                tampon.insert(tampon.end(), octets, octets + taille);
+            }
+        }
+        ok = fwrite(tampon.data(), 1, tampon.size(), f) == tampon.size();
+    }
+    ok = fclose(f) == 0 && ok;
+    if (!ok)
+        fprintf(stderr, "%s : erreur d'écriture\n", chemin.c_str());
+    return ok;
+}
+
+/*
+ * Traite tous les morceaux avec "nbThreads" threads (les résultats d'un passage précédent sont remplacés).
+ * Retourne le débit en images/s.
+ */
+static double traiterLot(const Options &options, int nbThreads, bool pretraitementVectorise, const std::vector<std::string> &videos,
+                         std::vector<Morceau> &morceaux)
+{
+    for (size_t i = 0; i < morceaux.size(); i++){
+        morceaux[i].resultats.clear();
+        morceaux[i].lu = false;
+    }
+    fprintf(stderr, "%zu vidéos, %zu morceaux, %d threads\n", videos.size(), morceaux.size(), nbThreads);
+
+    std::atomic<size_t> suivant(0);
+    std::atomic<uint64_t> imagesTraitees(0);
+    std::atomic<int> termines(0);
+    std::vector<Statistiques> statistiques(nbThreads);
+    std::vector<std::thread> threads;
+    std::chrono::steady_clock::time_point debut = std::chrono::steady_clock::now();
+    for (int t = 0; t < nbThreads; t++){
+        threads.push_back(std::thread(travailler, std::cref(options), pretraitementVectorise, std::cref(videos), std::ref(morceaux),
+                                      std::ref(suivant), std::ref(imagesTraitees), std::ref(termines), std::ref(statistiques[t])));
+    }
+
+    // Avancement toutes les 5 s, jusqu'à la fin de tous les threads.
+    for (int attente = 1; termines.load() < nbThreads; attente++){
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (attente % 50 != 0)
+            continue;
+        double secondes = std::chrono::duration<double>(std::chrono::steady_clock::now() - debut).count();
+        fprintf(stderr, "%llu images (%.0f images/s), morceau %zu / %zu\n", (unsigned long long)imagesTraitees.load(),
+                imagesTraitees.load() / secondes, std::min(suivant.load(), morceaux.size()), morceaux.size());
+    }
+    for (size_t t = 0; t < threads.size(); t++)
+        threads[t].join();
+    double secondes = std::chrono::duration<double>(std::chrono::steady_clock::now() - debut).count();
+
+    Statistiques total;
+    for (size_t t = 0; t < statistiques.size(); t++){
+        total.images += statistiques[t].images;
+        total.morceaux += statistiques[t].morceaux;
+        total.deplacements += statistiques[t].deplacements;
+        total.tempsDecodage += statistiques[t].tempsDecodage;
+        total.tempsDetection += statistiques[t].tempsDetection;
+    }
+    // Occupation : part du temps des threads passée à décoder ou détecter (le reste est l'attente de la fin des autres).
+    double debit = secondes > 0 ? total.images / secondes : 0.;
+    double occupation = secondes > 0 ? (total.tempsDecodage + total.tempsDetection) / 1e6 / (secondes * nbThreads) : 0.;
+    fprintf(stderr, "%llu images en %.1f s : %.1f images/s (%.1f par thread), occupation des threads %.0f %%\n",
+            (unsigned long long)total.images, secondes, debit, debit / nbThreads, 100 * occupation);
+    fprintf(stderr, "par image : décodage %.2f ms, détection %.2f ms ; déplacements inexacts refaits depuis le début : %llu\n",
+            total.images > 0 ? total.tempsDecodage / 1e3 / total.images : 0.,
+            total.images > 0 ? total.tempsDetection / 1e3 / total.images : 0., (unsigned long long)total.deplacements);
+    return debit;
+}
+
+static void utilisation(const char *programme)
+{
+    fprintf(stderr, "utilisation : %s [--threads n[,n...]] [--morceau n] [--cascades dossier] [--internes] [--points modele]\n"
+                    "       [--echelle e] [--facteur f] [--voisins n] [--taille-min px] [--retourner] -o resultats.lot <vidéos...>\n", programme);
+}
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    std::vector<std::string> videos;
+
+    for (int i = 1; i < argc; i++){
+        bool suivant = i + 1 < argc;
+        if (!strcmp(argv[i], "-o") && suivant){
+            options.sortie = argv[++i];
+        } else if (!strcmp(argv[i], "--threads") && suivant){
+            for (const char *valeur = argv[++i]; valeur; valeur = strchr(valeur, ',') ? strchr(valeur, ',') + 1 : 0){
+                options.threads.push_back(atoi(valeur));
+                if (options.threads.back() <= 0){
+                    fprintf(stderr, "--threads : nombres de threads positifs séparés par des virgules\n");
+                    return 1;
+                }
+            }
+        } else if (!strcmp(argv[i], "--morceau") && suivant){
+            options.imagesParMorceau = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--cascades") && suivant){
+            options.dossierCascades = argv[++i];
+        } else if (!strcmp(argv[i], "--internes")){
+            options.internes = true;
+        } else if (!strcmp(argv[i], "--points") && suivant){
+            options.modelePoints = argv[++i];
+        } else if (!strcmp(argv[i], "--echelle") && suivant){
+            options.reglages.echelle = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--facteur") && suivant){
+            options.reglages.facteurEchelle = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--voisins") && suivant){
+            options.reglages.voisinsVisage = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--taille-min") && suivant){
+            options.reglages.tailleMinVisage = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--retourner")){
+            options.retourner = true;
+        } else if (argv[i][0] == '-'){
+            fprintf(stderr, "option inconnue : %s\n", argv[i]);
+            utilisation(argv[0]);
+            return 1;
+        } else {
+            videos.push_back(argv[i]);
+        }
+    }
+    if (options.sortie.empty() || videos.empty() || videos.size() > 65535){
+        utilisation(argv[0]);
+        return 1;
+    }
+    if (options.reglages.echelle <= 0 || options.reglages.echelle > 1 || options.reglages.facteurEchelle <= 1){
+        fprintf(stderr, "réglages invalides : échelle dans ]0, 1], facteur > 1\n");
+        return 1;
+    }
+    if (options.threads.empty())
+        options.threads.push_back(std::max(1u, std::thread::hardware_concurrency()));
+
+    // Le parallélisme est entre les images : les fonctions d'OpenCV restent dans le thread qui les appelle.
+    cv::setNumThreads(0);
+
+    // Vérifications faites une seule fois, avant de lancer les threads.
+    {
+        DetecteurVisage essai;
+        if (!essai.charger(options.dossierCascades + "/haarcascade_frontalface_default.xml", options.dossierCascades + "/haarcascade_smile.xml",
+                           options.dossierCascades + "/haarcascade_lefteye_2splits.xml", options.dossierCascades + "/haarcascade_righteye_2splits.xml")){
+            fprintf(stderr, "%s : cascade de visage introuvable\n", options.dossierCascades.c_str());
+            return 1;
+        }
+        if (options.internes && !essai.activerCascadesInternes()){
+            fprintf(stderr, "cascades illisibles par l'évaluateur interne, utilisation de detectMultiScale\n");
+            options.internes = false;
+        }
+        fprintf(stderr, "%s\n", essai.rapportCascades().c_str());
+        EstimateurExpression estimateur;
+        if (!options.modelePoints.empty() && !estimateur.charger(options.modelePoints)){
+            fprintf(stderr, "%s : modèle de points illisible, utilisation des cascades sourire / yeux\n", options.modelePoints.c_str());
+            options.modelePoints.clear();
+        }
+    }
+    bool pretraitementVectorise = verifierPretraitement();
+
+    std::vector<Morceau> morceaux;
+    if (!decouper(videos, options.imagesParMorceau, morceaux))
+        return 1;
+
+    std::vector<double> debits;
+    for (size_t t = 0; t < options.threads.size(); t++)
+        debits.push_back(traiterLot(options, options.threads[t], pretraitementVectorise, videos, morceaux));
+    if (debits.size() > 1){
+        printf("%8s %10s %12s %10s\n", "threads", "images/s", "accélération", "efficacité");
+        for (size_t t = 0; t < debits.size(); t++){
+            // accélération et efficacité par rapport au premier nombre de threads donné.
+            double acceleration = debits[0] > 0 ? debits[t] / debits[0] : 0.;
+            printf("%8d %10.1f %11.2fx %9.0f%%\n", options.threads[t], debits[t], acceleration,
+                   100. * acceleration * options.threads[0] / options.threads[t]);
+        }
+    }
+
+    if (!ecrireResultats(options.sortie, videos, morceaux))
+        return 1;
+
+    int echoues = 0;
+    for (size_t i = 0; i < morceaux.size(); i++){
+        if (morceaux[i].lu)
+            continue;
+        const Morceau &m = morceaux[i];
+        if (m.derniere < 0)
+            fprintf(stderr, "morceau illisible : %s, images %d à la fin (%zu lues)\n", videos[m.video].c_str(), m.premiere, m.resultats.size());
+        else
+            fprintf(stderr, "morceau illisible : %s, images %d à %d (%zu lues)\n", videos[m.video].c_str(), m.premiere, m.derniere, m.resultats.size());
+        echoues++;
+    }
+    if (echoues > 0){
+        fprintf(stderr, "%d morceaux sur %zu illisibles : leurs images manquent dans %s\n", echoues, morceaux.size(), options.sortie.c_str());
+        return 3;
+    }
+    return 0;
+}